@@ -15,8 +15,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 extern NSString *PSMSceneCollectionKey;
 extern NSString *PTZ_BatchDelayKey;
+extern NSString *PTZ_BatchSettlePollingKey;
+extern NSString *PTZ_LogCommandTimingKey;
+extern NSString *PTZ_ExportConcurrencyKey;
 
-void PTZLog(NSString *format, ...);
+FOUNDATION_EXPORT void PTZLog(NSString *format, ...);
 
 @interface AppDelegate : PTZPrefObject <NSApplicationDelegate, PSMOBSWebSocketDelegate, NSWindowRestoration, NSOpenSavePanelDelegate>
 
@@ -24,6 +24,7 @@
 #import "PTZPrefCamera.h"
 #import "PTZPacketSenderCamera.h"
 #import "PTZCameraConfig.h"
+#import "PTZIniParser.h"
 #import "PTZProgressGroup.h"
 #import "PSMOBSWebSocketController.h"
 #import "PSMAppPreferencesWindowController.h"
@@ -31,6 +32,9 @@
 
 NSString *PSMSceneCollectionKey = @"SceneCollections";
 NSString *PTZ_BatchDelayKey = @"BatchDelay";
+NSString *PTZ_BatchSettlePollingKey = @"BatchSettlePolling";
+NSString *PTZ_LogCommandTimingKey = @"LogCommandTiming";
+NSString *PTZ_ExportConcurrencyKey = @"ExportConcurrency";
 
 
 static NSString *PSMAutosavePrefsWindowID = @"prefswindow";
@@ -52,6 +56,9 @@ static NSString *PSMAutosaveCameraCollectionWindowID = @"cameracollectionwindow"
 @property IBOutlet NSView *exportAccessoryView;
 @property NSInteger exportStartIndex, exportEndIndex;
 @property (strong) NSMutableArray *exportCameras;
+// Cameras that haven't started exporting yet; at most ExportConcurrency run at once.
+@property (strong) NSMutableArray *pendingExportCameras;
+@property NSInteger runningExportCount;
 @property PTZProgressGroup *progress;
 @property (strong) IBOutlet NSWindow *progressSheet;
 @property BOOL batchOperationInProgress;
@@ -67,6 +74,9 @@ PREF_VALUE_BOOL_ACCESSORS(exportAllRanges, ExportAllRanges)
     [[NSUserDefaults standardUserDefaults] registerDefaults:
      @{PSMOBSAutoConnect:@(NO),
        PTZ_BatchDelayKey:@(1),
+       PTZ_BatchSettlePollingKey:@(NO),
+       PTZ_LogCommandTimingKey:@(NO),
+       PTZ_ExportConcurrencyKey:@(4),
        @"exportAllRanges":@(NO),
        PSMOBSURLString:@"ws://localhost:4455",
        @"WebSockets":@"WebSockets", // Prefs window textfield "Null Placeholder" key.
@@ -120,7 +130,8 @@ PREF_VALUE_BOOL_ACCESSORS(exportAllRanges, ExportAllRanges)
 
 
 - (void)applicationWillTerminate:(NSNotification *)aNotification {
-    // Insert code here to tear down your application
+    // Settings edits are written after a short delay; don't lose the last ones.
+    [PTZIniParser commitAll];
 }
 
 
@@ -410,22 +421,46 @@ PREF_VALUE_BOOL_ACCESSORS(exportAllRanges, ExportAllRanges)
         [camera prepareForProgressOperationWith:indexSet];
     }
     self.progress = [PTZProgressGroup new];
+    self.progress.unitsPerSecondFormat = NSLocalizedString(@"%.1f scenes/sec", @"Export progress throughput");
+    // Add every camera up front so the group's total is right even while some are still waiting their turn.
+    for (PTZPacketSenderCamera *camera in self.exportCameras) {
+        [self.progress addChild:camera.progress];
+    }
     [self.progressSheet orderFront:nil];
     self.batchOperationInProgress = YES;
-    for (PTZPacketSenderCamera *camera in self.exportCameras) {
-        [camera doBackupWithParent:self.progress onDone:^(BOOL success) {
-            if (success) {
-                if (self.progress.finished) {
-                    self.batchOperationInProgress = NO;
-                    [self progressIsFinished];
-                }
-            } else {
-                self.batchOperationInProgress = NO;
-            }
-        }];
+    self.pendingExportCameras = [self.exportCameras mutableCopy];
+    self.runningExportCount = 0;
+    NSInteger maxConcurrent = MAX(1, [[NSUserDefaults standardUserDefaults] integerForKey:PTZ_ExportConcurrencyKey]);
+    for (NSInteger i = 0; i < maxConcurrent; i++) {
+        [self startNextExport];
     }
 }
 
+- (void)startNextExport {
+    PTZPacketSenderCamera *camera = [self.pendingExportCameras firstObject];
+    if (camera == nil) {
+        return;
+    }
+    [self.pendingExportCameras removeObjectAtIndex:0];
+    self.runningExportCount++;
+    [camera doBackupWithParent:self.progress onDone:^(BOOL success) {
+        self.runningExportCount--;
+        if (!success) {
+            // Don't start any more; the ones already running are still writing their files.
+            [self.pendingExportCameras removeAllObjects];
+        }
+        if (success && self.progress.finished) {
+            PTZLog(@"Export finished, %.1f scenes/sec", self.progress.unitsPerSecond);
+            self.batchOperationInProgress = NO;
+            [self progressIsFinished];
+        } else if (self.pendingExportCameras.count > 0) {
+            [self startNextExport];
+        } else if (self.runningExportCount == 0) {
+            self.batchOperationInProgress = NO;
+        }
+    }];
+}
+
 - (IBAction)exportAllCameras:(id)sender {
     if (self.batchOperationInProgress) {
         return;
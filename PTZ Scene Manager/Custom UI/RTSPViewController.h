@@ -21,6 +21,32 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)setStaticImage:(NSImage *)image;
 
+// The next frame the stream shows, scaled down to at most width pixels across and encoded as
+// JPEG off the main thread. Returns NO, without calling doneBlock, unless live video is
+// playing. doneBlock is called on the main thread, with nil if no frame turns up in time.
+- (BOOL)captureSnapshotWithMaxWidth:(CGFloat)width onDone:(void (^)(NSData * _Nullable data, NSImage * _Nullable image))doneBlock;
+
+// 0 for live video. Otherwise the stream is opened every this many seconds for one picture and
+// closed again, which costs a fraction of decoding it all.
+@property (nonatomic) NSTimeInterval refreshInterval;
+// Set while the window is covered up. The stream stays open, but only a picture every couple
+// of seconds is made until it's uncovered.
+@property (nonatomic) BOOL occluded;
+
+// Frames from the decoder thread since the video was opened. Skipped frames were decoded
+// while the view still had one to show, so no image was made; dropped frames had an image,
+// but a newer one was ready first.
+@property (readonly) NSUInteger framesDecoded;
+@property (readonly) NSUInteger framesSkipped;
+@property (readonly) NSUInteger framesDisplayed;
+@property (readonly) NSUInteger framesDropped;
+// From decoded to shown.
+@property (readonly) double averageFrameLatencyMS;
+@property (readonly) double maxFrameLatencyMS;
+// Of one core, by the decoder thread since the video was opened. Doesn't include any threads
+// the codec has of its own.
+@property (readonly) double decoderCPUPercent;
+
 @end
 
 @interface RTSPView : NSView
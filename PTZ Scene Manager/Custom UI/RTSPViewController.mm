@@ -0,0 +1,641 @@
+//
+//  RTSPViewController.mm
+//  RtspClient
+//
+//  Created by Lee Ann Rucker on 1/24/23.
+//
+/*
+ Different cameras have different streaming URL formats, some are http instead of rtsp.  https://www.ptzcontroller.com/2022/05/control-ptz-network-camera-with-ptz-controller/
+     ex: http://192.168.1.17/-wvhttp-01-/video.cgi?=vjpg:640×480:3:10000
+    maybe tossing it in a webkit view will work.
+  Sony
+     https://community.boschsecurity.com/t5/Security-Video/Which-are-the-RTSP-request-URLs-of-the-SONY-cameras-for-getting/ta-p/22057
+   rtsp://IP/media/video1
+ or for Stream 2: rtsp://IP/media/video2
+ or in case credentials are needed: rtsp://user:password@IP/media/video1
+ */
+
+#import "RTSPViewController.h"
+#import "RTSPPlayer.h"
+#import "AppDelegate.h"
+
+#include "framering.hpp"
+#include "decodescheduler.hpp"
+
+#include <atomic>
+
+@class RTSPDecoder;
+
+// Nobody can see a covered window's video, so it's only kept roughly up to date. The stream
+// stays open, so it's there as soon as the window is uncovered.
+static const NSTimeInterval RTSPOccludedFrameInterval = 2;
+// How many frame intervals a decoder can hold its turn for. A read that takes longer is
+// waiting on a camera that's stalled or gone, not decoding.
+static const double RTSPTurnLeaseFrames = 3;
+// A live stream has a new frame many times in this long; one that doesn't has stalled.
+static const NSTimeInterval RTSPSnapshotFrameTimeout = 0.5;
+
+typedef void (^RTSPFrameWaiter)(NSImage * _Nullable image);
+
+@interface RTSPViewController () {
+    framering::OutputSize outputSize;
+}
+
+@property IBOutlet NSImageView *imageView;
+@property RTSPDecoder *decoder;
+@property NSString *videoURLString;
+@property BOOL ended;
+@property BOOL paused;
+@property BOOL hidden;
+@property (nullable, copy) void (^openDoneBlock)(BOOL);
+// Snapshots waiting for the next frame.
+@property NSMutableArray<RTSPFrameWaiter> *frameWaiters;
+
+- (void)viewDidHide;
+- (void)viewDidUnhide;
+- (void)viewDidEndLiveResize;
+
+- (void)decoder:(RTSPDecoder *)decoder didOpen:(BOOL)success;
+- (void)decoderHasFrames:(RTSPDecoder *)decoder;
+- (void)decoderDidEnd:(RTSPDecoder *)decoder;
+
+@end
+
+// The thread that reads and decodes one stream. It owns the player; nothing else touches it
+// once it's open. Frames go into the ring as fast as the stream delivers them, and the
+// controller takes the newest one on the main thread. Decoding a live stream takes turns with
+// every other decoder in the process.
+@interface RTSPDecoder : NSObject {
+    // The default few frames is enough to ride out a slow one on either side.
+    framering::Ring<NSImage *> frames;
+    framering::Pacer pacer;
+    decodescheduler::Cadence cadence;
+    // Set while a main queue block is on its way to take a frame.
+    std::atomic<bool> displayScheduled;
+    // Guarded by condition.
+    BOOL wanted;
+    BOOL stopped;
+    NSTimeInterval refreshInterval;
+    // Set when refreshInterval changes, to cut short a wait for the next refresh.
+    BOOL woken;
+    framering::Clock::time_point startTime;
+    // The decoder thread's CPU time so far, updated once a frame.
+    std::atomic<double> cpuSeconds;
+    // Decoder thread: when a frame was last converted and pushed.
+    framering::Clock::time_point lastPushed;
+}
+
+// What size to scale frames to. Set from the main thread, only when it's worth a new
+// scaler; read on the decoder thread.
+@property (atomic) NSSize outputSize;
+// 0 to convert every frame the view can take. Otherwise the stream is still decoded as it
+// comes, but only one frame this many seconds is made into an image.
+@property (atomic) NSTimeInterval minFrameInterval;
+@property (readonly) BOOL opened;
+
+- (instancetype)initWithURL:(NSString *)urlString controller:(RTSPViewController *)controller;
+- (void)start;
+// Paused or hidden: the thread stops reading until it's wanted again.
+- (void)setWanted:(BOOL)wanted;
+// 0 to decode the stream as it comes. Otherwise the stream is only open long enough to get
+// one picture every this many seconds.
+@property NSTimeInterval refreshInterval;
+- (void)stop;
+
+// Main thread.
+- (nullable NSImage *)takeNewestFrame;
+- (framering::Stats)stats;
+// Percent of a core the decoder thread has used since it started.
+- (double)cpuPercent;
+
+@end
+
+@interface RTSPDecoder ()
+
+@property NSString *urlString;
+@property (weak) RTSPViewController *controller;
+@property NSThread *thread;
+@property NSCondition *condition;
+@property (readwrite) BOOL opened;
+
+@end
+
+@implementation RTSPDecoder
+
+- (instancetype)initWithURL:(NSString *)urlString controller:(RTSPViewController *)controller {
+    self = [super init];
+    if (self) {
+        displayScheduled = false;
+        cpuSeconds = 0;
+        _urlString = urlString;
+        _controller = controller;
+        _condition = [NSCondition new];
+    }
+    return self;
+}
+
+- (void)start {
+    startTime = framering::Clock::now();
+    // The thread keeps the decoder alive until it's done; the controller only has to let go.
+    self.thread = [[NSThread alloc] initWithTarget:self selector:@selector(decodeLoop) object:nil];
+    self.thread.name = [NSString stringWithFormat:@"RTSPDecoder_0x%p", self];
+    self.thread.qualityOfService = NSQualityOfServiceUserInteractive;
+    [self.thread start];
+}
+
+- (void)setWanted:(BOOL)isWanted {
+    [self.condition lock];
+    wanted = isWanted;
+    if (isWanted) {
+        pacer.reset();
+    }
+    [self.condition signal];
+    [self.condition unlock];
+    if (!isWanted) {
+        // Whatever's waiting would be stale by the time it's shown.
+        frames.clear();
+    }
+}
+
+- (void)setRefreshInterval:(NSTimeInterval)interval {
+    [self.condition lock];
+    if (interval != refreshInterval) {
+        refreshInterval = interval;
+        woken = YES;
+        [self.condition signal];
+    }
+    [self.condition unlock];
+}
+
+- (NSTimeInterval)refreshInterval {
+    [self.condition lock];
+    NSTimeInterval interval = refreshInterval;
+    [self.condition unlock];
+    return interval;
+}
+
+- (void)stop {
+    [self.condition lock];
+    stopped = YES;
+    [self.condition signal];
+    [self.condition unlock];
+    frames.clear();
+}
+
+// Waits until the decoder is wanted, or until the date if there is one or the refresh
+// interval changes. Returns NO if it's been stopped. Locks condition, which guards wanted,
+// stopped, refreshInterval and woken.
+- (BOOL)waitUntilWanted:(NSDate *)date {
+    [self.condition lock];
+    while (!stopped && (!wanted || (date != nil && !woken))) {
+        if (date == nil) {
+            [self.condition wait];
+        } else if (![self.condition waitUntilDate:date]) {
+            break;
+        }
+    }
+    if (date != nil) {
+        woken = NO;
+    }
+    BOOL running = !stopped;
+    [self.condition unlock];
+    return running;
+}
+
+- (nullable RTSPPlayer *)openPlayer:(NSSize)size {
+    RTSPPlayer *player = [[RTSPPlayer alloc] initWithVideo:self.urlString usesTcp:YES];
+    if (player != nil) {
+        player.outputWidth = size.width;
+        player.outputHeight = size.height;
+        [player seekTime:0.0];
+    }
+    return player;
+}
+
+- (void)decodeLoop {
+    NSSize size = self.outputSize;
+    RTSPPlayer *player = [self openPlayer:size];
+    self.opened = (player != nil);
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.controller decoder:self didOpen:self.opened];
+    });
+    if (player == nil) {
+        return;
+    }
+    // Seconds between frames, going by their timestamps.
+    double lastPTS = 0, frameInterval = 1.0 / 30;
+    while ([self waitUntilWanted:nil]) {
+        @autoreleasepool {
+            cpuSeconds = framering::threadCPUSeconds();
+            NSTimeInterval interval = self.refreshInterval;
+            if (player == nil) {
+                // Refreshing: a new connection for each picture. A new decoder starts at the
+                // next keyframe, so the first picture is a whole one and nothing before it
+                // gets decoded.
+                size = self.outputSize;
+                player = [self openPlayer:size];
+                pacer.reset();
+                cadence.reset();
+                if (player == nil) {
+                    dispatch_async(dispatch_get_main_queue(), ^{
+                        [self.controller decoderDidEnd:self];
+                    });
+                    break;
+                }
+            }
+            NSSize newSize = self.outputSize;
+            if (!NSEqualSizes(newSize, size)) {
+                // Each of these can mean a new scaler, so only when they change.
+                size = newSize;
+                player.outputWidth = size.width;
+                player.outputHeight = size.height;
+            }
+            // Live, wait for the next frame to get here before taking a turn to decode it. A
+            // picture every so often, or the first one, can wait any length of time for its
+            // frame, so it doesn't take a turn at all.
+            decodescheduler::Scheduler::Turn turn;
+            if (interval == 0 && cadence.known()) {
+                framering::Clock::time_point due = cadence.due(lastPTS + frameInterval);
+                double wait = std::chrono::duration<double>(due - framering::Clock::now()).count();
+                if (wait > 0 && ![self waitUntilWanted:[NSDate dateWithTimeIntervalSinceNow:wait]]) {
+                    break;
+                }
+                turn = decodescheduler::Scheduler::shared().wait(due, [self turnLease:frameInterval]);
+            }
+            // Blocks until the stream has a frame.
+            framering::Clock::time_point stepStart = framering::Clock::now();
+            if (![player stepFrame]) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [self.controller decoderDidEnd:self];
+                });
+                break;
+            }
+            double pts = player.currentTime;
+            if (interval == 0) {
+                cadence.stepped(pts, stepStart, framering::Clock::now());
+            }
+            framering::Clock::duration delay = pacer.delay(pts);
+            if (delay > framering::Clock::duration::zero()) {
+                // Nobody else needs to wait while a file waits for its time.
+                bool hadTurn = (bool)turn;
+                turn.release();
+                NSDate *due = [NSDate dateWithTimeIntervalSinceNow:std::chrono::duration<double>(delay).count()];
+                if (![self waitUntilWanted:due]) {
+                    break;
+                }
+                if (hadTurn) {
+                    turn = decodescheduler::Scheduler::shared().wait(framering::Clock::now(), [self turnLease:frameInterval]);
+                }
+            }
+            if (interval > 0) {
+                // That's the picture; let the camera go until it's time for the next one.
+                NSDate *next = [NSDate dateWithTimeIntervalSinceNow:interval];
+                frames.push(pts, player.currentImage);
+                player = nil;
+                if (!displayScheduled.exchange(true)) {
+                    dispatch_async(dispatch_get_main_queue(), ^{
+                        [self.controller decoderHasFrames:self];
+                    });
+                }
+                if (![self waitUntilWanted:next]) {
+                    break;
+                }
+                continue;
+            }
+            double step = pts - lastPTS;
+            lastPTS = pts;
+            if (step > 0 && step < framering::Pacer::MaxDrift) {
+                frameInterval += (step - frameInterval) / 8;
+            }
+            // The frame had to be decoded, but if the display hasn't taken the last one yet,
+            // there's no point scaling it and making an image nobody will see. Unless the last
+            // one has been waiting long enough that the display would be a frame behind.
+            std::chrono::duration<double> maxWait(frameInterval * 1.5);
+            std::chrono::duration<double> minInterval(self.minFrameInterval);
+            framering::Clock::time_point now = framering::Clock::now();
+            if (!frames.needsFrame(std::chrono::duration_cast<framering::Clock::duration>(maxWait), now) || now - lastPushed < minInterval) {
+                frames.skip();
+                continue;
+            }
+            // Scaling and making the image happen here too, so the main thread only shows it.
+            frames.push(pts, player.currentImage);
+            lastPushed = now;
+            if (!displayScheduled.exchange(true)) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [self.controller decoderHasFrames:self];
+                });
+            }
+        }
+    }
+    frames.clear();
+}
+
+- (framering::Clock::duration)turnLease:(double)frameInterval {
+    std::chrono::duration<double> lease(frameInterval * RTSPTurnLeaseFrames);
+    return std::chrono::duration_cast<framering::Clock::duration>(lease);
+}
+
+- (nullable NSImage *)takeNewestFrame {
+    // Cleared first, so a frame pushed while this one is taken schedules another look.
+    displayScheduled = false;
+    NSImage *image = nil;
+    frames.takeNewest(image);
+    return image;
+}
+
+- (framering::Stats)stats {
+    return frames.stats();
+}
+
+- (double)cpuPercent {
+    double elapsed = std::chrono::duration<double>(framering::Clock::now() - startTime).count();
+    return elapsed > 0 ? cpuSeconds / elapsed * 100 : 0;
+}
+
+@end
+
+// At most maxWidth across, keeping its shape; never scaled up.
+static CGImageRef RTSPCreateScaledImage(CGImageRef image, CGFloat maxWidth)
+{
+    size_t width = CGImageGetWidth(image), height = CGImageGetHeight(image);
+    if (width == 0 || height == 0) {
+        return NULL;
+    }
+    if (width > maxWidth) {
+        height = MAX((size_t)round(height * maxWidth / width), (size_t)1);
+        width = (size_t)maxWidth;
+    }
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpace, kCGImageAlphaNoneSkipLast);
+    CGColorSpaceRelease(colorSpace);
+    if (context == NULL) {
+        return NULL;
+    }
+    CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), image);
+    CGImageRef scaled = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    return scaled;
+}
+
+@implementation RTSPViewController
+
+- (void)dealloc {
+    [_decoder stop];
+}
+
+- (void)openRTSPURL:(NSString *)urlString onDone:(void (^)(BOOL))doneBlock {
+    if (urlString == nil) {
+        if (doneBlock) {
+            doneBlock(NO);
+        }
+        return;
+    }
+    // DEBUG urlString = @"rtsp://wowzaec2demo.streamlock.net/vod/mp4:BigBuckBunny_115k.mp4";
+    self.videoURLString = urlString;
+    [self startVideo:doneBlock];
+}
+
+- (void)startVideo:(void (^)(BOOL))doneBlock {
+    [self.decoder stop];
+    self.ended = NO;
+    RTSPDecoder *decoder = [[RTSPDecoder alloc] initWithURL:self.videoURLString controller:self];
+    [self updateOutputSize];
+    decoder.outputSize = NSMakeSize(outputSize.width(), outputSize.height());
+    decoder.refreshInterval = self.refreshInterval;
+    decoder.minFrameInterval = self.occluded ? RTSPOccludedFrameInterval : 0;
+    self.decoder = decoder;
+    self.openDoneBlock = doneBlock;
+    [decoder start];
+}
+
+- (void)decoder:(RTSPDecoder *)decoder didOpen:(BOOL)success {
+    if (decoder != self.decoder) {
+        return;
+    }
+    if (success) {
+        [self resumeVideo];
+    }
+    void (^doneBlock)(BOOL) = self.openDoneBlock;
+    self.openDoneBlock = nil;
+    if (doneBlock) {
+        doneBlock(success);
+    }
+}
+
+- (void)decoderHasFrames:(RTSPDecoder *)decoder {
+    if (decoder != self.decoder) {
+        return;
+    }
+    NSImage *image = [decoder takeNewestFrame];
+    [self updateOutputSize];
+    if (image != nil && !self.paused) {
+        self.imageView.image = image;
+        [self finishFrameWaitersWithImage:image];
+    }
+}
+
+- (void)updateOutputSize {
+    NSSize size = self.imageView.frame.size;
+    if (outputSize.update((int)size.width, (int)size.height, self.imageView.inLiveResize)) {
+        self.decoder.outputSize = NSMakeSize(outputSize.width(), outputSize.height());
+    }
+}
+
+- (void)decoderDidEnd:(RTSPDecoder *)decoder {
+    if (decoder != self.decoder) {
+        return;
+    }
+    self.ended = YES;
+    [self finishFrameWaitersWithImage:nil];
+    [self logFrameStats];
+}
+
+- (void)setRefreshInterval:(NSTimeInterval)interval {
+    _refreshInterval = MAX(interval, 0);
+    self.decoder.refreshInterval = _refreshInterval;
+}
+
+- (void)setOccluded:(BOOL)occluded {
+    _occluded = occluded;
+    self.decoder.minFrameInterval = occluded ? RTSPOccludedFrameInterval : 0;
+}
+
+- (BOOL)hasVideo {
+    return self.decoder.opened;
+}
+
+- (void)updateDecoding {
+    BOOL wanted = !self.paused && !self.hidden;
+    [self.decoder setWanted:wanted];
+    if (!wanted) {
+        [self finishFrameWaitersWithImage:nil];
+    }
+}
+
+- (void)pauseVideo {
+    if (self.decoder.opened && !self.paused) {
+        [self logFrameStats];
+    }
+    self.paused = YES;
+    [self updateDecoding];
+}
+
+- (void)resumeVideo {
+    self.paused = NO;
+    [self updateDecoding];
+}
+
+- (void)toggleVideoPaused {
+    if (self.ended) {
+        [self startVideo:nil];
+    } else if (self.paused) {
+        [self resumeVideo];
+    } else {
+        [self pauseVideo];
+    }
+}
+
+// Start and stop video without changing self.paused.
+- (void)viewDidHide {
+    self.hidden = YES;
+    [self updateDecoding];
+}
+- (void)viewDidUnhide {
+    self.hidden = NO;
+    [self updateDecoding];
+}
+
+- (void)viewDidEndLiveResize {
+    [self updateOutputSize];
+}
+
+- (BOOL)validateTogglePaused:(NSMenuItem *)menu {
+    BOOL hasVideo = [self hasVideo];
+    if (self.ended) {
+        menu.title = NSLocalizedString(@"Restart Video", @"Restart video menu item");
+    } else if (self.paused && hasVideo) {
+        menu.title = NSLocalizedString(@"Resume Video", @"Resume video menu item");
+    } else {
+        menu.title = NSLocalizedString(@"Pause Video", @"Pause video menu item");
+    }
+    return hasVideo;
+}
+
+- (void)setStaticImage:(NSImage *)image {
+    if ([self hasVideo] && !self.paused && image != nil) {
+        [self pauseVideo];
+    }
+    self.imageView.image = image;
+}
+
+#pragma mark snapshots
+
+- (BOOL)captureSnapshotWithMaxWidth:(CGFloat)width onDone:(void (^)(NSData *, NSImage *))doneBlock {
+    // A picture every few seconds could be most of that old, and a paused or hidden view has
+    // nothing coming.
+    if (![self hasVideo] || self.ended || self.paused || self.hidden || self.occluded || self.refreshInterval > 0) {
+        return NO;
+    }
+    // Not the frame on screen, which might be from before whatever the caller just did, but the
+    // next one, which is at most a frame away.
+    RTSPFrameWaiter waiter = ^(NSImage *image) {
+        CGImageRef cgImage = [image CGImageForProposedRect:NULL context:nil hints:nil];
+        if (cgImage == NULL) {
+            doneBlock(nil, nil);
+            return;
+        }
+        CGImageRetain(cgImage);
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            NSData *data = nil;
+            NSImage *snapshot = nil;
+            CGImageRef scaled = RTSPCreateScaledImage(cgImage, width);
+            CGImageRelease(cgImage);
+            if (scaled != NULL) {
+                NSBitmapImageRep *rep = [[NSBitmapImageRep alloc] initWithCGImage:scaled];
+                data = [rep representationUsingType:NSBitmapImageFileTypeJPEG properties:@{NSImageCompressionFactor:@(0.8)}];
+                if (data != nil) {
+                    snapshot = [[NSImage alloc] initWithCGImage:scaled size:NSZeroSize];
+                }
+                CGImageRelease(scaled);
+            }
+            dispatch_async(dispatch_get_main_queue(), ^{
+                doneBlock(data, snapshot);
+            });
+        });
+    };
+    if (self.frameWaiters == nil) {
+        self.frameWaiters = [NSMutableArray array];
+    }
+    [self.frameWaiters addObject:waiter];
+    __weak typeof(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(RTSPSnapshotFrameTimeout * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        typeof(self) strongSelf = weakSelf;
+        if (strongSelf != nil && [strongSelf.frameWaiters indexOfObjectIdenticalTo:waiter] != NSNotFound) {
+            [strongSelf.frameWaiters removeObjectIdenticalTo:waiter];
+            waiter(nil);
+        }
+    });
+    return YES;
+}
+
+- (void)finishFrameWaitersWithImage:(nullable NSImage *)image {
+    if (self.frameWaiters.count == 0) {
+        return;
+    }
+    NSArray<RTSPFrameWaiter> *waiters = self.frameWaiters;
+    self.frameWaiters = nil;
+    for (RTSPFrameWaiter waiter in waiters) {
+        waiter(image);
+    }
+}
+
+- (NSUInteger)framesDecoded {
+    return (NSUInteger)[self.decoder stats].decoded;
+}
+
+- (NSUInteger)framesDisplayed {
+    return (NSUInteger)[self.decoder stats].displayed;
+}
+
+- (NSUInteger)framesSkipped {
+    return (NSUInteger)[self.decoder stats].skipped;
+}
+
+- (NSUInteger)framesDropped {
+    return (NSUInteger)[self.decoder stats].dropped;
+}
+
+- (double)averageFrameLatencyMS {
+    return [self.decoder stats].averageLatencyMS();
+}
+
+- (double)maxFrameLatencyMS {
+    return [self.decoder stats].maxLatencyMS();
+}
+
+- (double)decoderCPUPercent {
+    return [self.decoder cpuPercent];
+}
+
+- (void)logFrameStats {
+    framering::Stats stats = [self.decoder stats];
+    PTZLog(@"RTSP %@: %llu frames decoded, %llu skipped, %llu shown, %llu dropped, latency %.2f ms average, %.2f ms max, decoder CPU %.1f%%",
+           self.videoURLString, stats.decoded, stats.skipped, stats.displayed, stats.dropped, stats.averageLatencyMS(), stats.maxLatencyMS(), [self.decoder cpuPercent]);
+}
+
+@end
+
+@implementation RTSPView
+- (void)viewDidHide {
+    [self.delegate viewDidHide];
+}
+- (void)viewDidUnhide {
+    [self.delegate viewDidUnhide];
+}
+- (void)viewDidEndLiveResize {
+    [super viewDidEndLiveResize];
+    [self.delegate viewDidEndLiveResize];
+}
+
+@end
@@ -0,0 +1,66 @@
+//
+//  PSMOBSMessage.h
+//  PTZ Scene Manager
+//
+// An obs-websocket message, already decoded on the socket thread from JSON or MessagePack.
+// Only the fields PSMOBSWebSocketController handles are kept; anything else in the message
+// is skipped. Missing or empty strings are nil.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface PSMOBSSceneItem : NSObject
+
+@property (nullable) NSString *sourceName;
+@property NSInteger sceneItemId;
+@property BOOL sceneItemEnabled;
+// sceneItemTransform
+@property CGFloat positionX, positionY;
+@property CGFloat width, height;
+@property CGFloat sourceWidth, sourceHeight;
+@property CGFloat boundsWidth, boundsHeight;
+@property CGFloat cropLeft, cropRight, cropTop, cropBottom;
+@property NSInteger alignment;
+@property (nullable) NSString *boundsType;
+
+@end
+
+@interface PSMOBSMessage : NSObject
+
+@property NSInteger op;
+@property (nullable) NSString *eventType;
+@property BOOL hasEventIntent;
+@property NSInteger eventIntent;
+@property (nullable) NSString *requestType;
+@property (nullable) NSString *requestId;
+@property BOOL requestResult;
+// Hello's challenge and salt, as OBSAuth wants them.
+@property (nullable) NSDictionary<NSString *, NSString *> *authentication;
+// From eventData or responseData.
+@property (nullable) NSString *sceneName;
+@property (nullable) NSString *currentProgramSceneName, *currentPreviewSceneName;
+@property CGFloat baseWidth, baseHeight;
+@property (nullable) NSArray<NSString *> *inputNames;
+@property (nullable) NSArray<PSMOBSSceneItem *> *sceneItems;
+// SceneItemEnableStateChanged and SceneItemTransformChanged: the item, with only the fields
+// the event has filled in.
+@property (nullable) PSMOBSSceneItem *sceneItem;
+// GetSourceScreenshot, decoded from base64.
+@property (nullable) NSData *imageData;
+// RequestBatchResponse: a RequestResponse message for each request, in the order they were sent.
+@property (nullable) NSArray<PSMOBSMessage *> *results;
+
+// Returns nil if the bytes aren't a JSON object. Safe on any thread; nothing in the
+// result refers back to bytes.
++ (nullable instancetype)messageWithJSONBytes:(const void *)bytes length:(size_t)length;
+// The same for a message from the obswebsocket.msgpack subprotocol.
++ (nullable instancetype)messageWithMessagePackBytes:(const void *)bytes length:(size_t)length;
+
+// What NSJSONSerialization would write for object, as MessagePack: dictionaries, arrays,
+// strings, numbers, booleans and NSNull. Returns nil for anything else.
++ (nullable NSData *)messagePackDataWithJSONObject:(id)object;
+
+@end
+
+NS_ASSUME_NONNULL_END
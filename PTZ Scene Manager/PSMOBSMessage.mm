@@ -0,0 +1,179 @@
+//
+//  PSMOBSMessage.mm
+//  PTZ Scene Manager
+//
+
+#import "PSMOBSMessage.h"
+#include "obsmessage.hpp"
+#include "obsbase64.hpp"
+
+static NSString *PSMStringFrom(const std::string& s) {
+    if (s.empty()) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:s.data() length:s.size() encoding:NSUTF8StringEncoding];
+}
+
+// Decodes straight out of the receive buffer into a pooled buffer; the NSData hands the
+// buffer back to the pool when the image is done with it.
+static NSData *PSMDecodeImageData(const char *uri, size_t length) {
+    size_t base64Length = 0;
+    const char *base64 = obsbase64::dataURIPayload(uri, length, base64Length);
+    obsbase64::BufferPool& pool = obsbase64::BufferPool::shared();
+    size_t capacity = 0;
+    uint8_t *buffer = pool.acquire(obsbase64::decodeBufferSize(base64Length), capacity);
+    size_t decodedLength = 0;
+    if (buffer == nullptr || !obsbase64::decode(base64, base64Length, buffer, decodedLength) || decodedLength == 0) {
+        pool.release(buffer, capacity);
+        return nil;
+    }
+    return [[NSData alloc] initWithBytesNoCopy:buffer length:decodedLength deallocator:^(void *bytes, NSUInteger) {
+        obsbase64::BufferPool::shared().release((uint8_t *)bytes, capacity);
+    }];
+}
+
+static PSMOBSSceneItem *PSMSceneItemFrom(const obsmessage::SceneItem& src) {
+    const obsmessage::SceneItemTransform& xform = src.sceneItemTransform;
+    PSMOBSSceneItem *item = [PSMOBSSceneItem new];
+    item.sourceName = PSMStringFrom(src.sourceName);
+    item.sceneItemId = (NSInteger)src.sceneItemId;
+    item.sceneItemEnabled = src.sceneItemEnabled;
+    item.positionX = xform.positionX;
+    item.positionY = xform.positionY;
+    item.width = xform.width;
+    item.height = xform.height;
+    item.sourceWidth = xform.sourceWidth;
+    item.sourceHeight = xform.sourceHeight;
+    item.boundsWidth = xform.boundsWidth;
+    item.boundsHeight = xform.boundsHeight;
+    item.cropLeft = xform.cropLeft;
+    item.cropRight = xform.cropRight;
+    item.cropTop = xform.cropTop;
+    item.cropBottom = xform.cropBottom;
+    item.alignment = xform.alignment;
+    item.boundsType = PSMStringFrom(xform.boundsType);
+    return item;
+}
+
+static BOOL PSMWriteMessagePack(id object, obsmessage::MsgPackWriter& writer) {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSDictionary *dict = object;
+        writer.map([dict count]);
+        for (id key in dict) {
+            if (![key isKindOfClass:[NSString class]] || !PSMWriteMessagePack(key, writer) || !PSMWriteMessagePack(dict[key], writer)) {
+                return NO;
+            }
+        }
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        NSArray *array = object;
+        writer.array([array count]);
+        for (id item in array) {
+            if (!PSMWriteMessagePack(item, writer)) {
+                return NO;
+            }
+        }
+    } else if ([object isKindOfClass:[NSString class]]) {
+        const char *str = [object UTF8String];
+        if (str == NULL) {
+            return NO;
+        }
+        writer.string(str, strlen(str));
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        // @YES and @NO are NSNumbers too; OBS wants them as booleans.
+        CFTypeRef number = (__bridge CFTypeRef)object;
+        if (CFGetTypeID(number) == CFBooleanGetTypeID()) {
+            writer.boolean([object boolValue]);
+        } else if (CFNumberIsFloatType((CFNumberRef)number)) {
+            writer.real([object doubleValue]);
+        } else {
+            writer.integer([object longLongValue]);
+        }
+    } else if (object == [NSNull null]) {
+        writer.nil();
+    } else {
+        return NO;
+    }
+    return YES;
+}
+
+@implementation PSMOBSSceneItem
+@end
+
+@implementation PSMOBSMessage
+
++ (instancetype)messageWithJSONBytes:(const void *)bytes length:(size_t)length {
+    obsmessage::Message m;
+    if (!obsmessage::parseJSON((const char *)bytes, length, m)) {
+        return nil;
+    }
+    return [self messageFromParsedMessage:m];
+}
+
++ (instancetype)messageWithMessagePackBytes:(const void *)bytes length:(size_t)length {
+    obsmessage::Message m;
+    if (!obsmessage::parseMsgPack((const char *)bytes, length, m)) {
+        return nil;
+    }
+    return [self messageFromParsedMessage:m];
+}
+
++ (NSData *)messagePackDataWithJSONObject:(id)object {
+    obsmessage::MsgPackWriter writer;
+    if (!PSMWriteMessagePack(object, writer)) {
+        return nil;
+    }
+    return [NSData dataWithBytes:writer.data().data() length:writer.data().size()];
+}
+
++ (instancetype)messageFromParsedMessage:(const obsmessage::Message&)m {
+    PSMOBSMessage *message = [PSMOBSMessage new];
+    message.op = m.op;
+    message.eventType = PSMStringFrom(m.eventType);
+    message.hasEventIntent = m.hasEventIntent;
+    message.eventIntent = (NSInteger)m.eventIntent;
+    message.requestType = PSMStringFrom(m.requestType);
+    message.requestId = PSMStringFrom(m.requestId);
+    message.requestResult = m.requestResult;
+    if (m.hasAuthentication) {
+        message.authentication = @{@"challenge" : PSMStringFrom(m.challenge) ?: @"",
+                                   @"salt" : PSMStringFrom(m.salt) ?: @""};
+    }
+    message.sceneName = PSMStringFrom(m.sceneName);
+    message.currentProgramSceneName = PSMStringFrom(m.currentProgramSceneName);
+    message.currentPreviewSceneName = PSMStringFrom(m.currentPreviewSceneName);
+    message.baseWidth = m.baseWidth;
+    message.baseHeight = m.baseHeight;
+    if (!m.inputNames.empty()) {
+        NSMutableArray *names = [NSMutableArray arrayWithCapacity:m.inputNames.size()];
+        for (const std::string& name : m.inputNames) {
+            NSString *str = PSMStringFrom(name);
+            if (str != nil) {
+                [names addObject:str];
+            }
+        }
+        message.inputNames = names;
+    }
+    if (m.hasSceneItems) {
+        NSMutableArray *items = [NSMutableArray arrayWithCapacity:m.sceneItems.size()];
+        for (const obsmessage::SceneItem& src : m.sceneItems) {
+            [items addObject:PSMSceneItemFrom(src)];
+        }
+        message.sceneItems = items;
+    }
+    if (m.hasSceneItem) {
+        message.sceneItem = PSMSceneItemFrom(m.sceneItem);
+    }
+    if (m.imageData != nullptr) {
+        message.imageData = PSMDecodeImageData(m.imageData, m.imageDataLength);
+    }
+    if (!m.results.empty()) {
+        NSMutableArray *results = [NSMutableArray arrayWithCapacity:m.results.size()];
+        for (const obsmessage::Message& result : m.results) {
+            [results addObject:[self messageFromParsedMessage:result]];
+        }
+        message.results = results;
+    }
+    return message;
+}
+
+@end
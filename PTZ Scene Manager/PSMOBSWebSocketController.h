@@ -33,13 +33,12 @@ extern NSString *PSMOBSSessionDidEnd;
 extern NSString *PSMOBSSessionAuthorizationFailedKey;
 extern NSString *PSMOBSAutoConnect;
 extern NSString *PSMOBSURLString;
-extern NSString *PSMOBSGetSourceSnapshotNotification;
-extern NSString *PSMOBSImageDataKey;
-extern NSString *PSMOBSSourceNameKey;
-extern NSString *PSMOBSSnapshotIndexKey;
 extern NSString *PSMOBSGetVideoSourceNamesNotification;
 extern NSString *PSMOBSVideoSourcesKey;
 
+// imageData is nil if the screenshot failed, timed out, or the session ended first.
+typedef void (^PSMOBSSnapshotDoneBlock)(NSData * _Nullable imageData, NSInteger index);
+
 @interface PSMOBSWebSocketController : NSObject
 
 @property (readonly) BOOL connected;
@@ -49,11 +48,16 @@ extern NSString *PSMOBSVideoSourcesKey;
 @property (weak) NSObject<PSMOBSWebSocketDelegate> *delegate;
 @property (readonly) NSArray *videoSourceNames;
 @property (readonly) CGFloat baseWidth, baseHeight;
+// Screenshot requests that haven't been answered by then complete with nil. Default 5 seconds.
+@property NSTimeInterval snapshotTimeout;
 
 + (PSMOBSWebSocketController *)defaultController;
 
-// Posts PSMOBSGetSourceSnapshotNotification on success.
-- (BOOL)requestSnapshotForCameraSource:(NSString *)obsSourceName index:(NSInteger)index preferredWidth:(NSInteger)width;
+// Main thread only. Any number of requests can be outstanding; a request for the same source and width as
+// one already in flight shares its reply. doneBlock is always called, on the main thread, with the index it
+// was given, and never before this returns. Returns NO if OBS isn't ready or there is no source name; doneBlock
+// is then called with nil on a later pass of the main queue.
+- (BOOL)requestSnapshotForCameraSource:(NSString *)obsSourceName index:(NSInteger)index preferredWidth:(NSInteger)width onDone:(PSMOBSSnapshotDoneBlock)doneBlock;
 
 - (void)connectToServer;
 - (void)deleteKeychainPasswords;
@@ -10,27 +10,20 @@
 #import "PSMOBSWebSocketController.h"
 #import "AppDelegate.h"
 #import "PTZPrefCamera.h"
+#import "PSMOBSMessage.h"
 #include "easywsclient.hpp"
+#include "spscqueue.hpp"
 #include <iostream>
 #include <string>
 #include <memory>
-#include <mutex>
-#include <deque>
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
 #import <PTZ_Scene_Manager-Swift.h>
 
-#import "pixman.h"
-
-#define EPSILON (1.0f)
-#define isCloseEnough(x,y)     (fabs((x) - (y)) <= EPSILON)
-
-#define OBS_ALIGN_CENTER (0)
-#define OBS_ALIGN_LEFT (1 << 0)
-#define OBS_ALIGN_RIGHT (1 << 1)
-#define OBS_ALIGN_TOP (1 << 2)
-#define OBS_ALIGN_BOTTOM (1 << 3)
+#include "obsvisibility.hpp"
 
 NSString *PSMOBSCurrentSourceDidChangeNotification = @"PSMOBSCurrentSourceDidChangeNotification";
 NSString *PSMOBSSessionIsReady = @"PSMOBSSessionDidBegin";
@@ -39,39 +32,34 @@ NSString *PSMOBSSessionAuthorizationFailedKey = @"PSMOBSSessionAuthorizationFail
 NSString *PSMOBSAutoConnect = @"OBSAutoConnect";
 NSString *PSMOBSURLString = @"OBSURLString";
 NSString *PSMOBSAccountName = @"OBSAccountName";
-NSString *PSMOBSGetSourceSnapshotNotification = @"PSMOBSGetSourceSnapshotNotification";
-NSString *PSMOBSImageDataKey = @"PSMOBSImageDataKey";
-NSString *PSMOBSSourceNameKey = @"PSMOBSSourceNameKey";
-NSString *PSMOBSSnapshotIndexKey = @"PSMOBSSnapshotIndexKey";
 NSString *PSMOBSGetVideoSourceNamesNotification = @"PSMOBSGetVideoSourceNamesNotification";
 NSString *PSMOBSVideoSourcesKey = @"PSMOBSVideoSourcesKey";
 
 static NSString *PSMOBSBundleID = @"com.obsproject.obs-studio";
 
-// a simple, thread-safe queue with (mostly) non-blocking reads and writes
-// Yes, this could probably be replaced by dispatch_queue code.
-namespace non_blocking {
-template <class T>
-class Queue {
-    mutable std::mutex m;
-    std::deque<T> data;
-public:
-    void push(T const &input) {
-        std::lock_guard<std::mutex> L(m);
-        data.push_back(input);
-    }
+// The setup batch can't know the scene names when it asks for their items, so these
+// stand in for them; see handleGetSceneItemList:.
+static NSString *PSMOBSProgramSceneItemsRequestID = @"GetSceneItemList:currentProgramScene";
+static NSString *PSMOBSPreviewSceneItemsRequestID = @"GetSceneItemList:currentPreviewScene";
 
-    bool pop(T &output) {
-        std::lock_guard<std::mutex> L(m);
-        if (data.empty())
-            return false;
-        output = data.front();
-        data.pop_front();
-        return true;
-    }
-};
+static NSTimeInterval PSMOBSNow(void) {
+    return [NSDate timeIntervalSinceReferenceDate];
 }
 
+// The socket thread blocks until OBS sends something or sendMessage: wakes it.
+// The timeout is only a backstop so a missed wakeup can't stall the loop.
+static const int PSMOBSSocketPollTimeoutMS = 1000;
+
+// MessagePack first: it's the same messages without JSON's quoting, escaping and number formatting.
+// OBS takes the first one it supports; if the server picks neither we get JSON.
+static const char *PSMOBSSubprotocols = "obswebsocket.msgpack, obswebsocket.json";
+static const char *PSMOBSMessagePackSubprotocol = "obswebsocket.msgpack";
+
+// The queues' default 1024 slots is far more than OBS and the app ever have in flight. If the
+// main thread stalls long enough to fill incoming, the socket thread stops reading and lets OBS
+// wait, checking back this often.
+static const useconds_t PSMOBSQueueFullBackoffUS = 1000;
+
 /* Don't use GetSourceActive. The Multiview counts as a "dialog" in "When an input is showing, [videoShowing] means it's being shown by the preview or a dialog.", making it pretty much useless.
  */
 
@@ -130,8 +118,13 @@ typedef enum {
     ES_SceneItems = (1 << 7),
     ES_MediaInputs = (1 << 8),
     ES_Vendors = (1 << 9),
+    ES_Ui = (1 << 10),
  // All non-high-volume events. (General | Config | Scenes | Inputs | Transitions | Filters | Outputs | SceneItems | MediaInputs | Vendors | Ui)
-    
+    // High-volume events have to be asked for by name.
+    ES_InputVolumeMeters = (1 << 16),
+    ES_InputActiveStateChanged = (1 << 17),
+    ES_InputShowStateChanged = (1 << 18),
+    ES_SceneItemTransformChanged = (1 << 19),
 } EventSubscription;
 
 typedef enum {
@@ -141,10 +134,29 @@ typedef enum {
     OBSStateDisconnected,
 } OBSState;
 
+// A GetSourceScreenshot in flight, and everyone waiting for it.
+@interface PSMOBSSnapshotRequest : NSObject
+@property NSString *requestId;
+// Source and width; a later navigation request for the same image joins the newest one instead of asking OBS again.
+@property NSString *dedupKey;
+@property NSMutableArray<void (^)(NSData *)> *completions;
+@end
+
+@implementation PSMOBSSnapshotRequest
+@end
+
 @interface PSMOBSWebSocketController () {
-    non_blocking::Queue<std::string> outgoing;
-    non_blocking::Queue<std::string> incoming;
+    // Single producer, single consumer: outgoing is pushed on the main thread and popped on
+    // the socket thread, incoming the other way round.
+    spsc::Queue<std::string> outgoing;
+    spsc::Queue<PSMOBSMessage *> incoming;
+    // A drain of incoming is already on its way to the main queue.
+    std::atomic<bool> incomingScheduled;
+    // Main thread only.
+    obsvisibility::Model visibility;
     dispatch_queue_t socketQueue;
+    // Written by sendMessage: (and on shutdown), read by the socket thread's poll.
+    int wakePipe[2];
 }
 @property (readwrite) BOOL connected;
 @property (readwrite) BOOL isReady;
@@ -152,6 +164,8 @@ typedef enum {
 @property (readwrite) NSString *currentProgramSource, *currentPreviewSource;
 @property (readwrite) NSArray *currentProgramSourceNames, *currentPreviewSourceNames;
 @property (readwrite) CGFloat baseWidth, baseHeight;
+// obswebsocket.msgpack was negotiated. Set by the socket thread before it reads anything.
+@property (atomic) BOOL useMessagePack;
 
 @property NSString *command;
 @property BOOL running;
@@ -167,6 +181,16 @@ typedef enum {
 @property NSString *obsAccount;
 @property NSData *obsPasswordData;
 @property NSArray *videoSourceNames;
+// Screenshot requests by requestId and by dedupKey. Main thread only.
+@property NSMutableDictionary<NSString *, PSMOBSSnapshotRequest *> *snapshotRequests;
+@property NSMutableDictionary<NSString *, PSMOBSSnapshotRequest *> *snapshotRequestsByKey;
+@property NSUInteger snapshotRequestCount;
+// Scenes whose items need fetching; sent together on the next pass through the main queue.
+@property NSMutableOrderedSet<NSString *> *pendingSceneItemRefreshes;
+// Timing, in seconds since the reference date.
+@property NSTimeInterval connectStartTime;
+@property BOOL loggedSetupTime;
+@property NSMutableDictionary<NSString *, NSNumber *> *sceneChangeTimes;
 
 @end
 
@@ -187,7 +211,19 @@ typedef enum {
         // A unique ID for requests when we don't care about matching request with reply.
         _requestId = [[NSUUID new] UUIDString];
         _obsAccount = @"OBSWebSocket";
+        _snapshotRequests = [NSMutableDictionary dictionary];
+        _snapshotRequestsByKey = [NSMutableDictionary dictionary];
+        _snapshotTimeout = 5;
+        _pendingSceneItemRefreshes = [NSMutableOrderedSet orderedSet];
+        _sceneChangeTimes = [NSMutableDictionary dictionary];
         socketQueue = dispatch_queue_create("socketQueue", NULL);
+        if (pipe(wakePipe) == 0) {
+            fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+        } else {
+            NSLog(@"Unable to create OBS socket wakeup pipe: %s", strerror(errno));
+            wakePipe[0] = wakePipe[1] = -1;
+        }
         _videoSourceNames = [[NSUserDefaults standardUserDefaults] objectForKey:@"OBSVideoSourceNames"];
 
     }
@@ -196,6 +232,10 @@ typedef enum {
 
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (wakePipe[0] >= 0) {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+    }
 }
 
 - (BOOL)obsIsRunning {
@@ -266,7 +306,7 @@ typedef enum {
 - (NSString *)convertToJSON:(id)dictionaryOrArrayToOutput {
     NSError *error;
     NSData *jsonData = [NSJSONSerialization dataWithJSONObject:dictionaryOrArrayToOutput
-                                                       options:NSJSONWritingPrettyPrinted // Pass 0 if you don't care about the readability of the generated string
+                                                       options:0
                                                          error:&error];
 
     if (! jsonData) {
@@ -277,47 +317,64 @@ typedef enum {
 }
 
 - (NSNumber *)eventSubscriptions {
-    return @(ES_General | ES_Scenes | ES_SceneItems);
-}
-
-- (NSString *)jsonGetRequestType:(NSString *)requestType {
-    NSDictionary *dict = @{@"op":@(Op_Request),
-                           @"d": @{@"requestType": requestType,
-                                   @"requestId": self.requestId,
-                                   @"requestData": @{}}};
-    return [self convertToJSON:dict];
-}
-
-#define JSON_GET_REQUEST_TYPE(_request) \
-- (NSString *)json##_request {  \
-    return [self jsonGetRequestType:@#_request]; \
-}
-
-JSON_GET_REQUEST_TYPE(GetInputList)
-JSON_GET_REQUEST_TYPE(GetCurrentProgramScene)
-JSON_GET_REQUEST_TYPE(GetCurrentPreviewScene)
-JSON_GET_REQUEST_TYPE(GetVideoSettings)
-
-- (NSString *)jsonHelloReply {
+    return @(ES_General | ES_Scenes | ES_SceneItems | ES_SceneItemTransformChanged);
+}
+
+// One entry in a RequestBatch's requests.
+- (NSDictionary *)batchRequest:(NSString *)requestType requestID:(NSString *)requestID requestData:(NSDictionary *)requestData {
+    return @{@"requestType": requestType,
+             @"requestId": requestID,
+             @"requestData": requestData ?: @{}};
+}
+
+// Requests run in order (SerialRealtime), which is what lets one pass a value on to the next with
+// outputVariables and inputVariables. A failed request doesn't stop the rest.
+- (NSDictionary *)jsonRequestBatch:(NSArray<NSDictionary *> *)requests requestID:(NSString *)requestID {
+    NSDictionary *dict = @{@"op":@(Op_RequestBatch),
+                           @"d": @{@"requestId": requestID,
+                                   @"haltOnFailure": @NO,
+                                   @"executionType": @(0),
+                                   @"requests": requests}};
+    return dict;
+}
+
+// Everything we need to get going, in one round trip. Video settings come first because
+// the visibility model needs the canvas size, and each scene's items come after the
+// request that names the scene, which hands the name over in a batch variable.
+- (NSDictionary *)jsonSetupBatch {
+    NSMutableDictionary *program = [[self batchRequest:@"GetCurrentProgramScene" requestID:self.requestId requestData:nil] mutableCopy];
+    program[@"outputVariables"] = @{@"programScene": @"currentProgramSceneName"};
+    NSMutableDictionary *preview = [[self batchRequest:@"GetCurrentPreviewScene" requestID:self.requestId requestData:nil] mutableCopy];
+    preview[@"outputVariables"] = @{@"previewScene": @"currentPreviewSceneName"};
+    NSMutableDictionary *programItems = [[self batchRequest:@"GetSceneItemList" requestID:PSMOBSProgramSceneItemsRequestID requestData:nil] mutableCopy];
+    programItems[@"inputVariables"] = @{@"sceneName": @"programScene"};
+    NSMutableDictionary *previewItems = [[self batchRequest:@"GetSceneItemList" requestID:PSMOBSPreviewSceneItemsRequestID requestData:nil] mutableCopy];
+    previewItems[@"inputVariables"] = @{@"sceneName": @"previewScene"};
+    NSArray *requests = @[[self batchRequest:@"GetVideoSettings" requestID:self.requestId requestData:nil],
+                          [self batchRequest:@"GetInputList" requestID:self.requestId requestData:nil],
+                          program, preview, programItems, previewItems];
+    return [self jsonRequestBatch:requests requestID:@"Setup"];
+}
+
+- (NSDictionary *)jsonHelloReply {
     NSDictionary *dict = @{@"op":@(Op_Identify),
                            @"d":@{@"rpcVersion":@(1),
                                   @"eventSubscriptions":self.eventSubscriptions}};
-    return [self convertToJSON:dict];
+    return dict;
 }
 
-- (NSString *)jsonHelloReplyWithAuth:(NSString *)auth {
+- (NSDictionary *)jsonHelloReplyWithAuth:(NSString *)auth {
     NSDictionary *dict = @{@"op":@(Op_Identify),
                            @"d":@{@"rpcVersion":@(1),
                                   @"authentication":auth,
                                   @"eventSubscriptions":self.eventSubscriptions}};
-    return [self convertToJSON:dict];
+    return dict;
 }
 
-- (void)handleHello:(NSDictionary *)dict {
-    NSDictionary *data = dict[@"d"];
-    NSDictionary *auth = data[@"authentication"];
+- (void)handleHello:(PSMOBSMessage *)message {
+    NSDictionary *auth = message.authentication;
     if (auth == nil) {
-        [self sendString:self.jsonHelloReply];
+        [self sendMessage:self.jsonHelloReply];
         return;
     }
     NSString *authResponse = nil;
@@ -330,7 +387,7 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
     self.obsPasswordData = nil;
     if (authResponse) {
         self.authType = OBSAuthTypeKeychainAttempt;
-        [self sendString:[self jsonHelloReplyWithAuth:authResponse]];
+        [self sendMessage:[self jsonHelloReplyWithAuth:authResponse]];
     } else {
         if (self.authType == OBSAuthTypeKeychainAttempt || self.authType == OBSAuthTypePromptFailed) {
             self.authType = OBSAuthTypePromptAttempt;
@@ -342,24 +399,23 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
                 self.obsState = OBSStateWaitingToConnect;
                 self.connected = NO;
                 self.running = NO;
+                [self wakeSocketThread];
                 return;
             }
             NSString *authResponse = [OBSAuth.shared obsSecret:auth password:password];
 
             if (authResponse != nil) {
                 self.obsPasswordData = [password dataUsingEncoding:NSUTF8StringEncoding];
-                [self sendString:[self jsonHelloReplyWithAuth:authResponse]];
+                [self sendMessage:[self jsonHelloReplyWithAuth:authResponse]];
             }
         }];
     }
 }
 
-- (void)handleIdentified:(NSDictionary *)dict {
+- (void)handleIdentified:(PSMOBSMessage *)message {
     self.obsState = OBSStateIdentified;
-    [self sendString:[self jsonGetInputList]];
-    [self sendString:[self jsonGetCurrentProgramScene]];
-    [self sendString:[self jsonGetCurrentPreviewScene]];
-    [self sendString:[self jsonGetVideoSettings]];
+    PTZLog(@"OBS identified %.0f ms after connecting", (PSMOBSNow() - self.connectStartTime) * 1000);
+    [self sendMessage:[self jsonSetupBatch]];
     if (self.obsPasswordData != nil) {
         [self.delegate requestOBSWebSocketKeychainPermission:^(BOOL allowed) {
             if (!allowed) {
@@ -375,36 +431,39 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
     }
 }
 
-- (void)handleGetVideoSettings:(NSDictionary *)dict {
-    self.baseHeight = [dict[@"baseHeight"] floatValue];
-    self.baseWidth = [dict[@"baseWidth"] floatValue];
+- (void)handleGetVideoSettings:(PSMOBSMessage *)message {
+    self.baseHeight = message.baseHeight;
+    self.baseWidth = message.baseWidth;
 }
 
-- (void)handleSourceScreenshot:(NSDictionary *)dict {
-    NSString *requestID = dict[@"requestId"];
-    NSDictionary *responseData = dict[@"responseData"];
-    NSString *imageJsonData = responseData[@"imageData"];
-    if (imageJsonData) {
-        // Strip the prefix, it's not base64
-        NSArray *parts = [imageJsonData componentsSeparatedByString:@","];
-        NSData *data = [[NSData alloc] initWithBase64EncodedString:[parts lastObject] options:NSDataBase64DecodingIgnoreUnknownCharacters];
-        if (data) {
-            parts = [requestID componentsSeparatedByString:@","];
-            NSString *sourceName = requestID;
-            NSInteger index = -1;
-            if ([parts count] == 2) {
-                sourceName = [parts lastObject];
-                index = [[parts firstObject] integerValue];
-            }
-            [[NSNotificationCenter defaultCenter]
-             postNotificationName:PSMOBSGetSourceSnapshotNotification
-             object:nil
-             userInfo:@{PSMOBSImageDataKey : data, PSMOBSSourceNameKey : sourceName, PSMOBSSnapshotIndexKey : @(index)}];
-        }
+- (void)handleSourceScreenshot:(PSMOBSMessage *)message {
+    // The socket thread already decoded the image.
+    // A failed request (say, the source was renamed) has no imageData, but its requesters still need an answer.
+    [self finishSnapshotRequest:message.requestId withData:message.imageData];
+}
+
+// Called for the reply, the timeout, and the end of the session; whichever comes first wins.
+- (void)finishSnapshotRequest:(NSString *)requestID withData:(NSData *)data {
+    PSMOBSSnapshotRequest *request = requestID ? self.snapshotRequests[requestID] : nil;
+    if (request == nil) {
+        return;
+    }
+    [self.snapshotRequests removeObjectForKey:requestID];
+    if (self.snapshotRequestsByKey[request.dedupKey] == request) {
+        [self.snapshotRequestsByKey removeObjectForKey:request.dedupKey];
+    }
+    for (void (^completion)(NSData *) in request.completions) {
+        completion(data);
     }
 }
 
-- (NSString *)jsonGetSourceScreenshot:(NSString *)sourceName requestID:(NSString *)requestID imageWidth:(NSInteger)imageWidth {
+- (void)failAllSnapshotRequests {
+    for (NSString *requestID in [self.snapshotRequests allKeys]) {
+        [self finishSnapshotRequest:requestID withData:nil];
+    }
+}
+
+- (NSDictionary *)jsonGetSourceScreenshot:(NSString *)sourceName requestID:(NSString *)requestID imageWidth:(NSInteger)imageWidth {
     // options: 1920x1080 (1.777) 960x600 (1.6) 480x300 (1.6)
     // imageWidth: ">= 8, <= 4096"
     imageWidth = MAX(8, MIN(imageWidth, 4096));
@@ -415,38 +474,90 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
                                        @"sourceName": sourceName,
                                        @"imageFormat": @"jpg",
                                        @"imageWidth":@(imageWidth)}}};
-    return [self convertToJSON:dict];
+    return dict;
 }
 
-- (NSString *)jsonGetSceneItemList:(NSString *)sceneName {
+- (NSDictionary *)jsonGetSceneItemList:(NSString *)sceneName {
     NSDictionary *dict = @{@"op":@(Op_Request),
                            @"d": @{@"requestType": @"GetSceneItemList",
                                    @"requestId": sceneName,
                                    @"requestData": @{
                                        @"sceneName": sceneName}}};
-    return [self convertToJSON:dict];
+    return dict;
+}
+
+// Switching scenes in studio mode changes program and preview at once, and dragging a source
+// around sends a stream of transform events; each of those only needs one GetSceneItemList
+// per scene, and the ones that are left go out as a single batch.
+- (void)refreshSceneItemsForScene:(NSString *)sceneName {
+    if (sceneName == nil) {
+        return;
+    }
+    BOOL scheduled = [self.pendingSceneItemRefreshes count] > 0;
+    [self.pendingSceneItemRefreshes addObject:sceneName];
+    if (!scheduled) {
+        // Behind any messages already queued for the main thread, so they get to add their scenes.
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self sendSceneItemRefreshes];
+        });
+    }
 }
 
-- (BOOL)requestSnapshotForCameraSource:(NSString *)obsSourceName index:(NSInteger)index preferredWidth:(NSInteger)width {
-    if (!self.isReady) {
+- (void)sendSceneItemRefreshes {
+    NSArray<NSString *> *scenes = [self.pendingSceneItemRefreshes array];
+    [self.pendingSceneItemRefreshes removeAllObjects];
+    if (!self.isReady || [scenes count] == 0) {
+        return;
+    }
+    if ([scenes count] == 1) {
+        [self sendMessage:[self jsonGetSceneItemList:scenes[0]]];
+        return;
+    }
+    NSMutableArray *requests = [NSMutableArray array];
+    for (NSString *sceneName in scenes) {
+        // The requestId is the scene name, same as jsonGetSceneItemList:.
+        [requests addObject:[self batchRequest:@"GetSceneItemList" requestID:sceneName requestData:@{@"sceneName": sceneName}]];
+    }
+    [self sendMessage:[self jsonRequestBatch:requests requestID:@"GetSceneItemList"]];
+}
+
+- (BOOL)requestSnapshotForCameraSource:(NSString *)obsSourceName index:(NSInteger)index preferredWidth:(NSInteger)width onDone:(PSMOBSSnapshotDoneBlock)doneBlock {
+    void (^completion)(NSData *) = ^(NSData *data) {
+        doneBlock(data, index);
+    };
+    if (!self.isReady || [obsSourceName length] == 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(nil);
+        });
         return NO;
     }
-    NSString *requestID = [NSString stringWithFormat:@"%ld,%@", index, obsSourceName];
-    NSString *json = [self jsonGetSourceScreenshot:obsSourceName requestID:requestID imageWidth:width];
-    [self sendString:json];
+    width = MAX(8, MIN(width, 4096));
+    NSString *dedupKey = [NSString stringWithFormat:@"%ld,%@", (long)width, obsSourceName];
+    PSMOBSSnapshotRequest *request = self.snapshotRequestsByKey[dedupKey];
+    // A preset snapshot is saved as the scene's thumbnail, so it has to be taken after the camera got there. One already
+    // in flight was asked for earlier, maybe mid-move, so it always gets its own. Navigation snapshots can share.
+    if (request != nil && index < 0) {
+        [request.completions addObject:completion];
+        return YES;
+    }
+    request = [PSMOBSSnapshotRequest new];
+    request.requestId = [NSString stringWithFormat:@"GetSourceScreenshot-%lu", (unsigned long)++self.snapshotRequestCount];
+    request.dedupKey = dedupKey;
+    request.completions = [NSMutableArray arrayWithObject:completion];
+    self.snapshotRequests[request.requestId] = request;
+    self.snapshotRequestsByKey[dedupKey] = request;
+    [self sendMessage:[self jsonGetSourceScreenshot:obsSourceName requestID:request.requestId imageWidth:width]];
+
+    NSString *requestID = request.requestId;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.snapshotTimeout * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [self finishSnapshotRequest:requestID withData:nil];
+    });
     return YES;
 }
 
-- (void)handleInputList:(NSDictionary *)responseData {
-    NSMutableArray *array = [NSMutableArray array];
-    NSArray *inputs = responseData[@"inputs"];
+- (void)handleInputList:(PSMOBSMessage *)message {
     // There is no way to tell what's a video source. Just show them all.
-    for (NSDictionary *input in inputs) {
-        NSString *name = input[@"inputName"];
-        if (name) {
-            [array addObject:name];
-        }
-    }
+    NSMutableArray *array = [NSMutableArray arrayWithArray:message.inputNames ?: @[]];
     [array sortUsingSelector:@selector(caseInsensitiveCompare:)];
     self.videoSourceNames = [NSArray arrayWithArray:array];
     [[NSUserDefaults standardUserDefaults] setObject:self.videoSourceNames forKey:@"OBSVideoSourceNames"];
@@ -456,267 +567,253 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
      userInfo:@{PSMOBSVideoSourcesKey : self.videoSourceNames}];
 }
 
-- (void)handleProgramSceneChanged:(NSDictionary *)dict {
-    // GetSceneItemList
-    self.currentProgramScene = dict[@"sceneName"];
-    if (self.currentProgramScene != nil) {
-        [self sendString:[self jsonGetSceneItemList:self.currentProgramScene]];
+- (void)noteSceneChange:(NSString *)sceneName {
+    if (sceneName != nil) {
+        self.sceneChangeTimes[sceneName] = @(PSMOBSNow());
     }
 }
 
-- (void)handlePreviewSceneChanged:(NSDictionary *)dict {
+// If we've had the scene before, its sources are known right away. Ask for the items anyway: the events
+// we get don't cover everything, like a source being renamed.
+- (void)handleProgramSceneChanged:(PSMOBSMessage *)message {
     // GetSceneItemList
-    self.currentPreviewScene = dict[@"sceneName"];
-    if (self.currentPreviewScene != nil) {
-        [self sendString:[self jsonGetSceneItemList:self.currentPreviewScene]];
-    }
+    self.currentProgramScene = message.sceneName;
+    [self noteSceneChange:self.currentProgramScene];
+    [self updateVisibleSourcesForScene:self.currentProgramScene];
+    [self refreshSceneItemsForScene:self.currentProgramScene];
 }
 
-- (void)handleGetCurrentProgramScene:(NSDictionary *)dict {
+- (void)handlePreviewSceneChanged:(PSMOBSMessage *)message {
     // GetSceneItemList
-    self.currentProgramScene = dict[@"currentProgramSceneName"];
-    if (self.currentProgramScene != nil) {
-        [self sendString:[self jsonGetSceneItemList:self.currentProgramScene]];
-    }
+    self.currentPreviewScene = message.sceneName;
+    [self noteSceneChange:self.currentPreviewScene];
+    [self updateVisibleSourcesForScene:self.currentPreviewScene];
+    [self refreshSceneItemsForScene:self.currentPreviewScene];
 }
 
-- (void)handleGetCurrentPreviewScene:(NSDictionary *)dict {
-    // GetSceneItemList
-    self.currentPreviewScene = dict[@"currentPreviewSceneName"];
-    if (self.currentPreviewScene != nil) {
-        [self sendString:[self jsonGetSceneItemList:self.currentPreviewScene]];
-    }
+// The setup batch asks for the scene's items itself.
+- (void)handleGetCurrentProgramScene:(PSMOBSMessage *)message {
+    self.currentProgramScene = message.currentProgramSceneName;
 }
 
-- (void)handleGetSceneItemList:(NSDictionary *)dict {
-    NSDictionary *responseData = dict[@"responseData"];
-    NSString *sceneName = dict[@"requestId"];
-    [self scene:sceneName didChangeItems:responseData[@"sceneItems"]];
+- (void)handleGetCurrentPreviewScene:(PSMOBSMessage *)message {
+    // Fails, leaving this nil, if studio mode is off.
+    self.currentPreviewScene = message.currentPreviewSceneName;
+}
+
+- (void)handleGetSceneItemList:(PSMOBSMessage *)message {
+    // The requestId is the scene name, except in the setup batch.
+    NSString *sceneName = message.requestId;
+    BOOL fromSetup = NO;
+    if ([sceneName isEqualToString:PSMOBSProgramSceneItemsRequestID]) {
+        sceneName = self.currentProgramScene;
+        fromSetup = YES;
+    } else if ([sceneName isEqualToString:PSMOBSPreviewSceneItemsRequestID]) {
+        sceneName = self.currentPreviewScene;
+        fromSetup = YES;
+    }
+    if (sceneName == nil) {
+        return;
+    }
+    if (fromSetup && !message.requestResult) {
+        // Batch variables need obs-websocket 5.0 or later; ask the old way.
+        [self refreshSceneItemsForScene:sceneName];
+        return;
+    }
+    [self scene:sceneName didChangeItems:message.sceneItems];
 }
 
-- (void)handleRequestResponse:(NSDictionary *)dict {
-    NSDictionary *data = dict[@"d"];
-    NSString *type = data[@"requestType"];
+- (void)handleRequestResponse:(PSMOBSMessage *)message {
+    NSString *type = message.requestType;
     if ([type isEqualToString:@"GetInputList"]) {
-        [self handleInputList:data[@"responseData"]];
+        [self handleInputList:message];
     } else if ([type isEqualToString:@"GetVersion"]) {
         // supportedImageFormats. We use jpg, it's not going anywhere.
     } else if ([type isEqualToString:@"GetSourceScreenshot"]) {
-        [self handleSourceScreenshot:data];
+        [self handleSourceScreenshot:message];
     } else if ([type isEqualToString:@"GetSceneItemList"]) {
-        [self handleGetSceneItemList:data];
+        [self handleGetSceneItemList:message];
     } else if ([type isEqualToString:@"GetCurrentProgramScene"]) {
-        [self handleGetCurrentProgramScene:data[@"responseData"]];
+        [self handleGetCurrentProgramScene:message];
     } else if ([type isEqualToString:@"GetCurrentPreviewScene"]) {
-        [self handleGetCurrentPreviewScene:data[@"responseData"]];
+        [self handleGetCurrentPreviewScene:message];
     } else if ([type isEqualToString:@"GetVideoSettings"]) {
-        [self handleGetVideoSettings:data[@"responseData"]];
+        [self handleGetVideoSettings:message];
     }
 }
 
-- (void)handleEventResponse:(NSDictionary *)dict {
-    NSDictionary *data = dict[@"d"];
-    NSNumber *intentObj = data[@"eventIntent"];
-    if (intentObj == nil) {
+- (void)handleEventResponse:(PSMOBSMessage *)message {
+    if (!message.hasEventIntent) {
         return;
     }
-    NSInteger intent = [intentObj integerValue];
-    NSString *eventType = data[@"eventType"];
+    NSInteger intent = message.eventIntent;
+    NSString *eventType = message.eventType;
     if (intent == ES_Scenes) {
         // Ignore SceneCreated, SceneRemoved, and SceneListChanged
         if ([eventType isEqualToString:@"CurrentProgramSceneChanged"]) {
-            [self handleProgramSceneChanged:data[@"eventData"]];
+            [self handleProgramSceneChanged:message];
         } else if ([eventType isEqualToString:@"CurrentPreviewSceneChanged"]) {
-            [self handlePreviewSceneChanged:data[@"eventData"]];
+            [self handlePreviewSceneChanged:message];
         }
     } else if (intent == ES_General) {
         // Ignore Vendor and Custom events.
         if ([eventType isEqualToString:@"ExitStarted"]) {
             self.running = NO;
+            [self wakeSocketThread];
         }
     } else if (intent == ES_SceneItems) {
-        // SceneItemListReindexed does not contain an array of full SceneItems, it's just the sceneID and index. Not what we need.
-        NSDictionary *eventData = data[@"eventData"];
-        NSString *sceneName = eventData[@"sceneName"];
-        [self sendString:[self jsonGetSceneItemList:sceneName]];
+        if ([eventType isEqualToString:@"SceneItemEnableStateChanged"]) {
+            [self handleSceneItemChanged:message];
+        } else if (![eventType isEqualToString:@"SceneItemLockStateChanged"] && ![eventType isEqualToString:@"SceneItemSelected"]) {
+            // SceneItemListReindexed does not contain an array of full SceneItems, it's just the sceneID and index. Not what we need.
+            [self sceneItemsAreOutOfDate:message.sceneName];
+        }
+    } else if (intent == ES_SceneItemTransformChanged) {
+        [self handleSceneItemChanged:message];
     }
 }
 
-- (void)handleJSON:(id)jsonObj {
-    if (![jsonObj isKindOfClass:[NSDictionary class]]) {
-        return;
-    }
-    NSDictionary *dict = (NSDictionary *)jsonObj;
-    NSNumber *opObj = dict[@"op"];
-    if (opObj == nil) {
-        return;
+- (void)handleRequestBatchResponse:(PSMOBSMessage *)message {
+    for (PSMOBSMessage *result in message.results) {
+        [self handleRequestResponse:result];
     }
-    switch ([opObj integerValue]) {
+}
+
+- (void)handleMessage:(PSMOBSMessage *)message {
+    switch (message.op) {
         case Op_Hello:
             self.connected = YES;
-            [self handleHello:dict];
+            [self handleHello:message];
             break;
         case Op_Identified:
             self.isReady = YES;
-            [self handleIdentified:dict];
+            [self handleIdentified:message];
             [self connectionIsReady];
             break;
         case Op_Event:
-            [self handleEventResponse:dict];
+            [self handleEventResponse:message];
             break;
         case Op_RequestResponse:
-            [self handleRequestResponse:dict];
+            [self handleRequestResponse:message];
+            break;
+        case Op_RequestBatchResponse:
+            [self handleRequestBatchResponse:message];
             break;
         default:
             break;
     }
 }
 
-#pragma mark data parsing
-/*
- {OBS_ALIGN_TOP | OBS_ALIGN_LEFT,
-                        OBS_ALIGN_TOP,
-                        OBS_ALIGN_TOP | OBS_ALIGN_RIGHT,
-                        OBS_ALIGN_LEFT,
-                        OBS_ALIGN_CENTER,
-                        OBS_ALIGN_RIGHT,
-                        OBS_ALIGN_BOTTOM | OBS_ALIGN_LEFT,
-                        OBS_ALIGN_BOTTOM,
-                        OBS_ALIGN_BOTTOM | OBS_ALIGN_RIGHT};
- */
-
-- (NSRect)adjustRect:(NSRect)rect forAlignment:(NSInteger)alignment {
-    // Top-Left is standard alignment, no offsets.
-    if (alignment == (OBS_ALIGN_TOP | OBS_ALIGN_LEFT)) {
-        return rect;
+#pragma mark Scene visibility
+
+static obsmessage::SceneItemTransform PSMTransformFrom(PSMOBSSceneItem *item) {
+    obsmessage::SceneItemTransform xform;
+    xform.positionX = item.positionX;
+    xform.positionY = item.positionY;
+    xform.width = item.width;
+    xform.height = item.height;
+    xform.sourceWidth = item.sourceWidth;
+    xform.sourceHeight = item.sourceHeight;
+    xform.boundsWidth = item.boundsWidth;
+    xform.boundsHeight = item.boundsHeight;
+    xform.cropLeft = item.cropLeft;
+    xform.cropRight = item.cropRight;
+    xform.cropTop = item.cropTop;
+    xform.cropBottom = item.cropBottom;
+    xform.alignment = (int)item.alignment;
+    xform.boundsType = item.boundsType ? [item.boundsType UTF8String] : "";
+    return xform;
+}
+
+// Only the cameras we know about count. We don't know what inputKinds correspond to cameras.
+- (void)updateVisibilityCanvas {
+    visibility.setCanvasSize(self.baseWidth, self.baseHeight);
+    std::vector<std::string> cameras;
+    for (NSString *name in [(AppDelegate *)[NSApp delegate] obsSourceNames]) {
+        cameras.push_back([name UTF8String]);
+    }
+    visibility.setCameras(cameras);
+}
+
+// Every scene we're sent the items for is kept, current or not, and the SceneItem events keep it up to date.
+- (void)scene:(NSString *)sceneName didChangeItems:(NSArray<PSMOBSSceneItem *> *)sceneItems {
+    PTZLog(@"sceneName '%@' program '%@' preview '%@'", sceneName, self.currentProgramScene, self.currentPreviewScene);
+    std::vector<obsvisibility::Item> items;
+    items.reserve([sceneItems count]);
+    for (PSMOBSSceneItem *sceneItem in sceneItems) {
+        obsvisibility::Item item;
+        item.sceneItemId = sceneItem.sceneItemId;
+        item.sourceName = sceneItem.sourceName ? [sceneItem.sourceName UTF8String] : "";
+        item.enabled = sceneItem.sceneItemEnabled;
+        item.transform = PSMTransformFrom(sceneItem);
+        items.push_back(std::move(item));
+    }
+    visibility.setItems([sceneName UTF8String], std::move(items));
+    [self updateVisibleSourcesForScene:sceneName];
+}
+
+// SceneItemEnableStateChanged and SceneItemTransformChanged change our copy of the scene in place,
+// instead of asking OBS for the whole list again.
+- (void)handleSceneItemChanged:(PSMOBSMessage *)message {
+    NSString *sceneName = message.sceneName;
+    PSMOBSSceneItem *item = message.sceneItem;
+    if (sceneName == nil || item == nil) {
+        return;
     }
-    CGFloat width = NSWidth(rect);
-    CGFloat height = NSHeight(rect);
-    switch (alignment) {
-        case OBS_ALIGN_TOP: // Center Top
-            rect.origin.x -= (width / 2.0);
-            break;
-        case OBS_ALIGN_RIGHT | OBS_ALIGN_TOP:
-            rect.origin.x -= width;
-            break;
-        case OBS_ALIGN_LEFT: // Left Center
-            rect.origin.y -= (height / 2.0);
-            break;
-        case OBS_ALIGN_CENTER:
-            rect.origin.x -= (width / 2.0);
-            rect.origin.y -= (height / 2.0);
-            break;
-        case OBS_ALIGN_RIGHT: // Right Center
-            rect.origin.x -= width;
-            rect.origin.y -= (height / 2.0);
-            break;
-        case OBS_ALIGN_LEFT | OBS_ALIGN_BOTTOM:
-            rect.origin.y -= height;
-            break;
-        case OBS_ALIGN_RIGHT | OBS_ALIGN_BOTTOM:
-            rect.origin.x -= width;
-            rect.origin.y -= height;
-            break;
+    obsvisibility::Scene *scene = visibility.scene([sceneName UTF8String]);
+    BOOL updated = NO;
+    if (scene != nullptr) {
+        if ([message.eventType isEqualToString:@"SceneItemEnableStateChanged"]) {
+            updated = scene->setEnabled(item.sceneItemId, item.sceneItemEnabled);
+        } else {
+            updated = scene->setTransform(item.sceneItemId, PSMTransformFrom(item));
+        }
+    }
+    if (updated) {
+        [self updateVisibleSourcesForScene:sceneName];
+    } else {
+        [self sceneItemsAreOutOfDate:sceneName];
     }
-    return rect;
 }
 
-- (NSArray *)visibleSourceItemNames:(NSArray *)sceneItems {
-    NSMutableArray *array = [NSMutableArray array];
-    pixman_region32_t region, screenRegion, diffRegion;
-
-    pixman_region32_init(&region);
-    pixman_region32_init(&diffRegion);
-    pixman_region32_init_rect(&screenRegion, 0, 0, self.baseWidth, self.baseHeight);
-
-    NSArray *sourceNames = [(AppDelegate *)[NSApp delegate] obsSourceNames];
-    // Item 0 is at the bottom of the visiblity stack.
-    for (NSDictionary *dict in [sceneItems reverseObjectEnumerator]) {
-        NSString *sourceName = dict[@"sourceName"];
-        // Only the cameras we know about. We don't know what inputKinds correspond to cameras.
-        if (![sourceNames containsObject:sourceName]) {
-            continue;
-        }
-        if ([dict[@"sceneItemEnabled"] boolValue] == NO) {
-            continue;
-        }
-        BOOL doesFill = YES;
-        // From github: width and height are computed values using respectively sourceWidth * scaleX and sourceHeight * scaleY
-        NSDictionary *xform = dict[@"sceneItemTransform"];
-        
-        // Zero width/height means use the whole screen.
-        CGFloat width = [xform[@"width"] floatValue] ?: self.baseWidth;
-        CGFloat height = [xform[@"height"] floatValue] ?: self.baseHeight;
-        // If we can't test it, assume it fills.
-        if (height > 0 && width > 0) {
-            CGRect testRect = CGRectZero;
-            CGFloat sourceWidth = [xform[@"sourceWidth"] floatValue] ?: self.baseWidth;
-            CGFloat sourceHeight = [xform[@"sourceHeight"] floatValue] ?: self.baseHeight;
-            // PositionXY - absolute position on the screen.
-            CGFloat positionX = [xform[@"positionX"] floatValue];
-            CGFloat positionY = [xform[@"positionY"] floatValue];
-            CGFloat cropLeft = [xform[@"cropLeft"] floatValue];
-            CGFloat cropRight = [xform[@"cropRight"] floatValue];
-            CGFloat cropTop = [xform[@"cropTop"] floatValue];
-            CGFloat cropBottom = [xform[@"cropBottom"] floatValue];
-            if ([xform[@"boundsType"] isEqualToString:@"OBS_BOUNDS_NONE"]) {
-                testRect = CGRectMake(positionX, positionY, width, height);
-            } else {
-                // boundsAlignment does not affect the geometry we care about
-                CGFloat boundsWidth = [xform[@"boundsWidth"] floatValue];
-                CGFloat boundsHeight = [xform[@"boundsHeight"] floatValue];
-                testRect = CGRectMake(positionX, positionY, boundsWidth, boundsHeight);
-            }
-            NSInteger alignment = [xform[@"alignment"] intValue];
-            testRect = [self adjustRect:testRect forAlignment:alignment];
-            // crop values only matter in that they change the width/height of what's visible.
-            testRect.size.width -= (cropLeft + cropRight);
-            testRect.size.height -= (cropTop + cropBottom);
-            testRect = NSIntegralRect(testRect);
-            CGFloat testHeight = MIN(sourceHeight, testRect.size.height);
-            CGFloat testWidth = MIN(sourceWidth, testRect.size.width);
-            // Do a simple fill check. If it's wider, it fills
-            doesFill = (testRect.origin.x == 0) && (testRect.origin.x == 0) && isCloseEnough(sourceHeight, testHeight) && isCloseEnough(sourceWidth, testWidth);
-            // OK, now play with regions.
-            if (!doesFill) {
-                // Add this rect to the accumulated 'region'.
-                pixman_region32_union_rect(&region, &region, testRect.origin.x, testRect.origin.y, testRect.size.width, testRect.size.height);
-                pixman_region32_subtract(&diffRegion, &screenRegion, &region);
-                int rects = pixman_region32_n_rects(&diffRegion);
-                if (rects == 0) {
-                    // Nothing left after subtracting region from screen.
-                    doesFill = YES;
-                }
-            }
-        }
-        [array addObject:sourceName];
-        if (doesFill) {
-            // Anything below a source collection that covers the screen is not visible.
-            break;
-        }
+// Items were added, removed or reordered, or we missed something. Only the current scenes are worth
+// asking about again; any other scene is fetched when it becomes current.
+- (void)sceneItemsAreOutOfDate:(NSString *)sceneName {
+    if ([sceneName isEqualToString:self.currentProgramScene] || [sceneName isEqualToString:self.currentPreviewScene]) {
+        [self refreshSceneItemsForScene:sceneName];
+    } else if (sceneName != nil) {
+        visibility.remove([sceneName UTF8String]);
     }
-    pixman_region32_fini(&diffRegion);
-    pixman_region32_fini(&region);
-    pixman_region32_fini(&screenRegion);
-    return array;
 }
 
-
-- (void)scene:(NSString *)sceneName didChangeItems:(NSArray *)sceneItems {
-    NSLog(@"sceneName '%@' program '%@' preview '%@'", sceneName, self.currentProgramScene, self.currentPreviewScene);
-    // Same scene can be preview and program. Don't cache; a scene's active cameras can change at any time, which we are also tracking.
+// If sceneName is the program or preview scene and we have its items, work out what's showing.
+// Same scene can be preview and program.
+- (void)updateVisibleSourcesForScene:(NSString *)sceneName {
     BOOL isProgram = [sceneName isEqualToString:self.currentProgramScene];
     BOOL isPreview = [sceneName isEqualToString:self.currentPreviewScene];
-    if (isProgram || isPreview) {
-        NSArray *names = [self visibleSourceItemNames:sceneItems];
-        if (isProgram) {
-            self.currentProgramSourceNames = names;
-            NSLog(@"program %@", [self.currentProgramSourceNames description]);
-        }
-        if (isPreview ){
-            self.currentPreviewSourceNames = names;
-            NSLog(@"preview %@", [self.currentPreviewSourceNames description]);
-        }
+    obsvisibility::Scene *scene = (isProgram || isPreview) ? visibility.scene([sceneName UTF8String]) : nullptr;
+    if (scene == nullptr) {
+        return;
+    }
+    [self updateVisibilityCanvas];
+    const std::vector<std::string>& visible = scene->visibleSources();
+    NSMutableArray *names = [NSMutableArray arrayWithCapacity:visible.size()];
+    for (const std::string& name : visible) {
+        [names addObject:@(name.c_str())];
+    }
+    BOOL changed = NO;
+    if (isProgram && ![names isEqualToArray:self.currentProgramSourceNames]) {
+        self.currentProgramSourceNames = names;
+        PTZLog(@"program %@", [self.currentProgramSourceNames description]);
+        changed = YES;
+    }
+    if (isPreview && ![names isEqualToArray:self.currentPreviewSourceNames]) {
+        self.currentPreviewSourceNames = names;
+        PTZLog(@"preview %@", [self.currentPreviewSourceNames description]);
+        changed = YES;
+    }
+    [self logTimingForScene:sceneName];
+    if (changed) {
         [[NSNotificationCenter defaultCenter]
          postNotificationName:PSMOBSCurrentSourceDidChangeNotification
          object:nil
@@ -724,6 +821,20 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
     }
 }
 
+// How long it took to get from connecting, or from the scene change, to knowing which sources are showing.
+- (void)logTimingForScene:(NSString *)sceneName {
+    NSTimeInterval now = PSMOBSNow();
+    if (!self.loggedSetupTime && self.currentProgramSourceNames != nil) {
+        self.loggedSetupTime = YES;
+        PTZLog(@"OBS ready: program sources known %.0f ms after connecting", (now - self.connectStartTime) * 1000);
+    }
+    NSNumber *changeTime = self.sceneChangeTimes[sceneName];
+    if (changeTime != nil) {
+        [self.sceneChangeTimes removeObjectForKey:sceneName];
+        PTZLog(@"OBS scene '%@' sources updated %.1f ms after the scene change", sceneName, (now - [changeTime doubleValue]) * 1000);
+    }
+}
+
 #pragma mark WebSocket thread
 
 - (void)onSomeApplicationDidLaunch:(NSNotification *)note {
@@ -739,25 +850,61 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
 }
 
 // WARNING! If you send anything before the identification is complete, OBS will drop you. Any user-facing methods (like the requests) need to be careful
-- (void)sendString:(NSString *)str {
-    outgoing.push([str UTF8String]);
+// Encoded for whichever subprotocol the socket thread negotiated; it has, by the time OBS says Hello.
+// Main thread only: it's outgoing's one producer.
+- (void)sendMessage:(NSDictionary *)message {
+    std::string data;
+    if (self.useMessagePack) {
+        NSData *msgpack = [PSMOBSMessage messagePackDataWithJSONObject:message];
+        if (msgpack == nil) {
+            return;
+        }
+        data.assign((const char *)msgpack.bytes, msgpack.length);
+    } else {
+        NSString *str = [self convertToJSON:message];
+        if (str == nil) {
+            return;
+        }
+        data = [str UTF8String];
+    }
+    if (!outgoing.push(std::move(data))) {
+        NSLog(@"OBS outgoing queue is full; dropping %@", message[@"d"][@"requestType"] ?: message[@"op"]);
+        return;
+    }
+    [self wakeSocketThread];
+}
+
+// Safe from any thread. If the pipe is full there's already a wakeup pending, so EAGAIN is fine.
+- (void)wakeSocketThread {
+    if (wakePipe[1] >= 0) {
+        const char c = 0;
+        (void)write(wakePipe[1], &c, 1);
+    }
 }
 
-- (void)recvString {
+// Socket thread, after pushing to incoming. One block on the main queue handles everything
+// that's waiting, however many messages arrived while it was on its way.
+- (void)recvMessages {
+    if (incomingScheduled.exchange(true)) {
+        return;
+    }
     dispatch_async(dispatch_get_main_queue(), ^{
-        std::string s;
-        if (self->incoming.pop(s)) {
-            const char *msg = s.c_str();
-            NSData *data = [NSData dataWithBytes:msg length:strlen(msg)];
-            NSError *error;
-            id msgObj = [NSJSONSerialization JSONObjectWithData:data
-                             options:0
-                               error:&error];
-            [self handleJSON:msgObj];
-        }
+        // Clear the flag first: anything pushed after this schedules another drain.
+        self->incomingScheduled.exchange(false);
+        self->incoming.drain([self](PSMOBSMessage *message) {
+            [self handleMessage:message];
+        });
     });
 }
 
+- (void)logQueueStats {
+    spsc::Stats sent = outgoing.stats(), received = incoming.stats();
+    NSLog(@"OBS outgoing queue: %llu queued, %llu dropped, high water %zu, wait %.2f ms average, %.2f ms max",
+          sent.pushed, sent.rejected, sent.highWater, sent.averageLatencyMS(), sent.maxLatencyMS());
+    NSLog(@"OBS incoming queue: %llu received, high water %zu, wait %.2f ms average, %.2f ms max",
+          received.popped, received.highWater, received.averageLatencyMS(), received.maxLatencyMS());
+}
+
 - (void)connectionIsReady {
     dispatch_async(dispatch_get_main_queue(), ^{
         [[NSNotificationCenter defaultCenter]
@@ -769,8 +916,12 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
 
 - (void)connectionDidEnd {
     dispatch_async(dispatch_get_main_queue(), ^{
+        [self logQueueStats];
         self.connected = NO;
         self.isReady = NO;
+        [self.pendingSceneItemRefreshes removeAllObjects];
+        self->visibility.clear();
+        [self failAllSnapshotRequests];
         if (self.obsState == OBSStateWaitingForAuthorization) {
             NSLog(@"Connection ended while waiting for auth; retrying with prompt");
             if (self.authType == OBSAuthTypeKeychainAttempt) {
@@ -794,10 +945,12 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
 }
 
 - (void)runSocketFromURL:(NSString *)url {
-    
+    self.connectStartTime = PSMOBSNow();
+    self.loggedSetupTime = NO;
+    [self.sceneChangeTimes removeAllObjects];
     dispatch_async(socketQueue, ^() {
         using easywsclient::WebSocket;
-        std::unique_ptr<WebSocket> ws(WebSocket::from_url([url UTF8String]));
+        std::unique_ptr<WebSocket> ws(WebSocket::from_url([url UTF8String], std::string(), PSMOBSSubprotocols));
         if (ws == NULL) {
             NSLog(@"Unable to connect to %@", url);
             if (![self obsIsRunning]) {
@@ -806,20 +959,40 @@ JSON_GET_REQUEST_TYPE(GetVideoSettings)
             return;
         }
         self.running = YES;
+        BOOL useMessagePack = ws->getProtocol() == PSMOBSMessagePackSubprotocol;
+        self.useMessagePack = useMessagePack;
         [self stopObservingRunningApps];
+        // Anything left from the last connection is for a session OBS has forgotten, and sending
+        // it before Identify would get us dropped.
+        self->outgoing.clear();
         while (self.running) {
             if (ws->getReadyState() == WebSocket::CLOSED)
                 break;
-            std::string data;
-            if (self->outgoing.pop(data)) {
-                ws->send(data);
-            }
-            ws->poll();
-            ws->dispatch([&](const std::string & message) {
-                self->incoming.push(message);
-                [self recvString];
+            // Queue everything that's waiting; poll writes as much as the socket will take.
+            self->outgoing.drain([&](std::string&& data) {
+                if (useMessagePack) {
+                    ws->sendBinary(data);
+                } else {
+                    ws->send(data);
+                }
+            });
+            ws->poll(PSMOBSSocketPollTimeoutMS, self->wakePipe[0]);
+            // The view points into easywsclient's receive buffer. Decode it here, on the socket thread,
+            // so the main thread only gets the handful of fields it uses - and never the JSON for a screenshot.
+            ws->dispatchView([&](const uint8_t *bytes, size_t length) {
+                @autoreleasepool {
+                    PSMOBSMessage *message = useMessagePack
+                        ? [PSMOBSMessage messageWithMessagePackBytes:bytes length:length]
+                        : [PSMOBSMessage messageWithJSONBytes:bytes length:length];
+                    if (message != nil) {
+                        while (!self->incoming.push(std::move(message)) && self.running) {
+                            [self recvMessages];
+                            usleep(PSMOBSQueueFullBackoffUS);
+                        }
+                        [self recvMessages];
+                    }
+                }
             });
-            [NSThread sleepForTimeInterval:0.01];
         }
         ws->close();
         ws->poll();
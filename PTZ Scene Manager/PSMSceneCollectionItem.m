@@ -70,21 +70,33 @@ static PSMSceneCollectionItem *selfType;
 }
 
 - (IBAction)sceneSet:(id)sender {
-    [self.camera memorySet:self.sceneNumber onDone:^(BOOL success) {
+    NSDate *start = [NSDate date];
+    NSInteger sceneNumber = self.sceneNumber;
+    [self.camera memorySet:sceneNumber onDone:^(BOOL success) {
         if (success) {
-            [self.camera fetchSnapshotAtIndex:self.sceneNumber onDone:^(NSData *data, NSImage *image, NSInteger index) {
-                if (data != nil && index == self.sceneNumber) {
+            void (^snapshotDone)(NSData *, NSImage *) = ^(NSData *data, NSImage *image) {
+                if (data != nil && sceneNumber == self.sceneNumber) {
                     NSImage *testImage = image != nil ? image : [[NSImage alloc] initWithData:data];
                     if (!NSEqualSizes(testImage.size, NSZeroSize)) {
                         self.image = testImage;
                         [self.prefCamera saveSnapshotAtIndex:self.sceneNumber  withData:data];
                         PSMSceneWindowController *wc = (PSMSceneWindowController *)self.view.window.windowController;
                         [wc updateStaticSnapshot:self.image];
+                        PTZLog(@"Scene %ld thumbnail saved %.0f ms after set", (long)sceneNumber, -[start timeIntervalSinceNow] * 1000);
                     } else {
                         NSLog(@"Bad scene image");
                     }
                 }
-            }];
+            };
+            // The window has the live video, if there is any.
+            PSMSceneWindowController *wc = (PSMSceneWindowController *)self.view.window.windowController;
+            if (wc != nil) {
+                [wc fetchPresetSnapshotAtIndex:sceneNumber onDone:snapshotDone];
+            } else {
+                [self.camera fetchSnapshotAtIndex:sceneNumber onDone:^(NSData *data, NSImage *image, NSInteger index) {
+                    snapshotDone(data, image);
+                }];
+            }
         }
     }];
 }
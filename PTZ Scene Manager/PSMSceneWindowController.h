@@ -27,6 +27,9 @@ typedef void (^PTZOperationBlock)(void);
 - (void)confirmCameraOperation:(PTZOperationBlock)operationBlock;
 
 - (void)fetchStaticSnapshot;
+// A new snapshot for the scene at index: the next frame of the live video if it's playing,
+// otherwise one from the camera or OBS. Called on the main thread, with nil on failure.
+- (void)fetchPresetSnapshotAtIndex:(NSInteger)index onDone:(void (^)(NSData * _Nullable data, NSImage * _Nullable image))doneBlock;
 - (void)updateStaticSnapshot:(NSImage *)image;
 - (void)updateVisibleValues;
 
@@ -13,6 +13,7 @@
 #import "PSMCameraStateWindowController.h"
 #import "PSMSceneCollectionItem.h"
 #import "PSMOBSWebSocketController.h"
+#import "PSMSnapshotPoller.h"
 #import "RTSPViewController.h"
 #import "AppDelegate.h"
 #import "DraggingStackView.h"
@@ -21,6 +22,8 @@
 
 static PSMSceneWindowController *selfType;
 static NSString *PTZControlStackOrderKey = @"ControlStackOrder";
+// Scene snapshots are shown at thumbnail size; OBS is asked for this width too.
+static const CGFloat PSMPresetSnapshotWidth = 480;
 
 // enum: row * 10 + column
 typedef enum {
@@ -68,8 +71,7 @@ typedef enum {
 @property IBOutlet DraggingStackView *controlStackView;
 @property IBOutlet NSSplitViewController *splitViewController;
 @property IBOutlet NSGridView *panTiltGridView;
-@property NSTimer *timer;
-@property dispatch_queue_t timerQueue;
+@property PSMSnapshotPoller *snapshotPoller;
 @property NSArray *presetSpeedValues;
 @property BOOL showOSDRemoteTitle;
 
@@ -128,6 +130,7 @@ typedef enum {
                       @"prefCamera.cameraname",
                       @"prefCamera.menuIndex",
                       @"prefCamera.thumbnailOption",
+                      @"prefCamera.rtspRefreshInterval",
                       @"lastRecalledItem",
                       @"prefCamera.camera.cameraIsOpen",
                       @"window.tabGroup.windows"];
@@ -170,6 +173,7 @@ typedef enum {
         [self updateActiveIndicators];
     }];
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(onOBSSessionDidEnd:) name:PSMOBSSessionDidEnd object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(windowDidChangeOcclusionState:) name:NSWindowDidChangeOcclusionStateNotification object:self.window];
     if ([[PSMOBSWebSocketController defaultController] connected]) {
         [self onOBSSessionDidBegin:nil];
     } else {
@@ -203,6 +207,8 @@ typedef enum {
         self.showStaticSnapshot = YES;
     } else {
         [self stopTimer];
+        // Cameras that only need a glance can be a picture every few seconds instead of video.
+        self.rtspViewController.refreshInterval = self.prefCamera.rtspRefreshInterval;
         if ([self.rtspViewController hasVideo]) {
             [self.rtspViewController resumeVideo];
         } else {
@@ -418,47 +424,81 @@ typedef enum {
 
 #pragma mark static snapshot
 
+// One snapshot request in flight at a time; a slow camera gets polled less often instead of piling up requests.
+- (PSMSnapshotPoller *)snapshotPoller {
+    if (_snapshotPoller == nil) {
+        __weak typeof(self) weakSelf = self;
+        _snapshotPoller = [[PSMSnapshotPoller alloc] initWithFetchBlock:^(PSMSnapshotPollerDoneBlock doneBlock) {
+            [weakSelf.camera fetchSnapshotAtIndex:-1 onDone:^(NSData *data, NSImage *image, NSInteger index) {
+                NSImage *testImage = image;
+                if (testImage == nil && data != nil) {
+                    testImage = [[NSImage alloc] initWithData:data];
+                }
+                if (testImage != nil && NSEqualSizes(testImage.size, NSZeroSize)) {
+                    NSLog(@"Bad static snapshot image");
+                    testImage = nil;
+                }
+                doneBlock(testImage);
+            }];
+        } imageBlock:^(NSImage *image) {
+            typeof(self) strongSelf = weakSelf;
+            if (strongSelf.showStaticSnapshot) {
+                [strongSelf.rtspViewController setStaticImage:image];
+            }
+        }];
+        // Live updates are for while a navigation button is held down.
+        _snapshotPoller.runLoopModes = @[NSEventTrackingRunLoopMode];
+        _snapshotPoller.visible = (self.window.occlusionState & NSWindowOcclusionStateVisible) != 0;
+    }
+    return _snapshotPoller;
+}
+
+- (void)windowDidChangeOcclusionState:(NSNotification *)note {
+    BOOL visible = (self.window.occlusionState & NSWindowOcclusionStateVisible) != 0;
+    self.snapshotPoller.visible = visible;
+    self.rtspViewController.occluded = !visible;
+}
+
 - (void)stopTimer {
-    [self.timer invalidate];
-    self.timer = nil;
+    [_snapshotPoller stop];
 }
 
 - (void)startTimer {
-    if (self.showStaticSnapshot && self.timer == nil) {
-        if (self.timerQueue == nil) {
-            NSString *name = [NSString stringWithFormat:@"timerQueue_0x%p", self];
-            self.timerQueue = dispatch_queue_create([name UTF8String], NULL);
-        }
-        self.timer = [NSTimer timerWithTimeInterval:0.1 target:self selector:@selector(timerUpdate:) userInfo:nil repeats:YES];
-        dispatch_sync(self.timerQueue, ^{
-            [[NSRunLoop currentRunLoop] addTimer:self.timer forMode:NSEventTrackingRunLoopMode];
-            [self.timer fire];
-        });
+    if (self.showStaticSnapshot) {
+        [self.snapshotPoller start];
     }
 }
 
-- (void)timerUpdate:(NSTimer *)timer {
-    [self fetchStaticSnapshot];
-}
-
 - (void)fetchStaticSnapshot {
     if (self.showStaticSnapshot) {
-        [self.camera fetchSnapshotAtIndex:-1 onDone:^(NSData *data, NSImage *image, NSInteger index) {
-            NSImage *testImage = image;
-            if (testImage == nil && data != nil) {
-                testImage = [[NSImage alloc] initWithData:data];
-            }
-            if (testImage != nil) {
-                if (!NSEqualSizes(testImage.size, NSZeroSize)) {
-                    [self.rtspViewController setStaticImage:testImage];
-                } else {
-                    NSLog(@"Bad static snapshot image");
-                }
-            }
-        }];
+        [self.snapshotPoller pollNow];
+    }
+}
+
+- (void)fetchPresetSnapshotAtIndex:(NSInteger)index onDone:(void (^)(NSData *, NSImage *))doneBlock {
+    // The camera's snapshot.jpg is made on demand, and OBS has to be asked for one; the video
+    // already has the picture.
+    NSDate *start = [NSDate date];
+    BOOL live = [self.rtspViewController captureSnapshotWithMaxWidth:PSMPresetSnapshotWidth onDone:^(NSData *data, NSImage *image) {
+        if (data != nil) {
+            PTZLog(@"Scene %ld snapshot from video in %.0f ms", (long)index, -[start timeIntervalSinceNow] * 1000);
+            doneBlock(data, image);
+        } else {
+            [self fetchCameraSnapshotAtIndex:index start:start onDone:doneBlock];
+        }
+    }];
+    if (!live) {
+        [self fetchCameraSnapshotAtIndex:index start:start onDone:doneBlock];
     }
 }
 
+- (void)fetchCameraSnapshotAtIndex:(NSInteger)index start:(NSDate *)start onDone:(void (^)(NSData *, NSImage *))doneBlock {
+    [self.camera fetchSnapshotAtIndex:index onDone:^(NSData *data, NSImage *image, NSInteger requestIndex) {
+        PTZLog(@"Scene %ld snapshot from camera in %.0f ms", (long)index, -[start timeIntervalSinceNow] * 1000);
+        doneBlock(data, image);
+    }];
+}
+
 - (void)updateStaticSnapshot:(NSImage *)image {
     if (self.showStaticSnapshot) {
         [self.rtspViewController setStaticImage:image];
@@ -670,7 +710,7 @@ typedef enum {
             break;
     }
     [self.camera applyPanTiltRelativePosition:params onDone:^(BOOL success) {
-        if (success && self.timer == nil) {
+        if (success && !self.snapshotPoller.running) {
             [self fetchStaticSnapshot];
         }
     }];
@@ -1018,7 +1058,8 @@ typedef enum {
         }
     } else if ([keyPath isEqualToString:@"prefCamera.cameraname"] || [keyPath isEqualToString:@"prefCamera.menuIndex"]) {
         [self.appDelegate changeWindowsItem:self.window title:self.prefCamera.cameraname menuShortcut:self.prefCamera.menuIndex];
-    } else if ([keyPath isEqualToString:@"prefCamera.thumbnailOption"]) {
+    } else if ([keyPath isEqualToString:@"prefCamera.thumbnailOption"]
+               || [keyPath isEqualToString:@"prefCamera.rtspRefreshInterval"]) {
         [self updateThumbnailContent];
     } else if ([keyPath isEqualToString:@"prefCamera.camera.cameraIsOpen"]
                || [keyPath isEqualToString:@"window.tabGroup.windows"]) {
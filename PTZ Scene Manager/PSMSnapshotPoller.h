@@ -0,0 +1,60 @@
+//
+//  PSMSnapshotPoller.h
+//  PTZ Scene Manager
+//
+// Polls a camera for static snapshots with at most one request in flight.
+// The next request is scheduled when the previous one finishes, spaced by how long the camera
+// took to answer, slowed down while the window can't be seen, and backed off after errors.
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Call exactly once, on any thread, with nil for a failed request.
+typedef void (^PSMSnapshotPollerDoneBlock)(NSImage * _Nullable image);
+typedef void (^PSMSnapshotPollerFetchBlock)(PSMSnapshotPollerDoneBlock doneBlock);
+typedef void (^PSMSnapshotPollerImageBlock)(NSImage *image);
+
+@interface PSMSnapshotPoller : NSObject
+
+// Modes the poll timer runs in. Default NSRunLoopCommonModes.
+@property (copy) NSArray<NSRunLoopMode> *runLoopModes;
+// Fastest polling rate, as a delay between request starts. Default 0.1 seconds.
+@property NSTimeInterval minInterval;
+// Delay between requests while not visible. Default 2 seconds.
+@property NSTimeInterval hiddenInterval;
+// Time the camera gets to rest after each reply, as a fraction of its response time. Default 0.5.
+@property double restFraction;
+// First delay after an error; it doubles with each further error, up to maxBackoff. Defaults 0.5 and 10 seconds.
+@property NSTimeInterval backoffInterval;
+@property NSTimeInterval maxBackoff;
+// A request that hasn't finished by now counts as failed, and a late reply is dropped. Default 10 seconds.
+@property NSTimeInterval requestTimeout;
+// Set from the window's occlusion state.
+@property (nonatomic) BOOL visible;
+
+@property (readonly, getter=isRunning) BOOL running;
+@property (readonly) BOOL requestInFlight;
+
+// Images per second delivered recently.
+@property (readonly) double achievedFPS;
+// Smoothed time from starting a request to its reply.
+@property (readonly) NSTimeInterval averageResponseTime;
+@property (readonly) NSUInteger requestCount;
+@property (readonly) NSUInteger successCount;
+@property (readonly) NSUInteger errorCount;
+// Polls skipped because a request was already in flight, plus replies dropped after a timeout.
+@property (readonly) NSUInteger droppedCount;
+
+// imageBlock is called on the main thread.
+- (instancetype)initWithFetchBlock:(PSMSnapshotPollerFetchBlock)fetchBlock imageBlock:(PSMSnapshotPollerImageBlock)imageBlock;
+
+- (void)start;
+- (void)stop;
+// Request one snapshot now, running or not. Does nothing except count a drop if one is in flight.
+- (void)pollNow;
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,189 @@
+//
+//  PSMSnapshotPoller.m
+//  PTZ Scene Manager
+//
+
+#import "PSMSnapshotPoller.h"
+
+// Weight of the newest sample in the smoothed response time and frame rate.
+static const double PSMPollerSmoothing = 0.2;
+
+@interface PSMSnapshotPoller ()
+@property (copy) PSMSnapshotPollerFetchBlock fetchBlock;
+@property (copy) PSMSnapshotPollerImageBlock imageBlock;
+@property NSTimer *pollTimer;
+@property NSTimer *timeoutTimer;
+@property BOOL running;
+@property BOOL requestInFlight;
+// Bumped for every request, so a reply that shows up after its timeout can be recognized.
+@property NSUInteger generation;
+@property NSTimeInterval requestStart;
+@property NSTimeInterval lastImageTime;
+@property NSUInteger consecutiveErrors;
+@property double achievedFPS;
+@property NSTimeInterval averageResponseTime;
+@property NSUInteger requestCount;
+@property NSUInteger successCount;
+@property NSUInteger errorCount;
+@property NSUInteger droppedCount;
+@end
+
+@implementation PSMSnapshotPoller
+
+- (instancetype)initWithFetchBlock:(PSMSnapshotPollerFetchBlock)fetchBlock imageBlock:(PSMSnapshotPollerImageBlock)imageBlock {
+    self = [super init];
+    if (self) {
+        _fetchBlock = fetchBlock;
+        _imageBlock = imageBlock;
+        _runLoopModes = @[NSRunLoopCommonModes];
+        _minInterval = 0.1;
+        _hiddenInterval = 2;
+        _restFraction = 0.5;
+        _backoffInterval = 0.5;
+        _maxBackoff = 10;
+        _requestTimeout = 10;
+        _visible = YES;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_pollTimer invalidate];
+    [_timeoutTimer invalidate];
+}
+
+#pragma mark scheduling
+
+- (NSTimeInterval)now {
+    return [NSDate timeIntervalSinceReferenceDate];
+}
+
+// Delay from the end of one request to the start of the next.
+- (NSTimeInterval)nextDelay {
+    if (self.consecutiveErrors > 0) {
+        double backoff = self.backoffInterval * pow(2, self.consecutiveErrors - 1);
+        return MIN(backoff, self.maxBackoff);
+    }
+    NSTimeInterval rtt = self.averageResponseTime;
+    if (!self.visible) {
+        return MAX(self.hiddenInterval - rtt, 0);
+    }
+    // Don't start more often than minInterval, and let a slow camera rest between requests.
+    return MAX(self.minInterval - rtt, self.restFraction * rtt);
+}
+
+- (void)schedulePollAfter:(NSTimeInterval)delay {
+    [self.pollTimer invalidate];
+    self.pollTimer = [NSTimer timerWithTimeInterval:delay target:self selector:@selector(pollTimerFired:) userInfo:nil repeats:NO];
+    for (NSRunLoopMode mode in self.runLoopModes) {
+        [[NSRunLoop mainRunLoop] addTimer:self.pollTimer forMode:mode];
+    }
+}
+
+- (void)pollTimerFired:(NSTimer *)timer {
+    self.pollTimer = nil;
+    if (self.running) {
+        [self pollNow];
+    }
+}
+
+- (void)timeoutTimerFired:(NSTimer *)timer {
+    self.timeoutTimer = nil;
+    if (self.requestInFlight) {
+        // Whatever comes back for this generation now is dropped.
+        self.generation++;
+        self.droppedCount++;
+        [self finishRequestWithImage:nil];
+    }
+}
+
+#pragma mark requests
+
+- (void)start {
+    if (self.running) {
+        return;
+    }
+    self.running = YES;
+    self.consecutiveErrors = 0;
+    // The gap since the last run isn't a frame interval.
+    self.lastImageTime = 0;
+    if (!self.requestInFlight) {
+        [self pollNow];
+    }
+}
+
+- (void)stop {
+    self.running = NO;
+    [self.pollTimer invalidate];
+    self.pollTimer = nil;
+    // An in-flight request is allowed to finish; it's still a valid image.
+}
+
+- (void)pollNow {
+    if (self.requestInFlight) {
+        self.droppedCount++;
+        return;
+    }
+    [self.pollTimer invalidate];
+    self.pollTimer = nil;
+    self.requestInFlight = YES;
+    self.requestCount++;
+    self.requestStart = [self now];
+    NSUInteger generation = ++self.generation;
+    self.timeoutTimer = [NSTimer timerWithTimeInterval:self.requestTimeout target:self selector:@selector(timeoutTimerFired:) userInfo:nil repeats:NO];
+    [[NSRunLoop mainRunLoop] addTimer:self.timeoutTimer forMode:NSRunLoopCommonModes];
+
+    __weak typeof(self) weakSelf = self;
+    self.fetchBlock(^(NSImage *image) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            typeof(self) strongSelf = weakSelf;
+            if (strongSelf == nil || !strongSelf.requestInFlight || strongSelf.generation != generation) {
+                return;
+            }
+            [strongSelf finishRequestWithImage:image];
+        });
+    });
+}
+
+- (void)finishRequestWithImage:(NSImage *)image {
+    [self.timeoutTimer invalidate];
+    self.timeoutTimer = nil;
+    self.requestInFlight = NO;
+    NSTimeInterval now = [self now];
+    if (image != nil) {
+        NSTimeInterval rtt = now - self.requestStart;
+        self.averageResponseTime = self.successCount == 0 ? rtt : self.averageResponseTime + PSMPollerSmoothing * (rtt - self.averageResponseTime);
+        if (self.lastImageTime > 0 && now > self.lastImageTime) {
+            double fps = 1 / (now - self.lastImageTime);
+            self.achievedFPS = self.achievedFPS == 0 ? fps : self.achievedFPS + PSMPollerSmoothing * (fps - self.achievedFPS);
+        }
+        self.lastImageTime = now;
+        self.successCount++;
+        self.consecutiveErrors = 0;
+        self.imageBlock(image);
+    } else {
+        self.errorCount++;
+        self.consecutiveErrors++;
+    }
+    if (self.running) {
+        [self schedulePollAfter:[self nextDelay]];
+    }
+}
+
+- (void)setVisible:(BOOL)visible {
+    BOOL wasVisible = _visible;
+    _visible = visible;
+    // Coming back into view shouldn't wait out the rest of a hidden interval.
+    if (visible && !wasVisible && self.running && !self.requestInFlight && self.consecutiveErrors == 0) {
+        [self schedulePollAfter:[self nextDelay]];
+    }
+}
+
+- (void)resetStatistics {
+    self.achievedFPS = 0;
+    self.averageResponseTime = 0;
+    self.lastImageTime = 0;
+    self.requestCount = self.successCount = self.errorCount = self.droppedCount = 0;
+}
+
+@end
@@ -0,0 +1,38 @@
+//
+//  PSMThumbnailCache.h
+//  PTZ Scene Manager
+//
+// Decoded, display-sized scene snapshots shared by every scene window.
+// Entries are keyed by camera key and scene index, and remember the size and modification
+// date of the snapshot file they were decoded from, so a file replaced behind our back is
+// decoded again instead of showing a stale image.
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface PSMThumbnailCache : NSObject
+
++ (instancetype)sharedCache;
+
+// Least recently used thumbnails are dropped once the decoded pixels exceed this. Default 64 MB.
+@property (nonatomic) NSUInteger maxBytes;
+// Longest side, in pixels, of a decoded thumbnail. Default 480, a Retina scene item.
+@property NSUInteger maxPixelSize;
+
+@property (readonly) NSUInteger hits;
+@property (readonly) NSUInteger misses;
+@property (readonly) NSUInteger evictions;
+@property (readonly) NSUInteger currentBytes;
+@property (readonly) NSUInteger count;
+@property (readonly) double hitRate;
+
+// Returns nil if there is no readable image at path.
+- (nullable NSImage *)thumbnailForPath:(NSString *)path cameraKey:(NSString *)cameraKey index:(NSInteger)index;
+- (void)invalidateCameraKey:(NSString *)cameraKey index:(NSInteger)index;
+- (void)removeAllThumbnails;
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
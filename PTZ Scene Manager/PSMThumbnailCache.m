@@ -0,0 +1,211 @@
+//
+//  PSMThumbnailCache.m
+//  PTZ Scene Manager
+//
+
+#import <ImageIO/ImageIO.h>
+#include <sys/stat.h>
+#import "PSMThumbnailCache.h"
+
+@interface PSMThumbnailEntry : NSObject
+@property NSString *key;
+@property NSImage *image;
+@property NSUInteger bytes;
+// Identifies the file contents the image was decoded from.
+@property off_t fileSize;
+@property struct timespec fileDate;
+// LRU list; the cache's dictionary owns the entries.
+@property (weak) PSMThumbnailEntry *newer;
+@property (weak) PSMThumbnailEntry *older;
+@end
+
+@implementation PSMThumbnailEntry
+@end
+
+@interface PSMThumbnailCache ()
+@property NSMutableDictionary<NSString *, PSMThumbnailEntry *> *entries;
+@property (weak) PSMThumbnailEntry *newest;
+@property (weak) PSMThumbnailEntry *oldest;
+@property NSUInteger hits;
+@property NSUInteger misses;
+@property NSUInteger evictions;
+@property NSUInteger currentBytes;
+@end
+
+@implementation PSMThumbnailCache
+
++ (instancetype)sharedCache {
+    static PSMThumbnailCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [PSMThumbnailCache new];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableDictionary dictionary];
+        _maxBytes = 64 * 1024 * 1024;
+        _maxPixelSize = 480;
+    }
+    return self;
+}
+
+- (NSString *)keyForCameraKey:(NSString *)cameraKey index:(NSInteger)index {
+    return [NSString stringWithFormat:@"%@_%ld", cameraKey, (long)index];
+}
+
+#pragma mark LRU list
+
+- (void)unlinkEntry:(PSMThumbnailEntry *)entry {
+    if (entry.newer != nil) {
+        entry.newer.older = entry.older;
+    } else {
+        self.newest = entry.older;
+    }
+    if (entry.older != nil) {
+        entry.older.newer = entry.newer;
+    } else {
+        self.oldest = entry.newer;
+    }
+    entry.newer = entry.older = nil;
+}
+
+- (void)pushEntry:(PSMThumbnailEntry *)entry {
+    entry.older = self.newest;
+    entry.newer = nil;
+    self.newest.newer = entry;
+    self.newest = entry;
+    if (self.oldest == nil) {
+        self.oldest = entry;
+    }
+}
+
+- (void)removeEntry:(PSMThumbnailEntry *)entry {
+    [self unlinkEntry:entry];
+    self.currentBytes -= entry.bytes;
+    [self.entries removeObjectForKey:entry.key];
+}
+
+- (void)evictToLimit {
+    while (self.currentBytes > self.maxBytes && self.oldest != nil) {
+        [self removeEntry:self.oldest];
+        self.evictions++;
+    }
+}
+
+#pragma mark decoding
+
+// Decodes straight to thumbnail size; ImageIO can skip most of the work for a downscaled JPEG.
+- (PSMThumbnailEntry *)decodeEntryAtPath:(NSString *)path {
+    NSURL *url = [NSURL fileURLWithPath:path];
+    CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef)url, NULL);
+    if (source == NULL) {
+        return nil;
+    }
+    NSDictionary *options = @{(id)kCGImageSourceCreateThumbnailFromImageAlways:@YES,
+                              (id)kCGImageSourceCreateThumbnailWithTransform:@YES,
+                              (id)kCGImageSourceShouldCacheImmediately:@YES,
+                              (id)kCGImageSourceThumbnailMaxPixelSize:@(self.maxPixelSize)};
+    CGImageRef cgImage = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+    CFRelease(source);
+    if (cgImage == NULL) {
+        return nil;
+    }
+    PSMThumbnailEntry *entry = [PSMThumbnailEntry new];
+    entry.bytes = CGImageGetBytesPerRow(cgImage) * CGImageGetHeight(cgImage);
+    entry.image = [[NSImage alloc] initWithCGImage:cgImage size:NSZeroSize];
+    CGImageRelease(cgImage);
+    return entry;
+}
+
+#pragma mark public
+
+- (NSImage *)thumbnailForPath:(NSString *)path cameraKey:(NSString *)cameraKey index:(NSInteger)index {
+    struct stat st;
+    if (stat([path fileSystemRepresentation], &st) != 0) {
+        [self invalidateCameraKey:cameraKey index:index];
+        return nil;
+    }
+    NSString *key = [self keyForCameraKey:cameraKey index:index];
+    @synchronized (self) {
+        PSMThumbnailEntry *entry = self.entries[key];
+        if (entry != nil
+            && entry.fileSize == st.st_size
+            && entry.fileDate.tv_sec == st.st_mtimespec.tv_sec
+            && entry.fileDate.tv_nsec == st.st_mtimespec.tv_nsec) {
+            self.hits++;
+            [self unlinkEntry:entry];
+            [self pushEntry:entry];
+            return entry.image;
+        }
+        self.misses++;
+        if (entry != nil) {
+            [self removeEntry:entry];
+        }
+    }
+    PSMThumbnailEntry *entry = [self decodeEntryAtPath:path];
+    if (entry == nil) {
+        return nil;
+    }
+    entry.key = key;
+    entry.fileSize = st.st_size;
+    entry.fileDate = st.st_mtimespec;
+    @synchronized (self) {
+        PSMThumbnailEntry *raced = self.entries[key];
+        if (raced != nil) {
+            [self removeEntry:raced];
+        }
+        self.entries[key] = entry;
+        self.currentBytes += entry.bytes;
+        [self pushEntry:entry];
+        [self evictToLimit];
+    }
+    return entry.image;
+}
+
+- (void)invalidateCameraKey:(NSString *)cameraKey index:(NSInteger)index {
+    NSString *key = [self keyForCameraKey:cameraKey index:index];
+    @synchronized (self) {
+        PSMThumbnailEntry *entry = self.entries[key];
+        if (entry != nil) {
+            [self removeEntry:entry];
+        }
+    }
+}
+
+- (void)removeAllThumbnails {
+    @synchronized (self) {
+        [self.entries removeAllObjects];
+        self.newest = self.oldest = nil;
+        self.currentBytes = 0;
+    }
+}
+
+- (void)setMaxBytes:(NSUInteger)maxBytes {
+    @synchronized (self) {
+        _maxBytes = maxBytes;
+        [self evictToLimit];
+    }
+}
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        return [self.entries count];
+    }
+}
+
+- (double)hitRate {
+    NSUInteger lookups = self.hits + self.misses;
+    return lookups > 0 ? (double)self.hits / lookups : 0;
+}
+
+- (void)resetStatistics {
+    @synchronized (self) {
+        self.hits = self.misses = self.evictions = 0;
+    }
+}
+
+@end
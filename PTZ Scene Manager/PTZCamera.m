@@ -35,7 +35,15 @@ const NSString *PTZProgressIndexSetKey = @"PTZProgressIndexSetKey";
 #define BOOL_TO_ONOFF(b) ((b) ? VISCA_FOCUS_AUTO_ON : VISCA_FOCUS_AUTO_OFF)
 #define ONOFF_TO_BOOL(b) ((b) == VISCA_FOCUS_AUTO_ON)
 
-void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t fromOffset, uint32_t toOffset, uint32_t length, uint32_t delaySecs, PTZCamera *ptzCamera, PTZDoneBlock doneBlock);
+void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t fromOffset, uint32_t toOffset, uint32_t length, NSTimeInterval maxDelay, BOOL pollSettle, PTZCamera *ptzCamera, PTZDoneBlock doneBlock);
+
+// Setpoint commands that read their value from the camera properties when they run, so a newer request can ride along with one that's still queued.
+typedef enum {
+    PTZCoalescedZoom = 0,
+    PTZCoalescedPantiltAbsolute,
+    PTZCoalescedFocusValue,
+    PTZCoalescedCommandCount
+} PTZCoalescedCommand;
 
 @interface NSDictionary (PTZ_Sim_Extras)
 - (NSInteger)ptz_numberForKey:(NSString *)key ifNil:(NSInteger)value;
@@ -48,14 +56,15 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
 }
 @end
 
-@interface PTZCamera ()
+@interface PTZCamera () {
+    // Done blocks for a coalesced command that's queued but hasn't been sent yet; nil when there isn't one.
+    NSMutableArray<PTZDoneBlock> *_coalescedDoneBlocks[PTZCoalescedCommandCount];
+}
 
 @property NSString *deviceName;
 @property BOOL batchOperationInProgress;
 @property BOOL ptzStateValid;
 @property PTZCameraOpener *cameraOpener;
-// TODO: Properly, PTZSnapshotFetchDoneBlock should be an array.
-@property PTZSnapshotFetchDoneBlock obsSnapshotDoneBlock;
 @property BOOL useOBSSnapshot;
 @property NSTimeInterval pingTimeout;
 @property NSTimeInterval goodTimeout, badTimeout;
@@ -69,6 +78,10 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
 
 @property NSTimer *pingTimer;
 
+// Command pipeline stats. Guarded by @synchronized(self)
+@property NSInteger commandQueueDepth;
+@property NSInteger coalescedCommandCount;
+
 @end
 
 @implementation PTZDeviceInfo
@@ -113,6 +126,7 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
         _tiltSpeed = 5;
         _zoomSpeed = 4;
         _presetSpeed = 24; // Default, fastest
+        _coalescesCommands = YES;
         NSString *name = [NSString stringWithFormat:@"cameraQueue_0x%p", self];
         _cameraQueue = dispatch_queue_create([name UTF8String], DISPATCH_QUEUE_SERIAL);
         dispatch_set_target_queue(_cameraQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0));
@@ -192,15 +206,7 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
 }
 
 - (void)configSnapshotOptions:(BOOL)forceOn {
-    if (forceOn || self.prefCamera.useOBSSnapshot) {
-        if (self.useOBSSnapshot == NO) {
-            self.useOBSSnapshot = YES;
-            [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(onOBSSnapshot:) name:PSMOBSGetSourceSnapshotNotification object:nil];
-        }
-    } else if (self.useOBSSnapshot) {
-        self.useOBSSnapshot = NO;
-        [[NSNotificationCenter defaultCenter] removeObserver:self name:PSMOBSGetSourceSnapshotNotification object:nil];
-    }
+    self.useOBSSnapshot = forceOn || self.prefCamera.useOBSSnapshot;
 }
 
 - (void)closeAndReload:(PTZDoneBlock _Nullable)doneBlock {
@@ -297,13 +303,17 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
             return;
         }
         self.recallBusy = YES;
-        dispatch_async(self.cameraQueue, ^{
+        if ([self coalesceCommand:PTZCoalescedPantiltAbsolute doneBlock:doneBlock]) {
+            return;
+        }
+        [self dispatchCommand:@"pantilt absolute" block:^{
+            PTZDoneBlock claimedDoneBlock = [self claimCoalescedCommand:PTZCoalescedPantiltAbsolute doneBlock:doneBlock];
             BOOL success = NO;
             if (VISCA_set_pantilt_absolute_position(&self->_iface, &self->_camera, (uint32_t)self.panSpeed, (uint32_t)self.tiltSpeed, (int)self.pan, (int)self.tilt) == VISCA_SUCCESS) {
                 success = YES;
             }
-            [self callDoneBlock:doneBlock success:success recallBusy:NO];
-        });
+            [self callDoneBlock:claimedDoneBlock success:success recallBusy:NO];
+        }];
     }];
 }
 
@@ -371,14 +381,18 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
             [self connectionFailed:doneBlock];
             return;
         }
-        dispatch_async(self.cameraQueue, ^{
+        if ([self coalesceCommand:PTZCoalescedZoom doneBlock:doneBlock]) {
+            return;
+        }
+        [self dispatchCommand:@"zoom" block:^{
+            PTZDoneBlock claimedDoneBlock = [self claimCoalescedCommand:PTZCoalescedZoom doneBlock:doneBlock];
             BOOL success = NO;
             if (VISCA_set_zoom_value(&self->_iface, &self->_camera, (uint32_t)self.zoom) == VISCA_SUCCESS) {
                 VISCA_set_zoom_stop(&self->_iface, &self->_camera);
                 success = YES;
             }
-            [self callDoneBlock:doneBlock success:success];
-        });
+            [self callDoneBlock:claimedDoneBlock success:success];
+        }];
     }];
 }
 
@@ -569,10 +583,10 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
             [self connectionFailed:doneBlock];          \
             return;                                     \
         }                                               \
-        dispatch_async(self.cameraQueue, ^{             \
+        [self dispatchCommand:@#_selector block:^{      \
             BOOL success = _function(&self->_iface, &self->_camera) == VISCA_SUCCESS;         \
             [self callDoneBlock:doneBlock success:success]; \
-        });                                             \
+        }];                                             \
     }];                                                 \
 }
 
@@ -594,13 +608,17 @@ SIMPLE_VISCA_FN_CALL(osdMenuReturn, VISCA_set_datascreen_return)
             [self connectionFailed:doneBlock];
             return;
         }
-        dispatch_async(self.cameraQueue, ^{
+        if ([self coalesceCommand:PTZCoalescedFocusValue doneBlock:doneBlock]) {
+            return;
+        }
+        [self dispatchCommand:@"focus" block:^{
+            PTZDoneBlock claimedDoneBlock = [self claimCoalescedCommand:PTZCoalescedFocusValue doneBlock:doneBlock];
             BOOL success = NO;
             if (VISCA_set_focus_value(&self->_iface, &self->_camera, (uint32_t)self.focus) == VISCA_SUCCESS) {
                 success = YES;
             }
-            [self callDoneBlock:doneBlock success:success];
-        });
+            [self callDoneBlock:claimedDoneBlock success:success];
+        }];
     }];
 }
 
@@ -894,6 +912,71 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
     [self callDoneBlock:doneBlock success:success];
 }
 
+#pragma mark command pipeline
+
+// Runs a VISCA command on cameraQueue, keeping track of how many are waiting and how long each one took.
+- (void)dispatchCommand:(NSString *)name block:(dispatch_block_t)block {
+    CFAbsoluteTime queued = CFAbsoluteTimeGetCurrent();
+    NSInteger depth;
+    @synchronized (self) {
+        depth = ++self.commandQueueDepth;
+    }
+    dispatch_async(self.cameraQueue, ^{
+        CFAbsoluteTime started = CFAbsoluteTimeGetCurrent();
+        block();
+        CFAbsoluteTime finished = CFAbsoluteTimeGetCurrent();
+        NSInteger coalesced;
+        @synchronized (self) {
+            self.commandQueueDepth--;
+            coalesced = self.coalescedCommandCount;
+        }
+        if ([[NSUserDefaults standardUserDefaults] boolForKey:PTZ_LogCommandTimingKey]) {
+            PTZLog(@"%@ %@: depth %ld, waited %.0f ms, ran %.0f ms (%ld coalesced so far)", self.deviceName, name, (long)depth, (started - queued) * 1000, (finished - started) * 1000, (long)coalesced);
+        }
+    });
+}
+
+// Returns YES if the same command is already waiting on cameraQueue; it will pick up the current values when it runs, so just add the doneBlock to it.
+// Otherwise the caller must dispatch a new command, which calls claimCoalescedCommand:doneBlock: before it talks to the camera.
+- (BOOL)coalesceCommand:(PTZCoalescedCommand)command doneBlock:(PTZDoneBlock _Nullable)doneBlock {
+    if (!self.coalescesCommands) {
+        return NO;
+    }
+    @synchronized (self) {
+        NSMutableArray *doneBlocks = _coalescedDoneBlocks[command];
+        if (doneBlocks != nil) {
+            if (doneBlock) {
+                [doneBlocks addObject:doneBlock];
+            }
+            self.coalescedCommandCount++;
+            return YES;
+        }
+        _coalescedDoneBlocks[command] = doneBlock ? [NSMutableArray arrayWithObject:doneBlock] : [NSMutableArray array];
+        return NO;
+    }
+}
+
+// Requests after this point queue a new command. Returns a block that calls all the waiting done blocks.
+// doneBlock is the one the command was queued with; it's only used directly when coalescing is off.
+- (PTZDoneBlock)claimCoalescedCommand:(PTZCoalescedCommand)command doneBlock:(PTZDoneBlock _Nullable)doneBlock {
+    if (!self.coalescesCommands) {
+        return doneBlock;
+    }
+    NSArray *doneBlocks;
+    @synchronized (self) {
+        doneBlocks = _coalescedDoneBlocks[command];
+        _coalescedDoneBlocks[command] = nil;
+    }
+    if ([doneBlocks count] == 0) {
+        return nil;
+    }
+    return ^(BOOL success) {
+        for (PTZDoneBlock doneBlock in doneBlocks) {
+            doneBlock(success);
+        }
+    };
+}
+
 - (void)memoryRecall:(NSInteger)scene onDone:(PTZDoneBlock)doneBlock {
     [self loadCameraWithCompletionHandler:^() {
         if (!self.cameraIsOpen) {
@@ -901,10 +984,10 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
             return;
         }
         self.recallBusy = YES;
-        dispatch_async(self.cameraQueue, ^{
+        [self dispatchCommand:@"memory recall" block:^{
             BOOL success = VISCA_memory_recall(&self->_iface, &self->_camera, scene) == VISCA_SUCCESS;
             [self callDoneBlock:doneBlock success:success recallBusy:NO];
-        });
+        }];
     }];
 }
 
@@ -930,13 +1013,13 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
             [self connectionFailed:doneBlock];
             return;
         }
-        dispatch_async(self.cameraQueue, ^{
+        [self dispatchCommand:@"memory set" block:^{
             [self unchecked_visca_set_extended_values:nil];
             BOOL success = VISCA_memory_set(&self->_iface, &self->_camera, scene) == VISCA_SUCCESS;
             dispatch_sync(dispatch_get_main_queue(), ^{
                 [self callDoneBlock:doneBlock success:success];
             });
-        });
+        }];
     }];
 }
 
@@ -1030,8 +1113,14 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
     };
 }
 
-- (NSInteger)batchDelay {
-    return [[NSUserDefaults standardUserDefaults] integerForKey:PTZ_BatchDelayKey];
+// How long to wait after a recall/set pair for the camera to be ready for the next one; depends on the firmware. Fractional seconds are fine.
+- (NSTimeInterval)batchDelay {
+    return [[NSUserDefaults standardUserDefaults] doubleForKey:PTZ_BatchDelayKey];
+}
+
+// Whether the firmware is ready for the next recall/set once the camera stops moving, so the delay above can be cut short.
+- (BOOL)batchSettlePolling {
+    return [[NSUserDefaults standardUserDefaults] boolForKey:PTZ_BatchSettlePollingKey];
 }
 
 - (void)backupRestoreWithParent:(PTZProgressGroup *)parent onDone:( PTZDoneBlock)inDoneBlock {
@@ -1059,7 +1148,7 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
             return;
         }
         dispatch_async(self.cameraQueue, ^{
-            backupRestore(&self->_iface, &self->_camera, (uint32_t)fromOffset, (uint32_t)toOffset, (uint32_t)length, (uint32_t)self.batchDelay, self, doneBlock);
+            backupRestore(&self->_iface, &self->_camera, (uint32_t)fromOffset, (uint32_t)toOffset, (uint32_t)length, self.batchDelay, self.batchSettlePolling, self, doneBlock);
         });
     }];
 }
@@ -1080,26 +1169,6 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
     [self fetchSnapshotAtIndex:index onDone:nil];
 }
 
-- (void)onOBSSnapshot:(NSNotification *)note {
-    NSDictionary *userInfo = [note userInfo];
-    if ([self.obsSourceName isEqualToString:userInfo[PSMOBSSourceNameKey]]) {
-        NSData *data = userInfo[PSMOBSImageDataKey];
-        if (data) {
-            NSInteger index = [userInfo[PSMOBSSnapshotIndexKey] integerValue];
-            NSImage *testImage = [[NSImage alloc] initWithData:data];
-            if (!NSEqualSizes(testImage.size, NSZeroSize)) {
-                self.snapshotImage = testImage;
-            } else {
-                NSLog(@"Bad OBS snapshot image");
-            }
-            if (self.obsSnapshotDoneBlock) {
-                self.obsSnapshotDoneBlock(data, testImage, index);
-            }
-            self.obsSnapshotDoneBlock = nil;
-        }
-    }
-}
-
 - (void)fetchSnapshotAtIndex:(NSInteger)index onDone:(PTZSnapshotFetchDoneBlock)doneBlock {
     // If IP fails we retry with OBS. If OBS fails that's the end.
     // Never retry an OBS failure with IP, that way lies infinite loops.
@@ -1111,12 +1180,23 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
 }
 
 - (void)fetchOBSSnapshotAtIndex:(NSInteger)index onDone:(PTZSnapshotFetchDoneBlock)doneBlock {
-    if (self.obsSnapshotDoneBlock) {
-        self.obsSnapshotDoneBlock(nil, nil, -1);
-    }
-    self.obsSnapshotDoneBlock = doneBlock;
-    // This silently fails if OBS isn't connected. That's fine. Snapshots are optional.
-    [[PSMOBSWebSocketController defaultController] requestSnapshotForCameraSource:self.obsSourceName index:index preferredWidth:480];
+    // Each request gets its own reply, so preset snapshots can be fetched in parallel.
+    // If OBS isn't connected this fails with nil data. That's fine. Snapshots are optional.
+    [[PSMOBSWebSocketController defaultController] requestSnapshotForCameraSource:self.obsSourceName index:index preferredWidth:480 onDone:^(NSData *data, NSInteger requestIndex) {
+        NSImage *testImage = nil;
+        if (data != nil) {
+            testImage = [[NSImage alloc] initWithData:data];
+            if (!NSEqualSizes(testImage.size, NSZeroSize)) {
+                self.snapshotImage = testImage;
+            } else {
+                NSLog(@"Bad OBS snapshot image");
+                testImage = nil;
+            }
+        }
+        if (doneBlock) {
+            doneBlock(testImage ? data : nil, testImage, requestIndex);
+        }
+    }];
 }
 
 // IP Camera does not need to be open; this doesn't use sockets.
@@ -1144,6 +1224,12 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
                 }
            } else {
                 NSLog(@"Bad IP snapshot image %@", [NSHTTPURLResponse localizedStringForStatusCode:response.statusCode]);
+                // Callers polling for snapshots need to know this one is finished.
+                if (doneBlock) {
+                    dispatch_async(dispatch_get_main_queue(), ^{
+                        doneBlock(nil, nil, index);
+                    });
+                }
             }
         } else if (index >= 0) {
             NSLog(@"Failed to get snapshot: trying OBS %@", error);
@@ -1152,6 +1238,10 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
                 // Only do it for preset snapshots; slightly stale navigation snapshots are OK.
                 [self fetchOBSSnapshotAtIndex:index onDone:doneBlock];
             });
+        } else if (doneBlock) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                doneBlock(nil, nil, index);
+            });
         }
 
     }] resume];
@@ -1652,18 +1742,64 @@ VALIDATE_KEY_MINMAX(Aperture, 0, 14)
 
 #pragma mark backup restore
 
-void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t fromOffset, uint32_t toOffset, uint32_t length, uint32_t delaySecs, PTZCamera *ptzCamera, PTZDoneBlock doneBlock)
+// Settle polling: the first check comes this long after the first reading, doubling up to the max until two readings agree.
+#define SETTLE_MIN_INTERVAL 0.05
+#define SETTLE_MAX_INTERVAL 0.4
+
+// Wait for the camera to be ready for the next recall/set, never longer than maxDelay, the firmware's delay.
+// Most firmware needs that whole delay after a memory set and doesn't say when it's done, so it's slept out unless poll is set.
+// Firmware that's ready once it stops moving can poll: done as soon as pan/tilt/zoom read the same twice in a row.
+// If it won't answer inquiries we can't tell, so it gets the rest of the delay.
+static NSTimeInterval waitForCameraToSettle(VISCAInterface_t *iface, VISCACamera_t *camera, NSTimeInterval maxDelay, BOOL poll)
+{
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    if (!poll) {
+        [NSThread sleepForTimeInterval:maxDelay];
+        return CFAbsoluteTimeGetCurrent() - start;
+    }
+    NSTimeInterval interval = SETTLE_MIN_INTERVAL;
+    int16_t lastPan = 0, lastTilt = 0;
+    uint16_t lastZoom = 0;
+    BOOL haveLast = NO;
+    while (CFAbsoluteTimeGetCurrent() - start < maxDelay) {
+        int16_t pan, tilt;
+        uint16_t zoom;
+        BOOL success = VISCA_get_pantilt_position(iface, camera, &pan, &tilt) == VISCA_SUCCESS && iface->errortype == 0;
+        success = success && VISCA_get_zoom_value(iface, camera, &zoom) == VISCA_SUCCESS && iface->errortype == 0;
+        if (!success) {
+            [NSThread sleepForTimeInterval:MAX(0, maxDelay - (CFAbsoluteTimeGetCurrent() - start))];
+            break;
+        }
+        if (haveLast && pan == lastPan && tilt == lastTilt && zoom == lastZoom) {
+            break;
+        }
+        lastPan = pan;
+        lastTilt = tilt;
+        lastZoom = zoom;
+        haveLast = YES;
+        [NSThread sleepForTimeInterval:MIN(interval, MAX(0, maxDelay - (CFAbsoluteTimeGetCurrent() - start)))];
+        interval = MIN(interval * 2, SETTLE_MAX_INTERVAL);
+    }
+    return CFAbsoluteTimeGetCurrent() - start;
+}
+
+void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t fromOffset, uint32_t toOffset, uint32_t length, NSTimeInterval maxDelay, BOOL pollSettle, PTZCamera *ptzCamera, PTZDoneBlock doneBlock)
 {
     NSString *log = @"";
 
     uint32_t sceneIndex;
-    dispatch_sync(dispatch_get_main_queue(), ^{
+    // Nothing here waits on the main thread; progress and bookkeeping are posted to it, and cancel is read from the progress object.
+    dispatch_async(dispatch_get_main_queue(), ^{
         ptzCamera.batchOperationInProgress = YES;
         ptzCamera.recallBusy = YES;
     });
+    PTZProgress *progress = ptzCamera.progress;
     // Set preset recall speed to max, just in case it got changed.
     VISCA_set_pantilt_preset_speed(iface, camera, 24);
-    __block BOOL cancel = NO;
+    BOOL cancel = NO;
+    uint32_t copied = 0;
+    NSTimeInterval totalRecall = 0, totalSet = 0, totalSettle = 0;
+    CFAbsoluteTime batchStart = CFAbsoluteTimeGetCurrent();
     for (sceneIndex = 0; sceneIndex < length; sceneIndex++) {
         if ([log length] > 0) {
             // For "continue" log statements.
@@ -1671,6 +1807,7 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
         }
         log = [NSString stringWithFormat:@"%@ : ", ptzCamera.deviceName];
         log = [log stringByAppendingFormat:@"recall %d", sceneIndex + fromOffset];
+        CFAbsoluteTime recallStart = CFAbsoluteTimeGetCurrent();
         if (VISCA_memory_recall(iface, camera, sceneIndex + fromOffset) != VISCA_SUCCESS) {
             log = [log stringByAppendingFormat:@" failed to send recall command %d\n", sceneIndex + fromOffset];
             continue;
@@ -1678,6 +1815,7 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
             log = [log stringByAppendingFormat:@" Cancelled recall at scene %d\n", sceneIndex + fromOffset];
             break;
         }
+        CFAbsoluteTime setStart = CFAbsoluteTimeGetCurrent();
         [ptzCamera unchecked_visca_set_extended_values:log];
         log = [log stringByAppendingFormat:@" set %d", sceneIndex + toOffset];
         if (VISCA_memory_set(iface, camera, sceneIndex + toOffset) != VISCA_SUCCESS) {
@@ -1687,22 +1825,38 @@ void backupRestore(VISCAInterface_t *iface, VISCACamera_t *camera, uint32_t from
             log = [log stringByAppendingFormat:@" cancelled set at scene %d\n", sceneIndex + toOffset];
             break;
         }
-        log = [log stringByAppendingFormat:@" copied scene %d to %d\n", sceneIndex + fromOffset, sceneIndex + toOffset];
-        dispatch_sync(dispatch_get_main_queue(), ^{
-            cancel = [ptzCamera batchSetFinishedFromIndex:sceneIndex+fromOffset toIndex:sceneIndex+toOffset];
+        CFAbsoluteTime setEnd = CFAbsoluteTimeGetCurrent();
+        uint32_t from = sceneIndex + fromOffset, to = sceneIndex + toOffset;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [ptzCamera batchSetFinishedFromIndex:from toIndex:to];
         });
-        if (cancel) {
+        if (progress.cancelled) {
+            log = [log stringByAppendingFormat:@" copied scene %d to %d; cancelled\n", from, to];
+            cancel = YES;
             break;
         }
         // You can recall all 9 scenes in a row with no delay. You can set 9 scenes without a delay!
         // But if you are doing a recall/set combo, the delay is required. Otherwise it just sits there in 'send' starting around recall 3. Might just be a bug in our cameras - well, PTZOptics says no. I don't believe them. They said I'm overloading the camera with commands, but these *are* waiting for the previous one to finish.
-        // Also 'usleep' doesn't seem to sleep, so we're stuck with integer seconds. And the firmware version affects the required delay. Latest one only needs 1 sec; older ones needed 5.
-        sleep(delaySecs);
+        // The firmware version affects the required delay. Latest one only needs 1 sec; older ones needed 5. That's the BatchDelay pref, and we never wait longer than that; with BatchSettlePolling on, we stop early once the camera has stopped moving.
+        NSTimeInterval settle = waitForCameraToSettle(iface, camera, maxDelay, pollSettle);
+        NSTimeInterval recallTime = setStart - recallStart, setTime = setEnd - setStart;
+        totalRecall += recallTime;
+        totalSet += setTime;
+        totalSettle += settle;
+        copied++;
+        log = [log stringByAppendingFormat:@" copied scene %d to %d (recall %.0f ms, set %.0f ms, settle %.0f ms)\n", from, to, recallTime * 1000, setTime * 1000, settle * 1000];
         fprintf(stdout, "%s", [log UTF8String]);
         log = @""; // Clear when exiting loop normally; we want to print anything in the log if we exited the loop via 'break'
+        if (progress.cancelled) {
+            cancel = YES;
+            break;
+        }
+    }
+    if (copied > 0) {
+        log = [log stringByAppendingFormat:@"%@ : copied %d scenes in %.1f s; average recall %.0f ms, set %.0f ms, settle %.0f ms\n", ptzCamera.deviceName, copied, CFAbsoluteTimeGetCurrent() - batchStart, totalRecall * 1000 / copied, totalSet * 1000 / copied, totalSettle * 1000 / copied];
     }
     // DO NOT DO AN EARLY RETURN! We must get here and run this block.
-    dispatch_sync(dispatch_get_main_queue(), ^{
+    dispatch_async(dispatch_get_main_queue(), ^{
         if ([log length] > 0) {
             fprintf(stdout, "%s", [log UTF8String]);
         }
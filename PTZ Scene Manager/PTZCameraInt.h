@@ -17,6 +17,8 @@ extern const NSString *PTZProgressIndexSetKey;
 
 @property dispatch_queue_t cameraQueue;
 @property BOOL isExportingHomeScene;
+// Defaults to YES. Turn it off when every queued setpoint matters, not just the latest one.
+@property BOOL coalescesCommands;
 
 - (instancetype)initWithPrefCamera:(PTZPrefCamera *)prefCamera IP:(NSString *)ipAddr;
 
@@ -18,11 +18,25 @@
 
 @property (strong) PTZCamera *realCamera;
 @property (strong) NSURL *url;
+// The real camera's values for the scene being written, captured when its inquiries finished. Only nil before the first scene.
+@property (strong) NSDictionary *exportState;
 
 @end
 
+// Everything the REAL_CAMERA_GET accessors forward.
+static NSArray *PTZPacketSenderStateKeys;
+
 @implementation PTZPacketSenderCamera
 
++ (void)initialize {
+    if (self == [PTZPacketSenderCamera class]) {
+        PTZPacketSenderStateKeys = @[@"tilt", @"pan", @"zoom", @"focus", @"autofocus", @"autofocusIndex", @"tiltSpeed", @"panSpeed", @"presetSpeed", @"zoomSpeed",
+                                     @"wbMode", @"redGain", @"blueGain", @"colorTempIndex", @"hueIndex", @"awbSens", @"saturationIndex",
+                                     @"exposureMode", @"expcompmode", @"expcomp", @"backlight", @"iris", @"shutter", @"gain", @"bright", @"gainlimit", @"flicker",
+                                     @"luminance", @"contrast", @"aperture", @"flipH", @"flipV", @"bwModeIndex"];
+    }
+}
+
 // NOTE: If we supported reading packet sender, we could also send it to USB cameras.
 - (instancetype)initWithPrefCamera:(PTZPrefCamera *)prefCamera fileURL:(NSURL *)url {
     if (url == nil) {
@@ -32,6 +46,8 @@
     if (self) {
         _realCamera = prefCamera.camera;
         _url = url;
+        // Each scene's setpoints go into the file, so none of them can be folded into a later one.
+        self.coalescesCommands = NO;
     }
     return self;
 }
@@ -53,11 +69,17 @@
     VISCA_ini_set_packet_id([self pIface], [str UTF8String]);
 }
 
-// Even though the VISCA calls don't need to talk to a camera, they're run in the camera queue so we must treat them accordingly and wait for the done callback.
+// Even though the VISCA calls don't need to talk to a camera, they're run in the camera queue so we must treat them accordingly.
+// Writes for a scene only depend on the state captured for it, so the real camera goes on to recall the next scene while they're queued.
 - (void)recallIndexSet:(NSIndexSet *)indexSet atIndex:(NSInteger)i onComplete:(PTZDoneBlock _Nullable)doneBlock {
  //   NSAssert([NSThread isMainThread], @"Not on main thread");
     if (i == NSNotFound || self.progress.cancelled) {
-        [self callDoneBlock:doneBlock success:YES];
+        // It's a serial queue, so this runs after every write we've queued.
+        dispatch_async(self.cameraQueue, ^{
+            // Back to reading through to the real camera.
+            self.exportState = nil;
+            [self callDoneBlock:doneBlock success:YES];
+        });
         return;
     }
     PTZCameraConfig *config = self.realCamera.cameraConfig;
@@ -70,28 +92,38 @@
     [self.realCamera memoryRecall:i onDone:^(BOOL success) {
         if (!success || self.progress.cancelled) {
             PTZLog(@"Cancelling export: could not recall scene %d", i);
-            [self callDoneBlock:doneBlock success:NO];
+            // Writes for earlier scenes may still be queued; finish after them, same as above.
+            dispatch_async(self.cameraQueue, ^{
+                self.exportState = nil;
+                [self callDoneBlock:doneBlock success:NO];
+            });
             return;
         }
         PTZLog(@"recalling %d", i);
         [self.realCamera updateCameraStateForExport:^(BOOL success) {
             PTZLog(@"exporting %d", i);
-            self.isExportingHomeScene = (i == 0);
-           // It's a serial queue so they'll run in order, we only need a done block on the last one.
-            [self setPacketID:[NSString stringWithFormat:@"P%ld", (long)i]];
+            // Freeze this scene's values; the real camera will have moved on by the time they're written.
+            NSDictionary *state = [self.realCamera dictionaryWithValuesForKeys:PTZPacketSenderStateKeys];
+            NSString *packetID = [NSString stringWithFormat:@"P%ld", (long)i];
+            dispatch_async(self.cameraQueue, ^{
+                self.exportState = state;
+                self.isExportingHomeScene = (i == 0);
+                [self setPacketID:packetID];
+            });
+            // It's a serial queue so they'll run in order, we only need a done block on the last one.
             [self applyPantiltAbsolutePosition:nil];
             [self applyZoom:nil];
             [self applyPantiltPresetSpeed:nil];
             [self applyFocusMode:nil];
-            if (!self.autofocus) {
+            if (![state[@"autofocus"] boolValue]) {
                 [self applyFocusValue:nil];
             }
             // memorySet applies any WB, Exposure, Image opt-in values.
             [self memorySet:i onDone:^(BOOL success) {
                 self.progress.completedUnitCount++;
-                NSInteger nextIndex = [indexSet indexGreaterThanIndex:i];
-                [self recallIndexSet:indexSet atIndex:nextIndex onComplete:doneBlock];
             }];
+            NSInteger nextIndex = [indexSet indexGreaterThanIndex:i];
+            [self recallIndexSet:indexSet atIndex:nextIndex onComplete:doneBlock];
         }];
     }];
 }
@@ -148,12 +180,14 @@
 
 #define REAL_CAMERA_GET(_sel)  \
 - (NSInteger)_sel {            \
-    return [self.realCamera _sel];   \
+    NSDictionary *state = self.exportState;  \
+    return state ? [state[@#_sel] integerValue] : [self.realCamera _sel];   \
 }
 
 #define REAL_CAMERA_GET_BOOL(_sel)  \
 - (BOOL)_sel {            \
-    return [self.realCamera _sel];   \
+    NSDictionary *state = self.exportState;  \
+    return state ? [state[@#_sel] boolValue] : [self.realCamera _sel];   \
 }
 
 - (NSString *)deviceName {
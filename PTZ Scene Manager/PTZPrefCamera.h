@@ -67,6 +67,8 @@ PREF_VALUE_NSINT_PROPERTIES(panTiltStep, PanTiltStep)
 PREF_VALUE_NSINT_PROPERTIES(selectedSceneRange, SelectedSceneRange)
 PREF_VALUE_NSINT_PROPERTIES(maxColumnCount, MaxColumnCount)
 PREF_VALUE_NSINT_PROPERTIES(thumbnailOption, ThumbnailOption)
+// Seconds between pictures for an RTSP thumbnail that doesn't need to be live; 0 for video.
+PREF_VALUE_NSINT_PROPERTIES(rtspRefreshInterval, RtspRefreshInterval)
 PREF_VALUE_NSINT_PROPERTIES(pingTimeout, PingTimeout)
 PREF_VALUE_NSINT_PROPERTIES(sceneCopyOffset, SceneCopyOffset)
 
@@ -84,6 +86,7 @@ PREF_VALUE_NSINT_PROPERTIES(sceneCopyOffset, SceneCopyOffset)
 - (void)setSceneNames:(NSArray *)names startingIndex:(NSInteger)index;
 - (void)copySceneNameAtIndex:(NSInteger)index toIndex:(NSInteger)toIndex;
 
+// Display-sized; decoded images are kept in PSMThumbnailCache.
 - (NSImage *)snapshotAtIndex:(NSInteger)index;
 - (void)saveSnapshotAtIndex:(NSInteger)index withData:(NSData *)imgData;
 - (void)copySnapshotAtIndex:(NSInteger)index toIndex:(NSInteger)toIndex;
@@ -20,6 +20,7 @@
 #import "PTZCamera.h"
 #import "PTZCameraSceneRange.h"
 #import "AppDelegate.h"
+#import "PSMThumbnailCache.h"
 #import "ObjCUtils.h"
 
 static NSString *PSM_PanPlusSpeed = @"panPlusSpeed";
@@ -57,6 +58,7 @@ static NSString *searchChildrenForSerialAddress(io_object_t object, NSString *si
        @"showSharpnessControls":@(YES),
        @"showPresetRecallControls":@(YES),
        @"thumbnailOption":@(PTZThumbnail_RTSP),
+       @"rtspRefreshInterval":@(0),
        @"useOBSSnapshot":@(NO),
     }];
 }
@@ -251,6 +253,7 @@ PREF_VALUE_NSINT_ACCESSORS(sceneCopyOffset, SceneCopyOffset)
 PREF_VALUE_NSINT_ACCESSORS(selectedSceneRange, SelectedSceneRange)
 PREF_VALUE_NSINT_ACCESSORS(maxColumnCount, MaxColumnCount)
 PREF_VALUE_NSINT_ACCESSORS(thumbnailOption, ThumbnailOption)
+PREF_VALUE_NSINT_ACCESSORS(rtspRefreshInterval, RtspRefreshInterval)
 PREF_VALUE_NSINT_ACCESSORS(pingTimeout, PingTimeout)
 
 // Backward compatiblity only. Use indexSet instead.
@@ -345,7 +348,7 @@ PREF_VALUE_NSINDEXSET_ACCESSORS(indexSet, IndexSet)
     NSString *rootPath = [self.appDelegate snapshotsDirectory];
     NSString *filename = [NSString stringWithFormat:@"snapshot_%@_%d.jpg", self.camerakey, (int)index];
     NSString *path = [NSString pathWithComponents:@[rootPath, filename]];
-    return [[NSImage alloc] initWithContentsOfFile:path];
+    return [[PSMThumbnailCache sharedCache] thumbnailForPath:path cameraKey:self.camerakey index:index];
 }
 
 - (void)saveSnapshotAtIndex:(NSInteger)index withData:(NSData *)imgData {
@@ -359,6 +362,7 @@ PREF_VALUE_NSINDEXSET_ACCESSORS(indexSet, IndexSet)
         }
         NSString *path = [NSString pathWithComponents:@[rootPath, filename]];
         [imgData writeToFile:path atomically:YES];
+        [[PSMThumbnailCache sharedCache] invalidateCameraKey:self.camerakey index:index];
     });
 }
 
@@ -384,6 +388,7 @@ PREF_VALUE_NSINDEXSET_ACCESSORS(indexSet, IndexSet)
         if ([fileManager fileExistsAtPath:path]) {
             [fileManager removeItemAtPath:toPath error:nil];
             [fileManager copyItemAtPath:path toPath:toPath error:nil];
+            [[PSMThumbnailCache sharedCache] invalidateCameraKey:self.camerakey index:toIndex];
         }
     });
 }
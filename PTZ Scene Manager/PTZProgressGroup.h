@@ -35,6 +35,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface PTZProgressGroup : PTZProgress
 
+// Completed units per second since the first child was added.
+@property(readonly) CGFloat unitsPerSecond;
+// If set, localizedAdditionalDescription shows the rate using this format (one %f) whenever no child has a string to show.
+@property(copy, nullable) NSString *unitsPerSecondFormat;
+
 - (void)addChild:(PTZProgress *)progress;
 
 @end
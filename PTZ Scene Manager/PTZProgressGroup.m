@@ -86,6 +86,8 @@ static PTZProgressGroup *selfType;
 @property(copy) NSString *internalLocalizedAdditionalDescription;
 @property(copy) NSString *childLocalizedDescription;
 @property(copy) NSString *childLocalizedAdditionalDescription;
+@property (readwrite) CGFloat unitsPerSecond;
+@property NSDate *startDate;
 @end
 
 @implementation PTZProgressGroup
@@ -138,6 +140,9 @@ static PTZProgressGroup *selfType;
 
 - (void)addChild:(PTZProgress *)progress {
     if (![self.children containsObject:progress]) {
+        if (self.startDate == nil) {
+            self.startDate = [NSDate date];
+        }
         [self.children addObject:progress];
         NSArray *PTZKeyPaths = @[@"cancelled", @"completedUnitCount", @"cancellable", @"totalUnitCount", @"finished", @"localizedDescription", @"localizedAdditionalDescription"];
         for (NSString *key in PTZKeyPaths) {
@@ -206,6 +211,11 @@ static PTZProgressGroup *selfType;
     self.totalUnitCount = total;
     self.completedUnitCount = completed;
     self.fractionCompleted = (total > 0) ? (completed / total) : 0;
+    NSTimeInterval elapsed = self.startDate ? -[self.startDate timeIntervalSinceNow] : 0;
+    self.unitsPerSecond = (elapsed > 0) ? (completed / elapsed) : 0;
+    if (self.unitsPerSecondFormat != nil && completed > 0) {
+        self.localizedAdditionalDescription = [NSString localizedStringWithFormat:self.unitsPerSecondFormat, self.unitsPerSecond];
+    }
     if (completed >= total) {
         [self _finish];
     }
@@ -0,0 +1,246 @@
+//
+//  decodescheduler.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef DECODESCHEDULER_HPP
+#define DECODESCHEDULER_HPP
+
+// Shares the CPU out among every stream's decoder thread, as RTSPViewController's are. Each
+// stream keeps its own thread, because reading a live stream mostly means waiting on the
+// network, and a pool thread stuck in a read can't decode anything else. But only as many of
+// them decode at once as there are cores, so sixteen streams on a four core machine take
+// turns instead of all being part way through a frame at once, and when they have to wait,
+// the one whose frame has been waiting longest goes first.
+//
+// A decoder asks for a Turn with the time its next frame should have arrived by. Its Cadence
+// works that out from when the last ones did, and the decoder waits until then before it
+// asks, so it isn't holding a turn while the frame is still on its way. A turn also comes
+// with a lease: if the frame still hasn't turned up by the end of it, the camera has stalled
+// or gone away, and the read blocked on it isn't using a core, so the turn stops counting and
+// someone else gets it.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace decodescheduler {
+
+using Clock = std::chrono::steady_clock;
+
+struct Stats {
+    uint64_t turns = 0;
+    // From asking for a turn to getting it.
+    uint64_t totalWaitNS = 0;
+    uint64_t maxWaitNS = 0;
+    // Turns held past their lease.
+    uint64_t expired = 0;
+
+    double averageWaitMS() const {
+        return turns ? totalWaitNS / (double)turns / 1e6 : 0;
+    }
+};
+
+class Scheduler {
+  public:
+    explicit Scheduler(size_t slots = defaultSlots()) : slots(std::max(slots, (size_t)1)), sequence(0) {}
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    static size_t defaultSlots() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 0 ? cores : 1;
+    }
+
+    // The one every decoder in the process shares.
+    static Scheduler& shared() {
+        static Scheduler scheduler;
+        return scheduler;
+    }
+
+    // Permission to decode; given back when it goes away, or by release.
+    class Turn {
+      public:
+        Turn() : scheduler(nullptr), id(0) {}
+        Turn(Turn&& other) noexcept : scheduler(other.scheduler), id(other.id) { other.scheduler = nullptr; }
+        Turn& operator=(Turn&& other) noexcept {
+            if (this != &other) {
+                release();
+                scheduler = other.scheduler;
+                id = other.id;
+                other.scheduler = nullptr;
+            }
+            return *this;
+        }
+        ~Turn() { release(); }
+
+        void release() {
+            if (scheduler != nullptr) {
+                scheduler->finished(id);
+                scheduler = nullptr;
+            }
+        }
+
+        explicit operator bool() const { return scheduler != nullptr; }
+
+      private:
+        friend class Scheduler;
+        Turn(Scheduler *scheduler, uint64_t id) : scheduler(scheduler), id(id) {}
+
+        Scheduler *scheduler;
+        uint64_t id;
+    };
+
+    // Blocks until there's a core free and nobody with an earlier deadline is waiting for it.
+    // The turn stops counting against the cores once it's been held for lease.
+    Turn wait(Clock::time_point deadline, Clock::duration lease = Clock::duration::max()) {
+        std::unique_lock<std::mutex> guard(lock);
+        Clock::time_point asked = Clock::now();
+        Waiter me(deadline, sequence++);
+        waiting.insert(me);
+        for (;;) {
+            Clock::time_point now = Clock::now();
+            Clock::time_point nextExpiry = expire(now);
+            if (held.size() < slots && *waiting.begin() == me) {
+                break;
+            }
+            if (nextExpiry == Clock::time_point::max()) {
+                wake.wait(guard);
+            } else {
+                wake.wait_until(guard, nextExpiry);
+            }
+        }
+        waiting.erase(waiting.begin());
+        Clock::time_point now = Clock::now();
+        held[me.second] = lease >= Clock::time_point::max() - now ? Clock::time_point::max() : now + lease;
+        uint64_t waited = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - asked).count();
+        counters.turns++;
+        counters.totalWaitNS += waited;
+        counters.maxWaitNS = std::max(counters.maxWaitNS, waited);
+        if (!waiting.empty()) {
+            // There may be room for the next one too, and if not, the rest need to know when
+            // this lease runs out.
+            wake.notify_all();
+        }
+        return Turn(this, me.second);
+    }
+
+    size_t size() const { return slots; }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return counters;
+    }
+
+  private:
+    // Earliest deadline first, and first come first served between equals.
+    using Waiter = std::pair<Clock::time_point, uint64_t>;
+
+    void finished(uint64_t id) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            // Already gone if its lease ran out.
+            held.erase(id);
+        }
+        wake.notify_all();
+    }
+
+    // Drops turns whose lease has run out, letting whoever's next know; returns when the next
+    // lease will run out. Locked.
+    Clock::time_point expire(Clock::time_point now) {
+        Clock::time_point next = Clock::time_point::max();
+        for (auto it = held.begin(); it != held.end();) {
+            if (it->second <= now) {
+                counters.expired++;
+                it = held.erase(it);
+                wake.notify_all();
+            } else {
+                next = std::min(next, it->second);
+                ++it;
+            }
+        }
+        return next;
+    }
+
+    const size_t slots;
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    std::set<Waiter> waiting;
+    // The turns being used, and when each one's lease runs out.
+    std::map<uint64_t, Clock::time_point> held;
+    uint64_t sequence;
+    Stats counters;
+};
+
+// When a live stream's next frame should be there to read, going by when the last ones were.
+//
+// A read that returns says its frame was there by then, less the time decoding takes: by
+// when the read started, if it didn't have to wait. That's only ever late, by however long the
+// thread was kept from running or the read was behind the stream, but never early. So the
+// earliest that any frame in the last couple of seconds could have arrived, against its
+// timestamp, is when frames arrive. Being kept from running only makes a guess later, which
+// the earliest ignores, and the window follows the camera's clock if it drifts from ours.
+class Cadence {
+  public:
+    // How many seconds of the stream's frames the guess goes by.
+    static constexpr double Window = 2.0;
+
+    bool known() const { return !earliest.empty(); }
+
+    // When the frame with this timestamp should be there to read.
+    Clock::time_point due(double pts) const { return base + seconds(pts + earliest.front().second); }
+
+    // The frame with this timestamp was read and decoded between start and end.
+    void stepped(double pts, Clock::time_point start, Clock::time_point end) {
+        Clock::duration took = end - start;
+        if (!timed || took < fastest) {
+            fastest = took;
+            timed = true;
+        }
+        if (!earliest.empty() && (pts < earliest.back().first || pts - earliest.back().first > Window)) {
+            // The timestamps jumped; nothing before means anything now.
+            earliest.clear();
+        }
+        if (earliest.empty()) {
+            base = end;
+        }
+        // The latest it can have arrived, less its timestamp.
+        double offset = std::chrono::duration<double>(std::max(start, end - fastest) - base).count() - pts;
+        while (!earliest.empty() && earliest.back().second >= offset) {
+            earliest.pop_back();
+        }
+        earliest.emplace_back(pts, offset);
+        while (earliest.front().first < pts - Window) {
+            earliest.pop_front();
+        }
+    }
+
+    void reset() {
+        earliest.clear();
+        timed = false;
+    }
+
+  private:
+    static Clock::duration seconds(double s) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+    }
+
+    // Timestamps and offsets in the window, offsets increasing, so the front is the earliest.
+    std::deque<std::pair<double, double>> earliest;
+    Clock::time_point base;
+    bool timed = false;
+    Clock::duration fastest = Clock::duration::zero();
+};
+
+} // namespace decodescheduler
+
+#endif /* DECODESCHEDULER_HPP */
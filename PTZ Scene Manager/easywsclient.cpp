@@ -70,6 +70,7 @@
     #define SOCKET_EWOULDBLOCK EWOULDBLOCK
 #endif
 
+#include <ctype.h>
 #include <vector>
 #include <string>
 
@@ -77,6 +78,7 @@
 
 using easywsclient::Callback_Imp;
 using easywsclient::BytesCallback_Imp;
+using easywsclient::ViewCallback_Imp;
 
 namespace { // private module-only namespace
 
@@ -110,11 +112,30 @@ socket_t hostname_connect(const std::string& hostname, int port) {
     return sockfd;
 }
 
+// XOR a payload with its 4-byte masking key, eight bytes at a time.
+// The word loop always stops on a multiple of 8, so the tail stays in phase with the key.
+void apply_mask(uint8_t *bytes, size_t length, const uint8_t masking_key[4]) {
+    uint32_t key32;
+    memcpy(&key32, masking_key, 4);
+    const uint64_t key64 = ((uint64_t)key32 << 32) | key32;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        word ^= key64;
+        memcpy(bytes + i, &word, 8);
+    }
+    for (; i < length; ++i) {
+        bytes[i] ^= masking_key[i & 0x3];
+    }
+}
+
 
 class _DummyWebSocket : public easywsclient::WebSocket
 {
   public:
     void poll(int timeout) { }
+    void poll(int /*timeout*/, int /*wakefd*/) { }
     void send(const std::string& message) { }
     void sendBinary(const std::string& message) { }
     void sendBinary(const std::vector<uint8_t>& message) { }
@@ -123,6 +144,8 @@ class _DummyWebSocket : public easywsclient::WebSocket
     readyStateValues getReadyState() const { return CLOSED; }
     void _dispatch(Callback_Imp & callable) { }
     void _dispatchBinary(BytesCallback_Imp& callable) { }
+    void _dispatchView(ViewCallback_Imp& callable) { }
+    const std::string& getProtocol() const { static const std::string none; return none; }
 };
 
 
@@ -166,7 +189,13 @@ class _RealWebSocket : public easywsclient::WebSocket
         uint8_t masking_key[4];
     };
 
+    // Received bytes live in rxbuf[rxbegin, rxend). Whole frames are consumed by
+    // advancing rxbegin; the unread tail is only moved down when recv needs room,
+    // so a large frame arriving in pieces is never shifted more than once per grow.
+    enum { RX_CHUNK = 1500, RX_INITIAL = 64 * 1024, RX_RETAIN = 1024 * 1024, RX_PRESIZE_LIMIT = 256 * 1024 * 1024 };
     std::vector<uint8_t> rxbuf;
+    size_t rxbegin;
+    size_t rxend;
     std::vector<uint8_t> txbuf;
     std::vector<uint8_t> receivedData;
 
@@ -174,19 +203,31 @@ class _RealWebSocket : public easywsclient::WebSocket
     readyStateValues readyState;
     bool useMask;
     bool isRxBad;
+    std::string protocol;
 
-    _RealWebSocket(socket_t sockfd, bool useMask)
-            : sockfd(sockfd)
+    _RealWebSocket(socket_t sockfd, bool useMask, const std::string& protocol)
+            : rxbegin(0)
+            , rxend(0)
+            , sockfd(sockfd)
             , readyState(OPEN)
             , useMask(useMask)
-            , isRxBad(false) {
+            , isRxBad(false)
+            , protocol(protocol) {
     }
 
     readyStateValues getReadyState() const {
       return readyState;
     }
 
+    const std::string& getProtocol() const {
+      return protocol;
+    }
+
     void poll(int timeout) { // timeout in milliseconds
+        poll(timeout, -1);
+    }
+
+    void poll(int timeout, int wakefd) { // timeout in milliseconds
         if (readyState == CLOSED) {
             if (timeout > 0) {
                 timeval tv = { timeout/1000, (timeout%1000) * 1000 };
@@ -202,28 +243,35 @@ class _RealWebSocket : public easywsclient::WebSocket
             FD_ZERO(&wfds);
             FD_SET(sockfd, &rfds);
             if (txbuf.size()) { FD_SET(sockfd, &wfds); }
-            select(sockfd + 1, &rfds, &wfds, 0, timeout > 0 ? &tv : 0);
+            int maxfd = (int)sockfd;
+            if (wakefd >= 0) {
+                FD_SET(wakefd, &rfds);
+                if (wakefd > maxfd) { maxfd = wakefd; }
+            }
+            select(maxfd + 1, &rfds, &wfds, 0, timeout > 0 ? &tv : 0);
+            if (wakefd >= 0 && FD_ISSET(wakefd, &rfds)) {
+                // Coalesce however many wakeups arrived; the caller drains its own queue.
+                char drain[64];
+                while (::read(wakefd, drain, sizeof(drain)) > 0) { }
+            }
         }
         while (true) {
             // FD_ISSET(0, &rfds) will be true
-            int N = (int)rxbuf.size();
+            reserveRx(RX_CHUNK);
             ssize_t ret;
-            rxbuf.resize(N + 1500);
-            ret = recv(sockfd, (char*)&rxbuf[0] + N, 1500, 0);
+            ret = recv(sockfd, (char*)&rxbuf[0] + rxend, rxbuf.size() - rxend, 0);
             if (false) { }
             else if (ret < 0 && (socketerrno == SOCKET_EWOULDBLOCK || socketerrno == SOCKET_EAGAIN_EINPROGRESS)) {
-                rxbuf.resize(N);
                 break;
             }
             else if (ret <= 0) {
-                rxbuf.resize(N);
                 closesocket(sockfd);
                 readyState = CLOSED;
                 fputs(ret < 0 ? "Connection error!\n" : "Connection closed!\n", stderr);
                 break;
             }
             else {
-                rxbuf.resize(N + ret);
+                rxend += ret;
             }
         }
         while (txbuf.size()) {
@@ -248,41 +296,73 @@ class _RealWebSocket : public easywsclient::WebSocket
         }
     }
 
+    // Make sure there are at least 'needed' free bytes after rxend.
+    void reserveRx(size_t needed) {
+        if (rxbuf.size() - rxend >= needed) { return; }
+        if (rxbegin > 0) {
+            size_t unread = rxend - rxbegin;
+            if (unread) { memmove(&rxbuf[0], &rxbuf[rxbegin], unread); }
+            rxbegin = 0;
+            rxend = unread;
+        }
+        if (rxbuf.size() - rxend < needed) {
+            size_t newSize = rxbuf.size() ? rxbuf.size() * 2 : RX_INITIAL;
+            while (newSize - rxend < needed) { newSize *= 2; }
+            rxbuf.resize(newSize);
+        }
+    }
+
     // Callable must have signature: void(const std::string & message).
     // Should work with C functions, C++ functors, and C++11 std::function and
     // lambda:
     //template<class Callable>
     //void dispatch(Callable callable)
     virtual void _dispatch(Callback_Imp & callable) {
-        struct CallbackAdapter : public BytesCallback_Imp
-            // Adapt void(const std::string<uint8_t>&) to void(const std::string&)
+        struct CallbackAdapter : public ViewCallback_Imp
+            // Adapt void(const uint8_t *, size_t) to void(const std::string&)
         {
             Callback_Imp& callable;
             CallbackAdapter(Callback_Imp& callable) : callable(callable) { }
-            void operator()(const std::vector<uint8_t>& message) {
-                std::string stringMessage(message.begin(), message.end());
+            void operator()(const uint8_t *bytes, size_t length) {
+                std::string stringMessage((const char *)bytes, length);
                 callable(stringMessage);
             }
         };
-        CallbackAdapter bytesCallback(callable);
-        _dispatchBinary(bytesCallback);
+        CallbackAdapter viewCallback(callable);
+        _dispatchView(viewCallback);
     }
 
     virtual void _dispatchBinary(BytesCallback_Imp & callable) {
+        struct CallbackAdapter : public ViewCallback_Imp
+            // Adapt void(const uint8_t *, size_t) to void(const std::vector<uint8_t>&)
+        {
+            BytesCallback_Imp& callable;
+            CallbackAdapter(BytesCallback_Imp& callable) : callable(callable) { }
+            void operator()(const uint8_t *bytes, size_t length) {
+                std::vector<uint8_t> message(bytes, bytes + length);
+                callable(message);
+            }
+        };
+        CallbackAdapter viewCallback(callable);
+        _dispatchView(viewCallback);
+    }
+
+    virtual void _dispatchView(ViewCallback_Imp & callable) {
         // TODO: consider acquiring a lock on rxbuf...
         if (isRxBad) {
             return;
         }
         while (true) {
             wsheader_type ws;
-            if (rxbuf.size() < 2) { return; /* Need at least 2 */ }
-            const uint8_t * data = (uint8_t *) &rxbuf[0]; // peek, but don't consume
+            const size_t available = rxend - rxbegin;
+            if (available < 2) { break; /* Need at least 2 */ }
+            uint8_t * data = &rxbuf[rxbegin]; // peek, but don't consume
             ws.fin = (data[0] & 0x80) == 0x80;
             ws.opcode = (wsheader_type::opcode_type) (data[0] & 0x0f);
             ws.mask = (data[1] & 0x80) == 0x80;
             ws.N0 = (data[1] & 0x7f);
             ws.header_size = 2 + (ws.N0 == 126? 2 : 0) + (ws.N0 == 127? 8 : 0) + (ws.mask? 4 : 0);
-            if (rxbuf.size() < ws.header_size) { return; /* Need: ws.header_size - rxbuf.size() */ }
+            if (available < ws.header_size) { break; /* Need: ws.header_size - available */ }
             int i = 0;
             if (ws.N0 < 126) {
                 ws.N = ws.N0;
@@ -335,33 +415,51 @@ class _RealWebSocket : public easywsclient::WebSocket
 
             // Note: The checks above should hopefully ensure this addition
             //       cannot overflow:
-            if (rxbuf.size() < ws.header_size+ws.N) { return; /* Need: ws.header_size+ws.N - rxbuf.size() */ }
+            if (available < ws.header_size+ws.N) {
+                // Grow once to fit the whole frame instead of doubling our way there.
+                if (ws.N < RX_PRESIZE_LIMIT) { reserveRx((size_t)(ws.header_size+ws.N - available)); }
+                break; /* Need: ws.header_size+ws.N - available */
+            }
 
             // We got a whole message, now do something with it:
+            uint8_t * payload = data + ws.header_size;
+            const size_t length = (size_t)ws.N;
             if (false) { }
             else if (
                    ws.opcode == wsheader_type::TEXT_FRAME 
                 || ws.opcode == wsheader_type::BINARY_FRAME
                 || ws.opcode == wsheader_type::CONTINUATION
             ) {
-                if (ws.mask) { for (size_t i = 0; i != ws.N; ++i) { rxbuf[i+ws.header_size] ^= ws.masking_key[i&0x3]; } }
-                receivedData.insert(receivedData.end(), rxbuf.begin()+ws.header_size, rxbuf.begin()+ws.header_size+(size_t)ws.N);// just feed
-                if (ws.fin) {
-                    callable((const std::vector<uint8_t>) receivedData);
-                    receivedData.erase(receivedData.begin(), receivedData.end());
-                    std::vector<uint8_t> ().swap(receivedData);// free memory
+                if (ws.mask) { apply_mask(payload, length, ws.masking_key); }
+                if (ws.fin && receivedData.empty()) {
+                    // Unfragmented message: hand it over in place.
+                    callable(payload, length);
+                }
+                else {
+                    receivedData.insert(receivedData.end(), payload, payload + length);// just feed
+                    if (ws.fin) {
+                        callable(receivedData.data(), receivedData.size());
+                        std::vector<uint8_t> ().swap(receivedData);// free memory
+                    }
                 }
             }
             else if (ws.opcode == wsheader_type::PING) {
-                if (ws.mask) { for (size_t i = 0; i != ws.N; ++i) { rxbuf[i+ws.header_size] ^= ws.masking_key[i&0x3]; } }
-                std::string data(rxbuf.begin()+ws.header_size, rxbuf.begin()+ws.header_size+(size_t)ws.N);
+                if (ws.mask) { apply_mask(payload, length, ws.masking_key); }
+                std::string data((const char *)payload, length);
                 sendData(wsheader_type::PONG, data.size(), data.begin(), data.end());
             }
             else if (ws.opcode == wsheader_type::PONG) { }
             else if (ws.opcode == wsheader_type::CLOSE) { close(); }
             else { fprintf(stderr, "ERROR: Got unexpected WebSocket message.\n"); close(); }
 
-            rxbuf.erase(rxbuf.begin(), rxbuf.begin() + ws.header_size+(size_t)ws.N);
+            rxbegin += ws.header_size + length;
+        }
+        if (rxbegin == rxend) {
+            // Everything consumed. Start over at the front, and don't keep a buffer sized for one huge screenshot.
+            rxbegin = rxend = 0;
+            if (rxbuf.size() > RX_RETAIN) {
+                std::vector<uint8_t> ().swap(rxbuf);
+            }
         }
     }
 
@@ -437,9 +535,7 @@ class _RealWebSocket : public easywsclient::WebSocket
         txbuf.insert(txbuf.end(), message_begin, message_end);
         if (useMask) {
             size_t message_offset = txbuf.size() - message_size;
-            for (size_t i = 0; i != message_size; ++i) {
-                txbuf[message_offset + i] ^= masking_key[i&0x3];
-            }
+            apply_mask(&txbuf[message_offset], (size_t)message_size, masking_key);
         }
     }
 
@@ -454,7 +550,26 @@ class _RealWebSocket : public easywsclient::WebSocket
 };
 
 
-easywsclient::WebSocket::pointer from_url(const std::string& url, bool useMask, const std::string& origin) {
+// If line is the named header, returns its value with the surrounding whitespace trimmed off.
+bool header_value(const char *line, const char *name, std::string& value) {
+    size_t n = strlen(name);
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)line[i]) != tolower((unsigned char)name[i])) {
+            return false;
+        }
+    }
+    if (line[n] != ':') {
+        return false;
+    }
+    const char *start = line + n + 1;
+    const char *end = start + strlen(start);
+    while (start < end && isspace((unsigned char)*start)) { ++start; }
+    while (end > start && isspace((unsigned char)end[-1])) { --end; }
+    value.assign(start, end - start);
+    return true;
+}
+
+easywsclient::WebSocket::pointer from_url(const std::string& url, bool useMask, const std::string& origin, const std::string& protocol) {
     char host[512];
     int port;
     char path[512];
@@ -466,6 +581,11 @@ easywsclient::WebSocket::pointer from_url(const std::string& url, bool useMask,
       fprintf(stderr, "ERROR: origin size limit exceeded: %s\n", origin.c_str());
       return NULL;
     }
+    if (protocol.size() >= 200) {
+      fprintf(stderr, "ERROR: protocol size limit exceeded: %s\n", protocol.c_str());
+      return NULL;
+    }
+    std::string acceptedProtocol;
     if (false) { }
     else if (sscanf(url.c_str(), "ws://%[^:/]:%d/%s", host, &port, path) == 3) {
     }
@@ -506,6 +626,9 @@ easywsclient::WebSocket::pointer from_url(const std::string& url, bool useMask,
         if (!origin.empty()) {
             snprintf(line, 1024, "Origin: %s\r\n", origin.c_str()); ::send(sockfd, line, strlen(line), 0);
         }
+        if (!protocol.empty()) {
+            snprintf(line, 1024, "Sec-WebSocket-Protocol: %s\r\n", protocol.c_str()); ::send(sockfd, line, strlen(line), 0);
+        }
         snprintf(line, 1024, "Sec-WebSocket-Key: x3JJHMbDL1EzLkh9GBhXDw==\r\n"); ::send(sockfd, line, strlen(line), 0);
         snprintf(line, 1024, "Sec-WebSocket-Version: 13\r\n"); ::send(sockfd, line, strlen(line), 0);
         snprintf(line, 1024, "\r\n"); ::send(sockfd, line, strlen(line), 0);
@@ -517,6 +640,8 @@ easywsclient::WebSocket::pointer from_url(const std::string& url, bool useMask,
         while (true) {
             for (i = 0; i < 2 || (i < 1023 && line[i-2] != '\r' && line[i-1] != '\n'); ++i) { if (recv(sockfd, line+i, 1, 0) == 0) { return NULL; } }
             if (line[0] == '\r' && line[1] == '\n') { break; }
+            line[i] = 0;
+            header_value(line, "Sec-WebSocket-Protocol", acceptedProtocol);
         }
     }
     int flag = 1;
@@ -528,7 +653,7 @@ easywsclient::WebSocket::pointer from_url(const std::string& url, bool useMask,
     fcntl(sockfd, F_SETFL, O_NONBLOCK);
 #endif
     //fprintf(stderr, "Connected to: %s\n", url.c_str());
-    return easywsclient::WebSocket::pointer(new _RealWebSocket(sockfd, useMask));
+    return easywsclient::WebSocket::pointer(new _RealWebSocket(sockfd, useMask, acceptedProtocol));
 }
 
 } // end of module-only namespace
@@ -543,12 +668,12 @@ WebSocket::pointer WebSocket::create_dummy() {
 }
 
 
-WebSocket::pointer WebSocket::from_url(const std::string& url, const std::string& origin) {
-    return ::from_url(url, true, origin);
+WebSocket::pointer WebSocket::from_url(const std::string& url, const std::string& origin, const std::string& protocol) {
+    return ::from_url(url, true, origin, protocol);
 }
 
-WebSocket::pointer WebSocket::from_url_no_mask(const std::string& url, const std::string& origin) {
-    return ::from_url(url, false, origin);
+WebSocket::pointer WebSocket::from_url_no_mask(const std::string& url, const std::string& origin, const std::string& protocol) {
+    return ::from_url(url, false, origin, protocol);
 }
 
 
@@ -15,6 +15,8 @@ namespace easywsclient {
 
 struct Callback_Imp { virtual void operator()(const std::string& message) = 0; };
 struct BytesCallback_Imp { virtual void operator()(const std::vector<uint8_t>& message) = 0; };
+// The bytes are only valid for the duration of the call; they point into the receive buffer.
+struct ViewCallback_Imp { virtual void operator()(const uint8_t *bytes, size_t length) = 0; };
 
 class WebSocket {
   public:
@@ -23,18 +25,25 @@ class WebSocket {
 
     // Factories:
     static pointer create_dummy();
-    static pointer from_url(const std::string& url, const std::string& origin = std::string());
-    static pointer from_url_no_mask(const std::string& url, const std::string& origin = std::string());
+    // protocol, if given, is offered as Sec-WebSocket-Protocol; it can be a comma-separated list.
+    static pointer from_url(const std::string& url, const std::string& origin = std::string(), const std::string& protocol = std::string());
+    static pointer from_url_no_mask(const std::string& url, const std::string& origin = std::string(), const std::string& protocol = std::string());
 
     // Interfaces:
     virtual ~WebSocket() { }
     virtual void poll(int timeout = 0) = 0; // timeout in milliseconds
+    // Like poll(timeout), but the wait also ends when wakefd becomes readable.
+    // The wake bytes are drained before returning. A negative timeout waits
+    // until there is socket traffic or a wakeup.
+    virtual void poll(int timeout, int wakefd) = 0;
     virtual void send(const std::string& message) = 0;
     virtual void sendBinary(const std::string& message) = 0;
     virtual void sendBinary(const std::vector<uint8_t>& message) = 0;
     virtual void sendPing() = 0;
     virtual void close() = 0;
     virtual readyStateValues getReadyState() const = 0;
+    // The subprotocol the server picked, or empty if it didn't pick one.
+    virtual const std::string& getProtocol() const = 0;
 
     template<class Callable>
     void dispatch(Callable callable)
@@ -62,9 +71,24 @@ class WebSocket {
         _dispatchBinary(callback);
     }
 
+    template<class Callable>
+    void dispatchView(Callable callable)
+        // For callbacks that accept (const uint8_t *bytes, size_t length). No copy is made
+        // for unfragmented messages, so copy out anything that must outlive the callback.
+    {
+        struct _Callback : public ViewCallback_Imp {
+            Callable& callable;
+            _Callback(Callable& callable) : callable(callable) { }
+            void operator()(const uint8_t *bytes, size_t length) { callable(bytes, length); }
+        };
+        _Callback callback(callable);
+        _dispatchView(callback);
+    }
+
   protected:
     virtual void _dispatch(Callback_Imp& callable) = 0;
     virtual void _dispatchBinary(BytesCallback_Imp& callable) = 0;
+    virtual void _dispatchView(ViewCallback_Imp& callable) = 0;
 };
 
 } // namespace easywsclient
@@ -0,0 +1,242 @@
+//
+//  framering.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef FRAMERING_HPP
+#define FRAMERING_HPP
+
+// A few decoded video frames on their way from a decoder thread to the display, in
+// presentation timestamp order, as between RTSPViewController's decoder thread and the main
+// thread.
+//
+// The decoder pushes each frame as soon as it has it, and the display takes the newest one
+// whenever it gets to run; the older ones are never shown. Neither side waits for the other
+// beyond a short lock, so a slow frame on one side doesn't hold up the other. If the display
+// falls behind far enough to fill the ring, the oldest frame goes.
+//
+// Turning a decoded frame into something to push (scaling it, making an image) costs more
+// than decoding it, so the decoder can ask needsFrame first and skip that for frames the
+// display would never get to. Skipping keeps an older frame waiting in place of a newer one,
+// so how long it's allowed to wait bounds how stale the display gets.
+//
+// A Pacer holds the decoder to the stream's own timing when it could go faster, as it would
+// with a file. A live stream is never ahead of itself, so it never waits. OutputSize decides
+// when a view has changed size enough to be worth a new scaler, and threadCPUSeconds is how
+// a decoder thread says what it's costing.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <time.h>
+#include <utility>
+#include <vector>
+
+namespace framering {
+
+using Clock = std::chrono::steady_clock;
+
+struct Stats {
+    uint64_t decoded = 0;
+    // Decoded while the display still had a frame to take, so never converted or pushed.
+    uint64_t skipped = 0;
+    uint64_t displayed = 0;
+    // Pushed but never displayed: pushed out of a full ring, passed over for a newer frame or
+    // cleared away.
+    uint64_t dropped = 0;
+    // Time from push to display, over every frame displayed so far.
+    uint64_t totalLatencyNS = 0;
+    uint64_t maxLatencyNS = 0;
+
+    double averageLatencyMS() const {
+        return displayed ? totalLatencyNS / (double)displayed / 1e6 : 0;
+    }
+    double maxLatencyMS() const { return maxLatencyNS / 1e6; }
+};
+
+template <class T>
+class Ring {
+  public:
+    explicit Ring(size_t capacity = 4) : slots(std::max(capacity, (size_t)1)), count(0) {}
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    size_t capacity() const { return slots.size(); }
+
+    // Decoder side. Whether the next frame is worth converting and pushing: the display has
+    // taken everything pushed so far, or what's waiting has waited longer than maxWait and a
+    // newer frame would be better. Otherwise it can be skipped.
+    bool needsFrame(Clock::duration maxWait = Clock::duration::max(), Clock::time_point now = Clock::now()) const {
+        std::lock_guard<std::mutex> guard(lock);
+        return count == 0 || now - slots[count - 1].pushedAt >= maxWait;
+    }
+
+    // Decoder side, for a frame that isn't pushed.
+    void skip() {
+        std::lock_guard<std::mutex> guard(lock);
+        counters.decoded++;
+        counters.skipped++;
+    }
+
+    // Decoder side. A frame that's older than everything in a full ring is the one dropped.
+    void push(double pts, T frame) {
+        std::lock_guard<std::mutex> guard(lock);
+        counters.decoded++;
+        size_t at = count;
+        while (at > 0 && slots[at - 1].pts > pts) {
+            at--;
+        }
+        if (count == slots.size()) {
+            counters.dropped++;
+            if (at == 0) {
+                return;
+            }
+            // Make room by moving everything older down over the oldest.
+            std::move(slots.begin() + 1, slots.begin() + (ptrdiff_t)at, slots.begin());
+            at--;
+        } else {
+            std::move_backward(slots.begin() + (ptrdiff_t)at, slots.begin() + (ptrdiff_t)count, slots.begin() + (ptrdiff_t)count + 1);
+            count++;
+        }
+        slots[at] = { pts, Clock::now(), std::move(frame) };
+    }
+
+    // Display side. Takes the newest frame and drops the rest; false if there's nothing new.
+    bool takeNewest(T& frame, double *pts = nullptr) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (count == 0) {
+            return false;
+        }
+        Slot& newest = slots[count - 1];
+        frame = std::move(newest.frame);
+        if (pts != nullptr) {
+            *pts = newest.pts;
+        }
+        uint64_t latency = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - newest.pushedAt).count();
+        counters.displayed++;
+        counters.totalLatencyNS += latency;
+        counters.maxLatencyNS = std::max(counters.maxLatencyNS, latency);
+        counters.dropped += count - 1;
+        release();
+        return true;
+    }
+
+    // Either side, when the stream stops or starts over.
+    void clear() {
+        std::lock_guard<std::mutex> guard(lock);
+        counters.dropped += count;
+        release();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return counters;
+    }
+
+  private:
+    struct Slot {
+        double pts = 0;
+        Clock::time_point pushedAt;
+        T frame = T();
+    };
+
+    // Frames can be big, so the ring doesn't hang on to the ones it's done with.
+    void release() {
+        for (size_t i = 0; i < count; i++) {
+            slots[i].frame = T();
+        }
+        count = 0;
+    }
+
+    mutable std::mutex lock;
+    std::vector<Slot> slots;
+    size_t count;
+    Stats counters;
+};
+
+// Maps presentation timestamps onto the clock, starting from the first frame.
+class Pacer {
+  public:
+    // A frame this late, or this far ahead, means the timestamps jumped or the stream is live
+    // and we've fallen behind; either way, start timing again from this frame.
+    static constexpr double MaxDrift = 1.0;
+
+    // How long the decoder should wait before pushing a frame with this timestamp.
+    Clock::duration delay(double pts, Clock::time_point now = Clock::now()) {
+        if (!anchored) {
+            anchor(pts, now);
+            return Clock::duration::zero();
+        }
+        double ahead = (pts - anchorPTS) - std::chrono::duration<double>(now - anchorTime).count();
+        if (ahead < -MaxDrift || ahead > MaxDrift) {
+            anchor(pts, now);
+            return Clock::duration::zero();
+        }
+        if (ahead <= 0) {
+            return Clock::duration::zero();
+        }
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(ahead));
+    }
+
+    void reset() { anchored = false; }
+
+  private:
+    void anchor(double pts, Clock::time_point now) {
+        anchored = true;
+        anchorPTS = pts;
+        anchorTime = now;
+    }
+
+    bool anchored = false;
+    double anchorPTS = 0;
+    Clock::time_point anchorTime;
+};
+
+// The size to have the scaler produce for a view. Changing it means a new scaler, so it only
+// changes once a live resize is over, and then only if the view has grown past it (the image
+// would be scaled up) or shrunk well below it (the scaler would be doing work that's thrown
+// away). In between, the view scales the image the rest of the way.
+class OutputSize {
+  public:
+    // How far below the output size a view can shrink before it's worth a smaller one.
+    static constexpr double MinScale = 0.75;
+
+    // Returns true if the size changed.
+    bool update(int viewWidth, int viewHeight, bool liveResize) {
+        if (viewWidth <= 0 || viewHeight <= 0) {
+            return false;
+        }
+        if (outputWidth > 0 && (liveResize || (fits(viewWidth, outputWidth) && fits(viewHeight, outputHeight)))) {
+            return false;
+        }
+        if (viewWidth == outputWidth && viewHeight == outputHeight) {
+            return false;
+        }
+        outputWidth = viewWidth;
+        outputHeight = viewHeight;
+        return true;
+    }
+
+    int width() const { return outputWidth; }
+    int height() const { return outputHeight; }
+
+  private:
+    static bool fits(int view, int output) { return view <= output && view >= output * MinScale; }
+
+    int outputWidth = 0, outputHeight = 0;
+};
+
+// CPU time the calling thread has used so far.
+inline double threadCPUSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+} // namespace framering
+
+#endif /* FRAMERING_HPP */
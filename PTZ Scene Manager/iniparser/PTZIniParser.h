@@ -15,6 +15,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property dictionary *ini;
 @property NSString *path;
+// YES when there are edits that have not been written to path yet.
+@property (readonly) BOOL dirty;
+// How long setNeedsWrite waits for more edits before writing. Default 0.5 seconds.
+@property NSTimeInterval writeDelay;
+// Total bytes written to disk by this object.
+@property (readonly) NSUInteger bytesWritten;
 
 - (instancetype)initWithPath:(NSString *)path;
 - (void)logDictionary;
@@ -25,6 +31,12 @@ NS_ASSUME_NONNULL_BEGIN
 - (BOOL)setInteger:(NSInteger)value forKey:(NSString *)aKey;
 
 - (BOOL)writeToFile:(NSString *)file;
+// Write edits to path after writeDelay, restarting the delay on every call, so a burst of edits is one write.
+- (void)setNeedsWrite;
+// Write pending edits to path now.
+- (BOOL)commit;
+// Write every parser's pending edits now, as when the app quits.
++ (void)commitAll;
 
 @end
 
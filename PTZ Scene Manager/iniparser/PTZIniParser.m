@@ -35,6 +35,11 @@ static int _error_callback(const char *format, ...)
 }
 @end
 
+@interface PTZIniParser ()
+@property BOOL dirty;
+@property NSUInteger bytesWritten;
+@end
+
 @implementation PTZIniParser
 
 + (void)initialize {
@@ -42,32 +47,73 @@ static int _error_callback(const char *format, ...)
     iniparser_set_error_callback(_error_callback);
 }
 
+// Every open parser, so pending writes can be flushed at quit. A pending write retains its parser, so dealloc won't do it.
++ (NSHashTable<PTZIniParser *> *)openParsers {
+    static NSHashTable *parsers;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        parsers = [NSHashTable weakObjectsHashTable];
+    });
+    return parsers;
+}
+
++ (void)commitAll {
+    NSArray *parsers;
+    @synchronized (self) {
+        parsers = [[self openParsers] allObjects];
+    }
+    for (PTZIniParser *parser in parsers) {
+        [parser commit];
+    }
+}
+
 - (instancetype)initWithPath:(NSString *)path {
     self = [super init];
     if (self) {
         _last_error[0] = '\0';
         _ini = iniparser_load([path UTF8String]);
         _path = path;
+        _writeDelay = 0.5;
         if (_ini == NULL) {
             return nil;
         }
+        @synchronized ([PTZIniParser class]) {
+            [[PTZIniParser openParsers] addObject:self];
+        }
     }
     return self;
 }
 
 - (void)dealloc {
+    [self commit];
     iniparser_freedict(_ini);
     _ini = NULL;
 }
 
+// Writes to a temp file and renames it over the original, so a crash mid-write can't truncate the settings.
 - (BOOL)writeToFile:(NSString *)file {
-    FILE * fd;
-    if ((fd=fopen([file UTF8String], "w"))==NULL) {
+    long written = iniparser_store(self.ini, [file UTF8String]);
+    if (written < 0) {
         return NO;
     }
+    self.bytesWritten += written;
+    return YES;
+}
+
+- (void)setNeedsWrite {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(commit) object:nil];
+    [self performSelector:@selector(commit) withObject:nil afterDelay:self.writeDelay];
+}
 
-    iniparser_dump_ini(self.ini, fd);
-    fclose(fd);
+- (BOOL)commit {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(commit) object:nil];
+    if (!self.dirty) {
+        return YES;
+    }
+    if (![self writeToFile:self.path]) {
+        return NO;
+    }
+    self.dirty = NO;
     return YES;
 }
 
@@ -91,7 +137,11 @@ static int _error_callback(const char *format, ...)
 }
 
 - (BOOL)setString:(NSString *)string forKey:(NSString *)key {
-    return iniparser_set(self.ini, [key UTF8String], [string ptz_INIString]) == 0;
+    if (iniparser_set(self.ini, [key UTF8String], [string ptz_INIString]) != 0) {
+        return NO;
+    }
+    self.dirty = YES;
+    return YES;
 }
 
 - (NSInteger)integerForKey:(NSString *)aKey {
@@ -89,7 +89,7 @@ static NSCharacterSet *PTZSettings_iniKeyCharacterSet;
     // list General "mem" + index + ip
     NSString *key = [NSString stringWithFormat:@"%@:mem%d%@", @"General", (int)scene, [self fixKey:devname]];
     if ([self setString:name forKey:key]) {
-        [self writeToFile:self.path];
+        [self setNeedsWrite];
     }
 }
 
@@ -29,6 +29,12 @@
 /** Invalid key token */
 #define DICT_INVALID_KEY    ((char*)-1)
 
+/** Index bucket that has never held a slot; ends a probe sequence */
+#define DICT_INDEX_EMPTY    (-1)
+
+/** Index bucket whose entry was removed; probing continues past it */
+#define DICT_INDEX_DELETED  (-2)
+
 /*---------------------------------------------------------------------------
                             Private functions
  ---------------------------------------------------------------------------*/
@@ -60,43 +66,305 @@ static char * xstrdup(const char * s)
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Double the size of the dictionary
-  @param    d Dictionary to grow
+  @brief    Free a key or value unless it lives in the arena
+  @param    d Dictionary owning the string
+  @param    s String to free, may be NULL
+ */
+/*--------------------------------------------------------------------------*/
+static void dictionary_freestr(const dictionary * d, char * s)
+{
+    if (s >= d->arena && s < d->arena + d->arenasize)
+        return ;
+    free(s);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Number of index buckets for a given storage size
+  @param    size Storage size of the dictionary
+  @return   Smallest power of two that is at least twice size
+
+  Keeping the index at most half full keeps probe sequences short, and
+  guarantees there is always an empty bucket to stop on.
+ */
+/*--------------------------------------------------------------------------*/
+static size_t dictionary_indexsize(ssize_t size)
+{
+    size_t indexsize = DICTMINSZ ;
+
+    while (indexsize < (size_t)size * 2)
+        indexsize *= 2 ;
+    return indexsize ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Hash the first len characters of a string
+  @param    key     Characters to hash
+  @param    len     Number of characters
+  @return   Same value dictionary_hash gives for a string of those characters
+ */
+/*--------------------------------------------------------------------------*/
+static unsigned dictionary_hashlen(const char * key, size_t len)
+{
+    unsigned    hash ;
+    size_t      i ;
+
+    for (hash=0, i=0 ; i<len ; i++) {
+        hash += (unsigned)key[i] ;
+        hash += (hash<<10);
+        hash ^= (hash>>6) ;
+    }
+    hash += (hash <<3);
+    hash ^= (hash >>11);
+    hash += (hash <<15);
+    return hash ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find the index bucket for a key
+  @param    d    Dictionary to search
+  @param    key  Key to look for
+  @param    hash Hash of key
+  @return   Bucket holding the key's slot, or -1 if the key is not present
+ */
+/*--------------------------------------------------------------------------*/
+static ssize_t dictionary_find(const dictionary * d, const char * key, unsigned hash)
+{
+    size_t      mask = d->indexsize - 1 ;
+    size_t      b ;
+    ssize_t     slot ;
+
+    for (b = hash & mask ; ; b = (b + 1) & mask) {
+        slot = d->index[b] ;
+        if (slot == DICT_INDEX_EMPTY)
+            return -1 ;
+        if (slot == DICT_INDEX_DELETED)
+            continue ;
+        /* Compare hash, then string to avoid hash collisions */
+        if (hash == d->hash[slot] && !strcmp(key, d->key[slot]))
+            return (ssize_t)b ;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Add a slot to the index
+  @param    d    Dictionary to modify
+  @param    slot Slot whose key is not in the index yet
+ */
+/*--------------------------------------------------------------------------*/
+static void dictionary_index_add(dictionary * d, ssize_t slot)
+{
+    size_t      mask = d->indexsize - 1 ;
+    size_t      b ;
+
+    for (b = d->hash[slot] & mask ; d->index[b] >= 0 ; b = (b + 1) & mask)
+        ;
+    d->index[b] = slot ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find the slot of a section from the start of a key
+  @param    d    Dictionary to search
+  @param    sec  Section name, not necessarily terminated
+  @param    len  Length of the section name
+  @return   Slot of the section, or -1 if it is not present
+ */
+/*--------------------------------------------------------------------------*/
+static ssize_t dictionary_secslot(const dictionary * d, const char * sec, size_t len)
+{
+    unsigned    hash = dictionary_hashlen(sec, len) ;
+    size_t      mask = d->indexsize - 1 ;
+    size_t      b ;
+    ssize_t     slot ;
+
+    for (b = hash & mask ; ; b = (b + 1) & mask) {
+        slot = d->index[b] ;
+        if (slot == DICT_INDEX_EMPTY)
+            return -1 ;
+        if (slot == DICT_INDEX_DELETED)
+            continue ;
+        if (hash == d->hash[slot] && !strncmp(sec, d->key[slot], len) && d->key[slot][len] == '\0')
+            return slot ;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Append a key to the end of its section's list
+  @param    d    Dictionary to modify
+  @param    slot Slot of a key that is in no list yet
+  @param    sec  Slot of its section
+ */
+/*--------------------------------------------------------------------------*/
+static void dictionary_secappend(dictionary * d, ssize_t slot, ssize_t sec)
+{
+    dictionary_link * l = d->link ;
+
+    l[slot].sec  = sec ;
+    l[slot].prev = l[sec].prev ;
+    l[slot].next = sec ;
+    l[l[sec].prev].next = slot ;
+    l[sec].prev = slot ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Add a newly filled slot to the section index
+  @param    d    Dictionary to modify
+  @param    slot Slot that was just filled, after every other used slot
+
+  A section goes at the end of d->sections. It also adopts any keys that
+  were added before it, which only happens if sections are removed or
+  keys are set before their section.
+ */
+/*--------------------------------------------------------------------------*/
+static void dictionary_seclink(dictionary * d, ssize_t slot)
+{
+    const char * colon = strchr(d->key[slot], ':') ;
+    ssize_t      sec ;
+    ssize_t      i ;
+    size_t       len ;
+
+    d->link[slot].sec  = -1 ;
+    d->link[slot].prev = slot ;
+    d->link[slot].next = slot ;
+    if (colon != NULL) {
+        /* When the index is rebuilt, a section that comes later adopts the key */
+        sec = dictionary_secslot(d, d->key[slot], (size_t)(colon - d->key[slot]));
+        if (sec >= 0 && sec < slot)
+            dictionary_secappend(d, slot, sec);
+        else
+            d->norphans++ ;
+        return ;
+    }
+    d->sections[d->nsec++] = slot ;
+    if (d->norphans == 0)
+        return ;
+    len = strlen(d->key[slot]);
+    for (i=0 ; i<slot ; i++) {
+        if (d->key[i] == NULL || d->link[i].sec >= 0)
+            continue ;
+        if (!strncmp(d->key[i], d->key[slot], len) && d->key[i][len] == ':') {
+            dictionary_secappend(d, i, slot);
+            d->norphans-- ;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Remove a slot from the section index
+  @param    d    Dictionary to modify
+  @param    slot Slot that is about to be emptied
+
+  Removing a section leaves its keys without one until it is set again.
+ */
+/*--------------------------------------------------------------------------*/
+static void dictionary_secunlink(dictionary * d, ssize_t slot)
+{
+    dictionary_link * l = d->link ;
+    ssize_t           i, next ;
+
+    if (l[slot].sec >= 0) {
+        l[l[slot].prev].next = l[slot].next ;
+        l[l[slot].next].prev = l[slot].prev ;
+        return ;
+    }
+    if (strchr(d->key[slot], ':') != NULL) {
+        d->norphans-- ;
+        return ;
+    }
+    for (i = l[slot].next ; i != slot ; i = next) {
+        next = l[i].next ;
+        l[i].sec  = -1 ;
+        l[i].prev = i ;
+        l[i].next = i ;
+        d->norphans++ ;
+    }
+    for (i=0 ; d->sections[i] != slot ; i++)
+        ;
+    memmove(d->sections + i, d->sections + i + 1, (size_t)(d->nsec - i - 1) * sizeof *d->sections);
+    d->nsec-- ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Reallocate the dictionary, dropping removed slots
+  @param    d       Dictionary to resize
+  @param    size    New storage size, at least d->n
   @return   This function returns non-zero in case of failure
+
+  Live entries keep their relative order. The index is rebuilt, which also
+  clears out deleted buckets.
  */
 /*--------------------------------------------------------------------------*/
-static int dictionary_grow(dictionary * d)
+static int dictionary_resize(dictionary * d, ssize_t size)
 {
     char        ** new_val ;
     char        ** new_key ;
     unsigned     * new_hash ;
-
-    new_val  = (char**) calloc(d->size * 2, sizeof *d->val);
-    new_key  = (char**) calloc(d->size * 2, sizeof *d->key);
-    new_hash = (unsigned*) calloc(d->size * 2, sizeof *d->hash);
-    if (!new_val || !new_key || !new_hash) {
+    ssize_t      * new_index ;
+    dictionary_link * new_link ;
+    ssize_t      * new_sections ;
+    size_t         new_indexsize ;
+    ssize_t        i, j ;
+
+    new_indexsize = dictionary_indexsize(size);
+    new_val   = (char**) calloc(size, sizeof *d->val);
+    new_key   = (char**) calloc(size, sizeof *d->key);
+    new_hash  = (unsigned*) calloc(size, sizeof *d->hash);
+    new_index = (ssize_t*) malloc(new_indexsize * sizeof *d->index);
+    new_link  = (dictionary_link*) malloc(size * sizeof *d->link);
+    new_sections = (ssize_t*) malloc(size * sizeof *d->sections);
+    if (!new_val || !new_key || !new_hash || !new_index || !new_link || !new_sections) {
         /* An allocation failed, leave the dictionary unchanged */
-        if (new_val)
-            free(new_val);
-        if (new_key)
-            free(new_key);
-        if (new_hash)
-            free(new_hash);
+        free(new_val);
+        free(new_key);
+        free(new_hash);
+        free(new_index);
+        free(new_link);
+        free(new_sections);
         return -1 ;
     }
-    /* Initialize the newly allocated space */
-    memcpy(new_val, d->val, d->size * sizeof(char *));
-    memcpy(new_key, d->key, d->size * sizeof(char *));
-    memcpy(new_hash, d->hash, d->size * sizeof(unsigned));
+    /* Move live entries down, in order */
+    for (i=0, j=0 ; i<d->used ; i++) {
+        if (d->key[i]==NULL)
+            continue ;
+        new_key[j]  = d->key[i];
+        new_val[j]  = d->val[i];
+        new_hash[j] = d->hash[i];
+        j++ ;
+    }
     /* Delete previous data */
     free(d->val);
     free(d->key);
     free(d->hash);
+    free(d->index);
+    free(d->link);
+    free(d->sections);
     /* Actually update the dictionary */
-    d->size *= 2 ;
+    d->size = size ;
+    d->used = j ;
     d->val = new_val;
     d->key = new_key;
     d->hash = new_hash;
+    d->index = new_index;
+    d->indexsize = new_indexsize;
+    d->link = new_link;
+    d->sections = new_sections;
+    for (i=0 ; i<(ssize_t)new_indexsize ; i++)
+        d->index[i] = DICT_INDEX_EMPTY ;
+    for (i=0 ; i<d->used ; i++)
+        dictionary_index_add(d, i);
+    /* Slot numbers changed, so the section lists are rebuilt too */
+    d->nsec = 0 ;
+    d->norphans = 0 ;
+    for (i=0 ; i<d->used ; i++)
+        dictionary_seclink(d, i);
     return 0 ;
 }
 
@@ -117,23 +385,10 @@ static int dictionary_grow(dictionary * d)
 /*--------------------------------------------------------------------------*/
 unsigned dictionary_hash(const char * key)
 {
-    size_t      len ;
-    unsigned    hash ;
-    size_t      i ;
-
     if (!key)
         return 0 ;
 
-    len = strlen(key);
-    for (hash=0, i=0 ; i<len ; i++) {
-        hash += (unsigned)key[i] ;
-        hash += (hash<<10);
-        hash ^= (hash>>6) ;
-    }
-    hash += (hash <<3);
-    hash ^= (hash >>11);
-    hash += (hash <<15);
-    return hash ;
+    return dictionary_hashlen(key, strlen(key));
 }
 
 /*-------------------------------------------------------------------------*/
@@ -157,10 +412,10 @@ dictionary * dictionary_new(size_t size)
     d = (dictionary*) calloc(1, sizeof *d) ;
 
     if (d) {
-        d->size = size ;
-        d->val  = (char**) calloc(size, sizeof *d->val);
-        d->key  = (char**) calloc(size, sizeof *d->key);
-        d->hash = (unsigned*) calloc(size, sizeof *d->hash);
+        if (dictionary_resize(d, size) != 0) {
+            free(d);
+            return NULL ;
+        }
     }
     return d ;
 }
@@ -178,15 +433,19 @@ void dictionary_del(dictionary * d)
     ssize_t  i ;
 
     if (d==NULL) return ;
-    for (i=0 ; i<d->size ; i++) {
+    for (i=0 ; i<d->used ; i++) {
         if (d->key[i]!=NULL)
-            free(d->key[i]);
+            dictionary_freestr(d, d->key[i]);
         if (d->val[i]!=NULL)
-            free(d->val[i]);
+            dictionary_freestr(d, d->val[i]);
     }
+    free(d->arena);
     free(d->val);
     free(d->key);
     free(d->hash);
+    free(d->index);
+    free(d->link);
+    free(d->sections);
     free(d);
     return ;
 }
@@ -208,21 +467,69 @@ void dictionary_del(dictionary * d)
 const char * dictionary_get(const dictionary * d, const char * key, const char * def)
 {
     unsigned    hash ;
-    ssize_t      i ;
+    ssize_t      b ;
 
     hash = dictionary_hash(key);
-    for (i=0 ; i<d->size ; i++) {
-        if (d->key[i]==NULL)
-            continue ;
-        /* Compare hash */
-        if (hash==d->hash[i]) {
-            /* Compare string, to avoid hash collisions */
-            if (!strcmp(key, d->key[i])) {
-                return d->val[i] ;
-            }
+    b = dictionary_find(d, key, hash);
+    if (b < 0)
+        return def ;
+    return d->val[d->index[b]] ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Shared body of dictionary_set and dictionary_set_arena
+  @param    d       dictionary object to modify.
+  @param    key     Key to modify or add.
+  @param    val     Value to add.
+  @param    copy    Non-zero to duplicate key and val, zero to keep the pointers
+  @return   int     0 if Ok, anything else otherwise
+ */
+/*--------------------------------------------------------------------------*/
+static int dictionary_store(dictionary * d, const char * key, const char * val, int copy)
+{
+    ssize_t         i, b ;
+    unsigned       hash ;
+
+    if (d==NULL || key==NULL) return -1 ;
+
+    /* Compute hash for this key */
+    hash = dictionary_hash(key) ;
+    /* Find if value is already in dictionary */
+    b = dictionary_find(d, key, hash);
+    if (b >= 0) {
+        /* Found a value: modify and return */
+        i = d->index[b] ;
+        if (d->val[i]!=NULL)
+            dictionary_freestr(d, d->val[i]);
+        d->val[i] = (val && copy ? xstrdup(val) : (char*)val);
+        /* Value has been modified: return */
+        return 0 ;
+    }
+    /* Add a new value */
+    /* See if dictionary needs to grow */
+    if (d->used==d->size) {
+        /* Out of slots: squeeze out removed ones if that frees enough,
+           otherwise double the size. Either way order is kept. */
+        if (d->n > d->size - d->size / 4) {
+            if (dictionary_resize(d, d->size * 2) != 0)
+                return -1;
+        } else {
+            if (dictionary_resize(d, d->size) != 0)
+                return -1;
         }
     }
-    return def ;
+
+    /* New keys always go at the end, so walking the slots gives insertion order */
+    i = d->used++ ;
+    /* Copy key */
+    d->key[i]  = (copy ? xstrdup(key) : (char*)key);
+    d->val[i]  = (val && copy ? xstrdup(val) : (char*)val) ;
+    d->hash[i] = hash;
+    dictionary_index_add(d, i);
+    dictionary_seclink(d, i);
+    d->n ++ ;
+    return 0 ;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -253,50 +560,21 @@ const char * dictionary_get(const dictionary * d, const char * key, const char *
 /*--------------------------------------------------------------------------*/
 int dictionary_set(dictionary * d, const char * key, const char * val)
 {
-    ssize_t         i ;
-    unsigned       hash ;
-
-    if (d==NULL || key==NULL) return -1 ;
-
-    /* Compute hash for this key */
-    hash = dictionary_hash(key) ;
-    /* Find if value is already in dictionary */
-    if (d->n>0) {
-        for (i=0 ; i<d->size ; i++) {
-            if (d->key[i]==NULL)
-                continue ;
-            if (hash==d->hash[i]) { /* Same hash value */
-                if (!strcmp(key, d->key[i])) {   /* Same key */
-                    /* Found a value: modify and return */
-                    if (d->val[i]!=NULL)
-                        free(d->val[i]);
-                    d->val[i] = (val ? xstrdup(val) : NULL);
-                    /* Value has been modified: return */
-                    return 0 ;
-                }
-            }
-        }
-    }
-    /* Add a new value */
-    /* See if dictionary needs to grow */
-    if (d->n==d->size) {
-        /* Reached maximum size: reallocate dictionary */
-        if (dictionary_grow(d) != 0)
-            return -1;
-    }
+    return dictionary_store(d, key, val, 1);
+}
 
-    /* Insert key in the first empty slot. Start at d->n and wrap at
-       d->size. Because d->n < d->size this will necessarily
-       terminate. */
-    for (i=d->n ; d->key[i] ; ) {
-        if(++i == d->size) i = 0;
-    }
-    /* Copy key */
-    d->key[i]  = xstrdup(key);
-    d->val[i]  = (val ? xstrdup(val) : NULL) ;
-    d->hash[i] = hash;
-    d->n ++ ;
-    return 0 ;
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value in a dictionary without copying it.
+  @param    d       dictionary object to modify.
+  @param    key     Key to modify or add, inside d->arena.
+  @param    val     Value to add, inside d->arena, or NULL.
+  @return   int     0 if Ok, anything else otherwise
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_set_arena(dictionary * d, const char * key, const char * val)
+{
+    return dictionary_store(d, key, val, 0);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -312,33 +590,26 @@ int dictionary_set(dictionary * d, const char * key, const char * val)
 void dictionary_unset(dictionary * d, const char * key)
 {
     unsigned    hash ;
-    ssize_t      i ;
+    ssize_t      i, b ;
 
     if (key == NULL || d == NULL) {
         return;
     }
 
     hash = dictionary_hash(key);
-    for (i=0 ; i<d->size ; i++) {
-        if (d->key[i]==NULL)
-            continue ;
-        /* Compare hash */
-        if (hash==d->hash[i]) {
-            /* Compare string, to avoid hash collisions */
-            if (!strcmp(key, d->key[i])) {
-                /* Found key */
-                break ;
-            }
-        }
-    }
-    if (i>=d->size)
+    b = dictionary_find(d, key, hash);
+    if (b < 0)
         /* Key not found */
         return ;
 
-    free(d->key[i]);
+    i = d->index[b] ;
+    /* Leave a marker so probes for keys that collided with this one still find them */
+    d->index[b] = DICT_INDEX_DELETED ;
+    dictionary_secunlink(d, i);
+    dictionary_freestr(d, d->key[i]);
     d->key[i] = NULL ;
     if (d->val[i]!=NULL) {
-        free(d->val[i]);
+        dictionary_freestr(d, d->val[i]);
         d->val[i] = NULL ;
     }
     d->hash[i] = 0 ;
@@ -346,6 +617,21 @@ void dictionary_unset(dictionary * d, const char * key)
     return ;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a section in a dictionary
+  @param    d       dictionary object to search.
+  @param    sec     Section name, exactly as stored.
+  @return   Slot of the section, or -1 if there is no such section
+ */
+/*--------------------------------------------------------------------------*/
+ssize_t dictionary_secfind(const dictionary * d, const char * sec)
+{
+    if (d==NULL || sec==NULL || strchr(sec, ':')!=NULL)
+        return -1 ;
+    return dictionary_secslot(d, sec, strlen(sec));
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Dump a dictionary to an opened file pointer.
@@ -366,7 +652,7 @@ void dictionary_dump(const dictionary * d, FILE * out)
         fprintf(out, "empty dictionary\n");
         return ;
     }
-    for (i=0 ; i<d->size ; i++) {
+    for (i=0 ; i<d->used ; i++) {
         if (d->key[i]) {
             fprintf(out, "%20s\t[%s]\n",
                     d->key[i],
@@ -32,6 +32,21 @@ extern "C" {
  ---------------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Section links for one dictionary slot
+
+  Keys of the same section form a circular list through prev and next,
+  with the section's own slot as the list head. A key whose section is
+  not in the dictionary links to itself.
+ */
+/*-------------------------------------------------------------------------*/
+typedef struct _dictionary_link_ {
+    ssize_t         sec ;   /** Slot of this key's section, -1 for sections and keys without one */
+    ssize_t         prev ;  /** Previous key in the section; for a section, its last key */
+    ssize_t         next ;  /** Next key in the section; for a section, its first key */
+} dictionary_link ;
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Dictionary object
@@ -41,6 +56,21 @@ extern "C" {
   in the dictionary is speeded up by the use of a (hopefully collision-free)
   hash function.
    Yes, case-sensitive keys are totally counter to the spec, but PacketSender is being idiosyncratic.
+
+  Entries are kept in key/val/hash in insertion order, with NULL keys where
+  entries were removed, so walking them from 0 to size gives the file order
+  back. index is an open-addressing table over those slots.
+
+  Dictionaries built by iniparser_load keep their strings in one arena
+  block. Strings set afterwards are allocated one by one; anything that
+  does not point into the arena is freed on its own.
+
+  A key with no ':' is a section. link and sections index the sections
+  and their "section:..." keys so they can be walked without scanning
+  every slot.
+
+  VISCA_open_ini in liblibvisca-all.a sets caseSensitive directly, so the
+  fields up to hash keep their original order; new ones go at the end.
  */
 /*-------------------------------------------------------------------------*/
 typedef struct _dictionary_ {
@@ -50,6 +80,15 @@ typedef struct _dictionary_ {
     char        **  val ;   /** List of string values */
     char        **  key ;   /** List of string keys */
     unsigned     *  hash ;  /** List of hash values for keys */
+    ssize_t         used ;  /** Slots filled so far, including removed ones */
+    ssize_t      *  index ; /** Hash table of slot numbers, linear probing */
+    size_t          indexsize ; /** Number of buckets in index, a power of two */
+    char         *  arena ; /** Block holding loaded keys and values, or NULL */
+    size_t          arenasize ; /** Bytes in arena */
+    dictionary_link * link ; /** Section list links, one per slot */
+    ssize_t      *  sections ; /** Slots of the sections, in slot order */
+    ssize_t         nsec ;  /** Number of sections */
+    ssize_t         norphans ; /** Keys whose section is not in the dictionary */
 } dictionary ;
 
 
@@ -139,6 +178,21 @@ const char * dictionary_get(const dictionary * d, const char * key, const char *
 /*--------------------------------------------------------------------------*/
 int dictionary_set(dictionary * vd, const char * key, const char * val);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Set a value in a dictionary without copying it.
+  @param    d       dictionary object to modify.
+  @param    key     Key to modify or add, inside d->arena.
+  @param    val     Value to add, inside d->arena, or NULL.
+  @return   int     0 if Ok, anything else otherwise
+
+  Same as dictionary_set, but the dictionary keeps the key and val
+  pointers instead of duplicating them. Both must point into d->arena,
+  which the dictionary frees as a whole in dictionary_del.
+ */
+/*--------------------------------------------------------------------------*/
+int dictionary_set_arena(dictionary * d, const char * key, const char * val);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Delete a key in a dictionary
@@ -152,6 +206,19 @@ int dictionary_set(dictionary * vd, const char * key, const char * val);
 void dictionary_unset(dictionary * d, const char * key);
 
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find a section in a dictionary
+  @param    d       dictionary object to search.
+  @param    sec     Section name, exactly as stored.
+  @return   Slot of the section, or -1 if there is no such section
+
+  The keys of the section are d->key[d->link[slot].next] and onwards,
+  following next until it comes back to slot.
+ */
+/*--------------------------------------------------------------------------*/
+ssize_t dictionary_secfind(const dictionary * d, const char * sec);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Dump a dictionary to an opened file pointer.
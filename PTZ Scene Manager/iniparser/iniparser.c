@@ -8,7 +8,10 @@
 /*--------------------------------------------------------------------------*/
 /*---------------------------- Includes ------------------------------------*/
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "iniparser.h"
 
 /*---------------------------- Defines -------------------------------------*/
@@ -62,54 +65,105 @@ static const char * strlwc(const dictionary *d, const char * in, char *out, size
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Duplicate a string
-  @param    s String to duplicate
-  @return   Pointer to a newly allocated string, to be freed with free()
+  @brief    Block that iniparser_load builds keys and values in
 
-  This is a replacement for strdup(). This implementation is provided
-  for systems that do not have it.
+  Records are appended as a tag byte, the key and, for values, the value,
+  each NUL terminated. Positions are kept as offsets while it grows; the
+  block is handed to the dictionary as its arena once the file is parsed.
  */
 /*--------------------------------------------------------------------------*/
-static char * xstrdup(const char * s)
-{
-    char * t ;
-    size_t len ;
-    if (!s)
-        return NULL ;
+typedef struct _ini_arena_ {
+    char   * buf ;  /** Records parsed so far */
+    size_t   len ;  /** Bytes used in buf */
+    size_t   cap ;  /** Bytes allocated for buf */
+} ini_arena ;
 
-    len = strlen(s) + 1 ;
-    t = (char*) malloc(len) ;
-    if (t) {
-        memcpy(t, s, len) ;
-    }
-    return t ;
-}
+/** Arena record tag for a section name */
+#define INI_REC_SECTION     's'
+
+/** Arena record tag for a section:key and its value */
+#define INI_REC_VALUE       'v'
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Remove blanks at the beginning and the end of a string.
-  @param    s  String to parse and alter.
-  @return   unsigned New size of the string.
+  @brief    Make room in the arena
+  @param    a   Arena to grow
+  @param    n   Number of bytes about to be appended
+  @return   0 if Ok, -1 if the allocation failed
  */
 /*--------------------------------------------------------------------------*/
-static unsigned strstrip(char * s)
+static int arena_reserve(ini_arena * a, size_t n)
 {
-    char *last = NULL ;
-    char *dest = s;
+    char   * buf ;
+    size_t   cap ;
+
+    if (a->len + n <= a->cap)
+        return 0 ;
+    cap = a->cap ? a->cap : ASCIILINESZ ;
+    while (cap < a->len + n)
+        cap *= 2 ;
+    buf = (char*) realloc(a->buf, cap) ;
+    if (buf == NULL)
+        return -1 ;
+    a->buf = buf ;
+    a->cap = cap ;
+    return 0 ;
+}
 
-    if (s==NULL) return 0;
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Append a string to the arena, lowercasing it if asked to
+  @param    d       Dictionary being loaded, for its case sensitivity
+  @param    a       Arena with room reserved for len bytes
+  @param    s       Characters to append
+  @param    len     Number of characters to append
+  @param    lower   Non-zero for keys and section names
+
+  This does not terminate the string.
+ */
+/*--------------------------------------------------------------------------*/
+static void arena_append(const dictionary * d, ini_arena * a, const char * s, size_t len, int lower)
+{
+    char   * out = a->buf + a->len ;
+    size_t   i ;
 
-    last = s + strlen(s);
-    while (isspace((int)*s) && *s) s++;
-    while (last > s) {
-        if (!isspace((int)*(last-1)))
-            break ;
-        last -- ;
+    if (lower && !d->caseSensitive) {
+        for (i=0 ; i<len ; i++)
+            out[i] = (char)tolower((int)s[i]);
+    } else {
+        memcpy(out, s, len);
     }
-    *last = (char)0;
+    a->len += len ;
+}
 
-    memmove(dest,s,last - s + 1);
-    return (unsigned)(last - s);
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Skip blanks at the start of a character range
+  @param    s   Start of the range
+  @param    e   End of the range
+  @return   First non-blank character, or e
+ */
+/*--------------------------------------------------------------------------*/
+static const char * skipspace(const char * s, const char * e)
+{
+    while (s < e && isspace((int)*s))
+        s++ ;
+    return s ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Drop blanks at the end of a character range
+  @param    s   Start of the range
+  @param    e   End of the range
+  @return   New end of the range
+ */
+/*--------------------------------------------------------------------------*/
+static const char * trimspace(const char * s, const char * e)
+{
+    while (e > s && isspace((int)e[-1]))
+        e-- ;
+    return e ;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -167,19 +221,8 @@ void iniparser_set_error_callback(int (*errback)(const char *, ...))
 /*--------------------------------------------------------------------------*/
 int iniparser_getnsec(const dictionary * d)
 {
-    int i ;
-    int nsec ;
-
     if (d==NULL) return -1 ;
-    nsec=0 ;
-    for (i=0 ; i<d->size ; i++) {
-        if (d->key[i]==NULL)
-            continue ;
-        if (strchr(d->key[i], ':')==NULL) {
-            nsec ++ ;
-        }
-    }
-    return nsec ;
+    return (int)d->nsec ;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -198,24 +241,8 @@ int iniparser_getnsec(const dictionary * d)
 /*--------------------------------------------------------------------------*/
 const char * iniparser_getsecname(const dictionary * d, int n)
 {
-    int i ;
-    int foundsec ;
-
-    if (d==NULL || n<0) return NULL ;
-    foundsec=0 ;
-    for (i=0 ; i<d->size ; i++) {
-        if (d->key[i]==NULL)
-            continue ;
-        if (strchr(d->key[i], ':')==NULL) {
-            foundsec++ ;
-            if (foundsec>n)
-                break ;
-        }
-    }
-    if (foundsec<=n) {
-        return NULL ;
-    }
-    return d->key[i] ;
+    if (d==NULL || n<0 || n>=d->nsec) return NULL ;
+    return d->key[d->sections[n]] ;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -255,6 +282,10 @@ void iniparser_dump(const dictionary * d, FILE * f)
 
   This function dumps a given dictionary into a loadable ini file.
   It is Ok to specify @c stderr or @c stdout as output files.
+
+  Sections are written in file order through the section index, each
+  walking only its own keys. VISCA_ini_write_file in liblibvisca-all.a
+  saves PacketSender files through here too.
  */
 /*--------------------------------------------------------------------------*/
 void iniparser_dump_ini(const dictionary * d, FILE * f)
@@ -296,30 +327,77 @@ void iniparser_dump_ini(const dictionary * d, FILE * f)
 /*--------------------------------------------------------------------------*/
 void iniparser_dumpsection_ini(const dictionary * d, const char * s, FILE * f)
 {
-    int     j ;
-    char    keym[ASCIILINESZ+1];
+    ssize_t sec, j ;
     int     seclen ;
 
     if (d==NULL || f==NULL) return ;
-    if (! iniparser_find_entry(d, s)) return ;
+    if ((sec = dictionary_secfind(d, s)) < 0) return ;
 
     seclen  = (int)strlen(s);
     fprintf(f, "\n[%s]\n", s);
-    sprintf(keym, "%s:", s);
-    for (j=0 ; j<d->size ; j++) {
-        if (d->key[j]==NULL)
-            continue ;
-        if (!strncmp(d->key[j], keym, seclen+1)) {
-            fprintf(f,
-                    "%-30s = %s\n",
-                    d->key[j]+seclen+1,
-                    d->val[j] ? d->val[j] : "");
-        }
+    for (j=d->link[sec].next ; j!=sec ; j=d->link[j].next) {
+        fprintf(f,
+                "%-30s = %s\n",
+                d->key[j]+seclen+1,
+                d->val[j] ? d->val[j] : "");
     }
     fprintf(f, "\n");
     return ;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Atomically replace an ini file with the contents of a dictionary
+  @param    d       Dictionary to save
+  @param    path    Name of the ini file to write
+  @return   Number of bytes written, or -1 in case of error
+ */
+/*--------------------------------------------------------------------------*/
+long iniparser_store(const dictionary * d, const char * path)
+{
+    char        * tmp ;
+    size_t        len ;
+    int           fd ;
+    FILE        * f ;
+    struct stat   st ;
+    long          written ;
+
+    if (d==NULL || path==NULL) return -1 ;
+
+    len = strlen(path) + sizeof(".XXXXXX") ;
+    tmp = (char*) malloc(len) ;
+    if (tmp==NULL) return -1 ;
+    snprintf(tmp, len, "%s.XXXXXX", path);
+    if ((fd=mkstemp(tmp))<0) {
+        iniparser_error_callback("iniparser: cannot create %s\n", tmp);
+        free(tmp);
+        return -1 ;
+    }
+    /* mkstemp makes the file private; keep whatever the original had */
+    fchmod(fd, stat(path, &st)==0 ? (st.st_mode & 07777) : 0644);
+    if ((f=fdopen(fd, "w"))==NULL) {
+        close(fd);
+        unlink(tmp);
+        free(tmp);
+        return -1 ;
+    }
+    iniparser_dump_ini(d, f);
+    written = ftell(f);
+    if (fflush(f)!=0 || fsync(fd)!=0 || ferror(f)) {
+        written = -1 ;
+    }
+    if (fclose(f)!=0) {
+        written = -1 ;
+    }
+    if (written<0 || rename(tmp, path)!=0) {
+        iniparser_error_callback("iniparser: cannot write %s\n", path);
+        unlink(tmp);
+        written = -1 ;
+    }
+    free(tmp);
+    return written ;
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the number of keys in a section of a dictionary.
@@ -330,25 +408,17 @@ void iniparser_dumpsection_ini(const dictionary * d, const char * s, FILE * f)
 /*--------------------------------------------------------------------------*/
 int iniparser_getsecnkeys(const dictionary * d, const char * s)
 {
-    int     seclen, nkeys ;
     char    keym[ASCIILINESZ+1];
-    int j ;
+    ssize_t sec, j ;
+    int     nkeys ;
 
     nkeys = 0;
 
-    if (d==NULL) return nkeys;
-    if (! iniparser_find_entry(d, s)) return nkeys;
+    if (d==NULL || s==NULL) return nkeys;
+    if ((sec = dictionary_secfind(d, strlwc(d, s, keym, sizeof(keym)))) < 0) return nkeys;
 
-    seclen  = (int)strlen(s);
-    strlwc(d, s, keym, sizeof(keym));
-    keym[seclen] = ':';
-
-    for (j=0 ; j<d->size ; j++) {
-        if (d->key[j]==NULL)
-            continue ;
-        if (!strncmp(d->key[j], keym, seclen+1))
-            nkeys++;
-    }
+    for (j=d->link[sec].next ; j!=sec ; j=d->link[j].next)
+        nkeys++;
 
     return nkeys;
 
@@ -372,25 +442,18 @@ int iniparser_getsecnkeys(const dictionary * d, const char * s)
 /*--------------------------------------------------------------------------*/
 const char ** iniparser_getseckeys(const dictionary * d, const char * s, const char ** keys)
 {
-    int i, j, seclen ;
-    char keym[ASCIILINESZ+1];
-
-    if (d==NULL || keys==NULL) return NULL;
-    if (! iniparser_find_entry(d, s)) return NULL;
+    char    keym[ASCIILINESZ+1];
+    ssize_t sec, j ;
+    int     i ;
 
-    seclen  = (int)strlen(s);
-    strlwc(d, s, keym, sizeof(keym));
-    keym[seclen] = ':';
+    if (d==NULL || s==NULL || keys==NULL) return NULL;
+    if ((sec = dictionary_secfind(d, strlwc(d, s, keym, sizeof(keym)))) < 0) return NULL;
 
     i = 0;
 
-    for (j=0 ; j<d->size ; j++) {
-        if (d->key[j]==NULL)
-            continue ;
-        if (!strncmp(d->key[j], keym, seclen+1)) {
-            keys[i] = d->key[j];
-            i++;
-        }
+    for (j=d->link[sec].next ; j!=sec ; j=d->link[j].next) {
+        keys[i] = d->key[j];
+        i++;
     }
 
     return keys;
@@ -622,80 +685,95 @@ void iniparser_unset(dictionary * ini, const char * entry)
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Load a single line from an INI file
-  @param    input_line  Input line, may be concatenated multi-line input
-  @param    section     Output space to store section
-  @param    key         Output space to store key
-  @param    value       Output space to store value
-  @return   line_status value
+  @brief    Parse a single line from an INI file into the arena
+  @param    d       Dictionary being loaded
+  @param    a       Arena to append the section or key/value record to
+  @param    s       Start of the line, may be concatenated multi-line input
+  @param    e       End of the line
+  @param    secoff  In/out: arena offset of the current section name
+  @param    seclen  In/out: length of the current section name
+  @return   line_status value, LINE_UNPROCESSED if the arena could not grow
+
+  The line is read in place. Only the section name, the "section:key" key
+  and the value are written out, lowercasing keys on the way.
  */
 /*--------------------------------------------------------------------------*/
 static line_status iniparser_line(
     dictionary * d,
-    const char * input_line,
-    char * section,
-    char * key,
-    char * value)
+    ini_arena * a,
+    const char * s,
+    const char * e,
+    size_t * secoff,
+    size_t * seclen)
 {
-    line_status sta ;
-    char * line = NULL;
-    size_t      len ;
-
-    line = xstrdup(input_line);
-    len = strstrip(line);
-
-    sta = LINE_UNPROCESSED ;
-    if (len<1) {
+    const char * q ;
+    const char * ke ;
+    const char * v ;
+    const char * ve ;
+
+    s = skipspace(s, e);
+    e = trimspace(s, e);
+    if (s == e) {
         /* Empty line */
-        sta = LINE_EMPTY ;
-    } else if (line[0]=='#' || line[0]==';') {
+        return LINE_EMPTY ;
+    }
+    if (*s=='#' || *s==';') {
         /* Comment line */
-        sta = LINE_COMMENT ;
-    } else if (line[0]=='[' && line[len-1]==']') {
-        /* Section name */
-        sscanf(line, "[%[^]]", section);
-        strstrip(section);
-        strlwc(d, section, section, len);
-        sta = LINE_SECTION ;
-    } else if (sscanf (line, "%[^=] = \"%[^\"]\"", key, value) == 2
-           ||  sscanf (line, "%[^=] = '%[^\']'",   key, value) == 2) {
-        /* Usual key=value with quotes, with or without comments */
-        strstrip(key);
-        strlwc(d, key, key, len);
-        /* Don't strip spaces from values surrounded with quotes */
-        sta = LINE_VALUE ;
-    } else if (sscanf (line, "%[^=] = %[^;#]", key, value) == 2) {
-        /* Usual key=value without quotes, with or without comments */
-        strstrip(key);
-        strlwc(d, key, key, len);
-        strstrip(value);
-        /*
-         * sscanf cannot handle '' or "" as empty values
-         * this is done here
-         */
-        if (!strcmp(value, "\"\"") || (!strcmp(value, "''"))) {
-            value[0]=0 ;
+        return LINE_COMMENT ;
+    }
+    if (*s=='[' && e[-1]==']') {
+        /* Section name, up to the first ']' */
+        q = (const char *) memchr(s+1, ']', (size_t)(e - (s+1)));
+        if (q == s+1) {
+            /* "[]": the current section carries on */
+            return LINE_SECTION ;
         }
-        sta = LINE_VALUE ;
-    } else if (sscanf(line, "%[^=] = %[;#]", key, value)==2
-           ||  sscanf(line, "%[^=] %[=]", key, value) == 2) {
-        /*
-         * Special cases:
-         * key=
-         * key=;
-         * key=#
-         */
-        strstrip(key);
-        strlwc(d, key, key, len);
-        value[0]=0 ;
-        sta = LINE_VALUE ;
-    } else {
+        v  = skipspace(s+1, q);
+        ve = trimspace(v, q);
+        if (arena_reserve(a, (size_t)(ve - v) + 2) != 0)
+            return LINE_UNPROCESSED ;
+        a->buf[a->len++] = INI_REC_SECTION ;
+        *secoff = a->len ;
+        *seclen = (size_t)(ve - v) ;
+        arena_append(d, a, v, *seclen, 1);
+        a->buf[a->len++] = '\0' ;
+        return LINE_SECTION ;
+    }
+    q = (const char *) memchr(s, '=', (size_t)(e - s));
+    if (q == NULL || q == s) {
         /* Generate syntax error */
-        sta = LINE_ERROR ;
+        return LINE_ERROR ;
     }
-
-    free(line);
-    return sta ;
+    ke = trimspace(s, q);
+    v  = skipspace(q+1, e);
+    ve = v ;
+    if (v+1 < e && (*v=='"' || *v=='\'') && v[1]!=*v) {
+        /* Quoted value: keep spaces and comment characters, stop at the
+           closing quote if there is one */
+        q  = (const char *) memchr(v+1, *v, (size_t)(e - (v+1)));
+        ve = q ? q : e ;
+        v++ ;
+    } else if (v < e && *v!=';' && *v!='#') {
+        /* Unquoted value, with or without comments */
+        while (ve < e && *ve!=';' && *ve!='#')
+            ve++ ;
+        ve = trimspace(v, ve);
+        /* '' or "" are empty values */
+        if (ve - v == 2 && (!memcmp(v, "\"\"", 2) || !memcmp(v, "''", 2)))
+            ve = v ;
+    }
+    /* Anything else is key=, key=; or key=#, which are empty values */
+    if (arena_reserve(a, *seclen + (size_t)(ke - s) + (size_t)(ve - v) + 4) != 0)
+        return LINE_UNPROCESSED ;
+    a->buf[a->len++] = INI_REC_VALUE ;
+    memcpy(a->buf + a->len, a->buf + *secoff, *seclen);
+    a->len += *seclen ;
+    a->buf[a->len++] = ':' ;
+    arena_append(d, a, s, (size_t)(ke - s), 1);
+    a->buf[a->len++] = '\0' ;
+    arena_append(d, a, v, (size_t)(ve - v), 0);
+    a->buf[a->len++] = '\0' ;
+    return LINE_VALUE ;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -709,114 +787,148 @@ static line_status iniparser_line(
   should not be accessed directly, but through accessor functions
   instead.
 
+  The file is memory-mapped and tokenized in place. Every key and value
+  goes into one arena block owned by the dictionary, so loading makes a
+  handful of allocations however large the file is.
+
   The returned dictionary must be freed using iniparser_freedict().
  */
 /*--------------------------------------------------------------------------*/
 dictionary * iniparser_load(const char * ininame)
 {
-    FILE * in ;
-
-    char line    [ASCIILINESZ+1] ;
-    char section [ASCIILINESZ+1] ;
-    char key     [ASCIILINESZ+1] ;
-    char tmp     [(ASCIILINESZ * 2) + 2] ;
-    char val     [ASCIILINESZ+1] ;
-
-    int  last=0 ;
-    int  len ;
-    int  lineno=0 ;
-    int  errs=0;
-    int  mem_err=0;
+    int          fd ;
+    struct stat  st ;
+    const char * map = NULL ;
+    const char * end ;
+    const char * p ;
+    const char * nl ;
+    const char * le ;
+    ini_arena    a = { NULL, 0, 0 } ;
+    ini_arena    join = { NULL, 0, 0 } ;
+    size_t       secoff = 0 ;
+    size_t       seclen = 0 ;
+    size_t       size ;
+    int          lineno=0 ;
+    int          errs=0;
+    int          mem_err=0;
+    const char * key ;
+    const char * val ;
+    char         tag ;
 
     dictionary * dict ;
 
-    if ((in=fopen(ininame, "r"))==NULL) {
+    if ((fd=open(ininame, O_RDONLY))<0 || fstat(fd, &st)!=0) {
         iniparser_error_callback("iniparser: cannot open %s\n", ininame);
+        if (fd>=0)
+            close(fd);
         return NULL ;
     }
+    size = (size_t)st.st_size ;
+    if (size>0) {
+        map = (const char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map==MAP_FAILED) {
+            iniparser_error_callback("iniparser: cannot open %s\n", ininame);
+            close(fd);
+            return NULL ;
+        }
+    }
+    close(fd);
 
     dict = dictionary_new(0) ;
     if (!dict) {
-        fclose(in);
+        if (map!=NULL)
+            munmap((void *)map, size);
         return NULL ;
     }
 
-    memset(line,    0, ASCIILINESZ);
-    memset(section, 0, ASCIILINESZ);
-    memset(key,     0, ASCIILINESZ);
-    memset(val,     0, ASCIILINESZ);
-    last=0 ;
+    /* Keys gain a "section:" prefix, values lose their "key=", so the file
+       size plus a little is usually enough */
+    mem_err = arena_reserve(&a, size + size / 4 + 1);
 
-    while (fgets(line+last, ASCIILINESZ-last, in)!=NULL) {
+    for (p = map, end = map + size ; p < end && !mem_err ; p = nl < end ? nl + 1 : end) {
+        nl = (const char *) memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL)
+            nl = end ;
         lineno++ ;
-        len = (int)strlen(line)-1;
-        if (len<=0)
-            continue;
-        /* Safety check against buffer overflows */
-        if (line[len]!='\n' && !feof(in)) {
-            iniparser_error_callback(
-              "iniparser: input line too long in %s (%d)\n",
-              ininame,
-              lineno);
-            dictionary_del(dict);
-            fclose(in);
-            return NULL ;
-        }
         /* Get rid of \n and spaces at end of line */
-        while ((len>=0) &&
-                ((line[len]=='\n') || (isspace(line[len])))) {
-            line[len]=0 ;
-            len-- ;
-        }
-        if (len < 0) { /* Line was entirely \n and/or spaces */
-            len = 0;
-        }
+        le = trimspace(p, nl);
         /* Detect multi-line */
-        if (line[len]=='\\') {
-            /* Multi-line value */
-            last=len ;
+        if (le > p && le[-1]=='\\') {
+            /* Multi-line value: join it with the next line, minus the '\' */
+            if (arena_reserve(&join, (size_t)(le - 1 - p)) != 0) {
+                mem_err = -1 ;
+                break ;
+            }
+            memcpy(join.buf + join.len, p, (size_t)(le - 1 - p));
+            join.len += (size_t)(le - 1 - p) ;
             continue ;
-        } else {
-            last=0 ;
         }
-        switch (iniparser_line(dict, line, section, key, val)) {
+        if (join.len > 0) {
+            if (arena_reserve(&join, (size_t)(le - p)) != 0) {
+                mem_err = -1 ;
+                break ;
+            }
+            memcpy(join.buf + join.len, p, (size_t)(le - p));
+            join.len += (size_t)(le - p) ;
+            p  = join.buf ;
+            le = join.buf + join.len ;
+            join.len = 0 ;
+        }
+        switch (iniparser_line(dict, &a, p, le, &secoff, &seclen)) {
             case LINE_EMPTY:
             case LINE_COMMENT:
             break ;
 
             case LINE_SECTION:
-            mem_err = dictionary_set(dict, section, NULL);
-            break ;
-
             case LINE_VALUE:
-            sprintf(tmp, "%s:%s", section, key);
-            mem_err = dictionary_set(dict, tmp, val);
             break ;
 
             case LINE_ERROR:
             iniparser_error_callback(
-              "iniparser: syntax error in %s (%d):\n-> %s\n",
+              "iniparser: syntax error in %s (%d):\n-> %.*s\n",
               ininame,
               lineno,
-              line);
+              (int)(le - p) < ASCIILINESZ ? (int)(le - p) : ASCIILINESZ,
+              p);
             errs++ ;
             break;
 
             default:
+            mem_err = -1 ;
             break ;
         }
-        memset(line, 0, ASCIILINESZ);
-        last=0;
-        if (mem_err<0) {
-            iniparser_error_callback("iniparser: memory allocation failure\n");
-            break ;
-        }
+    }
+    if (map!=NULL)
+        munmap((void *)map, size);
+    free(join.buf);
+    if (mem_err<0) {
+        iniparser_error_callback("iniparser: memory allocation failure\n");
     }
     if (errs) {
+        free(a.buf);
         dictionary_del(dict);
-        dict = NULL ;
+        return NULL ;
+    }
+
+    /* The arena is complete, so its records can be pointed at directly */
+    if (a.len > 0 && (p = (const char *) realloc(a.buf, a.len)) != NULL)
+        a.buf = (char *) p ;
+    dict->arena = a.buf ;
+    dict->arenasize = a.len ;
+    for (p = a.buf, end = a.buf + a.len ; p < end ; ) {
+        tag = *p++ ;
+        key = p ;
+        p  += strlen(p) + 1 ;
+        val = NULL ;
+        if (tag == INI_REC_VALUE) {
+            val = p ;
+            p  += strlen(p) + 1 ;
+        }
+        if (dictionary_set_arena(dict, key, val) < 0) {
+            iniparser_error_callback("iniparser: memory allocation failure\n");
+            break ;
+        }
     }
-    fclose(in);
     return dict ;
 }
 
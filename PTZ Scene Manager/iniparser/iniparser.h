@@ -91,6 +91,10 @@ const char * iniparser_getsecname(const dictionary * d, int n);
 
   This function dumps a given dictionary into a loadable ini file.
   It is Ok to specify @c stderr or @c stdout as output files.
+
+  Sections are written in file order through the section index, each
+  walking only its own keys. VISCA_ini_write_file in liblibvisca-all.a
+  saves PacketSender files through here too.
  */
 /*--------------------------------------------------------------------------*/
 
@@ -110,6 +114,21 @@ void iniparser_dump_ini(const dictionary * d, FILE * f);
 
 void iniparser_dumpsection_ini(const dictionary * d, const char * s, FILE * f);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Atomically replace an ini file with the contents of a dictionary
+  @param    d       Dictionary to save
+  @param    path    Name of the ini file to write
+  @return   Number of bytes written, or -1 in case of error
+
+  The dictionary is dumped with iniparser_dump_ini into a temporary file
+  in the same directory, which is then renamed over path. Readers see
+  either the old file or the new one, never a partial write. An existing
+  file keeps its permissions.
+ */
+/*--------------------------------------------------------------------------*/
+long iniparser_store(const dictionary * d, const char * path);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Dump a dictionary to an opened file pointer.
@@ -0,0 +1,350 @@
+//
+//  obsbase64.cpp
+//  PTZ Scene Manager
+//
+
+#include "obsbase64.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OBSBASE64_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define OBSBASE64_NEON 1
+#endif
+
+namespace obsbase64 {
+
+namespace {
+
+const uint8_t Invalid = 0xFF;
+
+struct DecodeTable {
+    uint8_t value[256];
+
+    constexpr DecodeTable() : value() {
+        for (int i = 0; i < 256; i++) {
+            value[i] = Invalid;
+        }
+        for (int i = 0; i < 26; i++) {
+            value['A' + i] = (uint8_t)i;
+            value['a' + i] = (uint8_t)(26 + i);
+        }
+        for (int i = 0; i < 10; i++) {
+            value['0' + i] = (uint8_t)(52 + i);
+        }
+        value['+'] = 62;
+        value['/'] = 63;
+    }
+};
+
+constexpr DecodeTable table;
+
+// Whole quads while they're all in the alphabet; the scalar counterpart of the vector loops.
+size_t decodeQuads(const uint8_t *&src, const uint8_t *end, uint8_t *dst)
+{
+    uint8_t *out = dst;
+    while (end - src >= 4) {
+        uint32_t a = table.value[src[0]], b = table.value[src[1]], c = table.value[src[2]], d = table.value[src[3]];
+        if ((a | b | c | d) & 0x80) {
+            break;
+        }
+        uint32_t bits = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = (uint8_t)(bits >> 16);
+        out[1] = (uint8_t)(bits >> 8);
+        out[2] = (uint8_t)bits;
+        out += 3;
+        src += 4;
+    }
+    return out - dst;
+}
+
+#if OBSBASE64_X86
+
+// Wojciech Muła's pshufb decoder: classify each character by its nibbles to validate it,
+// add a per-range offset to get its 6-bit value, then pack four 6-bit values into three
+// bytes with two multiply-adds and a shuffle.
+
+__attribute__((target("ssse3")))
+size_t decodeSSSE3(const uint8_t *&src, const uint8_t *end, uint8_t *dst)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2F);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    uint8_t *out = dst;
+    while (end - src >= 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)src);
+        __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask2F);
+        __m128i loNibbles = _mm_and_si128(in, mask2F);
+        __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        // _mm_testz_si128 would be SSE4.1.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+        __m128i eq2F = _mm_cmpeq_epi8(in, mask2F);
+        __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+        __m128i values = _mm_add_epi8(in, roll);
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(merged, pack));
+        out += 12;
+        src += 16;
+    }
+    return out - dst;
+}
+
+__attribute__((target("avx2")))
+size_t decodeAVX2(const uint8_t *&src, const uint8_t *end, uint8_t *dst)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask2F = _mm256_set1_epi8(0x2F);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    // Each lane packs to 12 bytes; close the gap between them.
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+    uint8_t *out = dst;
+    while (end - src >= 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask2F);
+        __m256i loNibbles = _mm256_and_si256(in, mask2F);
+        __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+        __m256i eq2F = _mm256_cmpeq_epi8(in, mask2F);
+        __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+        __m256i values = _mm256_add_epi8(in, roll);
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        _mm256_storeu_si256((__m256i *)out, _mm256_permutevar8x32_epi32(merged, lanes));
+        out += 24;
+        src += 32;
+    }
+    return out - dst;
+}
+
+#endif // OBSBASE64_X86
+
+#if OBSBASE64_NEON
+
+// 64 characters at a time: de-interleave into the first, second, third and fourth
+// character of each quad, look all four up in a 128-entry table, and interleave the
+// repacked bytes back out.
+size_t decodeNEON(const uint8_t *&src, const uint8_t *end, uint8_t *dst)
+{
+    uint8x16x4_t tableLo, tableHi;
+    for (int i = 0; i < 4; i++) {
+        tableLo.val[i] = vld1q_u8(table.value + 16 * i);
+        tableHi.val[i] = vld1q_u8(table.value + 64 + 16 * i);
+    }
+    const uint8x16_t offset = vdupq_n_u8(64);
+    uint8_t *out = dst;
+    while (end - src >= 64) {
+        uint8x16x4_t in = vld4q_u8(src);
+        uint8x16x4_t values;
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int i = 0; i < 4; i++) {
+            // vqtbl4q gives 0 for 64 and up, vqtbx4q leaves those under 64 alone, and
+            // anything 128 and up misses both tables, so flag it separately.
+            uint8x16_t v = vqtbl4q_u8(tableLo, in.val[i]);
+            v = vqtbx4q_u8(v, tableHi, vsubq_u8(in.val[i], offset));
+            values.val[i] = v;
+            invalid = vorrq_u8(invalid, vorrq_u8(v, vcgeq_u8(in.val[i], vdupq_n_u8(128))));
+        }
+        if (vmaxvq_u8(invalid) > 63) {
+            break;
+        }
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+        vst3q_u8(out, bytes);
+        out += 48;
+        src += 64;
+    }
+    return out - dst;
+}
+
+#endif // OBSBASE64_NEON
+
+typedef size_t (*VectorDecoder)(const uint8_t *&src, const uint8_t *end, uint8_t *dst);
+
+struct Implementation {
+    VectorDecoder decoder;
+    const char *name;
+};
+
+Implementation chooseImplementation()
+{
+#if OBSBASE64_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return { decodeAVX2, "avx2" };
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return { decodeSSSE3, "ssse3" };
+    }
+#elif OBSBASE64_NEON
+    return { decodeNEON, "neon" };
+#endif
+    return { decodeQuads, "scalar" };
+}
+
+const Implementation& best()
+{
+    static const Implementation implementation = chooseImplementation();
+    return implementation;
+}
+
+// fast takes as much as it can; whatever stopped it is stepped over one character at a
+// time, skipping anything outside the alphabet, and fast picks up again at the next quad
+// boundary after it.
+bool decodeWith(VectorDecoder fast, const uint8_t *in, const uint8_t *end, uint8_t *dst, size_t& decodedLength)
+{
+    uint8_t *out = dst;
+    uint32_t bits = 0;
+    int count = 0;
+    bool padded = false;
+    while (in < end && !padded) {
+        out += fast(in, end, out);
+        bool skipped = false;
+        for (; in < end; in++) {
+            if (*in == '=') {
+                padded = true;
+                break;
+            }
+            uint8_t v = table.value[*in];
+            if (v == Invalid) {
+                skipped = true;
+                continue;
+            }
+            bits = (bits << 6) | v;
+            if (++count == 4) {
+                out[0] = (uint8_t)(bits >> 16);
+                out[1] = (uint8_t)(bits >> 8);
+                out[2] = (uint8_t)bits;
+                out += 3;
+                bits = 0;
+                count = 0;
+                if (skipped) {
+                    in++;
+                    break;
+                }
+            }
+        }
+    }
+    if (count == 1) {
+        return false;
+    }
+    if (count == 2) {
+        *out++ = (uint8_t)(bits >> 4);
+    } else if (count == 3) {
+        *out++ = (uint8_t)(bits >> 10);
+        *out++ = (uint8_t)(bits >> 2);
+    }
+    decodedLength = out - dst;
+    return true;
+}
+
+} // namespace
+
+const char *dataURIPayload(const char *uri, size_t length, size_t& payloadLength)
+{
+    if (length >= 5 && memcmp(uri, "data:", 5) == 0) {
+        const char *comma = (const char *)memchr(uri, ',', length);
+        if (comma != nullptr) {
+            payloadLength = length - (comma + 1 - uri);
+            return comma + 1;
+        }
+    }
+    payloadLength = length;
+    return uri;
+}
+
+bool decode(const char *src, size_t length, uint8_t *dst, size_t& decodedLength)
+{
+    return decodeWith(best().decoder, (const uint8_t *)src, (const uint8_t *)src + length, dst, decodedLength);
+}
+
+bool decodeScalar(const char *src, size_t length, uint8_t *dst, size_t& decodedLength)
+{
+    return decodeWith(decodeQuads, (const uint8_t *)src, (const uint8_t *)src + length, dst, decodedLength);
+}
+
+const char *implementation()
+{
+    return best().name;
+}
+
+BufferPool::~BufferPool()
+{
+    for (const Buffer& buffer : buffers) {
+        free(buffer.data);
+    }
+}
+
+uint8_t *BufferPool::acquire(size_t size, size_t& capacity)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // The smallest one that fits, so a thumbnail doesn't take the full-size buffer.
+        size_t fit = buffers.size();
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i].capacity >= size && (fit == buffers.size() || buffers[i].capacity < buffers[fit].capacity)) {
+                fit = i;
+            }
+        }
+        if (fit < buffers.size()) {
+            Buffer buffer = buffers[fit];
+            buffers[fit] = buffers.back();
+            buffers.pop_back();
+            capacity = buffer.capacity;
+            return buffer.data;
+        }
+    }
+    // Round up so screenshots a few bytes apart share buffers.
+    capacity = (size + 0xFFFF) & ~(size_t)0xFFFF;
+    return (uint8_t *)malloc(capacity);
+}
+
+void BufferPool::release(uint8_t *buffer, size_t capacity)
+{
+    if (buffer == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (buffers.size() < maxBuffers) {
+            buffers.push_back({ buffer, capacity });
+            return;
+        }
+    }
+    free(buffer);
+}
+
+BufferPool& BufferPool::shared()
+{
+    // Never destroyed: NSData deallocators may still be returning buffers at exit.
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+} // namespace obsbase64
@@ -0,0 +1,72 @@
+//
+//  obsbase64.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef OBSBASE64_HPP
+#define OBSBASE64_HPP
+
+// Base64 decoding for GetSourceScreenshot's image data.
+//
+// decode runs 16 to 64 characters at a time with whatever the CPU has (AVX2 or SSSE3 on
+// Intel, NEON on Apple Silicon) and drops to the scalar decoder for the tail and for any
+// block that isn't plain base64, so a JSON-escaped slash or stray whitespace costs one
+// block, not the whole image. Characters outside the alphabet are skipped and '=' ends the
+// data, the same as NSDataBase64DecodingIgnoreUnknownCharacters.
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace obsbase64 {
+
+// The vector paths store whole registers, so decode may write this far past the decoded
+// length; decodeBufferSize includes it.
+constexpr size_t OutputSlack = 32;
+
+inline size_t decodeBufferSize(size_t length) {
+    return length / 4 * 3 + 3 + OutputSlack;
+}
+
+// The base64 part of a "data:image/jpg;base64,..." URI, without copying. Anything that
+// isn't a data URI is returned whole.
+const char *dataURIPayload(const char *uri, size_t length, size_t& payloadLength);
+
+// dst must hold decodeBufferSize(length) bytes. Returns false if the data ends partway
+// through a byte, which means it was truncated.
+bool decode(const char *src, size_t length, uint8_t *dst, size_t& decodedLength);
+
+// The same, one quad at a time; what decode does on a CPU without a vector path.
+bool decodeScalar(const char *src, size_t length, uint8_t *dst, size_t& decodedLength);
+
+// "avx2", "ssse3", "neon" or "scalar": what decode uses on this machine.
+const char *implementation();
+
+// Recycles decode buffers. Screenshots arrive at a steady rate and at a few sizes, so after
+// the first few every decode reuses a buffer the last image finished with instead of
+// allocating and faulting in a fresh 300 KB. Thread safe.
+class BufferPool {
+  public:
+    explicit BufferPool(size_t maxBuffers = 8) : maxBuffers(maxBuffers) {}
+    ~BufferPool();
+
+    // At least size bytes; capacity is what to hand back to release.
+    uint8_t *acquire(size_t size, size_t& capacity);
+    void release(uint8_t *buffer, size_t capacity);
+
+    static BufferPool& shared();
+
+  private:
+    struct Buffer {
+        uint8_t *data;
+        size_t capacity;
+    };
+    std::mutex mutex;
+    std::vector<Buffer> buffers;
+    size_t maxBuffers;
+};
+
+} // namespace obsbase64
+
+#endif /* OBSBASE64_HPP */
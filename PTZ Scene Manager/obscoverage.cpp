@@ -0,0 +1,394 @@
+//
+//  obscoverage.cpp
+//  PTZ Scene Manager
+//
+
+#include "obscoverage.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <vector>
+
+namespace obscoverage {
+
+namespace {
+
+// Room for N on the stack, and the heap only past that.
+template <class T, size_t N>
+class Scratch {
+  public:
+    T *get(size_t count) {
+        if (count <= N) {
+            return local;
+        }
+        heap.resize(count);
+        return heap.data();
+    }
+
+  private:
+    T local[N];
+    std::vector<T> heap;
+};
+
+// Stands for a box after all the others, for parts of the canvas nothing covers.
+const int32_t Uncovered = INT32_MAX;
+
+int64_t width(const Box& box) { return (int64_t)box.x2 - box.x1; }
+int64_t height(const Box& box) { return (int64_t)box.y2 - box.y1; }
+bool empty(const Box& box) { return box.x2 <= box.x1 || box.y2 <= box.y1; }
+
+Box clip(const Box& box, const Box& canvas)
+{
+    return { std::max(box.x1, canvas.x1), std::max(box.y1, canvas.y1), std::min(box.x2, canvas.x2), std::min(box.y2, canvas.y2) };
+}
+
+// A coordinate and a box side packed so that sorting them sorts by coordinate. The low bit
+// says which side: a box's right or bottom edge.
+uint64_t key(int32_t coordinate, size_t box, bool far)
+{
+    return (uint64_t)((uint32_t)coordinate ^ 0x80000000u) << 32 | (uint64_t)box << 1 | (far ? 1 : 0);
+}
+int32_t coordinateOf(uint64_t key) { return (int32_t)((uint32_t)(key >> 32) ^ 0x80000000u); }
+size_t boxOf(uint64_t key) { return (size_t)(key & 0xffffffffu) >> 1; }
+bool farOf(uint64_t key) { return key & 1; }
+
+// The boxes cut the canvas into bands across; each box's top and bottom become band numbers,
+// and the band heights go in heights. Returns how many bands there are.
+size_t bands(const Box *boxes, size_t count, const Box& canvas, uint64_t *keys, uint32_t *tops, uint32_t *bottoms, int64_t *heights)
+{
+    for (size_t i = 0; i < count; i++) {
+        keys[2 * i] = key(boxes[i].y1, i, false);
+        keys[2 * i + 1] = key(boxes[i].y2, i, true);
+    }
+    std::sort(keys, keys + 2 * count);
+    // The boxes are all inside the canvas, so its top and bottom are the first and last lines.
+    size_t band = 0;
+    int32_t line = canvas.y1;
+    for (size_t i = 0; i < 2 * count; i++) {
+        int32_t y = coordinateOf(keys[i]);
+        if (y != line) {
+            heights[band++] = (int64_t)y - line;
+            line = y;
+        }
+        (farOf(keys[i]) ? bottoms : tops)[boxOf(keys[i])] = (uint32_t)band;
+    }
+    if (line != canvas.y2) {
+        heights[band++] = (int64_t)canvas.y2 - line;
+    }
+    return band;
+}
+
+// Both sides of every box, in order across.
+void edges(const Box *boxes, size_t count, uint64_t *keys)
+{
+    for (size_t i = 0; i < count; i++) {
+        keys[2 * i] = key(boxes[i].x1, i, false);
+        keys[2 * i + 1] = key(boxes[i].x2, i, true);
+    }
+    std::sort(keys, keys + 2 * count);
+}
+
+size_t powerOfTwo(size_t n)
+{
+    size_t size = 1;
+    while (size < n) {
+        size *= 2;
+    }
+    return size;
+}
+
+// A segment tree over the bands, laid out as a heap with the leaves at size..2 * size - 1.
+// Node calls update for the nodes that make up a run of bands, then refresh for everything
+// above them, bottom up.
+template <class Node>
+void apply(Node& tree, size_t size, size_t top, size_t bottom, int32_t box)
+{
+    size_t first = top + size, last = bottom - 1 + size;
+    for (size_t lo = first, hi = last + 1; lo < hi; lo >>= 1, hi >>= 1) {
+        if (lo & 1) {
+            tree.update(lo++, box);
+        }
+        if (hi & 1) {
+            tree.update(--hi, box);
+        }
+    }
+    for (size_t node = first >> 1; node > 0; node >>= 1) {
+        tree.refresh(node);
+    }
+    for (size_t node = last >> 1; node > 0; node >>= 1) {
+        tree.refresh(node);
+    }
+}
+
+// How much of the column is covered. A node covered by some box as a whole only needs its
+// count, so nothing is ever pushed down to the children.
+class Column {
+  public:
+    Column(const int64_t *heights, size_t bands, size_t size, int32_t *counts, int64_t *spans, int64_t *covered)
+        : size(size), counts(counts), spans(spans), covered(covered) {
+        std::fill(counts, counts + 2 * size, 0);
+        std::fill(covered, covered + 2 * size, 0);
+        std::copy(heights, heights + bands, spans + size);
+        std::fill(spans + size + bands, spans + 2 * size, 0);
+        for (size_t node = size - 1; node > 0; node--) {
+            spans[node] = spans[2 * node] + spans[2 * node + 1];
+        }
+    }
+
+    void add(size_t top, size_t bottom, int32_t delta) { apply(*this, size, top, bottom, delta); }
+    int64_t coveredHeight() const { return covered[1]; }
+
+    void update(size_t node, int32_t delta) {
+        counts[node] += delta;
+        refresh(node);
+    }
+    void refresh(size_t node) {
+        if (counts[node] > 0) {
+            covered[node] = spans[node];
+        } else {
+            covered[node] = node >= size ? 0 : covered[2 * node] + covered[2 * node + 1];
+        }
+    }
+
+  private:
+    size_t size;
+    int32_t *counts;
+    int64_t *spans;
+    int64_t *covered;
+};
+
+// For each band, the first box covering it, and the last of those over the whole column.
+// Each node keeps a heap of the boxes covering it as a whole. A box that's gone stays in the
+// heaps until it gets to the top, which is fine since it can't come back.
+class Earliest {
+  public:
+    Earliest(size_t bands, size_t size, int32_t *starts, int32_t *sizes, int32_t *values, const uint8_t *gone)
+        : bands(bands), size(size), starts(starts), sizes(sizes), values(values), gone(gone) {
+        std::fill(sizes, sizes + 2 * size, 0);
+    }
+
+    // Every box has to be reserved before any are added, so the heaps can be laid out.
+    void reserve(size_t top, size_t bottom) { apply(*this, size, top, bottom, Reserve); }
+    size_t slotsNeeded() const {
+        size_t total = 0;
+        for (size_t node = 1; node < 2 * size; node++) {
+            total += (size_t)sizes[node];
+        }
+        return total;
+    }
+    void allocate(int32_t *storage) {
+        slots = storage;
+        int32_t start = 0;
+        for (size_t node = 1; node < 2 * size; node++) {
+            starts[node] = start;
+            start += sizes[node];
+            sizes[node] = 0;
+        }
+        // Padding past the last band is as good as covered from the start.
+        std::fill(values + size, values + size + bands, Uncovered);
+        std::fill(values + size + bands, values + 2 * size, -1);
+        for (size_t node = size - 1; node > 0; node--) {
+            refresh(node);
+        }
+    }
+
+    void add(size_t top, size_t bottom, int32_t box) { apply(*this, size, top, bottom, box); }
+    // After marking it gone.
+    void remove(size_t top, size_t bottom) { apply(*this, size, top, bottom, Remove); }
+    int32_t latest() const { return values[1]; }
+
+    void update(size_t node, int32_t box) {
+        if (box == Reserve) {
+            sizes[node]++;
+            return;
+        }
+        int32_t *heap = slots + starts[node];
+        if (box != Remove) {
+            heap[sizes[node]++] = box;
+            std::push_heap(heap, heap + sizes[node], std::greater<int32_t>());
+        }
+        while (sizes[node] > 0 && gone[heap[0]]) {
+            std::pop_heap(heap, heap + sizes[node]--, std::greater<int32_t>());
+        }
+        refresh(node);
+    }
+    void refresh(size_t node) {
+        if (slots == nullptr) {
+            return;
+        }
+        int32_t below = node >= size ? Uncovered : std::max(values[2 * node], values[2 * node + 1]);
+        if (node >= size + bands) {
+            below = -1;
+        }
+        values[node] = sizes[node] > 0 ? std::min(slots[starts[node]], below) : below;
+    }
+
+  private:
+    static const int32_t Reserve = -1, Remove = -2;
+
+    size_t bands, size;
+    int32_t *starts;
+    int32_t *sizes;
+    int32_t *values;
+    int32_t *slots = nullptr;
+    const uint8_t *gone;
+};
+
+// Inline room for the trees, which have a leaf for each band rounded up to a power of two.
+const size_t InlineBands = 2 * InlineBoxes + 1;
+const size_t InlineNodes = 4 * InlineBoxes * 2;
+
+// For boxes already clipped to canvas with the empty ones dropped.
+bool sweep(const Box *boxes, size_t count, const Box& canvas)
+{
+    Scratch<uint64_t, 2 * InlineBoxes> keyStore;
+    Scratch<uint32_t, InlineBoxes> topStore, bottomStore;
+    Scratch<int64_t, InlineBands> heightStore;
+    uint64_t *keys = keyStore.get(2 * count);
+    uint32_t *tops = topStore.get(count), *bottoms = bottomStore.get(count);
+    int64_t *heights = heightStore.get(2 * count + 1);
+    size_t bandCount = bands(boxes, count, canvas, keys, tops, bottoms, heights);
+    size_t size = powerOfTwo(bandCount);
+
+    Scratch<int32_t, InlineNodes> countStore;
+    Scratch<int64_t, InlineNodes> spanStore, coveredStore;
+    Column column(heights, bandCount, size, countStore.get(2 * size), spanStore.get(2 * size), coveredStore.get(2 * size));
+
+    edges(boxes, count, keys);
+    const int64_t canvasHeight = height(canvas);
+    int32_t x = canvas.x1;
+    for (size_t i = 0; i < 2 * count;) {
+        int32_t at = coordinateOf(keys[i]);
+        // Everything from x up to here looks like the column after the last batch of edges.
+        if (at > x && column.coveredHeight() != canvasHeight) {
+            return false;
+        }
+        for (; i < 2 * count && coordinateOf(keys[i]) == at; i++) {
+            size_t box = boxOf(keys[i]);
+            column.add(tops[box], bottoms[box], farOf(keys[i]) ? -1 : 1);
+        }
+        x = at;
+    }
+    // The last edges leave the column empty, so whatever's right of them is uncovered.
+    return x == canvas.x2;
+}
+
+// The same sweep, but finding the first box by which every part of the canvas is covered.
+// Uncovered if some part never is.
+int32_t sweepFirst(const Box *boxes, size_t count, const Box& canvas)
+{
+    Scratch<uint64_t, 2 * InlineBoxes> keyStore;
+    Scratch<uint32_t, InlineBoxes> topStore, bottomStore;
+    Scratch<int64_t, InlineBands> heightStore;
+    uint64_t *keys = keyStore.get(2 * count);
+    uint32_t *tops = topStore.get(count), *bottoms = bottomStore.get(count);
+    int64_t *heights = heightStore.get(2 * count + 1);
+    size_t bandCount = bands(boxes, count, canvas, keys, tops, bottoms, heights);
+    size_t size = powerOfTwo(bandCount);
+
+    Scratch<int32_t, InlineNodes> startStore, sizeStore, valueStore;
+    Scratch<uint8_t, InlineBoxes> goneStore;
+    uint8_t *gone = goneStore.get(count);
+    std::fill(gone, gone + count, 0);
+    Earliest earliest(bandCount, size, startStore.get(2 * size), sizeStore.get(2 * size), valueStore.get(2 * size), gone);
+    for (size_t i = 0; i < count; i++) {
+        earliest.reserve(tops[i], bottoms[i]);
+    }
+    // No box is split over more than two nodes a level.
+    Scratch<int32_t, 16 * InlineBoxes> slotStore;
+    earliest.allocate(slotStore.get(earliest.slotsNeeded()));
+
+    edges(boxes, count, keys);
+    int32_t x = canvas.x1, last = -1;
+    for (size_t i = 0; i < 2 * count;) {
+        int32_t at = coordinateOf(keys[i]);
+        if (at > x) {
+            last = std::max(last, earliest.latest());
+            if (last == Uncovered) {
+                return Uncovered;
+            }
+        }
+        for (; i < 2 * count && coordinateOf(keys[i]) == at; i++) {
+            size_t box = boxOf(keys[i]);
+            if (farOf(keys[i])) {
+                gone[box] = 1;
+                earliest.remove(tops[box], bottoms[box]);
+            } else {
+                earliest.add(tops[box], bottoms[box], (int32_t)box);
+            }
+        }
+        x = at;
+    }
+    return x == canvas.x2 ? last : Uncovered;
+}
+
+} // namespace
+
+bool covers(const Box *boxes, size_t count, const Box& canvas)
+{
+    if (empty(canvas)) {
+        return true;
+    }
+    Scratch<Box, InlineBoxes> clippedStore;
+    Box *clipped = clippedStore.get(count);
+    // Areas are in uint64_t since the canvas can be bigger than int64_t; the sum only gets
+    // as far as the canvas area, so it can't overflow either.
+    const uint64_t canvasArea = (uint64_t)width(canvas) * (uint64_t)height(canvas);
+    uint64_t area = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        Box box = clip(boxes[i], canvas);
+        if (empty(box)) {
+            continue;
+        }
+        uint64_t boxArea = (uint64_t)width(box) * (uint64_t)height(box);
+        if (boxArea == canvasArea) {
+            return true;
+        }
+        area = boxArea >= canvasArea - area ? canvasArea : area + boxArea;
+        clipped[kept++] = box;
+    }
+    if (area < canvasArea) {
+        return false;
+    }
+    return sweep(clipped, kept, canvas);
+}
+
+size_t coveringPrefix(const Box *boxes, size_t count, const Box& canvas)
+{
+    if (count == 0) {
+        return 0;
+    }
+    if (empty(canvas)) {
+        return 1;
+    }
+    Scratch<Box, InlineBoxes> clippedStore;
+    Scratch<int32_t, InlineBoxes> indexStore;
+    Box *clipped = clippedStore.get(count);
+    int32_t *indexes = indexStore.get(count);
+    const uint64_t canvasArea = (uint64_t)width(canvas) * (uint64_t)height(canvas);
+    uint64_t area = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        Box box = clip(boxes[i], canvas);
+        if (empty(box)) {
+            continue;
+        }
+        uint64_t boxArea = (uint64_t)width(box) * (uint64_t)height(box);
+        area = boxArea >= canvasArea - area ? canvasArea : area + boxArea;
+        clipped[kept] = box;
+        indexes[kept++] = (int32_t)i;
+        // Nothing after a box that covers the canvas by itself matters.
+        if (boxArea == canvasArea) {
+            break;
+        }
+    }
+    if (area < canvasArea) {
+        return 0;
+    }
+    int32_t first = sweepFirst(clipped, kept, canvas);
+    return first == Uncovered ? 0 : (size_t)indexes[first] + 1;
+}
+
+} // namespace obscoverage
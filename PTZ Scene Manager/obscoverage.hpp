@@ -0,0 +1,45 @@
+//
+//  obscoverage.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef OBSCOVERAGE_HPP
+#define OBSCOVERAGE_HPP
+
+// Does a set of rectangles cover the canvas? That's the only question the visibility walk asks
+// of a region, so this answers it directly instead of building one.
+//
+// It sweeps across the canvas left to right, keeping a segment tree over the bands the boxes
+// cut it into, and stops at the first column with a gap. Cheap tests go first: a box that
+// covers the canvas by itself, or boxes whose areas don't add up to the canvas's. Up to
+// InlineBoxes boxes it works entirely on the stack.
+//
+// The visibility walk really wants to know how many cameras it takes, so coveringPrefix keeps
+// the first box covering each band instead of a count, and gets that from the same one sweep.
+//
+// The answers are the same as unioning the boxes into a pixman region, subtracting that from
+// the canvas and checking for no rects left, including for empty boxes and an empty canvas.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace obscoverage {
+
+// Half-open, like pixman_box32_t: x1 <= x < x2, y1 <= y < y2. A box with x2 <= x1 or
+// y2 <= y1 is empty and covers nothing.
+struct Box {
+    int32_t x1, y1, x2, y2;
+};
+
+constexpr size_t InlineBoxes = 64;
+
+// Whether boxes between them cover all of canvas. An empty canvas is always covered.
+bool covers(const Box *boxes, size_t count, const Box& canvas);
+
+// The fewest leading boxes that cover canvas, or 0 if all count of them don't. An empty
+// canvas is covered by the first box. This is one sweep, not a covers for every prefix.
+size_t coveringPrefix(const Box *boxes, size_t count, const Box& canvas);
+
+} // namespace obscoverage
+
+#endif /* OBSCOVERAGE_HPP */
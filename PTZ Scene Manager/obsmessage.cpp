@@ -0,0 +1,849 @@
+//
+//  obsmessage.cpp
+//  PTZ Scene Manager
+//
+
+#include "obsmessage.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace obsmessage {
+
+namespace {
+
+// Deeper than any obs-websocket message; keeps hostile input from blowing the stack.
+const int MaxDepth = 64;
+
+// Batch results are shaped like the "d" of a RequestResponse, so they get its op.
+const int OpRequestResponse = 7;
+
+template <size_t N>
+bool keyIs(const char *key, size_t length, const char (&literal)[N])
+{
+    return length == N - 1 && memcmp(key, literal, N - 1) == 0;
+}
+
+void appendUTF8(std::string& out, uint32_t c)
+{
+    if (c < 0x80) {
+        out += (char)c;
+    } else if (c < 0x800) {
+        out += (char)(0xC0 | (c >> 6));
+        out += (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += (char)(0xE0 | (c >> 12));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    } else {
+        out += (char)(0xF0 | (c >> 18));
+        out += (char)(0x80 | ((c >> 12) & 0x3F));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+class JSONReader {
+  public:
+    JSONReader(const char *json, size_t length) : p(json), end(json + length) { }
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            p++;
+        }
+    }
+
+    bool atEnd() { skipSpace(); return p == end; }
+
+    bool peek(char c) { skipSpace(); return p < end && *p == c; }
+
+    bool atObject() { return peek('{'); }
+
+    bool consume(char c) {
+        skipSpace();
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    // The contents of a string, between the quotes, escapes and all.
+    bool rawString(const char *& start, size_t& length, bool& escaped) {
+        if (!consume('"')) {
+            return false;
+        }
+        start = p;
+        escaped = false;
+        // Screenshots are hundreds of KB of base64 with no escapes: find the closing quote with
+        // memchr, and only walk it a byte at a time if there's a backslash before it.
+        const char *quote = (const char *)memchr(p, '"', end - p);
+        if (quote == nullptr) {
+            return false;
+        }
+        const char *backslash = (const char *)memchr(p, '\\', quote - p);
+        if (backslash == nullptr) {
+            length = quote - p;
+            p = quote + 1;
+            return true;
+        }
+        escaped = true;
+        for (const char *s = backslash; s < end; s++) {
+            if (*s == '\\') {
+                s++;
+            } else if (*s == '"') {
+                length = s - p;
+                p = s + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool string(std::string& out) {
+        const char *s;
+        size_t length;
+        bool escaped;
+        if (!rawString(s, length, escaped)) {
+            return false;
+        }
+        if (!escaped) {
+            out.assign(s, length);
+            return true;
+        }
+        out.clear();
+        out.reserve(length);
+        const char *e = s + length;
+        while (s < e) {
+            if (*s != '\\') {
+                out += *s++;
+                continue;
+            }
+            if (++s == e) {
+                return false;
+            }
+            char c = *s++;
+            switch (c) {
+                case '"': case '\\': case '/': out += c; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code;
+                    if (!hex4(s, e, code)) {
+                        return false;
+                    }
+                    if (code >= 0xD800 && code < 0xDC00 && e - s >= 6 && s[0] == '\\' && s[1] == 'u') {
+                        const char *low = s + 2;
+                        uint32_t second;
+                        if (hex4(low, e, second) && second >= 0xDC00 && second < 0xE000) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (second - 0xDC00);
+                            s = low;
+                        }
+                    }
+                    appendUTF8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Exact for integers up to 19 digits, which covers sceneItemId; close enough for the geometry.
+    bool number(double& out, int64_t *integer = nullptr) {
+        skipSpace();
+        const char *start = p;
+        bool negative = false;
+        if (p < end && *p == '-') {
+            negative = true;
+            p++;
+        }
+        uint64_t mantissa = 0;
+        int digits = 0, scale = 0;
+        bool isInteger = true;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+            } else {
+                scale++;
+                isInteger = false;
+            }
+            p++;
+        }
+        if (p == start + negative) {
+            return false;
+        }
+        if (p < end && *p == '.') {
+            isInteger = false;
+            p++;
+            const char *fraction = p;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += mantissa != 0;
+                    scale--;
+                }
+                p++;
+            }
+            if (p == fraction) {
+                return false;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            isInteger = false;
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '+' || *p == '-')) {
+                negativeExponent = *p == '-';
+                p++;
+            }
+            const char *exponentStart = p;
+            int exponent = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (exponent < 10000) {
+                    exponent = exponent * 10 + (*p - '0');
+                }
+                p++;
+            }
+            if (p == exponentStart) {
+                return false;
+            }
+            scale += negativeExponent ? -exponent : exponent;
+        }
+        out = (double)mantissa * pow(10.0, scale);
+        if (negative) {
+            out = -out;
+        }
+        if (integer != nullptr) {
+            if (isInteger) {
+                *integer = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+            } else {
+                *integer = fabs(out) < 9.2e18 ? (int64_t)out : 0;
+            }
+        }
+        return true;
+    }
+
+    bool boolean(bool& out) {
+        skipSpace();
+        if (literal("true")) {
+            out = true;
+            return true;
+        }
+        if (literal("false")) {
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool skip(int depth) {
+        if (depth > MaxDepth) {
+            return false;
+        }
+        skipSpace();
+        if (p == end) {
+            return false;
+        }
+        switch (*p) {
+            case '"': {
+                const char *s;
+                size_t length;
+                bool escaped;
+                return rawString(s, length, escaped);
+            }
+            case '{':
+                return object(depth, [this](const char *, size_t, int depth) { return skip(depth); });
+            case '[':
+                return array(depth, [this](int depth) { return skip(depth); });
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': return literal("null");
+            default: {
+                double ignored;
+                return number(ignored);
+            }
+        }
+    }
+
+    // onMember(key, keyLength, depth) must consume the member's value.
+    template <class Callable>
+    bool object(int depth, Callable onMember) {
+        if (depth > MaxDepth || !consume('{')) {
+            return false;
+        }
+        if (consume('}')) {
+            return true;
+        }
+        do {
+            const char *key;
+            size_t length;
+            bool escaped;
+            if (!rawString(key, length, escaped) || !consume(':')) {
+                return false;
+            }
+            // None of the keys we look for have escapes; an escaped key is never a match.
+            if (escaped) {
+                length = 0;
+            }
+            if (!onMember(key, length, depth + 1)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume('}');
+    }
+
+    template <class Callable>
+    bool array(int depth, Callable onElement) {
+        if (depth > MaxDepth || !consume('[')) {
+            return false;
+        }
+        if (consume(']')) {
+            return true;
+        }
+        do {
+            if (!onElement(depth + 1)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume(']');
+    }
+
+  private:
+    const char *p;
+    const char *end;
+
+    template <size_t N>
+    bool literal(const char (&word)[N]) {
+        if ((size_t)(end - p) >= N - 1 && memcmp(p, word, N - 1) == 0) {
+            p += N - 1;
+            return true;
+        }
+        return false;
+    }
+
+    static bool hex4(const char *& s, const char *e, uint32_t& out) {
+        if (e - s < 4) {
+            return false;
+        }
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = *s++;
+            out <<= 4;
+            if (c >= '0' && c <= '9') {
+                out |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                out |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                out |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// The same interface as JSONReader, over MessagePack. obs-websocket's msgpack is its JSON
+// run through nlohmann::json::to_msgpack, so it's the same objects with the same keys.
+class MsgPackReader {
+  public:
+    MsgPackReader(const char *data, size_t length) : p((const uint8_t *)data), end((const uint8_t *)data + length) { }
+
+    bool atEnd() { return p == end; }
+
+    bool atObject() {
+        return p < end && ((*p >= 0x80 && *p <= 0x8F) || *p == 0xDE || *p == 0xDF);
+    }
+
+    // Strings are raw bytes, so there's never anything to unescape; bin is taken as a string too.
+    bool rawString(const char *& start, size_t& length, bool& escaped) {
+        escaped = false;
+        if (p == end) {
+            return false;
+        }
+        uint8_t type = *p++;
+        uint64_t n;
+        if (type >= 0xA0 && type <= 0xBF) {
+            n = type & 0x1F;
+        } else if (type == 0xD9 || type == 0xC4) {
+            if (!readBigEndian(1, n)) return false;
+        } else if (type == 0xDA || type == 0xC5) {
+            if (!readBigEndian(2, n)) return false;
+        } else if (type == 0xDB || type == 0xC6) {
+            if (!readBigEndian(4, n)) return false;
+        } else {
+            return false;
+        }
+        if (n > (uint64_t)(end - p)) {
+            return false;
+        }
+        start = (const char *)p;
+        length = (size_t)n;
+        p += n;
+        return true;
+    }
+
+    bool string(std::string& out) {
+        const char *s;
+        size_t length;
+        bool escaped;
+        if (!rawString(s, length, escaped)) {
+            return false;
+        }
+        out.assign(s, length);
+        return true;
+    }
+
+    bool number(double& out, int64_t *integer = nullptr) {
+        if (p == end) {
+            return false;
+        }
+        uint8_t type = *p++;
+        uint64_t bits;
+        int64_t value;
+        if (type <= 0x7F) {
+            value = type;
+        } else if (type >= 0xE0) {
+            value = (int8_t)type;
+        } else if (type >= 0xCC && type <= 0xCF) {
+            // uint8 to uint64
+            if (!readBigEndian(1 << (type - 0xCC), bits)) return false;
+            value = (int64_t)bits;
+            if (bits > (uint64_t)INT64_MAX) {
+                out = (double)bits;
+                if (integer != nullptr) {
+                    *integer = INT64_MAX;
+                }
+                return true;
+            }
+        } else if (type >= 0xD0 && type <= 0xD3) {
+            // int8 to int64
+            int size = 1 << (type - 0xD0);
+            if (!readBigEndian(size, bits)) return false;
+            int shift = 64 - 8 * size;
+            value = (int64_t)(bits << shift) >> shift;
+        } else if (type == 0xCA) {
+            if (!readBigEndian(4, bits)) return false;
+            uint32_t word = (uint32_t)bits;
+            float f;
+            memcpy(&f, &word, sizeof(f));
+            return real(f, out, integer);
+        } else if (type == 0xCB) {
+            if (!readBigEndian(8, bits)) return false;
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            return real(d, out, integer);
+        } else {
+            return false;
+        }
+        out = (double)value;
+        if (integer != nullptr) {
+            *integer = value;
+        }
+        return true;
+    }
+
+    bool boolean(bool& out) {
+        if (p == end || (*p != 0xC2 && *p != 0xC3)) {
+            return false;
+        }
+        out = *p++ == 0xC3;
+        return true;
+    }
+
+    bool skip(int depth) {
+        if (depth > MaxDepth || p == end) {
+            return false;
+        }
+        uint8_t type = *p;
+        if (atObject()) {
+            return object(depth, [this](const char *, size_t, int depth) { return skip(depth); });
+        }
+        if ((type >= 0x90 && type <= 0x9F) || type == 0xDC || type == 0xDD) {
+            return array(depth, [this](int depth) { return skip(depth); });
+        }
+        if ((type >= 0xA0 && type <= 0xBF) || (type >= 0xD9 && type <= 0xDB) || (type >= 0xC4 && type <= 0xC6)) {
+            const char *s;
+            size_t length;
+            bool escaped;
+            return rawString(s, length, escaped);
+        }
+        if (type == 0xC0 || type == 0xC2 || type == 0xC3) {
+            p++;
+            return true;
+        }
+        // ext: fixext 1 to 16, then ext 8/16/32 with a length; one type byte before the data.
+        if (type >= 0xD4 && type <= 0xD8) {
+            return advance(1 + 1 + ((size_t)1 << (type - 0xD4)));
+        }
+        if (type >= 0xC7 && type <= 0xC9) {
+            p++;
+            uint64_t n;
+            return readBigEndian(1 << (type - 0xC7), n) && n <= (uint64_t)(end - p) && advance(1 + (size_t)n);
+        }
+        double ignored;
+        return number(ignored);
+    }
+
+    // onMember(key, keyLength, depth) must consume the member's value. A key that isn't a
+    // string is skipped and passed on as empty, so it matches nothing.
+    template <class Callable>
+    bool object(int depth, Callable onMember) {
+        uint64_t count;
+        if (depth > MaxDepth || p == end) {
+            return false;
+        }
+        uint8_t type = *p++;
+        if (type >= 0x80 && type <= 0x8F) {
+            count = type & 0x0F;
+        } else if (type == 0xDE) {
+            if (!readBigEndian(2, count)) return false;
+        } else if (type == 0xDF) {
+            if (!readBigEndian(4, count)) return false;
+        } else {
+            return false;
+        }
+        // Every key and value takes at least a byte; don't believe a count the data can't hold.
+        if (count > (uint64_t)(end - p) / 2) {
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            const char *key = nullptr;
+            size_t length = 0;
+            bool escaped;
+            const uint8_t *keyStart = p;
+            if (!rawString(key, length, escaped)) {
+                p = keyStart;
+                length = 0;
+                if (!skip(depth + 1)) {
+                    return false;
+                }
+            }
+            if (!onMember(key, length, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <class Callable>
+    bool array(int depth, Callable onElement) {
+        uint64_t count;
+        if (depth > MaxDepth || p == end) {
+            return false;
+        }
+        uint8_t type = *p++;
+        if (type >= 0x90 && type <= 0x9F) {
+            count = type & 0x0F;
+        } else if (type == 0xDC) {
+            if (!readBigEndian(2, count)) return false;
+        } else if (type == 0xDD) {
+            if (!readBigEndian(4, count)) return false;
+        } else {
+            return false;
+        }
+        if (count > (uint64_t)(end - p)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            if (!onElement(depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+  private:
+    const uint8_t *p;
+    const uint8_t *end;
+
+    bool readBigEndian(int size, uint64_t& out) {
+        if (end - p < size) {
+            return false;
+        }
+        out = 0;
+        for (int i = 0; i < size; i++) {
+            out = (out << 8) | *p++;
+        }
+        return true;
+    }
+
+    bool advance(size_t n) {
+        if (n > (size_t)(end - p)) {
+            return false;
+        }
+        p += n;
+        return true;
+    }
+
+    static bool real(double value, double& out, int64_t *integer) {
+        out = value;
+        if (integer != nullptr) {
+            *integer = fabs(value) < 9.2e18 ? (int64_t)value : 0;
+        }
+        return true;
+    }
+};
+
+template <class Reader>
+bool parseTransform(Reader& r, int depth, SceneItemTransform& xform)
+{
+    return r.object(depth, [&](const char *key, size_t length, int depth) {
+        if (keyIs(key, length, "positionX")) return r.number(xform.positionX);
+        if (keyIs(key, length, "positionY")) return r.number(xform.positionY);
+        if (keyIs(key, length, "width")) return r.number(xform.width);
+        if (keyIs(key, length, "height")) return r.number(xform.height);
+        if (keyIs(key, length, "sourceWidth")) return r.number(xform.sourceWidth);
+        if (keyIs(key, length, "sourceHeight")) return r.number(xform.sourceHeight);
+        if (keyIs(key, length, "boundsWidth")) return r.number(xform.boundsWidth);
+        if (keyIs(key, length, "boundsHeight")) return r.number(xform.boundsHeight);
+        if (keyIs(key, length, "cropLeft")) return r.number(xform.cropLeft);
+        if (keyIs(key, length, "cropRight")) return r.number(xform.cropRight);
+        if (keyIs(key, length, "cropTop")) return r.number(xform.cropTop);
+        if (keyIs(key, length, "cropBottom")) return r.number(xform.cropBottom);
+        if (keyIs(key, length, "boundsType")) return r.string(xform.boundsType);
+        if (keyIs(key, length, "alignment")) {
+            double ignored;
+            int64_t alignment;
+            if (!r.number(ignored, &alignment)) {
+                return false;
+            }
+            xform.alignment = (int)alignment;
+            return true;
+        }
+        return r.skip(depth);
+    });
+}
+
+template <class Reader>
+bool parseSceneItem(Reader& r, int depth, SceneItem& item)
+{
+    return r.object(depth, [&](const char *key, size_t length, int depth) {
+        if (keyIs(key, length, "sourceName")) return r.string(item.sourceName);
+        if (keyIs(key, length, "sceneItemEnabled")) return r.boolean(item.sceneItemEnabled);
+        if (keyIs(key, length, "sceneItemId")) {
+            double ignored;
+            return r.number(ignored, &item.sceneItemId);
+        }
+        if (keyIs(key, length, "sceneItemTransform")) return parseTransform(r, depth, item.sceneItemTransform);
+        return r.skip(depth);
+    });
+}
+
+// eventData or responseData.
+template <class Reader>
+bool parseData(Reader& r, int depth, Message& m)
+{
+    // ExitStarted, for one, has "eventData": null.
+    if (!r.atObject()) {
+        return r.skip(depth);
+    }
+    return r.object(depth, [&](const char *key, size_t length, int depth) {
+        if (keyIs(key, length, "sceneName")) return r.string(m.sceneName);
+        if (keyIs(key, length, "currentProgramSceneName")) return r.string(m.currentProgramSceneName);
+        if (keyIs(key, length, "currentPreviewSceneName")) return r.string(m.currentPreviewSceneName);
+        if (keyIs(key, length, "baseWidth")) return r.number(m.baseWidth);
+        if (keyIs(key, length, "baseHeight")) return r.number(m.baseHeight);
+        if (keyIs(key, length, "imageData")) {
+            bool escaped;
+            return r.rawString(m.imageData, m.imageDataLength, escaped);
+        }
+        if (keyIs(key, length, "inputs")) {
+            return r.array(depth, [&](int depth) {
+                return r.object(depth, [&](const char *key, size_t length, int depth) {
+                    if (keyIs(key, length, "inputName")) {
+                        m.inputNames.emplace_back();
+                        return r.string(m.inputNames.back());
+                    }
+                    return r.skip(depth);
+                });
+            });
+        }
+        if (keyIs(key, length, "sceneItemId")) {
+            double ignored;
+            m.hasSceneItem = true;
+            return r.number(ignored, &m.sceneItem.sceneItemId);
+        }
+        if (keyIs(key, length, "sceneItemEnabled")) return r.boolean(m.sceneItem.sceneItemEnabled);
+        if (keyIs(key, length, "sceneItemTransform")) return parseTransform(r, depth, m.sceneItem.sceneItemTransform);
+        if (keyIs(key, length, "sceneItems")) {
+            m.hasSceneItems = true;
+            return r.array(depth, [&](int depth) {
+                m.sceneItems.emplace_back();
+                return parseSceneItem(r, depth, m.sceneItems.back());
+            });
+        }
+        return r.skip(depth);
+    });
+}
+
+template <class Reader>
+bool parseD(Reader& r, int depth, Message& m)
+{
+    return r.object(depth, [&](const char *key, size_t length, int depth) {
+        if (keyIs(key, length, "eventType")) return r.string(m.eventType);
+        if (keyIs(key, length, "eventIntent")) {
+            double ignored;
+            m.hasEventIntent = true;
+            return r.number(ignored, &m.eventIntent);
+        }
+        if (keyIs(key, length, "requestType")) return r.string(m.requestType);
+        if (keyIs(key, length, "requestId")) return r.string(m.requestId);
+        if (keyIs(key, length, "requestStatus")) {
+            return r.object(depth, [&](const char *key, size_t length, int depth) {
+                if (keyIs(key, length, "result")) return r.boolean(m.requestResult);
+                return r.skip(depth);
+            });
+        }
+        if (keyIs(key, length, "authentication")) {
+            m.hasAuthentication = true;
+            return r.object(depth, [&](const char *key, size_t length, int depth) {
+                if (keyIs(key, length, "challenge")) return r.string(m.challenge);
+                if (keyIs(key, length, "salt")) return r.string(m.salt);
+                return r.skip(depth);
+            });
+        }
+        if (keyIs(key, length, "eventData") || keyIs(key, length, "responseData")) {
+            return parseData(r, depth, m);
+        }
+        if (keyIs(key, length, "results")) {
+            return r.array(depth, [&](int depth) {
+                m.results.emplace_back();
+                m.results.back().op = OpRequestResponse;
+                return parseD(r, depth, m.results.back());
+            });
+        }
+        return r.skip(depth);
+    });
+}
+
+template <class Reader>
+bool parseMessage(Reader& r, Message& message)
+{
+    bool ok = r.object(0, [&](const char *key, size_t length, int depth) {
+        if (keyIs(key, length, "op")) {
+            double ignored;
+            int64_t op;
+            if (!r.number(ignored, &op)) {
+                return false;
+            }
+            message.op = (int)op;
+            return true;
+        }
+        if (keyIs(key, length, "d")) {
+            return parseD(r, depth, message);
+        }
+        return r.skip(depth);
+    });
+    return ok && r.atEnd();
+}
+
+} // namespace
+
+bool parseJSON(const char *json, size_t length, Message& message)
+{
+    JSONReader r(json, length);
+    return parseMessage(r, message);
+}
+
+bool parseMsgPack(const char *data, size_t length, Message& message)
+{
+    MsgPackReader r(data, length);
+    return parseMessage(r, message);
+}
+
+void MsgPackWriter::bigEndian(uint8_t type, uint64_t value, int size)
+{
+    buffer += (char)type;
+    for (int shift = 8 * (size - 1); shift >= 0; shift -= 8) {
+        buffer += (char)(value >> shift);
+    }
+}
+
+void MsgPackWriter::map(size_t count)
+{
+    if (count <= 15) {
+        buffer += (char)(0x80 | count);
+    } else if (count <= 0xFFFF) {
+        bigEndian(0xDE, count, 2);
+    } else {
+        bigEndian(0xDF, count, 4);
+    }
+}
+
+void MsgPackWriter::array(size_t count)
+{
+    if (count <= 15) {
+        buffer += (char)(0x90 | count);
+    } else if (count <= 0xFFFF) {
+        bigEndian(0xDC, count, 2);
+    } else {
+        bigEndian(0xDD, count, 4);
+    }
+}
+
+void MsgPackWriter::string(const char *s, size_t length)
+{
+    if (length <= 31) {
+        buffer += (char)(0xA0 | length);
+    } else if (length <= 0xFF) {
+        bigEndian(0xD9, length, 1);
+    } else if (length <= 0xFFFF) {
+        bigEndian(0xDA, length, 2);
+    } else {
+        bigEndian(0xDB, length, 4);
+    }
+    buffer.append(s, length);
+}
+
+void MsgPackWriter::integer(int64_t value)
+{
+    if (value >= 0 && value <= 0x7F) {
+        buffer += (char)value;
+    } else if (value < 0 && value >= -32) {
+        buffer += (char)(int8_t)value;
+    } else if (value >= 0) {
+        if (value <= 0xFF) {
+            bigEndian(0xCC, value, 1);
+        } else if (value <= 0xFFFF) {
+            bigEndian(0xCD, value, 2);
+        } else if (value <= 0xFFFFFFFFLL) {
+            bigEndian(0xCE, value, 4);
+        } else {
+            bigEndian(0xCF, value, 8);
+        }
+    } else if (value >= INT8_MIN) {
+        bigEndian(0xD0, (uint64_t)value, 1);
+    } else if (value >= INT16_MIN) {
+        bigEndian(0xD1, (uint64_t)value, 2);
+    } else if (value >= INT32_MIN) {
+        bigEndian(0xD2, (uint64_t)value, 4);
+    } else {
+        bigEndian(0xD3, (uint64_t)value, 8);
+    }
+}
+
+void MsgPackWriter::real(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bigEndian(0xCB, bits, 8);
+}
+
+void MsgPackWriter::boolean(bool value)
+{
+    buffer += (char)(value ? 0xC3 : 0xC2);
+}
+
+void MsgPackWriter::nil()
+{
+    buffer += (char)0xC0;
+}
+
+} // namespace obsmessage
@@ -0,0 +1,105 @@
+//
+//  obsmessage.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef OBSMESSAGE_HPP
+#define OBSMESSAGE_HPP
+
+// obs-websocket v5 messages, reduced to the fields PSMOBSWebSocketController uses.
+//
+// parseJSON and parseMsgPack make one pass over the message and skip everything they don't
+// need without building it, so they can run on the socket thread straight from easywsclient's
+// receive buffer. Only these small typed results go to the main thread; the screenshot payload
+// stays in the receive buffer as imageData until someone decodes it.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace obsmessage {
+
+struct SceneItemTransform {
+    double positionX = 0, positionY = 0;
+    double width = 0, height = 0;
+    double sourceWidth = 0, sourceHeight = 0;
+    double boundsWidth = 0, boundsHeight = 0;
+    double cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+    int alignment = 0;
+    std::string boundsType;
+};
+
+struct SceneItem {
+    std::string sourceName;
+    int64_t sceneItemId = 0;
+    bool sceneItemEnabled = false;
+    SceneItemTransform sceneItemTransform;
+};
+
+struct Message {
+    int op = -1;
+    // Events
+    std::string eventType;
+    int64_t eventIntent = 0;
+    bool hasEventIntent = false;
+    // Request responses
+    std::string requestType;
+    std::string requestId;
+    bool requestResult = false;
+    // Hello
+    bool hasAuthentication = false;
+    std::string challenge, salt;
+    // Fields of eventData or responseData, whichever the message has.
+    std::string sceneName;
+    std::string currentProgramSceneName, currentPreviewSceneName;
+    double baseWidth = 0, baseHeight = 0;
+    std::vector<std::string> inputNames;
+    bool hasSceneItems = false;
+    std::vector<SceneItem> sceneItems;
+    // The item a SceneItem event is about: sceneItemId, and sceneItemEnabled or
+    // sceneItemTransform if the event has them.
+    bool hasSceneItem = false;
+    SceneItem sceneItem;
+    // GetSourceScreenshot's data URI, still base64 and possibly JSON-escaped. Points into
+    // the buffer given to parseJSON, so it is only valid as long as that is.
+    const char *imageData = nullptr;
+    size_t imageDataLength = 0;
+    // RequestBatchResponse: one RequestResponse-shaped message per request, in order.
+    std::vector<Message> results;
+
+    void clear() { *this = Message(); }
+};
+
+// Returns false, leaving message partly filled, if json isn't a well-formed JSON object.
+bool parseJSON(const char *json, size_t length, Message& message);
+
+// The same for the obswebsocket.msgpack subprotocol. Strings, imageData included, are never
+// escaped, so they all point straight into data.
+bool parseMsgPack(const char *data, size_t length, Message& message);
+
+// Builds MessagePack for requests going to OBS. Containers are written as a count followed by
+// that many values (for a map, key then value), so the count has to be known up front.
+class MsgPackWriter {
+  public:
+    void map(size_t count);
+    void array(size_t count);
+    void string(const char *s, size_t length);
+    void string(const std::string& s) { string(s.data(), s.size()); }
+    void integer(int64_t value);
+    void real(double value);
+    void boolean(bool value);
+    void nil();
+    // A value that's already encoded, such as another writer's data().
+    void raw(const std::string& encoded) { buffer += encoded; }
+
+    const std::string& data() const { return buffer; }
+
+  private:
+    void bigEndian(uint8_t type, uint64_t value, int size);
+    std::string buffer;
+};
+
+} // namespace obsmessage
+
+#endif /* OBSMESSAGE_HPP */
@@ -0,0 +1,297 @@
+//
+//  obsvisibility.cpp
+//  PTZ Scene Manager
+//
+
+#include "obsvisibility.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace obsvisibility {
+
+namespace {
+
+const int AlignCenter = 0;
+const int AlignLeft = 1 << 0;
+const int AlignRight = 1 << 1;
+const int AlignTop = 1 << 2;
+const int AlignBottom = 1 << 3;
+
+// How far off a source's size can be and still fill.
+const double Epsilon = 1.0;
+
+// Well inside int, so x + width can't overflow either.
+int pixels(double value)
+{
+    const double limit = 1 << 28;
+    return (int)std::max(-limit, std::min(value, limit));
+}
+
+obscoverage::Box box(const Rect& r)
+{
+    return { r.x, r.y, r.x + r.width, r.y + r.height };
+}
+
+} // namespace
+
+struct Scene::Entry {
+    Item item;
+    Rect rect;
+    bool fills = false;
+    // An enabled camera: the only kind of item the walk looks at.
+    bool counts = false;
+};
+
+// The tests visibleSourceItemNames: made, adjustRect:forAlignment: and NSIntegralRect included.
+bool Scene::geometry(const obsmessage::SceneItemTransform& xform, double canvasWidth, double canvasHeight, Rect& rect, bool& fills)
+{
+    rect = Rect();
+    // From github: width and height are computed values using respectively sourceWidth * scaleX and sourceHeight * scaleY
+    // Zero width/height means use the whole screen.
+    double width = xform.width ? xform.width : canvasWidth;
+    double height = xform.height ? xform.height : canvasHeight;
+    // If we can't test it, assume it fills.
+    if (!(height > 0 && width > 0)) {
+        fills = true;
+        return false;
+    }
+    double sourceWidth = xform.sourceWidth ? xform.sourceWidth : canvasWidth;
+    double sourceHeight = xform.sourceHeight ? xform.sourceHeight : canvasHeight;
+    // PositionXY - absolute position on the screen.
+    double x = xform.positionX, y = xform.positionY;
+    double w = width, h = height;
+    if (xform.boundsType != "OBS_BOUNDS_NONE") {
+        // boundsAlignment does not affect the geometry we care about
+        w = xform.boundsWidth;
+        h = xform.boundsHeight;
+    }
+    // Top-Left is standard alignment, no offsets.
+    switch (xform.alignment) {
+        case AlignTop: // Center Top
+            x -= w / 2.0;
+            break;
+        case AlignRight | AlignTop:
+            x -= w;
+            break;
+        case AlignLeft: // Left Center
+            y -= h / 2.0;
+            break;
+        case AlignCenter:
+            x -= w / 2.0;
+            y -= h / 2.0;
+            break;
+        case AlignRight: // Right Center
+            x -= w;
+            y -= h / 2.0;
+            break;
+        case AlignLeft | AlignBottom:
+            y -= h;
+            break;
+        case AlignRight | AlignBottom:
+            x -= w;
+            y -= h;
+            break;
+    }
+    // crop values only matter in that they change the width/height of what's visible.
+    w -= xform.cropLeft + xform.cropRight;
+    h -= xform.cropTop + xform.cropBottom;
+    // NSIntegralRect: out to whole pixels, and nothing at all if it's empty.
+    if (w > 0 && h > 0) {
+        double left = std::floor(x), top = std::floor(y);
+        w = std::ceil(x + w) - left;
+        h = std::ceil(y + h) - top;
+        x = left;
+        y = top;
+    } else {
+        x = y = w = h = 0;
+    }
+    rect.x = pixels(x);
+    rect.y = pixels(y);
+    rect.width = pixels(w);
+    rect.height = pixels(h);
+    // Do a simple fill check. If it's wider, it fills
+    double testWidth = std::min(sourceWidth, w), testHeight = std::min(sourceHeight, h);
+    fills = x == 0 && y == 0 && std::fabs(sourceHeight - testHeight) <= Epsilon && std::fabs(sourceWidth - testWidth) <= Epsilon;
+    return true;
+}
+
+Scene::Scene(const Canvas& canvas) : canvas(canvas), generation(canvas.generation), dirtyFrom(-1), coveredAt(-1) {}
+
+Scene::~Scene() = default;
+
+void Scene::setItems(std::vector<Item> items)
+{
+    entries.clear();
+    entries.resize(items.size());
+    indexById.clear();
+    for (size_t i = 0; i < items.size(); i++) {
+        entries[i].item = std::move(items[i]);
+        indexById[entries[i].item.sceneItemId] = i;
+    }
+    // Start over, measuring everything.
+    generation = canvas.generation - 1;
+    steps.clear();
+    boxes.clear();
+    names.clear();
+}
+
+void Scene::measure(Entry& entry)
+{
+    entry.counts = entry.item.enabled && canvas.cameras.count(entry.item.sourceName) != 0;
+    geometry(entry.item.transform, canvas.width, canvas.height, entry.rect, entry.fills);
+}
+
+void Scene::changed(size_t index)
+{
+    dirtyFrom = std::max(dirtyFrom, (ptrdiff_t)index);
+}
+
+bool Scene::setTransform(int64_t sceneItemId, const obsmessage::SceneItemTransform& transform)
+{
+    auto found = indexById.find(sceneItemId);
+    if (found == indexById.end()) {
+        return false;
+    }
+    // Only a camera can change what's showing; anything else can move all it likes.
+    Entry& entry = entries[found->second];
+    entry.item.transform = transform;
+    Rect before = entry.rect;
+    bool fills = entry.fills;
+    measure(entry);
+    if (entry.counts && (fills != entry.fills || before.x != entry.rect.x || before.y != entry.rect.y
+                         || before.width != entry.rect.width || before.height != entry.rect.height)) {
+        changed(found->second);
+    }
+    return true;
+}
+
+bool Scene::setEnabled(int64_t sceneItemId, bool enabled)
+{
+    auto found = indexById.find(sceneItemId);
+    if (found == indexById.end()) {
+        return false;
+    }
+    Entry& entry = entries[found->second];
+    bool counted = entry.counts;
+    entry.item.enabled = enabled;
+    measure(entry);
+    if (counted != entry.counts) {
+        changed(found->second);
+    }
+    return true;
+}
+
+const std::vector<std::string>& Scene::visibleSources()
+{
+    walk();
+    return names;
+}
+
+void Scene::walk()
+{
+    if (generation != canvas.generation) {
+        generation = canvas.generation;
+        for (Entry& entry : entries) {
+            measure(entry);
+        }
+        steps.clear();
+        boxes.clear();
+        names.clear();
+        coveredAt = -1;
+        dirtyFrom = (ptrdiff_t)entries.size() - 1;
+    }
+    if (dirtyFrom < 0) {
+        return;
+    }
+    if (dirtyFrom < coveredAt) {
+        // Already hidden, and still hidden.
+        dirtyFrom = -1;
+        return;
+    }
+    // Everything above the change stands, and none of it covered the canvas or the walk would
+    // have stopped there.
+    size_t kept = steps.size();
+    while (kept > 0 && (ptrdiff_t)steps[kept - 1] <= dirtyFrom) {
+        kept--;
+    }
+    steps.resize(kept);
+    boxes.resize(kept);
+    names.resize(kept);
+    coveredAt = -1;
+
+    // Item 0 is at the bottom of the visiblity stack. Nothing can show below a camera that
+    // fills the screen by itself, so that's as far as there's any point looking.
+    bool filled = false;
+    for (ptrdiff_t i = dirtyFrom; i >= 0 && !filled; i--) {
+        const Entry& entry = entries[i];
+        if (!entry.counts) {
+            continue;
+        }
+        steps.push_back((size_t)i);
+        boxes.push_back(box(entry.rect));
+        names.push_back(entry.item.sourceName);
+        filled = entry.fills;
+    }
+    // Then it's the first run of cameras that covers it between them. An empty canvas counts
+    // as covered by the first one.
+    obscoverage::Box screen = { 0, 0, pixels(canvas.width), pixels(canvas.height) };
+    size_t tested = steps.size() - (filled ? 1 : 0);
+    size_t covering = obscoverage::coveringPrefix(boxes.data(), tested, screen);
+    if (covering > 0) {
+        steps.resize(covering);
+        boxes.resize(covering);
+        names.resize(covering);
+    }
+    if (covering > 0 || filled) {
+        // Anything below a source collection that covers the screen is not visible.
+        coveredAt = (ptrdiff_t)steps.back();
+    }
+    dirtyFrom = -1;
+}
+
+void Model::setCanvasSize(double width, double height)
+{
+    if (width != canvas.width || height != canvas.height) {
+        canvas.width = width;
+        canvas.height = height;
+        canvas.generation++;
+    }
+}
+
+void Model::setCameras(const std::vector<std::string>& cameras)
+{
+    std::unordered_set<std::string> names(cameras.begin(), cameras.end());
+    if (names != canvas.cameras) {
+        canvas.cameras = std::move(names);
+        canvas.generation++;
+    }
+}
+
+Scene *Model::scene(const std::string& name)
+{
+    auto found = scenes.find(name);
+    return found == scenes.end() ? nullptr : found->second.get();
+}
+
+Scene& Model::setItems(const std::string& name, std::vector<Item> items)
+{
+    std::unique_ptr<Scene>& scene = scenes[name];
+    if (!scene) {
+        scene.reset(new Scene(canvas));
+    }
+    scene->setItems(std::move(items));
+    return *scene;
+}
+
+void Model::remove(const std::string& name)
+{
+    scenes.erase(name);
+}
+
+void Model::clear()
+{
+    scenes.clear();
+}
+
+} // namespace obsvisibility
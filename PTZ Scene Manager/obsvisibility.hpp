@@ -0,0 +1,118 @@
+//
+//  obsvisibility.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef OBSVISIBILITY_HPP
+#define OBSVISIBILITY_HPP
+
+// Which camera sources are showing in an OBS scene, kept up to date item by item.
+//
+// Walking a scene from the top item down, each enabled camera source is showing, until the
+// cameras seen so far cover the canvas; everything below that is hidden. Other sources don't
+// hide anything, since we can't tell what they draw.
+//
+// A Scene remembers how far the walk got. When one item moves or is shown or hidden, the walk
+// picks up from that item instead of starting again at the top, and a change below the point
+// where the canvas was covered costs nothing at all. Whether the canvas is covered yet is up
+// to obscoverage.
+
+#include "obscoverage.hpp"
+#include "obsmessage.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace obsvisibility {
+
+struct Item {
+    int64_t sceneItemId = 0;
+    std::string sourceName;
+    bool enabled = false;
+    obsmessage::SceneItemTransform transform;
+};
+
+// An item's place on the canvas, in whole pixels; see Scene::geometry.
+struct Rect {
+    int x = 0, y = 0;
+    int width = 0, height = 0;
+};
+
+// What every scene is measured against. The Model bumps generation when it changes, and each
+// scene starts over the next time it's asked.
+struct Canvas {
+    double width = 0, height = 0;
+    std::unordered_set<std::string> cameras;
+    uint64_t generation = 0;
+};
+
+class Scene {
+  public:
+    explicit Scene(const Canvas& canvas);
+    ~Scene();
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // Items in GetSceneItemList order, bottom of the stack first.
+    void setItems(std::vector<Item> items);
+
+    // SceneItemTransformChanged and SceneItemEnableStateChanged. Return false if the scene
+    // has no such item, which means our copy of it is out of date.
+    bool setTransform(int64_t sceneItemId, const obsmessage::SceneItemTransform& transform);
+    bool setEnabled(int64_t sceneItemId, bool enabled);
+
+    // The camera sources that are showing, top first. Finishes the walk if anything changed.
+    const std::vector<std::string>& visibleSources();
+
+    // Where the item lands on the canvas, and whether it counts as covering all of it by
+    // itself. False if it has no size to test, in which case it's assumed to cover it.
+    static bool geometry(const obsmessage::SceneItemTransform& transform, double canvasWidth, double canvasHeight, Rect& rect, bool& fills);
+
+  private:
+    struct Entry;
+
+    void measure(Entry& entry);
+    void changed(size_t index);
+    void walk();
+
+    const Canvas& canvas;
+    uint64_t generation;
+    std::vector<Entry> entries;
+    std::unordered_map<int64_t, size_t> indexById;
+    // The index of each camera the walk has passed, top first, where it is and its source name.
+    std::vector<size_t> steps;
+    std::vector<obscoverage::Box> boxes;
+    std::vector<std::string> names;
+    // The walk has to start again from this index and work down; -1 if it's finished.
+    ptrdiff_t dirtyFrom;
+    // The index of the item that finished covering the canvas; -1 if nothing did.
+    ptrdiff_t coveredAt;
+};
+
+// Every scene we've been sent the items for, by name.
+class Model {
+  public:
+    // Either one changing means starting over on every scene, so they're compared first.
+    void setCanvasSize(double width, double height);
+    void setCameras(const std::vector<std::string>& cameras);
+
+    // nullptr if we don't have the scene's items.
+    Scene *scene(const std::string& name);
+    Scene& setItems(const std::string& name, std::vector<Item> items);
+    void remove(const std::string& name);
+    void clear();
+
+  private:
+    Canvas canvas;
+    std::map<std::string, std::unique_ptr<Scene>> scenes;
+};
+
+} // namespace obsvisibility
+
+#endif /* OBSVISIBILITY_HPP */
@@ -0,0 +1,194 @@
+//
+//  spscqueue.hpp
+//  PTZ Scene Manager
+//
+
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+// A bounded, lock-free queue for exactly one producer thread and one consumer thread, as
+// between PSMOBSWebSocketController's socket thread and the main thread.
+//
+// Values are moved in and moved out, never copied, and neither side ever waits on the other:
+// push fails when the queue is full and pop fails when it's empty, and the caller decides
+// what that means. Each side keeps its own index on its own cache line and a stale copy of
+// the other side's, so the shared indexes are only read when the copy says full or empty.
+//
+// It also keeps the statistics you'd want from a queue like this: the most it has ever held,
+// how many pushes failed, and how long values waited in it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace spsc {
+
+struct Stats {
+    uint64_t pushed = 0;
+    // Pushes that failed because the queue was full.
+    uint64_t rejected = 0;
+    // Most values the consumer has found waiting at once.
+    size_t highWater = 0;
+    // Time from push to pop, over every value popped so far.
+    uint64_t popped = 0;
+    uint64_t totalLatencyNS = 0;
+    uint64_t maxLatencyNS = 0;
+
+    double averageLatencyMS() const {
+        return popped ? totalLatencyNS / (double)popped / 1e6 : 0;
+    }
+    double maxLatencyMS() const { return maxLatencyNS / 1e6; }
+};
+
+template <class T>
+class Queue {
+  public:
+    // Rounded up to a power of two.
+    explicit Queue(size_t capacity = 1024) {
+        size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask = size - 1;
+        slots.reset(new Slot[size]);
+    }
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
+    size_t capacity() const { return size; }
+
+    // Producer thread only. Returns false, leaving value alone, if the queue is full.
+    bool push(T&& value) {
+        size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.otherIndex == size) {
+            producer.otherIndex = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.otherIndex == size) {
+                producerStats.rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        Slot& slot = slots[tail & mask];
+        slot.value = std::move(value);
+        slot.enqueued = now();
+        producer.index.store(tail + 1, std::memory_order_release);
+
+        producerStats.pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer thread only.
+    bool pop(T& value) {
+        return drain([&](T&& v) { value = std::move(v); }, 1) == 1;
+    }
+
+    // Consumer thread only. Hands each waiting value to fn, oldest first, up to max of them,
+    // and returns how many. Everything pushed before the call is included (up to max); values
+    // pushed while it runs may or may not be.
+    template <class Fn>
+    size_t drain(Fn&& fn, size_t max = SIZE_MAX) {
+        size_t head = consumer.index.load(std::memory_order_relaxed);
+        // Look at the producer's index only if what we already know it pushed won't do.
+        if (consumer.otherIndex - head < max) {
+            consumer.otherIndex = producer.index.load(std::memory_order_acquire);
+            // The depth is only known here, when we look at the producer's index, so the high
+            // water mark is the deepest the consumer has found the queue.
+            size_t depth = consumer.otherIndex - head;
+            if (depth > consumerStats.highWater.load(std::memory_order_relaxed)) {
+                consumerStats.highWater.store(depth, std::memory_order_relaxed);
+            }
+        }
+        size_t count = std::min(consumer.otherIndex - head, max);
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t t = now();
+        uint64_t totalLatency = 0, maxLatency = 0;
+        for (size_t i = 0; i < count; i++) {
+            Slot& slot = slots[(head + i) & mask];
+            uint64_t latency = t - slot.enqueued;
+            totalLatency += latency;
+            maxLatency = std::max(maxLatency, latency);
+            T value = std::move(slot.value);
+            // Leave nothing behind in the slot: a moved-from object may still own something.
+            slot.value = T();
+            // Free the slot before running fn, so a slow fn doesn't make the producer see full.
+            consumer.index.store(head + i + 1, std::memory_order_release);
+            fn(std::move(value));
+        }
+        consumerStats.popped.fetch_add(count, std::memory_order_relaxed);
+        consumerStats.totalLatencyNS.fetch_add(totalLatency, std::memory_order_relaxed);
+        if (maxLatency > consumerStats.maxLatencyNS.load(std::memory_order_relaxed)) {
+            consumerStats.maxLatencyNS.store(maxLatency, std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    // Consumer thread only. Drops everything waiting.
+    size_t clear() {
+        return drain([](T&&) {});
+    }
+
+    // Any thread. Each field is read on its own, so a snapshot taken while the queue is busy
+    // may not quite add up.
+    Stats stats() const {
+        Stats stats;
+        stats.pushed = producerStats.pushed.load(std::memory_order_relaxed);
+        stats.rejected = producerStats.rejected.load(std::memory_order_relaxed);
+        stats.highWater = consumerStats.highWater.load(std::memory_order_relaxed);
+        stats.popped = consumerStats.popped.load(std::memory_order_relaxed);
+        stats.totalLatencyNS = consumerStats.totalLatencyNS.load(std::memory_order_relaxed);
+        stats.maxLatencyNS = consumerStats.maxLatencyNS.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+  private:
+    // Apple Silicon's cache lines are 128 bytes, and that's enough for Intel too. Padding
+    // rather than alignas, so the queue can be an Objective-C ivar, which only gets malloc's
+    // alignment.
+    static constexpr size_t CacheLine = 128;
+
+    struct Slot {
+        T value = T();
+        uint64_t enqueued = 0;
+    };
+
+    // One side's index, written only by that side, and its last look at the other side's.
+    struct Side {
+        std::atomic<size_t> index{0};
+        size_t otherIndex = 0;
+        char padding[CacheLine];
+    };
+
+    struct ProducerStats {
+        std::atomic<uint64_t> pushed{0}, rejected{0};
+        char padding[CacheLine];
+    };
+
+    struct ConsumerStats {
+        std::atomic<uint64_t> popped{0}, totalLatencyNS{0}, maxLatencyNS{0};
+        std::atomic<size_t> highWater{0};
+        char padding[CacheLine];
+    };
+
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // The part neither side writes first, then each side's index and the stats only it writes.
+    std::unique_ptr<Slot[]> slots;
+    size_t size, mask;
+    char padding[CacheLine];
+    Side producer;
+    ProducerStats producerStats;
+    Side consumer;
+    ConsumerStats consumerStats;
+};
+
+} // namespace spsc
+
+#endif /* SPSCQUEUE_HPP */
@@ -0,0 +1,249 @@
+//
+//  command_pipeline_bench.m
+//  PTZ Scene Manager
+//
+// Drives PTZCamera's command pipeline against visca_sim: a slider drag's worth of zoom and
+// pan/tilt setpoints, then a memory set and a recall, with coalescing on and off.
+//
+// This is the app's PTZCamera, talking to the simulator through libvisca: applyZoom: and
+// applyPantiltAbsolutePosition: go through coalesceCommand:doneBlock:, dispatchCommand:block:
+// and claimCoalescedCommand:doneBlock: just as they do when a slider moves. Sent is counted from
+// the LogCommandTiming lines dispatchCommand:block: writes after each command it runs, and
+// coalesced is the camera's own coalescedCommandCount.
+//
+// It checks that every request's done block is called exactly once, successfully, and in the
+// order the requests were made; that the camera ends up at the last values asked for, read back
+// with updateCameraState:; that the memory set queued behind the drag stored those values, by
+// moving the camera away and recalling it; and that sent and coalesced add up to the requests.
+//
+// Build: S="../../PTZ Scene Manager"; V="$S/../../libvisca/libvisca-ip/visca"
+//        clang -O2 -fobjc-arc -framework Cocoa -framework AVFoundation -framework IOKit -I"$S" -I"$S/iniparser" -I"$V" -L"$S" -o command_pipeline_bench command_pipeline_bench.m "$S/PTZCamera.m" "$S/PTZCameraConfig.m" "$S/PTZCameraOpener.m" "$S/PTZProgressGroup.m" "$S/PTZPrefCamera.m" "$S/PTZPrefObject.m" "$S/PTZCameraSceneRange.m" "$S/PSMThumbnailCache.m" "$S/iniparser/ObjCUtils.m" -llibvisca-all
+// Run:   ../visca-sim/visca_sim --port 5678 --latency-ms 10 --move-ms 0 &
+//        ./command_pipeline_bench [port] [setpoints]
+
+#import <Cocoa/Cocoa.h>
+#import "PTZCameraInt.h"
+
+// MARK: - What PTZCamera.m needs from the rest of the app
+
+NSString *PTZ_BatchDelayKey = @"BatchDelay";
+NSString *PTZ_BatchSettlePollingKey = @"BatchSettlePolling";
+NSString *PTZ_LogCommandTimingKey = @"LogCommandTiming";
+
+// Only fetchOBSSnapshotAtIndex:onDone: uses it, and nothing here fetches snapshots.
+@interface PSMOBSWebSocketController : NSObject
+@end
+@implementation PSMOBSWebSocketController
+@end
+
+// dispatchCommand:block: logs "<device> <command>: depth ..." on the camera queue once each command has run.
+static NSObject *sentLock;
+static NSInteger zoomSent, pantiltSent;
+
+void PTZLog(NSString *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    NSString *line = [[NSString alloc] initWithFormat:format arguments:args];
+    va_end(args);
+    @synchronized (sentLock) {
+        if ([line containsString:@" zoom: depth"]) {
+            zoomSent++;
+        } else if ([line containsString:@" pantilt absolute: depth"]) {
+            pantiltSent++;
+        }
+    }
+}
+
+static NSInteger commandsSent(void)
+{
+    @synchronized (sentLock) {
+        return zoomSent + pantiltSent;
+    }
+}
+
+// MARK: - Main
+
+static void runFor(NSTimeInterval seconds)
+{
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:seconds]];
+}
+
+// Runs the main run loop, where done blocks are called, until done is set or 10 seconds pass.
+static BOOL runUntil(BOOL (^done)(void))
+{
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:10];
+    while (!done()) {
+        if ([deadline timeIntervalSinceNow] < 0) {
+            return NO;
+        }
+        runFor(0.001);
+    }
+    return YES;
+}
+
+// The camera's pan, tilt and zoom, read back from it.
+static BOOL readBack(PTZCamera *camera, NSInteger *zoom, NSInteger *pan, NSInteger *tilt)
+{
+    __block BOOL finished = NO, succeeded = NO;
+    camera.zoom = -1;
+    camera.pan = -1;
+    camera.tilt = -1;
+    [camera updateCameraState:^(BOOL success) {
+        succeeded = success;
+        finished = YES;
+    }];
+    if (!runUntil(^{ return finished; }) || !succeeded) {
+        return NO;
+    }
+    *zoom = camera.zoom;
+    *pan = camera.pan;
+    *tilt = camera.tilt;
+    return YES;
+}
+
+typedef struct {
+    NSInteger requests, sent, coalesced;
+    NSTimeInterval dragTime;
+} Result;
+
+static Result run(int port, int setpoints, BOOL coalesces, NSMutableArray<NSString *> *failures)
+{
+    Result result = { 0, 0, 0, 0 };
+    PTZCamera *camera = [[PTZCamera alloc] initWithPrefCamera:nil IP:[NSString stringWithFormat:@"127.0.0.1:%d", port]];
+    camera.coalescesCommands = coalesces;
+    __block BOOL connected = NO, finished = NO;
+    [camera applyPantiltPresetSpeed:^(BOOL success) {
+        connected = success;
+        finished = YES;
+    }];
+    if (!runUntil(^{ return finished; }) || !connected) {
+        [failures addObject:[NSString stringWithFormat:@"can't connect to visca_sim on port %d", port]];
+        return result;
+    }
+    @synchronized (sentLock) {
+        zoomSent = pantiltSent = 0;
+    }
+    NSInteger coalescedBefore = [[camera valueForKey:@"coalescedCommandCount"] integerValue];
+
+    // Main thread only.
+    NSUInteger requestCount = (NSUInteger)setpoints * 2 + 2;
+    NSInteger *calls = calloc(requestCount, sizeof(NSInteger));
+    __block NSUInteger callCount = 0;
+    __block BOOL allSucceeded = YES;
+    NSMutableArray<NSNumber *> *zoomOrder = [NSMutableArray array], *pantiltOrder = [NSMutableArray array];
+    PTZDoneBlock (^doneFor)(NSUInteger, NSMutableArray *) = ^PTZDoneBlock(NSUInteger request, NSMutableArray *order) {
+        return ^(BOOL success) {
+            calls[request]++;
+            callCount++;
+            [order addObject:@(request)];
+            allSucceeded = allSucceeded && success;
+        };
+    };
+
+    // A drag: zoom and pan/tilt moving together, a new value every 2 ms, much faster than the
+    // camera answers. The slider's binding sets the property, then the action applies it.
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    NSInteger zoom = 0, pan = 0, tilt = 0;
+    for (int i = 0; i < setpoints; i++) {
+        zoom = 0x100 + i * 37 % 0x4000;
+        pan = -600 + i * 9;
+        tilt = 200 - i * 3;
+        camera.zoom = zoom;
+        [camera applyZoom:doneFor((NSUInteger)i * 2, zoomOrder)];
+        camera.pan = pan;
+        camera.tilt = tilt;
+        [camera applyPantiltAbsolutePosition:doneFor((NSUInteger)i * 2 + 1, pantiltOrder)];
+        runFor(0.002);
+    }
+    // Saved as soon as the drag ends, as sceneSet: does.
+    const NSInteger scene = 5;
+    [camera memorySet:scene onDone:doneFor((NSUInteger)setpoints * 2, [NSMutableArray array])];
+    if (!runUntil(^{ return (BOOL)(callCount >= (NSUInteger)setpoints * 2 + 1); })) {
+        [failures addObject:@"timed out waiting for the drag's done blocks"];
+    }
+    result.dragTime = [NSDate timeIntervalSinceReferenceDate] - start;
+
+    // updateCameraState: runs on the camera queue behind the drag, so every command has logged by the time it's back.
+    NSInteger z, p, t;
+    if (!readBack(camera, &z, &p, &t)) {
+        [failures addObject:@"inquiry failed"];
+    } else if (z != zoom || p != pan || t != tilt) {
+        [failures addObject:@"camera isn't at the last setpoint"];
+    }
+    result.requests = (NSInteger)setpoints * 2;
+    result.sent = commandsSent();
+    result.coalesced = [[camera valueForKey:@"coalescedCommandCount"] integerValue] - coalescedBefore;
+
+    // Somewhere else, then back to the scene.
+    __block BOOL movedAway = NO;
+    camera.zoom = 0;
+    [camera applyZoom:nil];
+    camera.pan = 0;
+    camera.tilt = 0;
+    [camera applyPantiltAbsolutePosition:^(BOOL success) {
+        movedAway = YES;
+    }];
+    runUntil(^{ return movedAway; });
+    [camera memoryRecall:scene onDone:doneFor((NSUInteger)setpoints * 2 + 1, [NSMutableArray array])];
+    if (!runUntil(^{ return (BOOL)(callCount >= requestCount); })) {
+        [failures addObject:@"timed out waiting for the recall"];
+    }
+    if (!readBack(camera, &z, &p, &t)) {
+        [failures addObject:@"inquiry after recall failed"];
+    } else if (z != zoom || p != pan || t != tilt) {
+        [failures addObject:@"the memory set didn't store the last setpoint"];
+    }
+    [camera closeCamera];
+
+    for (NSUInteger i = 0; i < requestCount; i++) {
+        if (calls[i] != 1) {
+            [failures addObject:[NSString stringWithFormat:@"request %lu called back %ld times", (unsigned long)i, (long)calls[i]]];
+            break;
+        }
+    }
+    free(calls);
+    if (!allSucceeded) {
+        [failures addObject:@"a command failed"];
+    }
+    for (NSArray<NSNumber *> *order in @[zoomOrder, pantiltOrder]) {
+        for (NSUInteger i = 1; i < order.count; i++) {
+            if ([order[i] integerValue] < [order[i - 1] integerValue]) {
+                [failures addObject:@"done blocks called out of order"];
+                break;
+            }
+        }
+    }
+    if (coalesces ? result.sent + result.coalesced != result.requests : result.sent != result.requests || result.coalesced != 0) {
+        [failures addObject:@"sent and coalesced don't add up to the requests"];
+    }
+    return result;
+}
+
+int main(int argc, const char **argv)
+{
+    @autoreleasepool {
+        int port = argc > 1 ? atoi(argv[1]) : 5678;
+        int setpoints = argc > 2 ? atoi(argv[2]) : 200;
+        if (port <= 0 || setpoints <= 0) {
+            fprintf(stderr, "usage: %s [port] [setpoints]\n", argv[0]);
+            return 1;
+        }
+        sentLock = [NSObject new];
+        [[NSUserDefaults standardUserDefaults] registerDefaults:@{PTZ_BatchDelayKey:@(1),
+                                                                  PTZ_BatchSettlePollingKey:@(NO),
+                                                                  PTZ_LogCommandTimingKey:@(YES)}];
+        printf("%d zoom and %d pan/tilt setpoints against visca_sim on port %d\n", setpoints, setpoints, port);
+        printf("%-12s %10s %10s %10s %10s  %s\n", "coalescing", "requests", "sent", "coalesced", "drag ms", "checks");
+        BOOL passed = YES;
+        for (NSNumber *coalesces in @[@NO, @YES]) {
+            NSMutableArray<NSString *> *failures = [NSMutableArray array];
+            Result r = run(port, setpoints, coalesces.boolValue, failures);
+            NSString *checks = failures.count == 0 ? @"ok" : [failures componentsJoinedByString:@"; "];
+            printf("%-12s %10ld %10ld %10ld %10.0f  %s\n", coalesces.boolValue ? "on" : "off", (long)r.requests, (long)r.sent,
+                   (long)r.coalesced, r.dragTime * 1000, [checks UTF8String]);
+            passed = passed && failures.count == 0;
+        }
+        return passed ? 0 : 1;
+    }
+}
@@ -0,0 +1,258 @@
+//
+//  coverage_bench.cpp
+//  PTZ Scene Manager
+//
+// Checks obscoverage against pixman, then times them both.
+//
+// pixman is the reference: union every box into a region, subtract that from the canvas and
+// see if any rects are left, which is what visibleSourceItemNames: used to do. The check runs
+// random scenes through both and they have to agree on every prefix of every scene. The
+// scenes are exact tilings of the canvas with pieces dropped, nudged and shrunk, plus boxes
+// hanging off the edges, empty and inside-out boxes, huge ones and empty canvases.
+//
+// The timings are for finding the cameras that cover the canvas, the way the visibility walk
+// does: pixman unioning one camera at a time and testing after each, against
+// obscoverage::coveringPrefix over the lot.
+//
+// Build: S="../../PTZ Scene Manager"
+//        cc -O2 -c -I"$S/regions" "$S/regions/pixman-region32.c" "$S/regions/pixman-utils.c"
+//        c++ -std=c++17 -O2 -Wall -I"$S" -I"$S/regions" -o coverage_bench coverage_bench.cpp "$S/obscoverage.cpp" pixman-region32.o pixman-utils.o
+// Run:   ./coverage_bench [scenes]
+
+#include "obscoverage.hpp"
+#include "pixman.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using obscoverage::Box;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// MARK: - pixman
+
+static bool pixmanCovers(const Box *boxes, size_t count, const Box& canvas)
+{
+    pixman_region32_t region, screen, diff;
+    pixman_region32_init(&region);
+    pixman_region32_init(&diff);
+    if (canvas.x2 > canvas.x1 && canvas.y2 > canvas.y1) {
+        pixman_region32_init_rect(&screen, canvas.x1, canvas.y1, (unsigned)(canvas.x2 - canvas.x1), (unsigned)(canvas.y2 - canvas.y1));
+    } else {
+        pixman_region32_init(&screen);
+    }
+    for (size_t i = 0; i < count; i++) {
+        const Box& b = boxes[i];
+        // pixman ignores empty rects too, but complains about inside-out ones first.
+        if (b.x2 > b.x1 && b.y2 > b.y1) {
+            pixman_region32_union_rect(&region, &region, b.x1, b.y1, (unsigned)(b.x2 - b.x1), (unsigned)(b.y2 - b.y1));
+        }
+    }
+    pixman_region32_subtract(&diff, &screen, &region);
+    bool covered = pixman_region32_n_rects(&diff) == 0;
+    pixman_region32_fini(&diff);
+    pixman_region32_fini(&screen);
+    pixman_region32_fini(&region);
+    return covered;
+}
+
+// The visibility walk before obscoverage: one camera at a time, testing after each.
+static size_t pixmanCoveringPrefix(const std::vector<Box>& boxes, const Box& canvas)
+{
+    pixman_region32_t region;
+    pixman_region32_init(&region);
+    pixman_box32_t screen = { canvas.x1, canvas.y1, canvas.x2, canvas.y2 };
+    size_t found = 0;
+    for (size_t i = 0; i < boxes.size() && !found; i++) {
+        const Box& b = boxes[i];
+        if (b.x2 > b.x1 && b.y2 > b.y1) {
+            pixman_region32_union_rect(&region, &region, b.x1, b.y1, (unsigned)(b.x2 - b.x1), (unsigned)(b.y2 - b.y1));
+        }
+        if (pixman_region32_contains_rectangle(&region, &screen) == PIXMAN_REGION_IN) {
+            found = i + 1;
+        }
+    }
+    pixman_region32_fini(&region);
+    return found;
+}
+
+// MARK: - Scenes
+
+// Cut canvas up into about count boxes that cover it exactly.
+static void tile(const Box& canvas, size_t count, std::mt19937& rng, std::vector<Box>& out)
+{
+    std::vector<Box> pieces = { canvas };
+    while (pieces.size() < count) {
+        size_t pick = rng() % pieces.size();
+        Box b = pieces[pick];
+        bool across = rng() % 2;
+        int32_t span = across ? b.x2 - b.x1 : b.y2 - b.y1;
+        if (span < 2) {
+            if (rng() % 4 == 0) {
+                break;
+            }
+            continue;
+        }
+        int32_t cut = 1 + (int32_t)(rng() % (uint32_t)(span - 1));
+        Box first = b, second = b;
+        if (across) {
+            first.x2 = second.x1 = b.x1 + cut;
+        } else {
+            first.y2 = second.y1 = b.y1 + cut;
+        }
+        pieces[pick] = first;
+        pieces.push_back(second);
+    }
+    out.insert(out.end(), pieces.begin(), pieces.end());
+}
+
+static Box randomBox(const Box& canvas, std::mt19937& rng)
+{
+    int32_t w = std::max(canvas.x2 - canvas.x1, 4), h = std::max(canvas.y2 - canvas.y1, 4);
+    std::uniform_int_distribution<int32_t> x(canvas.x1 - w / 2, canvas.x2 + w / 2), y(canvas.y1 - h / 2, canvas.y2 + h / 2);
+    std::uniform_int_distribution<int32_t> size(-2, std::max(w, h));
+    Box b;
+    b.x1 = x(rng);
+    b.y1 = y(rng);
+    b.x2 = b.x1 + size(rng);
+    b.y2 = b.y1 + size(rng);
+    return b;
+}
+
+static std::vector<Box> randomScene(Box& canvas, std::mt19937& rng)
+{
+    const int32_t huge = 1 << 28;
+    switch (rng() % 8) {
+        case 0: canvas = { 0, 0, 0, (int32_t)(rng() % 5) }; break;
+        case 1: canvas = { -huge, -huge, huge, huge }; break;
+        default: {
+            int32_t x = (int32_t)(rng() % 41) - 20, y = (int32_t)(rng() % 41) - 20;
+            canvas = { x, y, x + 1 + (int32_t)(rng() % 40), y + 1 + (int32_t)(rng() % 40) };
+            break;
+        }
+    }
+    std::vector<Box> boxes;
+    size_t count = 1 + rng() % 80;
+    if (rng() % 4 != 0) {
+        tile(canvas, count, rng, boxes);
+    }
+    for (Box& b : boxes) {
+        switch (rng() % 12) {
+            case 0: b.x1++; break;
+            case 1: b.y2--; break;
+            case 2: b = randomBox(canvas, rng); break;
+            case 3: b.x2 += 3; b.y1 -= 3; break;
+        }
+    }
+    size_t extra = rng() % (count / 2 + 2);
+    for (size_t i = 0; i < extra; i++) {
+        boxes.push_back(rng() % 16 == 0 ? Box { -huge, -huge, huge, huge } : randomBox(canvas, rng));
+    }
+    std::shuffle(boxes.begin(), boxes.end(), rng);
+    if (!boxes.empty() && rng() % 3 == 0) {
+        boxes.erase(boxes.begin() + (long)(rng() % boxes.size()));
+    }
+    return boxes;
+}
+
+// Cameras for the timings: a wall that's covered once the last tile goes in, scattered
+// picture-in-picture that never covers, and a wall with the scatter on top of it.
+static std::vector<Box> timingScene(int kind, size_t count, const Box& canvas, std::mt19937& rng)
+{
+    std::vector<Box> boxes;
+    if (kind != 1) {
+        size_t tiles = kind == 0 ? count : count / 4;
+        int32_t columns = 1;
+        while ((size_t)(columns * columns) < tiles) {
+            columns++;
+        }
+        int32_t rows = (int32_t)((tiles + (size_t)columns - 1) / (size_t)columns);
+        for (size_t i = 0; i < tiles; i++) {
+            int32_t row = (int32_t)i / columns, column = (int32_t)i % columns;
+            int32_t inRow = row == rows - 1 ? (int32_t)tiles - row * columns : columns;
+            int32_t w = (canvas.x2 + inRow - 1) / inRow, h = (canvas.y2 + rows - 1) / rows;
+            boxes.push_back({ column * w, row * h, column * w + w + 1, row * h + h + 1 });
+        }
+    }
+    std::uniform_int_distribution<int32_t> x(0, canvas.x2 - 200), y(0, canvas.y2 - 120), size(80, 400);
+    std::vector<Box> scatter;
+    while (boxes.size() + scatter.size() < count) {
+        int32_t bx = x(rng), by = y(rng), w = size(rng);
+        scatter.push_back({ bx, by, bx + w, by + w * 9 / 16 });
+    }
+    // On top, so the walk meets them first.
+    boxes.insert(boxes.begin(), scatter.begin(), scatter.end());
+    return boxes;
+}
+
+// MARK: - Main
+
+int main(int argc, char *argv[])
+{
+    int scenes = argc > 1 ? atoi(argv[1]) : 20000;
+    if (scenes <= 0) {
+        fprintf(stderr, "usage: %s [scenes]\n", argv[0]);
+        return 1;
+    }
+    std::mt19937 rng(20);
+
+    size_t prefixes = 0, covered = 0;
+    for (int s = 0; s < scenes; s++) {
+        Box canvas;
+        std::vector<Box> boxes = randomScene(canvas, rng);
+        size_t expectedPrefix = 0;
+        for (size_t n = 0; n <= boxes.size(); n++) {
+            bool expected = pixmanCovers(boxes.data(), n, canvas);
+            if (obscoverage::covers(boxes.data(), n, canvas) != expected) {
+                fprintf(stderr, "scene %d: %zu of %zu boxes: covers says %d, pixman %d\n", s, n, boxes.size(), !expected, expected);
+                return 1;
+            }
+            if (expected && !expectedPrefix && n > 0) {
+                expectedPrefix = n;
+            }
+            prefixes++;
+            covered += expected;
+        }
+        size_t prefix = obscoverage::coveringPrefix(boxes.data(), boxes.size(), canvas);
+        if (prefix != expectedPrefix) {
+            fprintf(stderr, "scene %d: covered by the first %zu boxes, expected %zu\n", s, prefix, expectedPrefix);
+            return 1;
+        }
+    }
+    printf("%d scenes, %zu prefixes, %zu covered: all agree with pixman\n\n", scenes, prefixes, covered);
+
+    const Box canvas = { 0, 0, 1920, 1080 };
+    const char *kinds[] = { "wall", "picture in picture", "wall under pip" };
+    printf("%-20s %6s %8s %14s %14s %9s\n", "scene", "boxes", "covers", "pixman us", "obscov us", "speedup");
+    for (size_t count : { 8, 32, 64, 200, 500 }) {
+        for (int kind = 0; kind < 3; kind++) {
+            std::vector<Box> boxes = timingScene(kind, count, canvas, rng);
+            size_t expected = pixmanCoveringPrefix(boxes, canvas);
+            if (obscoverage::coveringPrefix(boxes.data(), boxes.size(), canvas) != expected) {
+                fprintf(stderr, "%s, %zu boxes: disagrees with pixman\n", kinds[kind], count);
+                return 1;
+            }
+            int runs = (int)(200000 / count);
+            double t = now();
+            size_t sink = 0;
+            for (int r = 0; r < runs; r++) {
+                sink += pixmanCoveringPrefix(boxes, canvas);
+            }
+            double pixmanTime = (now() - t) / runs;
+            t = now();
+            for (int r = 0; r < runs; r++) {
+                sink += obscoverage::coveringPrefix(boxes.data(), boxes.size(), canvas);
+            }
+            double coverageTime = (now() - t) / runs;
+            printf("%-20s %6zu %8zu %14.2f %14.2f %8.1fx\n", kinds[kind], count, sink / (2 * (size_t)runs), pixmanTime * 1e6, coverageTime * 1e6, pixmanTime / coverageTime);
+        }
+    }
+    return 0;
+}
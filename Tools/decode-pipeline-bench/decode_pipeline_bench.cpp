@@ -0,0 +1,286 @@
+//
+//  decode_pipeline_bench.cpp
+//  PTZ Scene Manager
+//
+// RTSPViewController's decoding, the old way and with a decoder thread and a frame ring, run
+// against a stand-in stream so it works anywhere.
+//
+// The old way: a 30 Hz timer queues a tick on a serial queue, and each tick reads the next
+// frame, decodes it, scales it and sends the image to the main thread. A slow frame holds up
+// the ticks behind it, and a stream faster than 30 fps falls further and further behind.
+//
+// The new way is the real framering.hpp: a decoder thread reads, decodes and scales frames
+// as they come, pushing them into the ring, and the main thread takes the newest whenever
+// it gets to run. A file is paced by its timestamps.
+//
+// The stand-in stream has a frame ready every 1/fps seconds, or all at once for a file, and
+// "decoding" is a sleep. The main thread is busy for a while once a second, like it would be
+// with the rest of the app running. Latency is from the frame being ready (or due, for a
+// file) to it being shown; lag is how far behind the stream the last frame shown was.
+//
+// Build: c++ -std=c++17 -O2 -Wall -pthread -I"../../PTZ Scene Manager" -o decode_pipeline_bench decode_pipeline_bench.cpp
+// Run:   ./decode_pipeline_bench [seconds]
+
+#include "framering.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using framering::Clock;
+
+static double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+static void sleepFor(double s)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double>(s));
+}
+
+// MARK: - Stand-ins
+
+struct Scenario {
+    const char *name;
+    double fps;
+    bool file;
+    // Seconds per frame, and a slow frame every so often.
+    double decode;
+    double slowDecode;
+    int slowEvery;
+};
+
+// A stream that has frame i ready at start + i / fps, or right away for a file.
+class Stream {
+  public:
+    Stream(const Scenario& scenario, Clock::time_point start) : scenario(scenario), start(start) {}
+
+    struct Frame {
+        int index;
+        double pts;
+        Clock::time_point ready;
+    };
+
+    // Blocks until the next frame is ready, like av_read_frame, then decodes and scales it.
+    Frame next() {
+        int index = count++;
+        // A file's frames are due then, even though they can be read any time.
+        Clock::time_point ready = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(index / scenario.fps));
+        if (!scenario.file) {
+            std::this_thread::sleep_until(ready);
+        }
+        bool slow = scenario.slowEvery > 0 && index % scenario.slowEvery == scenario.slowEvery - 1;
+        sleepFor(slow ? scenario.slowDecode : scenario.decode);
+        return { index, index / scenario.fps, ready };
+    }
+
+    // Where the stream is now, as a frame index.
+    double live(Clock::time_point now) const { return seconds(now - start) * scenario.fps; }
+
+  private:
+    const Scenario& scenario;
+    Clock::time_point start;
+    int count = 0;
+};
+
+// A serial queue on its own thread: the main queue, or the old videoQueue.
+class SerialQueue {
+  public:
+    SerialQueue() : thread([this] { run(); }) {}
+    ~SerialQueue() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void async(std::function<void()> block) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            blocks.push_back(std::move(block));
+        }
+        wake.notify_one();
+    }
+
+  private:
+    void run() {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [this] { return done || !blocks.empty(); });
+            if (blocks.empty()) {
+                return;
+            }
+            std::function<void()> block = std::move(blocks.front());
+            blocks.pop_front();
+            guard.unlock();
+            block();
+            guard.lock();
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> blocks;
+    bool done = false;
+    std::thread thread;
+};
+
+// What the main thread saw.
+struct Shown {
+    std::mutex lock;
+    int frames = 0;
+    int last = -1;
+    double totalLatency = 0, maxLatency = 0;
+
+    void show(const Stream::Frame& frame) {
+        std::lock_guard<std::mutex> guard(lock);
+        // Only newer frames count as shown.
+        if (frame.index <= last) {
+            return;
+        }
+        double latency = seconds(Clock::now() - frame.ready);
+        frames++;
+        last = frame.index;
+        totalLatency += latency;
+        maxLatency = std::max(maxLatency, latency);
+    }
+};
+
+struct Result {
+    int decoded = 0, shown = 0, dropped = 0;
+    double averageLatencyMS = 0, maxLatencyMS = 0, lagMS = 0;
+};
+
+// Keeps the main thread busy for 40 ms once a second.
+static void busyMainThread(SerialQueue& main, std::atomic<bool>& running)
+{
+    while (running) {
+        sleepFor(1.0);
+        main.async([] { sleepFor(0.040); });
+    }
+}
+
+static Result finish(Shown& shown, int decoded, const Stream& stream, const Scenario& scenario)
+{
+    Result result;
+    std::lock_guard<std::mutex> guard(shown.lock);
+    result.decoded = decoded;
+    result.shown = shown.frames;
+    result.dropped = decoded - shown.frames;
+    result.averageLatencyMS = shown.frames ? shown.totalLatency / shown.frames * 1e3 : 0;
+    result.maxLatencyMS = shown.maxLatency * 1e3;
+    double edge = stream.live(Clock::now());
+    result.lagMS = std::max(0.0, edge - 1 - shown.last) / scenario.fps * 1e3;
+    return result;
+}
+
+// MARK: - The old way
+
+static Result timerDriven(const Scenario& scenario, double duration)
+{
+    Shown shown;
+    std::atomic<int> decoded(0);
+    std::atomic<bool> running(true);
+    Clock::time_point start = Clock::now();
+    Stream stream(scenario, start);
+    SerialQueue main, videoQueue;
+    std::thread busy(busyMainThread, std::ref(main), std::ref(running));
+    Clock::time_point tick = start;
+    while (Clock::now() - start < std::chrono::duration<double>(duration)) {
+        videoQueue.async([&] {
+            if (!running) {
+                return;
+            }
+            Stream::Frame frame = stream.next();
+            decoded++;
+            main.async([&shown, frame] { shown.show(frame); });
+        });
+        tick += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / 30));
+        std::this_thread::sleep_until(tick);
+    }
+    Result result = finish(shown, decoded, stream, scenario);
+    running = false;
+    busy.join();
+    return result;
+}
+
+// MARK: - The new way
+
+static Result ringDriven(const Scenario& scenario, double duration)
+{
+    Shown shown;
+    std::atomic<int> decoded(0);
+    std::atomic<bool> running(true);
+    Clock::time_point start = Clock::now();
+    Stream stream(scenario, start);
+    framering::Ring<Stream::Frame> frames;
+    std::atomic<bool> displayScheduled(false);
+    Result result;
+    {
+        SerialQueue main;
+        std::thread busy(busyMainThread, std::ref(main), std::ref(running));
+        std::thread decoder([&] {
+            framering::Pacer pacer;
+            while (running) {
+                Stream::Frame frame = stream.next();
+                std::this_thread::sleep_for(pacer.delay(frame.pts));
+                decoded++;
+                frames.push(frame.pts, frame);
+                if (!displayScheduled.exchange(true)) {
+                    main.async([&] {
+                        displayScheduled = false;
+                        Stream::Frame newest;
+                        if (frames.takeNewest(newest)) {
+                            shown.show(newest);
+                        }
+                    });
+                }
+            }
+        });
+        sleepFor(duration);
+        result = finish(shown, decoded, stream, scenario);
+        framering::Stats stats = frames.stats();
+        // The ring's own count, which is what RTSPViewController reports.
+        result.dropped = (int)stats.dropped;
+        running = false;
+        decoder.join();
+        busy.join();
+    }
+    return result;
+}
+
+// MARK: - Main
+
+int main(int argc, char *argv[])
+{
+    double duration = argc > 1 ? atof(argv[1]) : 3;
+    if (duration <= 0) {
+        fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+    const Scenario scenarios[] = {
+        { "30 fps camera", 30, false, 0.010, 0.010, 0 },
+        { "30 fps, slow frames", 30, false, 0.010, 0.120, 30 },
+        { "60 fps camera", 60, false, 0.008, 0.008, 0 },
+        { "25 fps camera", 25, false, 0.010, 0.010, 0 },
+        { "30 fps file", 30, true, 0.005, 0.005, 0 },
+    };
+    printf("%-20s %-6s %8s %8s %8s %10s %10s %9s\n", "stream", "way", "decoded", "shown", "dropped", "avg ms", "max ms", "lag ms");
+    for (const Scenario& scenario : scenarios) {
+        Result results[] = { timerDriven(scenario, duration), ringDriven(scenario, duration) };
+        const char *ways[] = { "timer", "ring" };
+        for (int i = 0; i < 2; i++) {
+            const Result& r = results[i];
+            printf("%-20s %-6s %8d %8d %8d %10.1f %10.1f %9.0f\n", scenario.name, ways[i], r.decoded, r.shown, r.dropped, r.averageLatencyMS, r.maxLatencyMS, r.lagMS);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,309 @@
+//
+//  decode_scheduler_bench.cpp
+//  PTZ Scene Manager
+//
+// Sixteen live streams decoding at once, three ways: a thread per stream each decoding as
+// soon as its frame is in, which is what RTSPViewController did before; the same threads
+// taking turns through the real decodescheduler.hpp, which is what it does now; and a pool of
+// worker threads sharing the streams, each worker reading whichever stream its Cadence says
+// is due next.
+//
+// The stand-in streams are 30 fps local cameras, started a little apart, whose frames turn
+// up a few ms either side of when they're due. Reading one blocks until its frame is there,
+// like RTSPPlayer's stepFrame does, and decoding and converting it are busy loops, more for a
+// keyframe once a second. Latency is from a frame arriving to it being decoded and converted;
+// switches are the process's involuntary context switches; blocked is how long turns or
+// workers spent waiting in a read instead of decoding.
+//
+// The dead rows add as many cameras as there are turns that stop sending after half a
+// second: reading one then blocks until the run is over, like a read on an unplugged camera's TCP connection.
+// Without a lease their turns are never given back and nothing else decodes; with the
+// decoder's lease of three frames, the others carry on.
+//
+// Build: c++ -std=c++17 -O2 -Wall -pthread -I"../../PTZ Scene Manager" -o decode_scheduler_bench decode_scheduler_bench.cpp
+// Run:   ./decode_scheduler_bench [streams] [seconds]
+
+#include "decodescheduler.hpp"
+#include "framering.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+using decodescheduler::Clock;
+
+static const double FPS = 30;
+static const int KeyframeEvery = 30;
+static const double DecodeCPU = 0.0008, KeyframeCPU = 0.0025, ConvertCPU = 0.0003;
+static const double Jitter = 0.003;
+
+static double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+static Clock::duration duration(double s)
+{
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+}
+
+static void spin(double s)
+{
+    double until = framering::threadCPUSeconds() + s;
+    while (framering::threadCPUSeconds() < until) {
+    }
+}
+
+static long involuntarySwitches()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nivcsw;
+}
+
+// MARK: - Stand-in streams
+
+class Stream {
+  public:
+    Stream(Clock::time_point start, unsigned seed, bool dead = false) : start(start), rng(seed), dead(dead) {}
+
+    // When the next frame will be there to read.
+    Clock::time_point nextArrival() {
+        if (!arrivalKnown) {
+            std::uniform_real_distribution<double> jitter(-Jitter, Jitter);
+            arrival = start + duration(frame / FPS + Jitter + jitter(rng));
+            arrivalKnown = true;
+        }
+        return arrival;
+    }
+
+    // Blocks until the next frame is in, then decodes it. Returns its timestamp, and how long
+    // it waited to read it, or -1 if the stream has died and the run is over.
+    double step(Clock::duration& blocked, const std::atomic<bool>& running) {
+        if (dead && frame >= FPS / 2) {
+            while (running) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return -1;
+        }
+        Clock::time_point ready = nextArrival();
+        Clock::time_point before = Clock::now();
+        std::this_thread::sleep_until(ready);
+        blocked = std::max(Clock::now() - before, Clock::duration::zero());
+        spin(frame % KeyframeEvery == 0 ? KeyframeCPU : DecodeCPU);
+        lastArrival = ready;
+        arrivalKnown = false;
+        return frame++ / FPS;
+    }
+
+    Clock::time_point lastArrival;
+
+  private:
+    Clock::time_point start;
+    std::mt19937 rng;
+    bool dead;
+    long frame = 0;
+    bool arrivalKnown = false;
+    Clock::time_point arrival;
+};
+
+struct Totals {
+    std::mutex lock;
+    long frames = 0;
+    double totalLatency = 0;
+    std::vector<double> latencies;
+    Clock::duration blocked = Clock::duration::zero();
+
+    void decoded(const Stream& stream, Clock::duration wasBlocked) {
+        double latency = seconds(Clock::now() - stream.lastArrival);
+        std::lock_guard<std::mutex> guard(lock);
+        frames++;
+        totalLatency += latency;
+        latencies.push_back(latency);
+        blocked += wasBlocked;
+    }
+};
+
+struct Result {
+    double fps = 0, averageMS = 0, p99MS = 0, maxMS = 0, blockedPercent = 0;
+    long switches = 0;
+    uint64_t expired = 0;
+};
+
+// MARK: - Ways to decode them
+
+// One thread per stream, taking turns if there's a scheduler.
+static void threadPerStream(std::vector<std::unique_ptr<Stream>>& streams, decodescheduler::Scheduler *scheduler, Clock::duration lease, std::atomic<bool>& running, Totals& totals)
+{
+    std::vector<std::thread> threads;
+    for (std::unique_ptr<Stream>& owned : streams) {
+        Stream& stream = *owned;
+        threads.emplace_back([&stream, scheduler, lease, &running, &totals] {
+            decodescheduler::Cadence cadence;
+            double lastPTS = 0;
+            while (running) {
+                decodescheduler::Scheduler::Turn turn;
+                if (scheduler != nullptr && cadence.known()) {
+                    Clock::time_point due = cadence.due(lastPTS + 1 / FPS);
+                    std::this_thread::sleep_until(due);
+                    turn = scheduler->wait(due, lease);
+                }
+                Clock::duration blocked;
+                Clock::time_point start = Clock::now();
+                double pts = stream.step(blocked, running);
+                if (pts < 0) {
+                    break;
+                }
+                lastPTS = pts;
+                cadence.stepped(lastPTS, start, Clock::now());
+                spin(ConvertCPU);
+                // Only time spent blocked while holding a turn keeps anyone else from decoding.
+                totals.decoded(stream, turn ? blocked : Clock::duration::zero());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// A pool of workers; each takes the stream that's due next, going by its Cadence, waits for
+// it to be due and reads it.
+static void workerPool(std::vector<std::unique_ptr<Stream>>& streams, size_t workers, std::atomic<bool>& running, Totals& totals)
+{
+    std::mutex lock;
+    std::vector<bool> busy(streams.size(), false);
+    std::vector<decodescheduler::Cadence> cadences(streams.size());
+    std::vector<double> lastPTS(streams.size(), 0);
+    auto due = [&](size_t i) {
+        return cadences[i].known() ? cadences[i].due(lastPTS[i] + 1 / FPS) : Clock::time_point();
+    };
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; w++) {
+        threads.emplace_back([&] {
+            while (running) {
+                size_t pick = streams.size();
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    for (size_t i = 0; i < streams.size(); i++) {
+                        if (!busy[i] && (pick == streams.size() || due(i) < due(pick))) {
+                            pick = i;
+                        }
+                    }
+                    if (pick == streams.size()) {
+                        continue;
+                    }
+                    busy[pick] = true;
+                }
+                Clock::time_point wanted = due(pick);
+                std::this_thread::sleep_until(wanted);
+                Clock::duration blocked;
+                Clock::time_point start = Clock::now();
+                double pts = streams[pick]->step(blocked, running);
+                spin(ConvertCPU);
+                totals.decoded(*streams[pick], blocked);
+                std::lock_guard<std::mutex> guard(lock);
+                cadences[pick].stepped(pts, start, Clock::now());
+                lastPTS[pick] = pts;
+                busy[pick] = false;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// MARK: - Main
+
+enum Way {
+    Threads,
+    Scheduled,
+    Pool,
+};
+
+static Result run(Way way, size_t size, Clock::duration lease, int streamCount, int deadCount, double length)
+{
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(20);
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (int i = 0; i < streamCount; i++) {
+        // Spread out across a frame, the way cameras that were started separately are.
+        streams.emplace_back(new Stream(start + duration(i / FPS / streamCount), (unsigned)i + 1));
+    }
+    // First, so they're the ones holding the turns.
+    for (int i = 0; i < deadCount; i++) {
+        streams.emplace(streams.begin(), new Stream(start, 0, true));
+    }
+    decodescheduler::Scheduler scheduler(size);
+    Totals totals;
+    std::atomic<bool> running(true);
+    long switches = involuntarySwitches();
+    std::thread decoding([&] {
+        switch (way) {
+            case Threads: threadPerStream(streams, nullptr, lease, running, totals); break;
+            case Scheduled: threadPerStream(streams, &scheduler, lease, running, totals); break;
+            case Pool: workerPool(streams, size, running, totals); break;
+        }
+    });
+    std::this_thread::sleep_for(duration(length));
+    running = false;
+    decoding.join();
+
+    Result result;
+    result.switches = involuntarySwitches() - switches;
+    std::lock_guard<std::mutex> guard(totals.lock);
+    result.fps = totals.frames / length;
+    result.expired = scheduler.stats().expired;
+    if (totals.frames > 0) {
+        result.averageMS = totals.totalLatency / totals.frames * 1e3;
+        std::sort(totals.latencies.begin(), totals.latencies.end());
+        result.p99MS = totals.latencies[totals.latencies.size() * 99 / 100] * 1e3;
+        result.maxMS = totals.latencies.back() * 1e3;
+    }
+    // Of the time there was to decode in: every turn or worker, all the time.
+    double capacity = length * (way == Threads ? 1 : (double)size);
+    result.blockedPercent = way == Threads ? 0 : seconds(totals.blocked) / capacity * 100;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int streams = argc > 1 ? atoi(argv[1]) : 16;
+    double length = argc > 2 ? atof(argv[2]) : 5;
+    if (streams <= 0 || length <= 0) {
+        fprintf(stderr, "usage: %s [streams] [seconds]\n", argv[0]);
+        return 1;
+    }
+    size_t cores = decodescheduler::Scheduler::defaultSlots();
+    printf("%d streams at 30 fps for %.0f s, %zu cores; the app's scheduler has %zu turns\n", streams, length, cores, cores);
+    printf("%-26s %9s %9s %9s %9s %10s %10s %8s\n", "way", "fps", "avg ms", "p99 ms", "max ms", "blocked %", "switches", "expired");
+    const Clock::duration forever = Clock::duration::max(), lease = duration(3 / FPS);
+    struct {
+        const char *name;
+        Way way;
+        size_t size;
+        Clock::duration lease;
+        int dead;
+    } ways[] = {
+        { "thread per stream", Threads, 0, forever, 0 },
+        { "scheduled, cores", Scheduled, cores, lease, 0 },
+        { "scheduled, 2 x cores", Scheduled, cores * 2, lease, 0 },
+        { "worker pool, cores", Pool, cores, forever, 0 },
+        { "worker pool, 4 x cores", Pool, cores * 4, forever, 0 },
+        { "scheduled, dead, no lease", Scheduled, cores, forever, (int)cores },
+        { "scheduled, dead", Scheduled, cores, lease, (int)cores },
+    };
+    for (const auto& w : ways) {
+        Result r = run(w.way, w.size, w.lease, streams, w.dead, length);
+        printf("%-26s %9.1f %9.2f %9.2f %9.2f %10.1f %10ld %8llu\n", w.name, r.fps, r.averageMS, r.p99MS, r.maxMS, r.blockedPercent, r.switches,
+               (unsigned long long)r.expired);
+    }
+    return 0;
+}
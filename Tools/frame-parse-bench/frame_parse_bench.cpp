@@ -0,0 +1,338 @@
+//
+//  frame_parse_bench.cpp
+//  PTZ Scene Manager
+//
+// WebSocket receive and frame parsing for screenshot-sized messages: easywsclient's rxbuf cursor
+// path against the erase-from-the-front path it replaced.
+//
+// The stream mixes multi-MB text frames, multi-MB binary messages split into continuation frames,
+// masked versions of both, and small event-sized frames in between. It's written into a socket
+// pair a chunk at a time, and after every chunk the receiver polls and dispatches, so a big frame
+// turns up over thousands of small recvs the way a GetSourceScreenshot reply does.
+//
+// The new path is the app's own _RealWebSocket, reached by building easywsclient.cpp into this
+// file. The old one is the poll() receive loop and _dispatchBinary as they were before the cursor:
+// recv 1500 bytes at a time onto the end of rxbuf, unmask a byte at a time, copy each payload into
+// receivedData, and erase each consumed frame from the front of rxbuf. Each message is copied out
+// once in the dispatch callback, as PSMOBSWebSocketController does, and checked byte for byte
+// against what was sent once the timing's done.
+//
+// Build: S="../../PTZ Scene Manager"
+//        c++ -std=c++17 -O2 -Wall -I"$S" -o frame_parse_bench frame_parse_bench.cpp
+// Run:   ./frame_parse_bench [MB per big message]
+
+// _RealWebSocket lives in easywsclient.cpp's private namespace.
+#include "easywsclient.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// MARK: - Old receive path
+
+class OldReceiver {
+  public:
+    explicit OldReceiver(int sockfd) : sockfd(sockfd), isRxBad(false) { }
+
+    // The receive half of poll(0).
+    bool poll() {
+        while (true) {
+            int N = (int)rxbuf.size();
+            ssize_t ret;
+            rxbuf.resize(N + 1500);
+            ret = recv(sockfd, (char*)&rxbuf[0] + N, 1500, 0);
+            if (ret < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+                rxbuf.resize(N);
+                return true;
+            }
+            else if (ret <= 0) {
+                rxbuf.resize(N);
+                return false;
+            }
+            else {
+                rxbuf.resize(N + ret);
+            }
+        }
+    }
+
+    // _dispatchBinary, for the data frames this bench sends.
+    template<class Callable>
+    bool dispatch(Callable callable) {
+        if (isRxBad) {
+            return false;
+        }
+        while (true) {
+            if (rxbuf.size() < 2) { return true; }
+            const uint8_t * data = (uint8_t *) &rxbuf[0];
+            bool fin = (data[0] & 0x80) == 0x80;
+            int opcode = data[0] & 0x0f;
+            bool mask = (data[1] & 0x80) == 0x80;
+            int N0 = (data[1] & 0x7f);
+            size_t header_size = 2 + (N0 == 126? 2 : 0) + (N0 == 127? 8 : 0) + (mask? 4 : 0);
+            if (rxbuf.size() < header_size) { return true; }
+            int i = 0;
+            uint64_t N = 0;
+            if (N0 < 126) {
+                N = N0;
+                i = 2;
+            }
+            else if (N0 == 126) {
+                N = ((uint64_t) data[2] << 8) | data[3];
+                i = 4;
+            }
+            else {
+                for (i = 2; i < 10; i++) { N = (N << 8) | data[i]; }
+            }
+            uint8_t masking_key[4] = { 0, 0, 0, 0 };
+            if (mask) { memcpy(masking_key, data + i, 4); }
+            if (rxbuf.size() < header_size+N) { return true; }
+            if (opcode > 2) {
+                isRxBad = true;
+                return false;
+            }
+            if (mask) { for (size_t i = 0; i != N; ++i) { rxbuf[i+header_size] ^= masking_key[i&0x3]; } }
+            receivedData.insert(receivedData.end(), rxbuf.begin()+header_size, rxbuf.begin()+header_size+(size_t)N);
+            if (fin) {
+                callable((const std::vector<uint8_t>) receivedData);
+                receivedData.erase(receivedData.begin(), receivedData.end());
+                std::vector<uint8_t> ().swap(receivedData);
+            }
+            rxbuf.erase(rxbuf.begin(), rxbuf.begin() + header_size+(size_t)N);
+        }
+    }
+
+  private:
+    int sockfd;
+    bool isRxBad;
+    Bytes rxbuf;
+    Bytes receivedData;
+};
+
+// MARK: - Stream
+
+static void appendFrame(Bytes& stream, int opcode, bool fin, const uint8_t *payload, size_t length, std::mt19937& rng, bool masked)
+{
+    stream.push_back((uint8_t)((fin ? 0x80 : 0) | opcode));
+    uint8_t maskBit = masked ? 0x80 : 0;
+    if (length < 126) {
+        stream.push_back((uint8_t)(maskBit | length));
+    } else if (length < 65536) {
+        stream.push_back((uint8_t)(maskBit | 126));
+        stream.push_back((uint8_t)(length >> 8));
+        stream.push_back((uint8_t)length);
+    } else {
+        stream.push_back((uint8_t)(maskBit | 127));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            stream.push_back((uint8_t)((uint64_t)length >> shift));
+        }
+    }
+    size_t start = stream.size();
+    uint8_t key[4] = { 0, 0, 0, 0 };
+    if (masked) {
+        for (uint8_t& byte : key) {
+            byte = (uint8_t)rng();
+        }
+        stream.insert(stream.end(), key, key + 4);
+        start += 4;
+    }
+    stream.insert(stream.end(), payload, payload + length);
+    if (masked) {
+        for (size_t i = 0; i < length; i++) {
+            stream[start + i] ^= key[i & 3];
+        }
+    }
+}
+
+// A message as one frame, or split into fragments of fragmentSize.
+static void appendMessage(Bytes& stream, int opcode, const Bytes& payload, size_t fragmentSize, std::mt19937& rng, bool masked)
+{
+    if (fragmentSize == 0 || payload.size() <= fragmentSize) {
+        appendFrame(stream, opcode, true, payload.data(), payload.size(), rng, masked);
+        return;
+    }
+    for (size_t offset = 0; offset < payload.size(); offset += fragmentSize) {
+        size_t length = std::min(fragmentSize, payload.size() - offset);
+        appendFrame(stream, offset == 0 ? opcode : 0, offset + length == payload.size(), payload.data() + offset, length, rng, masked);
+    }
+}
+
+static Bytes base64Text(size_t length, std::mt19937& rng)
+{
+    static const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    Bytes text(length);
+    for (uint8_t& c : text) {
+        c = (uint8_t)chars[rng() & 63];
+    }
+    return text;
+}
+
+static Bytes randomBytes(size_t length, std::mt19937& rng)
+{
+    Bytes bytes(length);
+    for (uint8_t& b : bytes) {
+        b = (uint8_t)rng();
+    }
+    return bytes;
+}
+
+// MARK: - Feeding
+
+struct Run {
+    double seconds = 0;
+    std::vector<Bytes> messages;
+    bool failed = false;
+};
+
+// Writes the stream in chunks, letting the receiver read and dispatch after each one.
+template<class Receive>
+static Run feed(const Bytes& stream, size_t chunk, Receive receive)
+{
+    Run run;
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        perror("socketpair");
+        run.failed = true;
+        return run;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    double start = now();
+    size_t offset = 0;
+    while (offset < stream.size() && !run.failed) {
+        size_t end = std::min(offset + chunk, stream.size());
+        while (offset < end) {
+            ssize_t written = write(fds[1], stream.data() + offset, end - offset);
+            if (written > 0) {
+                offset += (size_t)written;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("write");
+                run.failed = true;
+                break;
+            } else if (!receive(fds[0], run.messages)) {
+                run.failed = true;
+                break;
+            }
+        }
+        run.failed = run.failed || !receive(fds[0], run.messages);
+    }
+    run.seconds = now() - start;
+    close(fds[0]);
+    close(fds[1]);
+    return run;
+}
+
+static Run feedOld(const Bytes& stream, size_t chunk)
+{
+    OldReceiver *receiver = nullptr;
+    Run run = feed(stream, chunk, [&receiver](int fd, std::vector<Bytes>& messages) {
+        if (!receiver) {
+            receiver = new OldReceiver(fd);
+        }
+        return receiver->poll() && receiver->dispatch([&messages](const Bytes& message) {
+            messages.push_back(message);
+        });
+    });
+    delete receiver;
+    return run;
+}
+
+static Run feedNew(const Bytes& stream, size_t chunk)
+{
+    _RealWebSocket *ws = nullptr;
+    Run run = feed(stream, chunk, [&ws](int fd, std::vector<Bytes>& messages) {
+        if (!ws) {
+            ws = new _RealWebSocket(fd, true, "");
+        }
+        ws->poll(0);
+        ws->dispatchView([&messages](const uint8_t *bytes, size_t length) {
+            messages.emplace_back(bytes, bytes + length);
+        });
+        return ws->getReadyState() == easywsclient::WebSocket::OPEN;
+    });
+    delete ws;
+    return run;
+}
+
+static size_t mismatches(const Run& run, const std::vector<Bytes>& expected)
+{
+    size_t bad = run.messages.size() > expected.size() ? run.messages.size() - expected.size() : 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        bad += i >= run.messages.size() || run.messages[i] != expected[i];
+    }
+    return bad;
+}
+
+// MARK: - Main
+
+int main(int argc, char *argv[])
+{
+    int megabytes = argc > 1 ? atoi(argv[1]) : 4;
+    if (megabytes <= 0) {
+        fprintf(stderr, "usage: %s [MB per big message]\n", argv[0]);
+        return 1;
+    }
+    size_t bigSize = (size_t)megabytes * 1024 * 1024;
+
+    // An OBS event between each big message, like the scene and source events that arrive
+    // while a screenshot is on its way.
+    std::mt19937 rng(11);
+    Bytes stream;
+    std::vector<Bytes> expected;
+    struct Big { int opcode; size_t fragmentSize; bool masked; };
+    const Big bigs[] = {
+        { 1, 0, false },            // one text frame
+        { 1, 0, true },             // one masked text frame
+        { 2, 4096, false },         // binary, 4 KB continuation frames
+        { 2, 4096, true },          // masked binary, 4 KB continuation frames
+        { 1, 1000, false },         // text, continuation frames smaller than a recv
+        { 1, 65536 + 7, true },     // masked text, continuation frames with 64-bit lengths
+    };
+    for (const Big& big : bigs) {
+        Bytes event = base64Text(200 + rng() % 200, rng);
+        appendMessage(stream, 1, event, 0, rng, false);
+        expected.push_back(event);
+        Bytes payload = big.opcode == 1 ? base64Text(bigSize + rng() % 4096, rng) : randomBytes(bigSize + rng() % 4096, rng);
+        appendMessage(stream, big.opcode, payload, big.fragmentSize, rng, big.masked);
+        expected.push_back(payload);
+    }
+
+    printf("%zu messages, %.1f MB of frames\n", expected.size(), stream.size() / 1048576.0);
+    printf("%-10s %12s %12s %8s  %s\n", "chunk", "erase ms", "cursor ms", "speedup", "checks");
+    bool passed = true;
+    const size_t chunks[] = { 1460, 8192, 65536 };
+    for (size_t chunk : chunks) {
+        double oldBest = 1e9, newBest = 1e9;
+        size_t oldBad = 0, newBad = 0;
+        bool failed = false;
+        for (int repeat = 0; repeat < 3; repeat++) {
+            Run oldRun = feedOld(stream, chunk);
+            Run newRun = feedNew(stream, chunk);
+            oldBest = std::min(oldBest, oldRun.seconds);
+            newBest = std::min(newBest, newRun.seconds);
+            oldBad += mismatches(oldRun, expected);
+            newBad += mismatches(newRun, expected);
+            failed = failed || oldRun.failed || newRun.failed;
+        }
+        std::string checks = "ok";
+        if (failed) {
+            checks = "receive failed";
+        } else if (oldBad || newBad) {
+            checks = std::to_string(oldBad) + " erase, " + std::to_string(newBad) + " cursor messages didn't match";
+        }
+        passed = passed && checks == "ok";
+        printf("%-10zu %12.1f %12.1f %7.1fx  %s\n", chunk, oldBest * 1000, newBest * 1000, oldBest / newBest, checks.c_str());
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+//
+//  frame_pool_bench.cpp
+//  PTZ Scene Manager
+//
+// What making images costs RTSPViewController's decoder threads: converting every decoded
+// frame, converting only when the view has taken the last one, and the decoder's way, which
+// also converts once the one waiting is a frame late. And how often a window resize rebuilds
+// the scaler.
+//
+// Conversions: a handful of cameras, each with its own decoder thread, feed one main thread
+// through the real framering::Ring. Converting a frame is a real bilinear scale from 720p
+// into a newly allocated buffer, standing in for RTSPPlayer's sws_scale and NSImage; each
+// one is an allocation. The main thread takes a while to draw each frame, either a little or
+// a lot, as with a window full of cameras, and is busy for longer every so often. CPU is the
+// decoder threads' own time spent converting; age is from when a frame was due to when it
+// was shown.
+//
+// Resizing: a window is dragged from 640x360 to 1280x720 over two seconds, then snapped
+// smaller. The old way set the player's output size to the view's on every frame, and each
+// of width and height that changed meant a new scaler. The new way is framering::OutputSize.
+// Building a scaler is the stand-in's filter tables.
+//
+// Build: c++ -std=c++17 -O2 -Wall -pthread -I"../../PTZ Scene Manager" -o frame_pool_bench frame_pool_bench.cpp
+// Run:   ./frame_pool_bench [cameras] [seconds]
+
+#include "framering.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using framering::Clock;
+
+static const int SourceWidth = 1280, SourceHeight = 720;
+
+static double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+static void sleepFor(double s)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double>(s));
+}
+
+// MARK: - Stand-in scaler
+
+// Bilinear RGBA scaling with its tables worked out up front, the way an SwsContext is.
+class Scaler {
+  public:
+    Scaler(int width, int height) : width(width), height(height) {
+        xs.resize((size_t)width);
+        ys.resize((size_t)height);
+        table(xs, SourceWidth, width);
+        table(ys, SourceHeight, height);
+    }
+
+    // A new buffer every time, like the image RTSPPlayer makes.
+    std::unique_ptr<uint8_t[]> scale(const uint8_t *source) const {
+        std::unique_ptr<uint8_t[]> out(new uint8_t[(size_t)width * height * 4]);
+        for (int y = 0; y < height; y++) {
+            const Tap& ty = ys[(size_t)y];
+            const uint8_t *row0 = source + (size_t)ty.index * SourceWidth * 4;
+            const uint8_t *row1 = row0 + (ty.index + 1 < SourceHeight ? SourceWidth * 4 : 0);
+            uint8_t *dst = out.get() + (size_t)y * width * 4;
+            for (int x = 0; x < width; x++) {
+                const Tap& tx = xs[(size_t)x];
+                int next = tx.index + 1 < SourceWidth ? 4 : 0;
+                for (int c = 0; c < 4; c++) {
+                    int i = tx.index * 4 + c;
+                    int top = row0[i] * (256 - tx.weight) + row0[i + next] * tx.weight;
+                    int bottom = row1[i] * (256 - tx.weight) + row1[i + next] * tx.weight;
+                    dst[x * 4 + c] = (uint8_t)((top * (256 - ty.weight) + bottom * ty.weight) >> 16);
+                }
+            }
+        }
+        return out;
+    }
+
+  private:
+    struct Tap {
+        int index;
+        int weight;
+    };
+
+    static void table(std::vector<Tap>& taps, int from, int to) {
+        for (size_t i = 0; i < taps.size(); i++) {
+            double at = (i + 0.5) * from / to - 0.5;
+            double floored = std::floor(std::max(at, 0.0));
+            taps[i] = { (int)floored, (int)((std::max(at, 0.0) - floored) * 256) };
+        }
+    }
+
+    int width, height;
+    std::vector<Tap> xs, ys;
+};
+
+// MARK: - Conversions
+
+// The main queue, on its own thread.
+class MainQueue {
+  public:
+    MainQueue() : thread([this] { run(); }) {}
+    ~MainQueue() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void async(std::function<void()> block) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            blocks.push_back(std::move(block));
+        }
+        wake.notify_one();
+    }
+
+  private:
+    void run() {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [this] { return done || !blocks.empty(); });
+            if (blocks.empty()) {
+                return;
+            }
+            std::function<void()> block = std::move(blocks.front());
+            blocks.pop_front();
+            guard.unlock();
+            block();
+            guard.lock();
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> blocks;
+    bool done = false;
+    std::thread thread;
+};
+
+struct Camera {
+    framering::Ring<std::shared_ptr<uint8_t>> frames;
+    std::atomic<bool> displayScheduled { false };
+    std::atomic<uint64_t> allocations { 0 };
+    std::atomic<double> convertCPU { 0 };
+    // Main thread: from when each frame shown was due to when it was shown.
+    std::atomic<double> age { 0 };
+};
+
+struct Totals {
+    uint64_t decoded = 0, allocations = 0, shown = 0;
+    double convertCPU = 0, age = 0;
+};
+
+// A frame is converted if the display has taken the last one, or if the last one has waited
+// maxWait frames; 0 converts them all.
+static Totals convert(double maxWait, double draw, int cameraCount, double duration)
+{
+    std::vector<uint8_t> source((size_t)SourceWidth * SourceHeight * 4);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = (uint8_t)(i * 7 + i / 4093);
+    }
+    const Scaler scaler(480, 270);
+    std::vector<std::unique_ptr<Camera>> cameras;
+    for (int i = 0; i < cameraCount; i++) {
+        cameras.emplace_back(new Camera());
+    }
+    Clock::duration wait = std::isinf(maxWait) ? Clock::duration::max() : std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(maxWait / 30));
+    std::atomic<bool> running(true);
+    {
+        MainQueue main;
+        std::vector<std::thread> threads;
+        // The rest of the app: busy for 40 ms twice a second.
+        threads.emplace_back([&] {
+            while (running) {
+                sleepFor(0.5);
+                main.async([] { sleepFor(0.040); });
+            }
+        });
+        for (int i = 0; i < cameraCount; i++) {
+            Camera& camera = *cameras[(size_t)i];
+            threads.emplace_back([&, i] {
+                Clock::time_point next = Clock::now() + std::chrono::milliseconds(i * 4);
+                while (running) {
+                    // A frame every 1/30 s, and a little decoding.
+                    std::this_thread::sleep_until(next);
+                    double due = seconds(next.time_since_epoch());
+                    next += std::chrono::microseconds(33333);
+                    sleepFor(0.002);
+                    if (!camera.frames.needsFrame(wait)) {
+                        camera.frames.skip();
+                        continue;
+                    }
+                    double cpu = framering::threadCPUSeconds();
+                    std::shared_ptr<uint8_t> image(scaler.scale(source.data()).release(), std::default_delete<uint8_t[]>());
+                    camera.convertCPU = camera.convertCPU + (framering::threadCPUSeconds() - cpu);
+                    camera.allocations++;
+                    camera.frames.push(due, std::move(image));
+                    if (!camera.displayScheduled.exchange(true)) {
+                        main.async([&camera, draw] {
+                            camera.displayScheduled = false;
+                            std::shared_ptr<uint8_t> newest;
+                            double pts;
+                            if (camera.frames.takeNewest(newest, &pts)) {
+                                camera.age = camera.age + (seconds(Clock::now().time_since_epoch()) - pts);
+                                sleepFor(draw);
+                            }
+                        });
+                    }
+                }
+            });
+        }
+        sleepFor(duration);
+        running = false;
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    Totals totals;
+    for (const std::unique_ptr<Camera>& camera : cameras) {
+        framering::Stats stats = camera->frames.stats();
+        totals.decoded += stats.decoded;
+        totals.shown += stats.displayed;
+        totals.allocations += camera->allocations;
+        totals.convertCPU += camera->convertCPU;
+        totals.age += camera->age;
+    }
+    return totals;
+}
+
+// MARK: - Resizing
+
+struct ResizeResult {
+    int rebuilds = 0;
+    double rebuildMS = 0;
+    int lastWidth = 0, lastHeight = 0;
+};
+
+// Frames at 30 fps while the view changes size: a live resize from 640x360 to 1280x720 over
+// two seconds, a second to settle, then snapped to 900x506 (a split view collapsing), which
+// isn't live.
+static ResizeResult resize(bool useOutputSize)
+{
+    ResizeResult result;
+    framering::OutputSize outputSize;
+    int playerWidth = 0, playerHeight = 0;
+    auto rebuild = [&] {
+        double start = seconds(Clock::now().time_since_epoch());
+        Scaler scaler(playerWidth, playerHeight);
+        result.rebuildMS += (seconds(Clock::now().time_since_epoch()) - start) * 1e3;
+        result.rebuilds++;
+    };
+    for (int frame = 0; frame < 150; frame++) {
+        double t = frame / 30.0;
+        int viewWidth, viewHeight;
+        bool live = t < 2;
+        if (t < 2) {
+            viewWidth = 640 + (int)(640 * t / 2);
+            viewHeight = viewWidth * 9 / 16;
+        } else if (t < 3) {
+            viewWidth = 1280;
+            viewHeight = 720;
+        } else {
+            viewWidth = 900;
+            viewHeight = 506;
+        }
+        if (frame == 60) {
+            // viewDidEndLiveResize.
+            live = false;
+        }
+        int width = viewWidth, height = viewHeight;
+        if (useOutputSize) {
+            outputSize.update(viewWidth, viewHeight, live);
+            width = outputSize.width();
+            height = outputSize.height();
+        }
+        // RTSPPlayer's setters: a new scaler for each one that changes.
+        if (width != playerWidth) {
+            playerWidth = width;
+            rebuild();
+        }
+        if (height != playerHeight) {
+            playerHeight = height;
+            rebuild();
+        }
+    }
+    result.lastWidth = playerWidth;
+    result.lastHeight = playerHeight;
+    return result;
+}
+
+// MARK: - Main
+
+int main(int argc, char *argv[])
+{
+    int cameras = argc > 1 ? atoi(argv[1]) : 8;
+    double duration = argc > 2 ? atof(argv[2]) : 3;
+    if (cameras <= 0 || duration <= 0) {
+        fprintf(stderr, "usage: %s [cameras] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d cameras at 30 fps for %.0f s, 720p scaled to 480x270\n", cameras, duration);
+    printf("%-8s %-12s %8s %8s %12s %12s %14s %12s\n", "draw ms", "convert", "decoded", "shown", "allocations", "allocs/shown", "CPU ms/shown", "age ms");
+    const char *names[] = { "every frame", "when taken", "a frame late" };
+    const double maxWaits[] = { 0, HUGE_VAL, 1.5 };
+    for (double draw : { 0.0005, 0.008 }) {
+        for (int i = 0; i < 3; i++) {
+            Totals t = convert(maxWaits[i], draw, cameras, duration);
+            printf("%-8.1f %-12s %8llu %8llu %12llu %12.2f %14.2f %12.1f\n", draw * 1e3, names[i], (unsigned long long)t.decoded, (unsigned long long)t.shown,
+                   (unsigned long long)t.allocations, t.shown ? (double)t.allocations / t.shown : 0, t.shown ? t.convertCPU * 1e3 / t.shown : 0,
+                   t.shown ? t.age * 1e3 / t.shown : 0);
+        }
+    }
+
+    printf("\nresizing, 150 frames\n");
+    printf("%-16s %10s %12s %12s\n", "output size", "rebuilds", "rebuild ms", "ends at");
+    const char *sizes[] = { "view's", "OutputSize" };
+    for (int i = 0; i < 2; i++) {
+        ResizeResult r = resize(i == 1);
+        printf("%-16s %10d %12.2f %7dx%d\n", sizes[i], r.rebuilds, r.rebuildMS, r.lastWidth, r.lastHeight);
+    }
+    return 0;
+}
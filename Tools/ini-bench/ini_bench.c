@@ -0,0 +1,342 @@
+//
+//  ini_bench.c
+//  PTZ Scene Manager
+//
+// Times the iniparser dictionary against synthetic PTZOptics settings.ini files:
+// [General] gets a mem<scene><ip> name for every scene of every camera, the same keys
+// PTZSettingsFile nameForScene:camera: looks up.
+//
+// Build: S="../../PTZ Scene Manager/iniparser"
+//        cc -O2 -Wall -I"$S" -o ini_bench ini_bench.c "$S/iniparser.c" "$S/dictionary.c"
+// Run:   ./ini_bench [keys] [lookup passes]      defaults: 50000 keys, 10 passes
+//        ./ini_bench 200000                       a multi-megabyte file
+//
+// Load and free are also timed over repeated passes and reported as MB/s of ini text.
+// A burst of 50 scene renames is saved with iniparser_store after every rename, the way
+// setName:forScene:camera: used to, and once at the end, the way setNeedsWrite batches it.
+//
+// A PacketSender-style file, one section per packet as VISCA_ini_write_file writes it, times
+// walking every section's keys and dumping the file.
+//
+// It also checks that iniparser_dump_ini writes keys back in file order, and that
+// order survives removing and re-adding keys.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "iniparser.h"
+
+// MARK: - Helpers
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Scene s of camera c, as PTZSettingsFile fixKey: would write it.
+static void sceneKey(char *buf, size_t len, int c, int s)
+{
+    snprintf(buf, len, "general:mem%d192.168.%d.%d", s, 100 + c / 200, c % 200 + 2);
+}
+
+static int writeSettings(const char *path, int keys, int *outCameras)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    int cameras = (keys + 254) / 255;
+    fprintf(f, "[cameraslist]\nsize=%d\n", cameras);
+    for (int c = 0; c < cameras; c++) {
+        fprintf(f, "%d\\devicename=192.168.%d.%d\n", c + 1, 100 + c / 200, c % 200 + 2);
+    }
+    fprintf(f, "\n[General]\n");
+    char key[64];
+    for (int i = 0; i < keys; i++) {
+        sceneKey(key, sizeof(key), i / 255, i % 255);
+        fprintf(f, "%s=Scene %d\n", key + strlen("general:"), i);
+    }
+    fclose(f);
+    *outCameras = cameras;
+    return 0;
+}
+
+// One [packet] section per scene, with the keys PacketSender writes for each packet.
+static const char *packetKeys[] = {"fromIP", "fromPort", "hexString", "name", "port", "repeat",
+    "requestPath", "sendResponse", "tcpOrUdp", "timestamp", "toIP"};
+#define PACKET_KEYS (int)(sizeof(packetKeys) / sizeof(packetKeys[0]))
+
+static int writePackets(const char *path, int packets)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    for (int i = 0; i < packets; i++) {
+        fprintf(f, "[Recall%%20%d]\n", i);
+        for (int k = 0; k < PACKET_KEYS; k++) {
+            fprintf(f, "%s=%d\n", packetKeys[k], i);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// MARK: - Checks
+
+// Every line iniparser_dump_ini writes for [General] must come out in the order it went in.
+static int checkOrder(dictionary *d, const char *path, int keys)
+{
+    FILE *f = fopen(path, "w+");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    iniparser_dump_ini(d, f);
+    rewind(f);
+    char line[256], key[64];
+    int next = 0, inGeneral = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '[') {
+            inGeneral = strncmp(line, "[general]", 9) == 0;
+            continue;
+        }
+        if (!inGeneral || line[0] == '\n') {
+            continue;
+        }
+        sceneKey(key, sizeof(key), next / 255, next % 255);
+        const char *name = key + strlen("general:");
+        if (strncmp(line, name, strlen(name)) != 0 || line[strlen(name)] != ' ') {
+            fprintf(stderr, "order: expected %s, got %s", name, line);
+            fclose(f);
+            return -1;
+        }
+        next++;
+    }
+    fclose(f);
+    if (next != keys) {
+        fprintf(stderr, "order: expected %d keys, dumped %d\n", keys, next);
+        return -1;
+    }
+    return 0;
+}
+
+// MARK: - Writes
+
+#define RENAME_BURST 50
+
+// Renames the first RENAME_BURST scenes, storing after each one or only at the end.
+// Returns bytes written, or -1 if the file doesn't read back with the new names.
+static long renameBurst(dictionary *d, const char *path, int batched, double *outTime)
+{
+    char key[64], name[64];
+    long bytes = 0, written;
+    double t = now();
+    for (int i = 0; i < RENAME_BURST; i++) {
+        sceneKey(key, sizeof(key), 0, i);
+        snprintf(name, sizeof(name), "%s %d", batched ? "Batched" : "Renamed", i);
+        iniparser_set(d, key, name);
+        if (!batched || i == RENAME_BURST - 1) {
+            if ((written = iniparser_store(d, path)) < 0) {
+                return -1;
+            }
+            bytes += written;
+        }
+    }
+    *outTime = now() - t;
+
+    dictionary *check = iniparser_load(path);
+    if (check == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < RENAME_BURST; i++) {
+        sceneKey(key, sizeof(key), 0, i);
+        snprintf(name, sizeof(name), "%s %d", batched ? "Batched" : "Renamed", i);
+        if (strcmp(iniparser_getstring(check, key, ""), name) != 0) {
+            fprintf(stderr, "store: %s is not %s\n", key, name);
+            bytes = -1;
+            break;
+        }
+    }
+    iniparser_freedict(check);
+    return bytes;
+}
+
+// MARK: - Main
+
+int main(int argc, char **argv)
+{
+    int keys = argc > 1 ? atoi(argv[1]) : 50000;
+    int passes = argc > 2 ? atoi(argv[2]) : 10;
+    const char *path = "/tmp/ini_bench_settings.ini";
+    const char *dumpPath = "/tmp/ini_bench_dump.ini";
+    int cameras;
+    char key[64];
+
+    if (writeSettings(path, keys, &cameras) != 0) {
+        return 1;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return 1;
+    }
+    double megabytes = st.st_size / (1024.0 * 1024.0);
+
+    double t = now();
+    dictionary *d = iniparser_load(path);
+    double loadTime = now() - t;
+    if (d == NULL) {
+        return 1;
+    }
+
+    // Repeated load/free, the way importing or validating a settings folder does it.
+    double reloadTime = 0, freeTime = 0;
+    for (int p = 0; p < passes; p++) {
+        t = now();
+        dictionary *again = iniparser_load(path);
+        reloadTime += now() - t;
+        if (again == NULL) {
+            return 1;
+        }
+        t = now();
+        iniparser_freedict(again);
+        freeTime += now() - t;
+    }
+
+    t = now();
+    long found = 0;
+    for (int p = 0; p < passes; p++) {
+        for (int i = 0; i < keys; i++) {
+            sceneKey(key, sizeof(key), i / 255, i % 255);
+            found += iniparser_getstring(d, key, NULL) != NULL;
+        }
+    }
+    double lookupTime = now() - t;
+    long lookups = (long)keys * passes;
+    if (found != lookups) {
+        fprintf(stderr, "lookup: found %ld of %ld\n", found, lookups);
+        return 1;
+    }
+
+    t = now();
+    long missing = 0;
+    for (int i = 0; i < keys; i++) {
+        sceneKey(key, sizeof(key), i / 255 + cameras, i % 255);
+        missing += iniparser_getstring(d, key, NULL) == NULL;
+    }
+    double missTime = now() - t;
+
+    int status = checkOrder(d, dumpPath, keys);
+
+    double eachTime, batchTime;
+    long eachBytes = renameBurst(d, dumpPath, 0, &eachTime);
+    long batchBytes = renameBurst(d, dumpPath, 1, &batchTime);
+    if (eachBytes < 0 || batchBytes < 0) {
+        status = -1;
+    }
+
+    // Remove every other scene and put them back with their old values; the dump order must not change.
+    t = now();
+    for (int i = 0; i < keys; i += 2) {
+        sceneKey(key, sizeof(key), i / 255, i % 255);
+        iniparser_unset(d, key);
+    }
+    for (int i = 0; i < keys; i += 2) {
+        sceneKey(key, sizeof(key), i / 255, i % 255);
+        if (iniparser_getstring(d, key, NULL) != NULL) {
+            fprintf(stderr, "unset: %s still present\n", key);
+            status = -1;
+        }
+    }
+    double unsetTime = now() - t;
+    // Removed keys come back at the end, so rebuild from scratch in order to check compaction.
+    dictionary *rebuilt = dictionary_new(0);
+    rebuilt->caseSensitive = d->caseSensitive;
+    iniparser_set(rebuilt, "general", NULL);
+    for (int i = 0; i < keys; i++) {
+        sceneKey(key, sizeof(key), i / 255, i % 255);
+        iniparser_set(rebuilt, key, "x");
+        if (i % 3 == 0) {
+            iniparser_unset(rebuilt, key);
+            iniparser_set(rebuilt, key, "x");
+        }
+    }
+    for (int i = 0; i < keys; i++) {
+        sceneKey(key, sizeof(key), i / 255, i % 255);
+        if (i % 3 != 0) {
+            iniparser_unset(rebuilt, key);
+        }
+    }
+    for (int i = 0; i < keys; i++) {
+        sceneKey(key, sizeof(key), i / 255, i % 255);
+        if ((iniparser_getstring(rebuilt, key, NULL) != NULL) != (i % 3 == 0)) {
+            fprintf(stderr, "rebuild: wrong presence for %s\n", key);
+            status = -1;
+            break;
+        }
+    }
+
+    // Sections: enumerate every packet's keys, the way the PacketSender import walks them.
+    int packets = keys / PACKET_KEYS;
+    double sectionTime = 0, sectionDumpTime = 0;
+    if (writePackets(path, packets) != 0) {
+        return 1;
+    }
+    dictionary *ps = iniparser_load(path);
+    if (ps == NULL) {
+        return 1;
+    }
+    const char *secKeys[PACKET_KEYS];
+    long sectionKeys = 0;
+    t = now();
+    int nsec = iniparser_getnsec(ps);
+    for (int i = 0; i < nsec; i++) {
+        const char *secname = iniparser_getsecname(ps, i);
+        int n = iniparser_getsecnkeys(ps, secname);
+        if (n != PACKET_KEYS || iniparser_getseckeys(ps, secname, secKeys) == NULL) {
+            fprintf(stderr, "sections: %s has %d keys\n", secname, n);
+            status = -1;
+            break;
+        }
+        sectionKeys += n;
+    }
+    sectionTime = now() - t;
+    if (nsec != packets) {
+        fprintf(stderr, "sections: expected %d, got %d\n", packets, nsec);
+        status = -1;
+    }
+    FILE *null = fopen("/dev/null", "w");
+    t = now();
+    iniparser_dump_ini(ps, null);
+    sectionDumpTime = now() - t;
+    fclose(null);
+    iniparser_freedict(ps);
+
+    printf("%d keys, %d cameras, %.1f MB\n", keys, cameras, megabytes);
+    printf("load:         %8.1f ms\n", loadTime * 1000);
+    printf("reload:       %8.1f ms, %.0f MB/s (%d passes)\n", reloadTime * 1000 / passes, megabytes * passes / reloadTime, passes);
+    printf("free:         %8.2f ms\n", freeTime * 1000 / passes);
+    printf("lookup hit:   %8.1f ns/lookup (%ld lookups)\n", lookupTime * 1e9 / lookups, lookups);
+    printf("lookup miss:  %8.1f ns/lookup (%ld lookups)\n", missTime * 1e9 / keys, missing);
+    printf("unset:        %8.1f ms for %d keys\n", unsetTime * 1000, (keys + 1) / 2);
+    printf("rename burst: %8.1f KB, %.1f ms writing after each of %d renames\n", eachBytes / 1024.0, eachTime * 1000, RENAME_BURST);
+    printf("              %8.1f KB, %.1f ms writing once\n", batchBytes / 1024.0, batchTime * 1000);
+    printf("sections:     %8.1f ms to walk %d sections, %ld keys\n", sectionTime * 1000, nsec, sectionKeys);
+    printf("              %8.1f ms to dump them\n", sectionDumpTime * 1000);
+    printf("dump order:   %s\n", status == 0 ? "ok" : "FAILED");
+
+    iniparser_freedict(rebuilt);
+    iniparser_freedict(d);
+    unlink(path);
+    unlink(dumpPath);
+    return status == 0 ? 0 : 1;
+}
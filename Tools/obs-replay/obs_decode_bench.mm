@@ -0,0 +1,134 @@
+//
+//  obs_decode_bench.mm
+//  PTZ Scene Manager
+//
+// Main-thread time per OBS message, before and after decoding moved to the socket thread.
+//
+// Before: recvString copied each message into NSData on the main thread, ran
+// NSJSONSerialization on it, and handleJSON: dug through the dictionaries; screenshots were
+// split with componentsSeparatedByString: and base64-decoded there too.
+// After: PSMOBSMessage decodes on the socket thread, and the main thread only reads the
+// typed fields. Both sides read the same fields the handlers do.
+//
+// Build: S="../../PTZ Scene Manager"
+//        clang++ -std=c++17 -O2 -fobjc-arc -framework Foundation -I"$S" -o obs_decode_bench obs_decode_bench.mm "$S/PSMOBSMessage.mm" "$S/obsmessage.cpp" "$S/obsbase64.cpp"
+// Run:   ./obs_stream write session.jsonl && ./obs_decode_bench session.jsonl
+
+#import <Foundation/Foundation.h>
+#import "PSMOBSMessage.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+static double now(void)
+{
+    return [NSDate timeIntervalSinceReferenceDate];
+}
+
+// What handleJSON: and its handlers read from a message.
+static NSUInteger consumeDictionary(NSDictionary *dict)
+{
+    NSUInteger touched = [dict[@"op"] integerValue];
+    NSDictionary *d = dict[@"d"];
+    for (NSDictionary *result in d[@"results"]) {
+        touched += consumeDictionary(@{@"op": @7, @"d": result});
+    }
+    touched += [d[@"requestType"] length] + [d[@"eventType"] length] + [d[@"eventIntent"] integerValue];
+    NSDictionary *data = d[@"responseData"] ?: d[@"eventData"];
+    if (![data isKindOfClass:[NSDictionary class]]) {
+        return touched;
+    }
+    touched += [data[@"sceneName"] length] + [data[@"baseWidth"] floatValue];
+    for (NSDictionary *input in data[@"inputs"]) {
+        touched += [input[@"inputName"] length];
+    }
+    for (NSDictionary *item in data[@"sceneItems"]) {
+        NSDictionary *xform = item[@"sceneItemTransform"];
+        touched += [item[@"sourceName"] length] + [item[@"sceneItemEnabled"] boolValue];
+        touched += [xform[@"width"] floatValue] + [xform[@"height"] floatValue] + [xform[@"positionX"] floatValue]
+                 + [xform[@"positionY"] floatValue] + [xform[@"cropLeft"] floatValue] + [xform[@"alignment"] intValue]
+                 + [xform[@"boundsType"] length];
+    }
+    NSString *imageJsonData = data[@"imageData"];
+    if (imageJsonData) {
+        NSArray *parts = [imageJsonData componentsSeparatedByString:@","];
+        NSData *image = [[NSData alloc] initWithBase64EncodedString:[parts lastObject] options:NSDataBase64DecodingIgnoreUnknownCharacters];
+        touched += [image length];
+    }
+    return touched;
+}
+
+static NSUInteger consumeMessage(PSMOBSMessage *message)
+{
+    NSUInteger touched = message.op;
+    for (PSMOBSMessage *result in message.results) {
+        touched += consumeMessage(result);
+    }
+    touched += [message.requestType length] + [message.eventType length] + message.eventIntent;
+    touched += [message.sceneName length] + message.baseWidth;
+    for (NSString *name in message.inputNames) {
+        touched += [name length];
+    }
+    for (PSMOBSSceneItem *item in message.sceneItems) {
+        touched += [item.sourceName length] + item.sceneItemEnabled;
+        touched += item.width + item.height + item.positionX + item.positionY + item.cropLeft + item.alignment + [item.boundsType length];
+    }
+    touched += [message.imageData length];
+    return touched;
+}
+
+int main(int argc, const char **argv)
+{
+    @autoreleasepool {
+        if (argc < 2) {
+            fprintf(stderr, "usage: %s stream.jsonl [passes]\n", argv[0]);
+            return 1;
+        }
+        int passes = argc > 2 ? atoi(argv[2]) : 3;
+        std::ifstream in(argv[1], std::ios::binary);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) {
+                lines.push_back(line);
+            }
+        }
+        if (lines.empty()) {
+            fprintf(stderr, "no messages in %s\n", argv[1]);
+            return 1;
+        }
+
+        double beforeMain = 0, beforeWorst = 0, afterMain = 0, afterWorst = 0, afterSocket = 0;
+        NSUInteger beforeTouched = 0, afterTouched = 0;
+        size_t messages = 0;
+        for (int pass = 0; pass < passes; pass++) {
+            for (const std::string& s : lines) {
+                @autoreleasepool {
+                    double t = now();
+                    NSData *data = [NSData dataWithBytes:s.data() length:s.size()];
+                    id obj = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+                    beforeTouched += consumeDictionary(obj);
+                    double elapsed = now() - t;
+                    beforeMain += elapsed;
+                    beforeWorst = MAX(beforeWorst, elapsed);
+
+                    t = now();
+                    PSMOBSMessage *message = [PSMOBSMessage messageWithJSONBytes:s.data() length:s.size()];
+                    afterSocket += now() - t;
+                    t = now();
+                    afterTouched += consumeMessage(message);
+                    elapsed = now() - t;
+                    afterMain += elapsed;
+                    afterWorst = MAX(afterWorst, elapsed);
+                    messages++;
+                }
+            }
+        }
+        printf("%zu messages\n", messages);
+        printf("before: main thread %8.2f us/message, worst %8.2f us\n", beforeMain * 1e6 / messages, beforeWorst * 1e6);
+        printf("after:  main thread %8.2f us/message, worst %8.2f us\n", afterMain * 1e6 / messages, afterWorst * 1e6);
+        printf("        socket thread %6.2f us/message\n", afterSocket * 1e6 / messages);
+        // The same fields should have been seen both ways.
+        return beforeTouched == afterTouched ? 0 : 1;
+    }
+}
@@ -0,0 +1,533 @@
+//
+//  obs_standin.cpp
+//  PTZ Scene Manager
+//
+// A stand-in OBS WebSocket server that replays a stream file, and a benchmark that compares
+// the obswebsocket.json and obswebsocket.msgpack subprotocols against it.
+//
+// The server does the WebSocket handshake, picks msgpack if the client offers it and JSON
+// otherwise, then sends every message in the stream file and closes. Messages are converted
+// to MessagePack the way obs-websocket does it, by re-encoding the same JSON object, before
+// anyone connects. It ignores whatever the client sends, so pointed at the app it gets as far
+// as Hello and then replays the session regardless.
+//
+// "bench" runs the server on a background thread and connects to it twice with the app's
+// easywsclient, once for each subprotocol. It counts the bytes on the wire and times the app's
+// parser on every message.
+//
+// Build: S="../../PTZ Scene Manager"
+//        c++ -std=c++17 -O2 -Wall -pthread -I"$S" -o obs_standin obs_standin.cpp "$S/obsmessage.cpp" "$S/easywsclient.cpp"
+// Run:   ./obs_stream write session.jsonl
+//        ./obs_standin bench session.jsonl
+//        ./obs_standin serve session.jsonl [port]
+
+#include "obsmessage.hpp"
+#include "easywsclient.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// MARK: - JSON to MessagePack
+
+// Just enough JSON for the stream files; anything unexpected throws away the message.
+class Transcoder {
+  public:
+    Transcoder(const std::string& json) : p(json.data()), end(json.data() + json.size()) { }
+
+    bool run(obsmessage::MsgPackWriter& out) { return value(out) && (space(), p == end); }
+
+  private:
+    const char *p, *end;
+
+    void space() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            p++;
+        }
+    }
+
+    bool string(std::string& out) {
+        if (p == end || *p++ != '"') {
+            return false;
+        }
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                out += *p++;
+                continue;
+            }
+            if (++p == end) {
+                return false;
+            }
+            char c = *p++;
+            switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (end - p < 4) {
+                        return false;
+                    }
+                    unsigned code = (unsigned)strtoul(std::string(p, 4).c_str(), nullptr, 16);
+                    p += 4;
+                    // The stream files are ASCII apart from the odd BMP character.
+                    if (code < 0x80) {
+                        out += (char)code;
+                    } else if (code < 0x800) {
+                        out += (char)(0xC0 | (code >> 6));
+                        out += (char)(0x80 | (code & 0x3F));
+                    } else {
+                        out += (char)(0xE0 | (code >> 12));
+                        out += (char)(0x80 | ((code >> 6) & 0x3F));
+                        out += (char)(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += c; break;
+            }
+        }
+        return p++ < end;
+    }
+
+    // Containers are counted first, since MessagePack needs the count before the contents.
+    bool value(obsmessage::MsgPackWriter& out) {
+        space();
+        if (p == end) {
+            return false;
+        }
+        if (*p == '{' || *p == '[') {
+            bool isObject = *p == '{';
+            char close = isObject ? '}' : ']';
+            p++;
+            std::vector<obsmessage::MsgPackWriter> items;
+            space();
+            if (p < end && *p == close) {
+                p++;
+            } else {
+                while (true) {
+                    items.emplace_back();
+                    if (isObject) {
+                        std::string key;
+                        space();
+                        if (!string(key)) {
+                            return false;
+                        }
+                        items.back().string(key);
+                        space();
+                        if (p == end || *p++ != ':') {
+                            return false;
+                        }
+                    }
+                    if (!value(items.back())) {
+                        return false;
+                    }
+                    space();
+                    if (p < end && *p == ',') {
+                        p++;
+                        continue;
+                    }
+                    if (p < end && *p == close) {
+                        p++;
+                        break;
+                    }
+                    return false;
+                }
+            }
+            if (isObject) {
+                out.map(items.size());
+            } else {
+                out.array(items.size());
+            }
+            for (const auto& item : items) {
+                out.raw(item.data());
+            }
+            return true;
+        }
+        if (*p == '"') {
+            std::string s;
+            if (!string(s)) {
+                return false;
+            }
+            out.string(s);
+            return true;
+        }
+        if (end - p >= 4 && !memcmp(p, "true", 4)) { p += 4; out.boolean(true); return true; }
+        if (end - p >= 5 && !memcmp(p, "false", 5)) { p += 5; out.boolean(false); return true; }
+        if (end - p >= 4 && !memcmp(p, "null", 4)) { p += 4; out.nil(); return true; }
+        const char *start = p;
+        while (p < end && strchr("+-0123456789.eE", *p)) {
+            p++;
+        }
+        std::string number(start, p - start);
+        if (number.empty()) {
+            return false;
+        }
+        // nlohmann keeps integers as integers, and so does MessagePack.
+        if (number.find_first_of(".eE") == std::string::npos) {
+            out.integer(strtoll(number.c_str(), nullptr, 10));
+        } else {
+            out.real(strtod(number.c_str(), nullptr));
+        }
+        return true;
+    }
+};
+
+// MARK: - Handshake
+
+static uint32_t rol(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static std::string sha1(const std::string& message)
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string m = message;
+    uint64_t bitLength = (uint64_t)message.size() * 8;
+    m += (char)0x80;
+    while (m.size() % 64 != 56) {
+        m += (char)0;
+    }
+    for (int i = 7; i >= 0; i--) {
+        m += (char)(bitLength >> (8 * i));
+    }
+    for (size_t chunk = 0; chunk < m.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t *b = (const uint8_t *)m.data() + chunk + 4 * i;
+            w[i] = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int i = 3; i >= 0; i--) {
+            digest += (char)(word >> (8 * i));
+        }
+    }
+    return digest;
+}
+
+static std::string base64(const std::string& in)
+{
+    static const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < in.size(); i += 3) {
+        uint32_t n = (uint8_t)in[i] << 16;
+        if (i + 1 < in.size()) n |= (uint8_t)in[i + 1] << 8;
+        if (i + 2 < in.size()) n |= (uint8_t)in[i + 2];
+        out += chars[(n >> 18) & 63];
+        out += chars[(n >> 12) & 63];
+        out += i + 1 < in.size() ? chars[(n >> 6) & 63] : '=';
+        out += i + 2 < in.size() ? chars[n & 63] : '=';
+    }
+    return out;
+}
+
+static std::string headerValue(const std::string& request, const char *name)
+{
+    std::string lower = request, key = std::string("\r\n") + name + ":";
+    for (char& c : lower) c = (char)tolower((unsigned char)c);
+    for (char& c : key) c = (char)tolower((unsigned char)c);
+    size_t start = lower.find(key);
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += key.size();
+    size_t stop = request.find("\r\n", start);
+    std::string value = request.substr(start, stop - start);
+    value.erase(0, value.find_first_not_of(' '));
+    value.erase(value.find_last_not_of(' ') + 1);
+    return value;
+}
+
+static bool sendAll(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, 0);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+// MARK: - Server
+
+struct Session {
+    std::vector<std::string> json, msgpack;
+};
+
+static bool loadSession(const char *path, Session& session)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        obsmessage::MsgPackWriter writer;
+        if (!Transcoder(line).run(writer)) {
+            fprintf(stderr, "can't convert message %zu to MessagePack\n", session.json.size() + 1);
+            return false;
+        }
+        session.json.push_back(line);
+        session.msgpack.push_back(writer.data());
+    }
+    return !session.json.empty();
+}
+
+static bool sendFrame(int fd, uint8_t opcode, const std::string& payload)
+{
+    std::string header(1, (char)(0x80 | opcode));
+    size_t n = payload.size();
+    if (n < 126) {
+        header += (char)n;
+    } else if (n <= 0xFFFF) {
+        header += (char)126;
+        header += (char)(n >> 8);
+        header += (char)n;
+    } else {
+        header += (char)127;
+        for (int i = 7; i >= 0; i--) {
+            header += (char)((uint64_t)n >> (8 * i));
+        }
+    }
+    return sendAll(fd, header.data(), header.size()) && sendAll(fd, payload.data(), payload.size());
+}
+
+static void serveClient(int fd, const Session& session)
+{
+    std::string request;
+    char buf[4096];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            close(fd);
+            return;
+        }
+        request.append(buf, n);
+    }
+    std::string offered = headerValue(request, "Sec-WebSocket-Protocol");
+    std::string protocol;
+    if (offered.find("obswebsocket.msgpack") != std::string::npos) {
+        protocol = "obswebsocket.msgpack";
+    } else if (offered.find("obswebsocket.json") != std::string::npos) {
+        protocol = "obswebsocket.json";
+    }
+    std::string accept = base64(sha1(headerValue(request, "Sec-WebSocket-Key") + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + accept + "\r\n";
+    if (!protocol.empty()) {
+        response += "Sec-WebSocket-Protocol: " + protocol + "\r\n";
+    }
+    response += "\r\n";
+    bool msgpack = protocol == "obswebsocket.msgpack";
+    printf("server: client asked for '%s', using %s\n", offered.c_str(), msgpack ? "msgpack" : "json");
+    if (sendAll(fd, response.data(), response.size())) {
+        const std::vector<std::string>& messages = msgpack ? session.msgpack : session.json;
+        for (const std::string& message : messages) {
+            if (!sendFrame(fd, msgpack ? 0x2 : 0x1, message)) {
+                break;
+            }
+        }
+        sendFrame(fd, 0x8, std::string("\x03\xE8", 2));
+    }
+    // Let the client's close frame arrive before hanging up.
+    shutdown(fd, SHUT_WR);
+    while (recv(fd, buf, sizeof(buf), 0) > 0) {
+    }
+    close(fd);
+}
+
+static int listenOn(int port, int& boundPort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(fd, (sockaddr *)&addr, &length);
+    boundPort = ntohs(addr.sin_port);
+    return fd;
+}
+
+// MARK: - Client
+
+struct Result {
+    size_t messages = 0, failures = 0, payloadBytes = 0, wireBytes = 0, imageBytes = 0, sceneItems = 0;
+    double parseSeconds = 0, totalSeconds = 0;
+    std::map<std::string, std::pair<size_t, double>> byType;
+};
+
+static bool runClient(const std::string& url, const std::string& offer, Result& result)
+{
+    using easywsclient::WebSocket;
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<WebSocket> ws(WebSocket::from_url(url, std::string(), offer));
+    if (!ws) {
+        return false;
+    }
+    bool msgpack = ws->getProtocol() == "obswebsocket.msgpack";
+    while (ws->getReadyState() != WebSocket::CLOSED) {
+        ws->poll(100);
+        ws->dispatchView([&](const uint8_t *bytes, size_t length) {
+            obsmessage::Message m;
+            auto t = std::chrono::steady_clock::now();
+            bool ok = msgpack ? obsmessage::parseMsgPack((const char *)bytes, length, m)
+                              : obsmessage::parseJSON((const char *)bytes, length, m);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+            result.messages++;
+            result.failures += !ok;
+            result.payloadBytes += length;
+            result.wireBytes += length + (length < 126 ? 2 : length <= 0xFFFF ? 4 : 10);
+            result.parseSeconds += seconds;
+            result.imageBytes += m.imageDataLength;
+            result.sceneItems += m.sceneItems.size();
+            std::string type = !m.requestType.empty() ? m.requestType : !m.eventType.empty() ? "events" : "other";
+            if (!m.results.empty()) {
+                type = "batch of " + m.results[0].requestType;
+                for (const auto& r : m.results) {
+                    result.sceneItems += r.sceneItems.size();
+                }
+            }
+            auto& entry = result.byType[type];
+            entry.first += length;
+            entry.second += seconds;
+        });
+    }
+    result.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+static int bench(const char *path)
+{
+    Session session;
+    if (!loadSession(path, session)) {
+        fprintf(stderr, "can't read %s\n", path);
+        return 1;
+    }
+    int port = 0;
+    int listener = listenOn(0, port);
+    if (listener < 0) {
+        return 1;
+    }
+    std::thread server([&]() {
+        for (int i = 0; i < 2; i++) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                serveClient(fd, session);
+            }
+        }
+    });
+    std::string url = "ws://127.0.0.1:" + std::to_string(port) + "/";
+    Result json, msgpack;
+    bool ok = runClient(url, "obswebsocket.json", json) && runClient(url, "obswebsocket.msgpack", msgpack);
+    server.join();
+    close(listener);
+    if (!ok) {
+        fprintf(stderr, "couldn't connect to the stand-in server\n");
+        return 1;
+    }
+
+    printf("\n%-28s %14s %14s\n", "", "json", "msgpack");
+    printf("%-28s %14zu %14zu\n", "messages", json.messages, msgpack.messages);
+    printf("%-28s %14zu %14zu\n", "bytes on the wire", json.wireBytes, msgpack.wireBytes);
+    printf("%-28s %14zu %14zu\n", "  of which imageData", json.imageBytes, msgpack.imageBytes);
+    printf("%-28s %14.2f %14.2f\n", "parse ms, all messages", json.parseSeconds * 1e3, msgpack.parseSeconds * 1e3);
+    printf("%-28s %14.2f %14.2f\n", "receive ms, connect to close", json.totalSeconds * 1e3, msgpack.totalSeconds * 1e3);
+    for (const auto& entry : json.byType) {
+        auto other = msgpack.byType.find(entry.first);
+        if (other == msgpack.byType.end()) {
+            continue;
+        }
+        printf("%-28s %6zuB %5.1fms %6zuB %5.1fms\n", entry.first.c_str(),
+               entry.second.first, entry.second.second * 1e3, other->second.first, other->second.second * 1e3);
+    }
+    if (json.failures || msgpack.failures || json.sceneItems != msgpack.sceneItems || json.messages != msgpack.messages) {
+        printf("mismatch: %zu/%zu failures, %zu/%zu scene items\n", json.failures, msgpack.failures, json.sceneItems, msgpack.sceneItems);
+        return 1;
+    }
+    return 0;
+}
+
+static int serve(const char *path, int port)
+{
+    Session session;
+    if (!loadSession(path, session)) {
+        fprintf(stderr, "can't read %s\n", path);
+        return 1;
+    }
+    int listener = listenOn(port, port);
+    if (listener < 0) {
+        return 1;
+    }
+    printf("serving %zu messages on ws://127.0.0.1:%d/\n", session.json.size(), port);
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd >= 0) {
+            serveClient(fd, session);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && !strcmp(argv[1], "bench")) {
+        return bench(argv[2]);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "serve")) {
+        return serve(argv[2], argc > 3 ? atoi(argv[3]) : 4455);
+    }
+    fprintf(stderr, "usage: %s bench|serve stream.jsonl [port]\n", argv[0]);
+    return 1;
+}
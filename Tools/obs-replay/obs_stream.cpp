@@ -0,0 +1,234 @@
+//
+//  obs_stream.cpp
+//  PTZ Scene Manager
+//
+// Writes and replays OBS WebSocket message streams for benchmarking the message decoder.
+//
+// A stream file has one obs-websocket message per line, as received (OBS never puts a raw
+// newline inside a message). "write" generates one shaped like a session with obs-websocket
+// 5.x: the Hello/Identified handshake and the setup batch, then a few hundred rounds of
+// program/preview scene changes with their batched GetSceneItemList replies, transform events,
+// and 480-wide GetSourceScreenshot replies, with the occasional full-size screenshot.
+// "parse" times obsmessage::parseJSON over every message, which is the socket thread's share
+// of the work; obs_decode_bench.mm compares main-thread time with the old decoder on macOS.
+//
+// Build: S="../../PTZ Scene Manager"
+//        c++ -std=c++17 -O2 -Wall -I"$S" -o obs_stream obs_stream.cpp "$S/obsmessage.cpp"
+// Run:   ./obs_stream write session.jsonl [rounds]
+//        ./obs_stream parse session.jsonl [passes]
+
+#include "obsmessage.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char *base64Chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string fakeScreenshot(std::mt19937& rng, size_t jpegBytes)
+{
+    std::string s = "data:image/jpg;base64,/9j/4AAQ";
+    size_t length = (jpegBytes + 2) / 3 * 4;
+    s.reserve(s.size() + length);
+    for (size_t i = 4; i < length; i++) {
+        s += base64Chars[rng() & 63];
+    }
+    return s;
+}
+
+static std::string sceneItem(int id, int index, const std::string& name, bool enabled, double x, double y, double scale)
+{
+    char buf[1024];
+    snprintf(buf, sizeof(buf),
+             "{\"inputKind\":\"av_capture_input_v2\",\"isGroup\":null,\"sceneItemBlendMode\":\"OBS_BLEND_NORMAL\","
+             "\"sceneItemEnabled\":%s,\"sceneItemId\":%d,\"sceneItemIndex\":%d,\"sceneItemLocked\":false,"
+             "\"sceneItemTransform\":{\"alignment\":5,\"boundsAlignment\":0,\"boundsHeight\":0.0,\"boundsType\":\"OBS_BOUNDS_NONE\","
+             "\"boundsWidth\":0.0,\"cropBottom\":0,\"cropLeft\":0,\"cropRight\":0,\"cropTop\":0,\"height\":%.1f,"
+             "\"positionX\":%.1f,\"positionY\":%.1f,\"rotation\":0.0,\"scaleX\":%.4f,\"scaleY\":%.4f,"
+             "\"sourceHeight\":1080.0,\"sourceWidth\":1920.0,\"width\":%.1f},"
+             "\"sourceName\":\"%s\",\"sourceType\":\"OBS_SOURCE_TYPE_INPUT\"}",
+             enabled ? "true" : "false", id, index, 1080 * scale, x, y, scale, scale, 1920 * scale, name.c_str());
+    return buf;
+}
+
+// The "d" of a RequestResponse, which is also what a RequestBatchResponse has for each request.
+static std::string result(const std::string& type, const std::string& requestId, const std::string& data)
+{
+    return "{\"requestId\":\"" + requestId + "\",\"requestStatus\":{\"code\":100,\"result\":true},\"requestType\":\""
+        + type + "\",\"responseData\":" + data + "}";
+}
+
+static std::string response(const std::string& type, const std::string& requestId, const std::string& data)
+{
+    return "{\"d\":" + result(type, requestId, data) + ",\"op\":7}";
+}
+
+static std::string batchResponse(const std::string& requestId, const std::vector<std::string>& results)
+{
+    std::string s = "{\"d\":{\"requestId\":\"" + requestId + "\",\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        s += (i ? "," : "") + results[i];
+    }
+    return s + "]},\"op\":9}";
+}
+
+static std::string event(const std::string& type, int intent, const std::string& data)
+{
+    return "{\"d\":{\"eventData\":" + data + ",\"eventIntent\":" + std::to_string(intent) + ",\"eventType\":\"" + type + "\"},\"op\":5}";
+}
+
+static int writeStream(const char *path, int rounds)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        fprintf(stderr, "can't write %s\n", path);
+        return 1;
+    }
+    std::mt19937 rng(1234);
+    const int cameras = 6;
+    const std::string uuid = "F1B3D1A4-6C55-4C8E-9E63-4A0D0C9B0F2E";
+    std::vector<std::string> lines;
+
+    lines.push_back("{\"d\":{\"authentication\":{\"challenge\":\"+IxH4CnCiqpX1rM9scsNynZzbOe4KhDeYcTNS3PDaeY=\","
+                    "\"salt\":\"lM1GncleQOaCu9lT1yeUZhFYnqhsLLP1G5lAGo3ixaI=\"},\"obsWebSocketVersion\":\"5.4.2\",\"rpcVersion\":1},\"op\":0}");
+    lines.push_back("{\"d\":{\"negotiatedRpcVersion\":1},\"op\":2}");
+    std::string inputs = "{\"inputs\":[";
+    for (int i = 0; i < 12; i++) {
+        inputs += std::string(i ? "," : "") + "{\"inputKind\":\"av_capture_input_v2\",\"inputName\":\"" + (i < cameras ? "PTZ " : "Media ")
+            + std::to_string(i + 1) + "\",\"unversionedInputKind\":\"av_capture_input\"}";
+    }
+    const char *scenes[] = { "Wide", "Pulpit", "Choir", "Picture in Picture", "Announcements" };
+    auto sceneItems = [&]() {
+        std::string items = "{\"sceneItems\":[";
+        for (int i = 0; i < cameras; i++) {
+            double scale = i == 0 ? 1.0 : 0.25;
+            items += (i ? "," : "") + sceneItem(i + 1, i, "PTZ " + std::to_string(i + 1), (rng() & 3) != 0, i * 480.0 - 480, i ? 810 : 0, scale);
+        }
+        return items + "]}";
+    };
+
+    // The setup batch: settings, inputs, both scenes and their items in one reply.
+    lines.push_back(batchResponse("Setup", {
+        result("GetVideoSettings", uuid, "{\"baseHeight\":1080,\"baseWidth\":1920,\"fpsDenominator\":1,\"fpsNumerator\":30,\"outputHeight\":1080,\"outputWidth\":1920}"),
+        result("GetInputList", uuid, inputs + "]}"),
+        result("GetCurrentProgramScene", uuid, "{\"currentProgramSceneName\":\"Wide\",\"sceneName\":\"Wide\",\"sceneUuid\":\"" + uuid + "\"}"),
+        result("GetCurrentPreviewScene", uuid, "{\"currentPreviewSceneName\":\"Pulpit\",\"sceneName\":\"Pulpit\",\"sceneUuid\":\"" + uuid + "\"}"),
+        result("GetSceneItemList", "GetSceneItemList:currentProgramScene", sceneItems()),
+        result("GetSceneItemList", "GetSceneItemList:currentPreviewScene", sceneItems()),
+    }));
+    int screenshot = 0;
+    for (int round = 0; round < rounds; round++) {
+        std::string program = scenes[round % 5], preview = scenes[(round + 1) % 5];
+        lines.push_back(event("CurrentProgramSceneChanged", 4, "{\"sceneName\":\"" + program + "\",\"sceneUuid\":\"" + uuid + "\"}"));
+        lines.push_back(event("CurrentPreviewSceneChanged", 4, "{\"sceneName\":\"" + preview + "\",\"sceneUuid\":\"" + uuid + "\"}"));
+        // Both scene changes' GetSceneItemLists go out together.
+        lines.push_back(batchResponse("GetSceneItemList", {
+            result("GetSceneItemList", program, sceneItems()),
+            result("GetSceneItemList", preview, sceneItems()),
+        }));
+        if (round % 3 == 0) {
+            lines.push_back(event("SceneItemTransformChanged", 128, "{\"sceneItemId\":2,\"sceneItemTransform\":{\"alignment\":5,\"positionX\":0.0},\"sceneName\":\"" + program + "\",\"sceneUuid\":\"" + uuid + "\"}"));
+        }
+        // The snapshot poller and preset saves; one in twenty is a full-size frame.
+        for (int shot = 0; shot < 2; shot++, screenshot++) {
+            size_t jpegBytes = screenshot % 20 == 19 ? 240000 + rng() % 60000 : 28000 + rng() % 12000;
+            lines.push_back(response("GetSourceScreenshot", "GetSourceScreenshot-" + std::to_string(screenshot + 1),
+                                     "{\"imageData\":\"" + fakeScreenshot(rng, jpegBytes) + "\"}"));
+        }
+    }
+    lines.push_back(event("ExitStarted", 1, "null"));
+
+    size_t bytes = 0;
+    for (const std::string& line : lines) {
+        out << line << '\n';
+        bytes += line.size();
+    }
+    printf("wrote %zu messages, %.1f MB, to %s\n", lines.size(), bytes / 1e6, path);
+    return 0;
+}
+
+static bool readStream(const char *path, std::vector<std::string>& lines)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+    return true;
+}
+
+static int parseStream(const char *path, int passes)
+{
+    std::vector<std::string> lines;
+    if (!readStream(path, lines)) {
+        fprintf(stderr, "can't read %s\n", path);
+        return 1;
+    }
+    struct Stats { size_t count = 0, bytes = 0; double seconds = 0, worst = 0; };
+    std::map<std::string, Stats> byType;
+    size_t failures = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        for (const std::string& line : lines) {
+            // A copy of exactly the message, as dispatchView hands it over.
+            std::vector<char> buffer(line.begin(), line.end());
+            obsmessage::Message m;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = obsmessage::parseJSON(buffer.data(), buffer.size(), m);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (!ok) {
+                failures++;
+                continue;
+            }
+            std::string type = !m.requestType.empty() ? m.requestType : !m.eventType.empty() ? m.eventType : "op " + std::to_string(m.op);
+            if (!m.results.empty()) {
+                type = "batch of " + m.results[0].requestType;
+            }
+            Stats& stats = byType[type];
+            stats.count++;
+            stats.bytes += line.size();
+            stats.seconds += seconds;
+            if (seconds > stats.worst) {
+                stats.worst = seconds;
+            }
+        }
+    }
+    printf("%-28s %7s %10s %10s %10s %9s\n", "message", "count", "avg bytes", "avg us", "worst us", "MB/s");
+    Stats total;
+    for (const auto& entry : byType) {
+        const Stats& s = entry.second;
+        printf("%-28s %7zu %10zu %10.2f %10.2f %9.0f\n", entry.first.c_str(), s.count, s.bytes / s.count,
+               s.seconds * 1e6 / s.count, s.worst * 1e6, s.bytes / s.seconds / 1e6);
+        total.count += s.count;
+        total.bytes += s.bytes;
+        total.seconds += s.seconds;
+    }
+    printf("%-28s %7zu %10zu %10.2f %10s %9.0f\n", "all", total.count, total.bytes / total.count,
+           total.seconds * 1e6 / total.count, "", total.bytes / total.seconds / 1e6);
+    if (failures) {
+        printf("%zu messages failed to parse\n", failures);
+    }
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && !strcmp(argv[1], "write")) {
+        return writeStream(argv[2], argc > 3 ? atoi(argv[3]) : 300);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "parse")) {
+        return parseStream(argv[2], argc > 3 ? atoi(argv[3]) : 5);
+    }
+    fprintf(stderr, "usage: %s write|parse stream.jsonl [rounds|passes]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,207 @@
+//
+//  queue_bench.cpp
+//  PTZ Scene Manager
+//
+// The OBS socket thread and the main thread trade messages through a pair of queues. This
+// runs one producer thread against one consumer thread through each of:
+//
+//   mutex deque   the old non_blocking::Queue: std::deque under a std::mutex, push copies,
+//                 pop takes the lock once per element
+//   spsc pop      spsc::Queue, one pop per element
+//   spsc drain    spsc::Queue, the consumer taking everything waiting at once, as the
+//                 controller does
+//
+// with request-sized strings and with screenshot-sized ones, and with the consumer spinning
+// (the worst case for contention) and with it napping between drains like a busy main thread.
+// Reports throughput, how long items waited, and what spsc::Queue's own statistics saw.
+//
+// Build: S="../../PTZ Scene Manager"
+//        c++ -std=c++17 -O2 -Wall -pthread -I"$S" -o queue_bench queue_bench.cpp
+// Run:   ./queue_bench [messages]
+
+#include "spscqueue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// MARK: - The old queue
+
+// As it was in PSMOBSWebSocketController.mm.
+namespace non_blocking {
+template <class T>
+class Queue {
+    mutable std::mutex m;
+    std::deque<T> data;
+public:
+    void push(T const &input) {
+        std::lock_guard<std::mutex> L(m);
+        data.push_back(input);
+    }
+
+    bool pop(T &output) {
+        std::lock_guard<std::mutex> L(m);
+        if (data.empty())
+            return false;
+        output = data.front();
+        data.pop_front();
+        return true;
+    }
+};
+}
+
+// MARK: - Harness
+
+static uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Item {
+    std::string payload;
+    uint64_t enqueued = 0;
+};
+
+struct Result {
+    double seconds = 0;
+    std::vector<uint64_t> latencies;
+    size_t bytes = 0;
+    spsc::Stats stats;
+    bool hasStats = false;
+};
+
+enum class Mode { MutexDeque, SPSCPop, SPSCDrain };
+
+static const char *modeName(Mode mode)
+{
+    switch (mode) {
+        case Mode::MutexDeque: return "mutex deque";
+        case Mode::SPSCPop: return "spsc pop";
+        case Mode::SPSCDrain: return "spsc drain";
+    }
+    return "";
+}
+
+// The consumer naps napUS between looks at the queue when it finds it empty; 0 spins.
+static Result run(Mode mode, size_t messages, size_t payloadSize, int napUS)
+{
+    Result result;
+    result.latencies.reserve(messages);
+    non_blocking::Queue<Item> deque;
+    spsc::Queue<Item> ring;
+    std::string payload(payloadSize, 'x');
+
+    uint64_t start = now();
+    std::thread producer([&]() {
+        for (size_t i = 0; i < messages; i++) {
+            Item item;
+            item.payload = payload;
+            // Bursts of 8, like a batch of replies arriving together.
+            if (i % 8 == 0) {
+                std::this_thread::yield();
+            }
+            item.enqueued = now();
+            if (mode == Mode::MutexDeque) {
+                deque.push(item);
+            } else {
+                while (!ring.push(std::move(item))) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    });
+
+    size_t received = 0;
+    auto consume = [&](Item&& item) {
+        result.latencies.push_back(now() - item.enqueued);
+        result.bytes += item.payload.size();
+        received++;
+    };
+    while (received < messages) {
+        size_t got = 0;
+        Item item;
+        switch (mode) {
+            case Mode::MutexDeque:
+                while (deque.pop(item)) {
+                    consume(std::move(item));
+                    got++;
+                }
+                break;
+            case Mode::SPSCPop:
+                while (ring.pop(item)) {
+                    consume(std::move(item));
+                    got++;
+                }
+                break;
+            case Mode::SPSCDrain:
+                got = ring.drain(consume);
+                break;
+        }
+        if (got == 0 && napUS > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(napUS));
+        }
+    }
+    producer.join();
+    result.seconds = (now() - start) / 1e9;
+    if (mode != Mode::MutexDeque) {
+        result.stats = ring.stats();
+        result.hasStats = true;
+    }
+    return result;
+}
+
+static double percentileUS(std::vector<uint64_t>& values, double p)
+{
+    size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i] / 1e3;
+}
+
+// MARK: - Main
+
+int main(int argc, char *argv[])
+{
+    size_t messages = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    if (messages == 0) {
+        fprintf(stderr, "usage: %s [messages]\n", argv[0]);
+        return 1;
+    }
+
+    struct Case { const char *name; size_t payloadSize; size_t messages; int napUS; };
+    const Case cases[] = {
+        { "200 B, spinning", 200, messages, 0 },
+        { "200 B, napping", 200, messages / 4, 100 },
+        { "400 KB, spinning", 400000, messages / 200 + 1, 0 },
+        { "400 KB, napping", 400000, messages / 200 + 1, 100 },
+    };
+    printf("%-18s %-12s %10s %10s %10s %10s %10s %8s\n", "case", "queue", "msgs/s", "MB/s", "p50 us", "p99 us", "max us", "high");
+    for (const Case& c : cases) {
+        for (Mode mode : { Mode::MutexDeque, Mode::SPSCPop, Mode::SPSCDrain }) {
+            Result r = run(mode, c.messages, c.payloadSize, c.napUS);
+            if (r.latencies.size() != c.messages || r.bytes != c.messages * c.payloadSize) {
+                fprintf(stderr, "%s %s: lost messages\n", c.name, modeName(mode));
+                return 1;
+            }
+            if (r.hasStats && (r.stats.popped != c.messages || r.stats.pushed != c.messages)) {
+                fprintf(stderr, "%s %s: queue statistics don't match\n", c.name, modeName(mode));
+                return 1;
+            }
+            double p50 = percentileUS(r.latencies, 0.5), p99 = percentileUS(r.latencies, 0.99);
+            double worst = *std::max_element(r.latencies.begin(), r.latencies.end()) / 1e3;
+            char high[32] = "-";
+            if (r.hasStats) {
+                snprintf(high, sizeof(high), "%zu", r.stats.highWater);
+            }
+            printf("%-18s %-12s %10.0f %10.1f %10.2f %10.2f %10.1f %8s\n", c.name, modeName(mode),
+                   c.messages / r.seconds, r.bytes / r.seconds / 1e6, p50, p99, worst, high);
+        }
+    }
+    return 0;
+}
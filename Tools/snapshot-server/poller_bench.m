@@ -0,0 +1,104 @@
+//
+//  poller_bench.m
+//  PTZ Scene Manager
+//
+// Polls snapshot_server the old way, a new request every 0.1 seconds whether or not the last
+// one came back, and then through PSMSnapshotPoller, and compares what each got out of it.
+// The poller run spends its second half hidden, to show the rate dropping off.
+//
+// Build: S="../../PTZ Scene Manager"
+//        clang -O2 -fobjc-arc -framework Cocoa -I"$S" -o poller_bench poller_bench.m "$S/PSMSnapshotPoller.m"
+// Run:   ./snapshot_server --latency-ms 300 --jitter-ms 100 &
+//        ./poller_bench [url] [seconds]     defaults: http://127.0.0.1:8080/snapshot.jpg, 10
+
+#import <Cocoa/Cocoa.h>
+#import "PSMSnapshotPoller.h"
+
+static NSURL *snapshotURL;
+static NSInteger inFlight, maxInFlight;
+static NSUInteger images, failures;
+static NSTimeInterval totalResponse, maxResponse;
+
+static void resetCounters(void)
+{
+    inFlight = maxInFlight = 0;
+    images = failures = 0;
+    totalResponse = maxResponse = 0;
+}
+
+// The same request fetchIPSnapshotAtIndex makes.
+static void fetchSnapshot(void (^doneBlock)(NSImage *image))
+{
+    NSURLRequest *request = [NSURLRequest requestWithURL:snapshotURL cachePolicy:NSURLRequestReloadIgnoringLocalCacheData timeoutInterval:10];
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    maxInFlight = MAX(maxInFlight, ++inFlight);
+    [[[NSURLSession sharedSession] dataTaskWithRequest:request
+                                     completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSImage *image = nil;
+        if (((NSHTTPURLResponse *)response).statusCode == 200 && data != nil) {
+            image = [[NSImage alloc] initWithData:data];
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - start;
+            inFlight--;
+            totalResponse += elapsed;
+            maxResponse = MAX(maxResponse, elapsed);
+            if (image != nil) {
+                images++;
+            } else {
+                failures++;
+            }
+            doneBlock(image);
+        });
+    }] resume];
+}
+
+static void runFor(NSTimeInterval seconds)
+{
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:seconds]];
+}
+
+static void report(const char *name, NSTimeInterval seconds)
+{
+    NSUInteger answered = images + failures;
+    printf("%-8s %4lu images %5.2f fps, %3lu failed, max in flight %2ld, response %5.0f ms avg %5.0f ms max\n",
+           name, (unsigned long)images, images / seconds, (unsigned long)failures, (long)maxInFlight,
+           answered ? totalResponse * 1000 / answered : 0, maxResponse * 1000);
+}
+
+int main(int argc, const char **argv)
+{
+    @autoreleasepool {
+        snapshotURL = [NSURL URLWithString:argc > 1 ? @(argv[1]) : @"http://127.0.0.1:8080/snapshot.jpg"];
+        NSTimeInterval seconds = argc > 2 ? atof(argv[2]) : 10;
+
+        resetCounters();
+        NSTimer *timer = [NSTimer scheduledTimerWithTimeInterval:0.1 repeats:YES block:^(NSTimer *t) {
+            fetchSnapshot(^(NSImage *image) {});
+        }];
+        runFor(seconds);
+        [timer invalidate];
+        report("timer", seconds);
+        // Let the backlog drain so it doesn't count against the poller.
+        while (inFlight > 0) {
+            runFor(0.1);
+        }
+
+        resetCounters();
+        PSMSnapshotPoller *poller = [[PSMSnapshotPoller alloc] initWithFetchBlock:^(PSMSnapshotPollerDoneBlock doneBlock) {
+            fetchSnapshot(doneBlock);
+        } imageBlock:^(NSImage *image) {}];
+        [poller start];
+        runFor(seconds / 2);
+        report("visible", seconds / 2);
+        NSUInteger visibleImages = images;
+        poller.visible = NO;
+        runFor(seconds / 2);
+        [poller stop];
+        printf("hidden   %4lu images %5.2f fps\n", (unsigned long)(images - visibleImages), (images - visibleImages) / (seconds / 2));
+        printf("poller   achieved %.2f fps, response %.0f ms, %lu requests, %lu errors, %lu dropped\n",
+               poller.achievedFPS, poller.averageResponseTime * 1000, (unsigned long)poller.requestCount,
+               (unsigned long)poller.errorCount, (unsigned long)poller.droppedCount);
+        return maxInFlight > 1 ? 1 : 0;
+    }
+}
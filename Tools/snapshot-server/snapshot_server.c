@@ -0,0 +1,495 @@
+//
+//  snapshot_server.c
+//  PTZ Scene Manager
+//
+// A stand-in for a camera's snapshot CGI, so PSMSnapshotPoller and fetchIPSnapshotAtIndex
+// can be exercised without hardware. Like the cameras, it renders one snapshot at a time:
+// requests that arrive while it is busy wait their turn, so a client that doesn't wait for
+// replies sees its response times climb. That queueing is what the max in-flight and wait
+// numbers at exit are for.
+//
+// Build: cc -O2 -Wall -o snapshot_server snapshot_server.c
+// Run:   ./snapshot_server --port 8080 --latency-ms 300
+//        then set the camera's snapshot URL to http://127.0.0.1:8080/snapshot.jpg
+//
+// Every GET gets the same image, whatever the path: the --file contents, or a generated BMP.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS     64
+#define MAX_REQUEST     4096
+
+typedef struct {
+    int latencyMS;          // Time to render one snapshot
+    int jitterMS;           // Up to this much extra, at random
+    int workers;            // Snapshots rendered at once; the cameras manage one
+    double errorRate;       // Chance a request gets a 500 instead of an image, 0-1
+    int verbose;
+} snap_options;
+
+typedef enum {
+    CLIENT_FREE = 0,
+    CLIENT_READING,         // Waiting for the end of the request headers
+    CLIENT_QUEUED,          // Waiting for a worker
+    CLIENT_RENDERING,       // A worker is on it until due
+    CLIENT_WRITING
+} client_state;
+
+typedef struct {
+    int fd;
+    client_state state;
+    char rx[MAX_REQUEST];
+    int rxlen;
+    double arrived;         // Request complete
+    double due;             // Rendering done
+    unsigned long ticket;   // FIFO order for the queue
+    int failed;
+    const char *tx;
+    size_t txlen, txsent;
+    char header[256];
+    int headerlen;
+    int headersent;
+} snap_client;
+
+static snap_options options = { 200, 0, 1, 0.0, 0 };
+static snap_client clients[MAX_CLIENTS];
+static char *body;
+static size_t bodylen;
+static const char *contentType = "image/bmp";
+static unsigned long nextTicket;
+static volatile sig_atomic_t quitting = 0;
+
+// Stats reported at exit.
+static unsigned long requests, served, errors, rejected, disconnected;
+static int inFlight, maxInFlight;
+static double totalWait, maxWait, totalResponse, maxResponse;
+
+static double now_seconds(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    quitting = 1;
+}
+
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// MARK: image
+
+static void put16(unsigned char *p, unsigned v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put32(unsigned char *p, unsigned long v)
+{
+    put16(p, v & 0xFFFF);
+    put16(p + 2, (v >> 16) & 0xFFFF);
+}
+
+// A 24-bit BMP with color bars; NSImage decodes it without help.
+static int make_bmp(int width, int height)
+{
+    size_t row = ((size_t)width * 3 + 3) & ~(size_t)3;
+    bodylen = 54 + row * height;
+    body = calloc(1, bodylen);
+    if (body == NULL) {
+        return -1;
+    }
+    unsigned char *p = (unsigned char *)body;
+    p[0] = 'B';
+    p[1] = 'M';
+    put32(p + 2, bodylen);
+    put32(p + 10, 54);
+    put32(p + 14, 40);
+    put32(p + 18, width);
+    put32(p + 22, height);
+    put16(p + 26, 1);
+    put16(p + 28, 24);
+    put32(p + 34, row * height);
+    for (int y = 0; y < height; y++) {
+        unsigned char *px = p + 54 + row * y;
+        for (int x = 0; x < width; x++) {
+            int bar = x * 8 / width;
+            px[x * 3] = (bar & 1) ? 0xC0 : 0x20;
+            px[x * 3 + 1] = (bar & 2) ? 0xC0 : 0x20;
+            px[x * 3 + 2] = (bar & 4) ? 0xC0 : (unsigned char)(y * 255 / height);
+        }
+    }
+    return 0;
+}
+
+static int load_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    body = malloc(size > 0 ? size : 1);
+    if (body == NULL || size < 0 || fread(body, 1, size, f) != (size_t)size) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    bodylen = size;
+    const char *ext = strrchr(path, '.');
+    if (ext && (!strcasecmp(ext, ".jpg") || !strcasecmp(ext, ".jpeg"))) {
+        contentType = "image/jpeg";
+    } else if (ext && !strcasecmp(ext, ".png")) {
+        contentType = "image/png";
+    }
+    return 0;
+}
+
+// MARK: clients
+
+static void close_client(snap_client *client, const char *why)
+{
+    if (options.verbose) {
+        fprintf(stderr, "client %d: closing (%s)\n", client->fd, why);
+    }
+    if (client->state == CLIENT_QUEUED || client->state == CLIENT_RENDERING) {
+        // Gave up before we answered, the way NSURLSession does after its timeout.
+        disconnected++;
+    }
+    if (client->state != CLIENT_FREE && client->state != CLIENT_READING) {
+        inFlight--;
+    }
+    close(client->fd);
+    client->fd = -1;
+    client->state = CLIENT_FREE;
+}
+
+static void start_response(snap_client *client, double now)
+{
+    double wait = client->due - client->arrived - options.latencyMS / 1000.0;
+    double response = now - client->arrived;
+    totalResponse += response;
+    if (response > maxResponse) {
+        maxResponse = response;
+    }
+    if (client->failed) {
+        errors++;
+        static const char error[] = "snapshot failed\n";
+        client->headerlen = snprintf(client->header, sizeof(client->header),
+                                     "HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\n"
+                                     "Content-Length: %zu\r\nConnection: close\r\n\r\n", sizeof(error) - 1);
+        client->tx = error;
+        client->txlen = sizeof(error) - 1;
+    } else {
+        served++;
+        client->headerlen = snprintf(client->header, sizeof(client->header),
+                                     "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                                     "Cache-Control: no-cache\r\nConnection: close\r\n\r\n", contentType, bodylen);
+        client->tx = body;
+        client->txlen = bodylen;
+    }
+    if (options.verbose) {
+        fprintf(stderr, "client %d: %s after %.0f ms (%.0f ms queued), %d in flight\n",
+                client->fd, client->failed ? "500" : "200", response * 1000, wait > 0 ? wait * 1000 : 0, inFlight);
+    }
+    client->headersent = 0;
+    client->txsent = 0;
+    client->state = CLIENT_WRITING;
+}
+
+static void write_client(snap_client *client)
+{
+    while (client->headersent < client->headerlen) {
+        ssize_t n = send(client->fd, client->header + client->headersent, client->headerlen - client->headersent, 0);
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            }
+            close_client(client, "write failed");
+            return;
+        }
+        client->headersent += n;
+    }
+    while (client->txsent < client->txlen) {
+        ssize_t n = send(client->fd, client->tx + client->txsent, client->txlen - client->txsent, 0);
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            }
+            close_client(client, "write failed");
+            return;
+        }
+        client->txsent += n;
+    }
+    close_client(client, "done");
+}
+
+static void read_client(snap_client *client, double now)
+{
+    ssize_t n = recv(client->fd, client->rx + client->rxlen, sizeof(client->rx) - 1 - client->rxlen, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close_client(client, n == 0 ? "eof" : strerror(errno));
+        return;
+    }
+    if (n < 0 || client->state != CLIENT_READING) {
+        // Anything after the request (a pipelined request, say) is ignored; we close after replying.
+        return;
+    }
+    client->rxlen += n;
+    client->rx[client->rxlen] = '\0';
+    if (strstr(client->rx, "\r\n\r\n") == NULL) {
+        if (client->rxlen == sizeof(client->rx) - 1) {
+            close_client(client, "request too long");
+        }
+        return;
+    }
+    if (strncmp(client->rx, "GET ", 4) != 0) {
+        static const char reply[] = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send(client->fd, reply, sizeof(reply) - 1, 0);
+        close_client(client, "not a GET");
+        return;
+    }
+    requests++;
+    inFlight++;
+    if (inFlight > maxInFlight) {
+        maxInFlight = inFlight;
+    }
+    client->arrived = now;
+    client->ticket = nextTicket++;
+    client->failed = options.errorRate > 0 && (double)rand() / RAND_MAX < options.errorRate;
+    client->state = CLIENT_QUEUED;
+}
+
+static void accept_client(int listenfd)
+{
+    int fd = accept(listenfd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].state == CLIENT_FREE) {
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            set_nonblocking(fd);
+            clients[i].fd = fd;
+            clients[i].state = CLIENT_READING;
+            clients[i].rxlen = 0;
+            return;
+        }
+    }
+    // Out of connections, like a camera's embedded web server.
+    rejected++;
+    close(fd);
+}
+
+// Hands queued requests to free workers, finishes rendered ones, and returns the time until
+// the next render finishes, in ms (-1 if none).
+static int run_workers(double now)
+{
+    int busy = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        snap_client *client = &clients[i];
+        if (client->state == CLIENT_RENDERING) {
+            if (client->due <= now) {
+                start_response(client, now);
+            } else {
+                busy++;
+            }
+        }
+    }
+    while (busy < options.workers) {
+        snap_client *first = NULL;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].state == CLIENT_QUEUED && (first == NULL || clients[i].ticket < first->ticket)) {
+                first = &clients[i];
+            }
+        }
+        if (first == NULL) {
+            break;
+        }
+        double wait = now - first->arrived;
+        totalWait += wait;
+        if (wait > maxWait) {
+            maxWait = wait;
+        }
+        int jitter = options.jitterMS > 0 ? rand() % (options.jitterMS + 1) : 0;
+        first->due = now + (options.latencyMS + jitter) / 1000.0;
+        first->state = CLIENT_RENDERING;
+        busy++;
+    }
+    double next = -1;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].state == CLIENT_RENDERING && (next < 0 || clients[i].due < next)) {
+            next = clients[i].due;
+        }
+    }
+    if (next < 0) {
+        return -1;
+    }
+    int ms = (int)((next - now) * 1000) + 1;
+    return ms > 0 ? ms : 0;
+}
+
+static int open_listener(const char *bindAddress, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress, &addr.sin_addr) != 1
+        || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --port P           listen port (default 8080)\n"
+            "  --bind ADDR        listen address (default 127.0.0.1)\n"
+            "  --latency-ms N     time to render one snapshot (default 200)\n"
+            "  --jitter-ms N      up to N ms extra per snapshot, at random (default 0)\n"
+            "  --workers N        snapshots rendered at once (default 1, like the cameras)\n"
+            "  --error-rate R     fraction of requests answered with a 500, 0-1 (default 0)\n"
+            "  --file PATH        image to serve (default: generated 640x360 BMP)\n"
+            "  --verbose          log every request\n",
+            name);
+}
+
+int main(int argc, char *argv[])
+{
+    int port = 8080;
+    const char *bindAddress = "127.0.0.1";
+    const char *file = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--verbose")) {
+            options.verbose = 1;
+            continue;
+        }
+        if (value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (!strcmp(arg, "--port")) {
+            port = atoi(value);
+        } else if (!strcmp(arg, "--bind")) {
+            bindAddress = value;
+        } else if (!strcmp(arg, "--latency-ms")) {
+            options.latencyMS = atoi(value);
+        } else if (!strcmp(arg, "--jitter-ms")) {
+            options.jitterMS = atoi(value);
+        } else if (!strcmp(arg, "--workers")) {
+            options.workers = atoi(value);
+        } else if (!strcmp(arg, "--error-rate")) {
+            options.errorRate = atof(value);
+        } else if (!strcmp(arg, "--file")) {
+            file = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.workers < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (file != NULL ? load_file(file) < 0 : make_bmp(640, 360) < 0) {
+        fprintf(stderr, "unable to load %s: %s\n", file ? file : "image", strerror(errno));
+        return 1;
+    }
+
+    int listenfd = open_listener(bindAddress, port);
+    if (listenfd < 0) {
+        fprintf(stderr, "unable to listen on %s:%d: %s\n", bindAddress, port, strerror(errno));
+        return 1;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+    fprintf(stderr, "snapshot_server: http://%s:%d/snapshot.jpg, %zu byte %s, %d ms +%d ms, %d worker(s)\n",
+            bindAddress, port, bodylen, contentType, options.latencyMS, options.jitterMS, options.workers);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    srand((unsigned)time(NULL));
+
+    struct pollfd fds[MAX_CLIENTS + 1];
+    while (!quitting) {
+        int timeout = run_workers(now_seconds());
+        int nfds = 0;
+        fds[nfds].fd = listenfd;
+        fds[nfds++].events = POLLIN;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            fds[nfds].fd = clients[i].fd;
+            fds[nfds++].events = clients[i].state == CLIENT_WRITING ? POLLIN | POLLOUT : POLLIN;
+        }
+        if (poll(fds, nfds, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        double now = now_seconds();
+        if (fds[0].revents & POLLIN) {
+            accept_client(listenfd);
+        }
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            snap_client *client = &clients[i];
+            short revents = fds[i + 1].revents;
+            if (client->state == CLIENT_FREE || fds[i + 1].fd != client->fd) {
+                continue;
+            }
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_client(client, now);
+            }
+            if (client->state == CLIENT_WRITING && (revents & POLLOUT)) {
+                write_client(client);
+            }
+        }
+    }
+
+    unsigned long answered = served + errors;
+    fprintf(stderr, "%lu requests: %lu served, %lu errors, %lu abandoned, %lu connections refused\n",
+            requests, served, errors, disconnected, rejected);
+    fprintf(stderr, "max in flight %d; queued %.0f ms avg, %.0f ms max; response %.0f ms avg, %.0f ms max\n",
+            maxInFlight, requests ? totalWait * 1000 / requests : 0, maxWait * 1000,
+            answered ? totalResponse * 1000 / answered : 0, maxResponse * 1000);
+    return 0;
+}
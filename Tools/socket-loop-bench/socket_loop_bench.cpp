@@ -0,0 +1,393 @@
+//
+//  socket_loop_bench.cpp
+//  PTZ Scene Manager
+//
+// Send-to-echo latency through the OBS socket thread's loop, the old way and the new way,
+// against a WebSocket echo server on loopback.
+//
+// The old loop is runSocketFromURL: as it was: send one queued message, poll() with no wait,
+// dispatch whatever came in, sleep 10 ms. The new loop sends everything queued, then blocks in
+// poll(timeout, wakefd) until the socket has traffic or sendString: writes to the wake pipe.
+// Both run the app's easywsclient on a thread of their own, fed from a queue the way
+// sendString: feeds it.
+//
+// Requests go out one at a time with a random gap in between, like the app's OBS requests,
+// and each one's latency is from queuing it to its echo being dispatched. Every echo has to
+// match what was sent. Wakeups are how often the socket thread went round its loop while
+// nothing was being sent.
+//
+// Build: S="../../PTZ Scene Manager"
+//        c++ -std=c++17 -O2 -Wall -pthread -I"$S" -o socket_loop_bench socket_loop_bench.cpp "$S/easywsclient.cpp"
+// Run:   ./socket_loop_bench [requests]
+
+#include "easywsclient.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// The old loop's sleep and the new loop's backstop timeout, as in PSMOBSWebSocketController.
+static const int OldLoopSleepMS = 10;
+static const int PollTimeoutMS = 1000;
+
+// MARK: - Echo server
+
+static bool sendAll(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, 0);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+static bool recvAll(int fd, uint8_t *data, size_t length)
+{
+    while (length > 0) {
+        ssize_t got = recv(fd, data, length, 0);
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        length -= (size_t)got;
+    }
+    return true;
+}
+
+// Sends every text or binary frame straight back, unmasked, until the client closes.
+static void serveEcho(int fd)
+{
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    std::string request;
+    char buf[4096];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            close(fd);
+            return;
+        }
+        request.append(buf, (size_t)n);
+    }
+    // easywsclient only looks at the status line.
+    const char *response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n";
+    if (!sendAll(fd, response, strlen(response))) {
+        close(fd);
+        return;
+    }
+    for (;;) {
+        uint8_t header[2];
+        if (!recvAll(fd, header, 2)) {
+            break;
+        }
+        uint8_t opcode = header[0] & 0x0F;
+        bool masked = header[1] & 0x80;
+        uint64_t length = header[1] & 0x7F;
+        if (length >= 126) {
+            uint8_t extended[8];
+            int bytes = length == 126 ? 2 : 8;
+            if (!recvAll(fd, extended, (size_t)bytes)) {
+                break;
+            }
+            length = 0;
+            for (int i = 0; i < bytes; i++) {
+                length = (length << 8) | extended[i];
+            }
+        }
+        uint8_t mask[4] = { 0, 0, 0, 0 };
+        if (masked && !recvAll(fd, mask, 4)) {
+            break;
+        }
+        std::string payload(length, '\0');
+        if (length > 0 && !recvAll(fd, (uint8_t *)&payload[0], length)) {
+            break;
+        }
+        for (size_t i = 0; i < payload.size(); i++) {
+            payload[i] = (char)(payload[i] ^ mask[i & 3]);
+        }
+        if (opcode == 0x8) {
+            break;
+        }
+        if (opcode != 0x1 && opcode != 0x2) {
+            continue;
+        }
+        std::string frame(1, (char)(0x80 | opcode));
+        if (payload.size() < 126) {
+            frame += (char)payload.size();
+        } else {
+            frame += (char)126;
+            frame += (char)(payload.size() >> 8);
+            frame += (char)payload.size();
+        }
+        frame += payload;
+        if (!sendAll(fd, frame.data(), frame.size())) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+static int listenOn(int& boundPort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(fd, (sockaddr *)&addr, &length);
+    boundPort = ntohs(addr.sin_port);
+    return fd;
+}
+
+// MARK: - Socket thread
+
+// What PSMOBSWebSocketController keeps for its socket thread: the outgoing queue, the wake
+// pipe, and somewhere for the echoes to go.
+class SocketLoop {
+  public:
+    explicit SocketLoop(bool wakes) : wakes(wakes) {
+        if (pipe(wakePipe) == 0) {
+            fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+        } else {
+            wakePipe[0] = wakePipe[1] = -1;
+        }
+    }
+
+    ~SocketLoop() {
+        stop();
+        if (wakePipe[0] >= 0) {
+            close(wakePipe[0]);
+            close(wakePipe[1]);
+        }
+    }
+
+    bool start(const std::string& url) {
+        ws.reset(easywsclient::WebSocket::from_url(url));
+        if (!ws) {
+            return false;
+        }
+        running = true;
+        thread = std::thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        if (thread.joinable()) {
+            running = false;
+            wake();
+            thread.join();
+        }
+    }
+
+    // sendString:
+    void send(const std::string& message) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            outgoing.push_back(message);
+        }
+        if (wakes) {
+            wake();
+        }
+    }
+
+    // Waits for the next echo, up to a second.
+    bool receive(std::string& message) {
+        std::unique_lock<std::mutex> guard(lock);
+        if (!arrived.wait_for(guard, std::chrono::seconds(1), [this] { return !incoming.empty(); })) {
+            return false;
+        }
+        message = std::move(incoming.front());
+        incoming.pop_front();
+        return true;
+    }
+
+    std::atomic<uint64_t> iterations { 0 };
+
+  private:
+    bool pop(std::string& message) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (outgoing.empty()) {
+            return false;
+        }
+        message = std::move(outgoing.front());
+        outgoing.pop_front();
+        return true;
+    }
+
+    void wake() {
+        if (wakePipe[1] >= 0) {
+            const char c = 0;
+            (void)!write(wakePipe[1], &c, 1);
+        }
+    }
+
+    void run() {
+        using easywsclient::WebSocket;
+        while (running) {
+            if (ws->getReadyState() == WebSocket::CLOSED) {
+                break;
+            }
+            iterations++;
+            std::string data;
+            if (wakes) {
+                while (pop(data)) {
+                    ws->send(data);
+                }
+                ws->poll(PollTimeoutMS, wakePipe[0]);
+            } else {
+                if (pop(data)) {
+                    ws->send(data);
+                }
+                ws->poll();
+            }
+            ws->dispatch([this](const std::string& message) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    incoming.push_back(message);
+                }
+                arrived.notify_one();
+            });
+            if (!wakes) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(OldLoopSleepMS));
+            }
+        }
+        ws->close();
+        ws->poll();
+    }
+
+    const bool wakes;
+    int wakePipe[2];
+    std::unique_ptr<easywsclient::WebSocket> ws;
+    std::atomic<bool> running { false };
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable arrived;
+    std::deque<std::string> outgoing, incoming;
+};
+
+// MARK: - Main
+
+struct Result {
+    std::vector<double> latencies;
+    double idleWakeupsPerSecond = 0;
+    size_t mismatches = 0, lost = 0;
+};
+
+static bool run(const std::string& url, bool wakes, int requests, Result& result)
+{
+    SocketLoop loop(wakes);
+    if (!loop.start(url)) {
+        return false;
+    }
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> gapMS(0, 20);
+    for (int i = 0; i < requests; i++) {
+        std::string request = "{\"op\":6,\"d\":{\"requestType\":\"GetCurrentProgramScene\",\"requestId\":\"" + std::to_string(i) + "\"}}";
+        Clock::time_point sent = Clock::now();
+        loop.send(request);
+        std::string echo;
+        if (!loop.receive(echo)) {
+            result.lost++;
+            continue;
+        }
+        result.latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+        result.mismatches += echo != request;
+        std::this_thread::sleep_for(std::chrono::milliseconds(gapMS(rng)));
+    }
+    uint64_t before = loop.iterations;
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    result.idleWakeupsPerSecond = (double)(loop.iterations - before);
+    loop.stop();
+    return true;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * (double)values.size()))];
+}
+
+int main(int argc, char *argv[])
+{
+    int requests = argc > 1 ? atoi(argv[1]) : 200;
+    if (requests <= 0) {
+        fprintf(stderr, "usage: %s [requests]\n", argv[0]);
+        return 1;
+    }
+    int port = 0;
+    int listener = listenOn(port);
+    if (listener < 0) {
+        return 1;
+    }
+    std::thread server([listener] {
+        int fd;
+        while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+            std::thread(serveEcho, fd).detach();
+        }
+    });
+    std::string url = "ws://127.0.0.1:" + std::to_string(port) + "/";
+
+    printf("%d requests, one at a time, against an echo server on loopback\n", requests);
+    printf("%-24s %8s %8s %8s %8s %8s  %s\n", "loop", "avg ms", "p50 ms", "p99 ms", "max ms", "idle/s", "checks");
+    bool passed = true;
+    for (bool wakes : { false, true }) {
+        Result r;
+        if (!run(url, wakes, requests, r)) {
+            fprintf(stderr, "can't connect to %s\n", url.c_str());
+            return 1;
+        }
+        double total = 0;
+        for (double latency : r.latencies) {
+            total += latency;
+        }
+        std::string checks = "ok";
+        if (r.lost > 0 || r.mismatches > 0) {
+            checks = std::to_string(r.lost) + " lost, " + std::to_string(r.mismatches) + " didn't match";
+            passed = false;
+        }
+        printf("%-24s %8.2f %8.2f %8.2f %8.2f %8.0f  %s\n", wakes ? "poll(timeout, wakefd)" : "poll() + 10 ms sleep",
+               r.latencies.empty() ? 0 : total / (double)r.latencies.size(), percentile(r.latencies, 0.5),
+               percentile(r.latencies, 0.99), percentile(r.latencies, 1), r.idleWakeupsPerSecond, checks.c_str());
+    }
+    shutdown(listener, SHUT_RDWR);
+    close(listener);
+    server.join();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+//
+//  thumbnail_bench.cpp
+//  PTZ Scene Manager
+//
+// What an RTSP thumbnail costs per camera, decoding the stream as it comes and with
+// RTSPViewController's refreshInterval, which opens the stream for one picture every so
+// often and closes it again.
+//
+// The stand-in stream is 30 fps with a keyframe every second. Decoding and converting are
+// busy loops as long as a small H.264 frame takes: more for a keyframe, and a little CPU to
+// open the stream on top of the time the camera takes to answer. A new decoder only starts
+// at a keyframe, so refreshing waits for the next one and decodes just that. CPU is each
+// decoder thread's own, from framering::threadCPUSeconds; age is how old the picture on
+// screen is, on average, from when it was due.
+//
+// Build: c++ -std=c++17 -O2 -Wall -pthread -I"../../PTZ Scene Manager" -o thumbnail_bench thumbnail_bench.cpp
+// Run:   ./thumbnail_bench [cameras] [seconds]
+
+#include "framering.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using framering::Clock;
+
+static const double FPS = 30;
+static const int KeyframeEvery = 30;
+static const double DecodeCPU = 0.002, KeyframeCPU = 0.006, ConvertCPU = 0.001;
+static const double OpenCPU = 0.004, OpenWait = 0.150;
+
+static double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+static Clock::duration duration(double s)
+{
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+}
+
+// Uses s seconds of this thread's CPU.
+static void spin(double s)
+{
+    double until = framering::threadCPUSeconds() + s;
+    while (framering::threadCPUSeconds() < until) {
+    }
+}
+
+// MARK: - Stand-ins
+
+// Frame i of every camera is due at start + i / FPS.
+struct Stream {
+    Clock::time_point start;
+
+    long frameAt(Clock::time_point t) const { return (long)(seconds(t - start) * FPS); }
+    Clock::time_point due(long frame) const { return start + duration(frame / FPS); }
+};
+
+class Stop {
+  public:
+    // Sleeps until t; false if it's time to stop.
+    bool sleepUntil(Clock::time_point t) {
+        std::unique_lock<std::mutex> guard(lock);
+        return !wake.wait_until(guard, t, [this] { return stopped; });
+    }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+        }
+        wake.notify_all();
+    }
+    bool running() {
+        std::lock_guard<std::mutex> guard(lock);
+        return !stopped;
+    }
+
+  private:
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopped = false;
+};
+
+struct Camera {
+    framering::Ring<long> frames;
+    double cpu = 0;
+    int opens = 0;
+};
+
+// MARK: - Decoder threads
+
+static void decodeLive(Camera& camera, const Stream& stream, Stop& stop)
+{
+    double cpu = framering::threadCPUSeconds();
+    spin(OpenCPU);
+    long frame = stream.frameAt(Clock::now()) + 1;
+    camera.opens++;
+    // Nothing can be decoded until the first keyframe.
+    while (frame % KeyframeEvery != 0) {
+        frame++;
+    }
+    while (stop.sleepUntil(stream.due(frame))) {
+        spin(frame % KeyframeEvery == 0 ? KeyframeCPU : DecodeCPU);
+        if (camera.frames.needsFrame()) {
+            spin(ConvertCPU);
+            camera.frames.push(frame / FPS, frame);
+        } else {
+            camera.frames.skip();
+        }
+        frame++;
+    }
+    camera.cpu = framering::threadCPUSeconds() - cpu;
+}
+
+static void decodeRefreshing(Camera& camera, const Stream& stream, Stop& stop, double interval)
+{
+    double cpu = framering::threadCPUSeconds();
+    Clock::time_point next = Clock::now();
+    while (stop.sleepUntil(next)) {
+        next += duration(interval);
+        if (!stop.sleepUntil(Clock::now() + duration(OpenWait))) {
+            break;
+        }
+        spin(OpenCPU);
+        camera.opens++;
+        long frame = stream.frameAt(Clock::now()) + 1;
+        while (frame % KeyframeEvery != 0) {
+            frame++;
+        }
+        if (!stop.sleepUntil(stream.due(frame))) {
+            break;
+        }
+        spin(KeyframeCPU + ConvertCPU);
+        camera.frames.push(frame / FPS, frame);
+    }
+    camera.cpu = framering::threadCPUSeconds() - cpu;
+}
+
+// MARK: - Main
+
+struct Result {
+    double cpuPercent = 0, pictures = 0, ageMS = 0, opens = 0;
+};
+
+static Result run(double interval, int cameraCount, double length)
+{
+    Stream stream { Clock::now() };
+    Stop stop;
+    std::vector<std::unique_ptr<Camera>> cameras;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < cameraCount; i++) {
+        cameras.emplace_back(new Camera());
+        Camera& camera = *cameras.back();
+        if (interval > 0) {
+            threads.emplace_back(decodeRefreshing, std::ref(camera), std::cref(stream), std::ref(stop), interval);
+        } else {
+            threads.emplace_back(decodeLive, std::ref(camera), std::cref(stream), std::ref(stop));
+        }
+    }
+    // The main thread looks every 10 ms, like a display would, and sees how old each camera's
+    // picture is.
+    std::vector<long> shown((size_t)cameraCount, -1);
+    double totalAge = 0;
+    long looks = 0;
+    Clock::time_point end = stream.start + duration(length);
+    for (Clock::time_point t = stream.start; t < end; t += std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_until(t);
+        for (size_t i = 0; i < shown.size(); i++) {
+            long frame;
+            if (cameras[i]->frames.takeNewest(frame)) {
+                shown[i] = frame;
+            }
+            // Only once there's been time for everyone's first picture.
+            if (shown[i] >= 0 && t > stream.start + duration(2)) {
+                totalAge += seconds(Clock::now() - stream.due(shown[i]));
+                looks++;
+            }
+        }
+    }
+    stop.stop();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    Result result;
+    for (const std::unique_ptr<Camera>& camera : cameras) {
+        result.cpuPercent += camera->cpu / length * 100 / cameraCount;
+        result.pictures += camera->frames.stats().displayed / length / cameraCount;
+        result.opens += camera->opens / (double)cameraCount;
+    }
+    result.ageMS = looks ? totalAge / looks * 1e3 : 0;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int cameras = argc > 1 ? atoi(argv[1]) : 4;
+    double length = argc > 2 ? atof(argv[2]) : 12;
+    if (cameras <= 0 || length <= 2) {
+        fprintf(stderr, "usage: %s [cameras] [seconds > 2]\n", argv[0]);
+        return 1;
+    }
+    printf("%d cameras, 30 fps with a keyframe a second, for %.0f s\n", cameras, length);
+    printf("%-14s %14s %12s %10s %10s\n", "refresh", "CPU %/camera", "pictures/s", "age ms", "opens");
+    for (double interval : { 0.0, 1.0, 2.0, 5.0 }) {
+        Result r = run(interval, cameras, length);
+        char name[32];
+        if (interval > 0) {
+            snprintf(name, sizeof(name), "every %.0f s", interval);
+        } else {
+            snprintf(name, sizeof(name), "live");
+        }
+        printf("%-14s %14.2f %12.2f %10.0f %10.1f\n", name, r.cpuPercent, r.pictures, r.ageMS, r.opens);
+    }
+    return 0;
+}
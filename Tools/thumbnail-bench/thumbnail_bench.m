@@ -0,0 +1,145 @@
+//
+//  thumbnail_bench.m
+//  PTZ Scene Manager
+//
+// Scrolls scene grids through PSMThumbnailCache the way PSMSceneWindowController realizes
+// collection items: 8 cameras, 255 scenes each, a window of visible cells that moves down the
+// grid and back up again. Each realized cell is timed against decoding the full-size snapshot
+// with NSImage, which is what snapshotAtIndex: used to do.
+//
+// Build: S="../../PTZ Scene Manager"
+//        clang -O2 -fobjc-arc -framework Cocoa -I"$S" -o thumbnail_bench thumbnail_bench.m "$S/PSMThumbnailCache.m"
+// Run:   ./thumbnail_bench [scrolls] [cache MB]     defaults: 4 scrolls, 64 MB
+
+#import <Cocoa/Cocoa.h>
+#import <ImageIO/ImageIO.h>
+#import "PSMThumbnailCache.h"
+
+#define CAMERAS 8
+#define SCENES 255
+// A 4-column scene window shows about 4 rows at a time.
+#define VISIBLE 16
+#define COLUMNS 4
+
+static double now(void)
+{
+    return [NSDate timeIntervalSinceReferenceDate];
+}
+
+static NSString *snapshotPath(NSString *dir, int camera, int scene)
+{
+    return [dir stringByAppendingPathComponent:[NSString stringWithFormat:@"snapshot_cam%d_%d.jpg", camera, scene]];
+}
+
+// 1920x1080 JPEGs with enough detail that they don't compress to nothing.
+static BOOL writeSnapshots(NSString *dir)
+{
+    size_t width = 1920, height = 1080;
+    CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+    CGContextRef ctx = CGBitmapContextCreate(NULL, width, height, 8, 0, space, kCGImageAlphaNoneSkipLast);
+    CGColorSpaceRelease(space);
+    for (int c = 0; c < CAMERAS; c++) {
+        for (int s = 0; s < SCENES; s++) {
+            for (int band = 0; band < 32; band++) {
+                CGContextSetRGBFillColor(ctx, (band * 8 % 256) / 255.0, (s % 256) / 255.0, (c * 32 % 256) / 255.0, 1);
+                CGContextFillRect(ctx, CGRectMake(band * width / 32.0, 0, width / 32.0, height));
+            }
+            CGImageRef image = CGBitmapContextCreateImage(ctx);
+            NSURL *url = [NSURL fileURLWithPath:snapshotPath(dir, c, s)];
+            CGImageDestinationRef dest = CGImageDestinationCreateWithURL((__bridge CFURLRef)url, CFSTR("public.jpeg"), 1, NULL);
+            CGImageDestinationAddImage(dest, image, (__bridge CFDictionaryRef)@{(id)kCGImageDestinationLossyCompressionQuality:@0.8});
+            BOOL ok = CGImageDestinationFinalize(dest);
+            CFRelease(dest);
+            CGImageRelease(image);
+            if (!ok) {
+                CGContextRelease(ctx);
+                return NO;
+            }
+        }
+    }
+    CGContextRelease(ctx);
+    return YES;
+}
+
+// Forces the pixels to be decoded, as drawing the cell would.
+static void realize(NSImage *image)
+{
+    CGImageRef cgImage = [image CGImageForProposedRect:NULL context:nil hints:nil];
+    CFRelease(CGDataProviderCopyData(CGImageGetDataProvider(cgImage)));
+}
+
+// Every row that scrolls into view realizes COLUMNS new cells, going down the grid and then
+// back up. Returns cells realized.
+static long scrollGrid(NSString *dir, int camera, BOOL cached, double *outTime)
+{
+    PSMThumbnailCache *cache = [PSMThumbnailCache sharedCache];
+    NSString *cameraKey = [NSString stringWithFormat:@"cam%d", camera];
+    int rows = (SCENES + COLUMNS - 1) / COLUMNS, visibleRows = VISIBLE / COLUMNS;
+    long cells = 0;
+    double t = now();
+    for (int step = 0; step < 2 * rows - visibleRows; step++) {
+        // Going down, the new row is at the bottom of the window; going up, at the top.
+        int row = step < rows ? step : 2 * rows - visibleRows - 1 - step;
+        for (int s = row * COLUMNS; s < (row + 1) * COLUMNS && s < SCENES; s++) {
+            @autoreleasepool {
+                NSString *path = snapshotPath(dir, camera, s);
+                NSImage *image = cached ? [cache thumbnailForPath:path cameraKey:cameraKey index:s]
+                                        : [[NSImage alloc] initWithContentsOfFile:path];
+                realize(image);
+                cells++;
+            }
+        }
+    }
+    *outTime += now() - t;
+    return cells;
+}
+
+int main(int argc, const char **argv)
+{
+    @autoreleasepool {
+        int scrolls = argc > 1 ? atoi(argv[1]) : 4;
+        NSUInteger cacheMB = argc > 2 ? (NSUInteger)atoi(argv[2]) : 64;
+        NSString *dir = [NSTemporaryDirectory() stringByAppendingPathComponent:@"thumbnail_bench"];
+        [[NSFileManager defaultManager] createDirectoryAtPath:dir withIntermediateDirectories:YES attributes:nil error:nil];
+
+        printf("writing %d snapshots...\n", CAMERAS * SCENES);
+        if (!writeSnapshots(dir)) {
+            fprintf(stderr, "could not write snapshots to %s\n", [dir fileSystemRepresentation]);
+            return 1;
+        }
+
+        double uncachedTime = 0;
+        long uncachedCells = 0;
+        for (int c = 0; c < CAMERAS; c++) {
+            uncachedCells += scrollGrid(dir, c, NO, &uncachedTime);
+        }
+
+        PSMThumbnailCache *cache = [PSMThumbnailCache sharedCache];
+        cache.maxBytes = cacheMB * 1024 * 1024;
+        double cachedTime = 0;
+        long cachedCells = 0;
+        for (int pass = 0; pass < scrolls; pass++) {
+            for (int c = 0; c < CAMERAS; c++) {
+                cachedCells += scrollGrid(dir, c, YES, &cachedTime);
+            }
+        }
+
+        // A preset was re-saved: that one cell must be decoded again.
+        NSUInteger missesBefore = cache.misses;
+        [cache invalidateCameraKey:@"cam0" index:0];
+        [cache thumbnailForPath:snapshotPath(dir, 0, 0) cameraKey:@"cam0" index:0];
+        int status = cache.misses == missesBefore + 1 ? 0 : 1;
+
+        printf("%d cameras x %d scenes, %d visible cells\n", CAMERAS, SCENES, VISIBLE);
+        printf("uncached:   %8.3f ms/cell (%ld cells)\n", uncachedTime * 1000 / uncachedCells, uncachedCells);
+        printf("cached:     %8.3f ms/cell (%ld cells, %d scrolls)\n", cachedTime * 1000 / cachedCells, cachedCells, scrolls);
+        printf("hit rate:   %8.1f %% (%lu hits, %lu misses, %lu evictions)\n",
+               cache.hitRate * 100, (unsigned long)cache.hits, (unsigned long)cache.misses, (unsigned long)cache.evictions);
+        printf("memory:     %8.1f MB in %lu thumbnails, limit %lu MB\n",
+               cache.currentBytes / (1024.0 * 1024.0), (unsigned long)cache.count, (unsigned long)cacheMB);
+        printf("invalidate: %s\n", status == 0 ? "ok" : "FAILED");
+
+        [[NSFileManager defaultManager] removeItemAtPath:dir error:nil];
+        return status;
+    }
+}
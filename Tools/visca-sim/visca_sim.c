@@ -0,0 +1,578 @@
+//
+//  visca_sim.c
+//  PTZ Scene Manager
+//
+// A stand-in for PTZOptics cameras so PTZCamera, backupRestore and the PacketSender export
+// can be exercised without hardware. It speaks raw VISCA over TCP, the same framing
+// VISCA_open_tcp uses, and simulates any number of cameras from one process.
+//
+// Build: cc -O2 -Wall -o visca_sim visca_sim.c
+// Run:   ./visca_sim --cameras 12 --port 5678
+//        then add cameras as 127.0.0.1:5678, 127.0.0.1:5679, ...
+//
+// Camera state is a register file indexed by the VISCA command byte, so anything that
+// follows the usual "81 01 04 XX ..." set / "81 09 04 XX FF" inquiry pattern round-trips.
+// Pan/tilt and memory presets are modeled explicitly, and the registers PTZCamera inquires
+// about start out with power-on values in the width libvisca parses.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_PACKET      32
+#define MAX_CLIENTS     4
+#define MAX_PRESETS     256
+#define MAX_PENDING     4096
+
+typedef struct {
+    int latencyMS;          // Before the ACK (or inquiry reply)
+    int moveMS;             // Between ACK and completion for recall and absolute moves
+    double dropRate;        // Chance a reply is never sent, 0-1
+    int idleTimeout;        // Seconds without traffic before the camera hangs up; 0 = never
+    int verbose;
+} sim_options;
+
+typedef struct {
+    int16_t pan, tilt;
+    uint16_t regs[256];
+    uint8_t wide[256];      // Register was last set as four nibbles, so reply that way too.
+} sim_state;
+
+typedef struct {
+    int fd;
+    double lastActivity;
+    uint8_t rx[MAX_PACKET];
+    int rxlen;
+} sim_client;
+
+typedef struct {
+    int index;
+    int listenfd;
+    sim_state state;
+    sim_state presets[MAX_PRESETS];
+    uint8_t presetValid[MAX_PRESETS];
+    sim_client clients[MAX_CLIENTS];
+    unsigned long commands, inquiries, dropped;
+} sim_camera;
+
+// Replies and deferred state changes, sent when their time comes.
+typedef struct {
+    double due;
+    sim_camera *camera;
+    int fd;
+    uint8_t bytes[MAX_PACKET];
+    int length;
+    int applyPreset;        // >= 0: copy that preset into the live state when sent
+    int applyMove;          // Non-zero: move pan/tilt to movePan/moveTilt when sent
+    int16_t movePan, moveTilt;
+} sim_pending;
+
+static sim_options options = { 20, 500, 0.0, 0, 0 };
+static sim_pending pending[MAX_PENDING];
+static int pendingCount = 0;
+static volatile sig_atomic_t quitting = 0;
+
+static double now_seconds(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    quitting = 1;
+}
+
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// MARK: replies
+
+static void queue_reply(sim_camera *cam, int fd, double delay, const uint8_t *bytes, int length)
+{
+    if (pendingCount == MAX_PENDING) {
+        fprintf(stderr, "camera %d: reply queue full, dropping\n", cam->index);
+        return;
+    }
+    if (options.dropRate > 0 && (double)rand() / RAND_MAX < options.dropRate) {
+        cam->dropped++;
+        return;
+    }
+    sim_pending *p = &pending[pendingCount++];
+    memset(p, 0, sizeof(*p));
+    p->due = now_seconds() + delay;
+    p->camera = cam;
+    p->fd = fd;
+    memcpy(p->bytes, bytes, length);
+    p->length = length;
+    p->applyPreset = -1;
+}
+
+static void queue_ack_and_completion(sim_camera *cam, int fd, double moveSeconds, int preset, int moveTo, int16_t pan, int16_t tilt)
+{
+    static const uint8_t ack[] = { 0x90, 0x41, 0xFF };
+    static const uint8_t done[] = { 0x90, 0x51, 0xFF };
+    double latency = options.latencyMS / 1000.0;
+    queue_reply(cam, fd, latency, ack, sizeof(ack));
+    int before = pendingCount;
+    queue_reply(cam, fd, latency + moveSeconds, done, sizeof(done));
+    if (pendingCount > before) {
+        pending[pendingCount - 1].applyPreset = preset;
+        pending[pendingCount - 1].applyMove = moveTo;
+        pending[pendingCount - 1].movePan = pan;
+        pending[pendingCount - 1].moveTilt = tilt;
+    } else {
+        // Reply dropped; the camera still moves.
+        if (preset >= 0) {
+            cam->state = cam->presets[preset];
+        } else if (moveTo) {
+            cam->state.pan = pan;
+            cam->state.tilt = tilt;
+        }
+    }
+}
+
+static void queue_error(sim_camera *cam, int fd, uint8_t code)
+{
+    uint8_t err[] = { 0x90, 0x60, code, 0xFF };
+    queue_reply(cam, fd, options.latencyMS / 1000.0, err, sizeof(err));
+}
+
+static void queue_inquiry_reply(sim_camera *cam, int fd, const uint8_t *payload, int length)
+{
+    uint8_t reply[MAX_PACKET] = { 0x90, 0x50 };
+    memcpy(reply + 2, payload, length);
+    reply[2 + length] = 0xFF;
+    queue_reply(cam, fd, options.latencyMS / 1000.0, reply, length + 3);
+}
+
+static int nibbles_to_int(const uint8_t *p, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        value = (value << 4) | (p[i] & 0x0F);
+    }
+    return value;
+}
+
+static void int_to_nibbles(int value, uint8_t *p, int count)
+{
+    for (int i = count - 1; i >= 0; i--) {
+        p[i] = value & 0x0F;
+        value >>= 4;
+    }
+}
+
+// What a camera powers up with. The direct-value registers reply with four nibbles even before
+// they've been set, as libvisca expects; the modes reply with one byte.
+static void seed_defaults(sim_state *st)
+{
+    static const struct {
+        uint8_t cmd;
+        uint16_t value;
+    } wide[] = {
+        { 0x42, 0x0005 },   // Aperture
+        { 0x43, 0x0080 },   // R gain
+        { 0x44, 0x0080 },   // B gain
+        { 0x46, 0x0000 },   // Digital zoom
+        { 0x47, 0x0000 },   // Zoom, wide end
+        { 0x48, 0x1000 },   // Focus
+        { 0x4A, 0x0011 },   // Shutter
+        { 0x4B, 0x000D },   // Iris
+        { 0x4C, 0x0000 },   // Gain
+        { 0x4D, 0x000D },   // Bright
+    };
+    static const struct {
+        uint8_t cmd;
+        uint8_t value;
+    } modes[] = {
+        { 0x00, 0x02 },     // Power on
+        { 0x35, 0x00 },     // White balance auto
+        { 0x38, 0x02 },     // Focus auto
+        { 0x39, 0x00 },     // Exposure full auto
+    };
+    memset(st, 0, sizeof(*st));
+    for (size_t i = 0; i < sizeof(wide) / sizeof(wide[0]); i++) {
+        st->regs[wide[i].cmd] = wide[i].value;
+        st->wide[wide[i].cmd] = 1;
+    }
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        st->regs[modes[i].cmd] = modes[i].value;
+    }
+}
+
+// MARK: packets
+
+static void handle_packet(sim_camera *cam, sim_client *client, const uint8_t *pkt, int len)
+{
+    sim_state *st = &cam->state;
+    int fd = client->fd;
+
+    if (options.verbose) {
+        fprintf(stderr, "camera %d <-", cam->index);
+        for (int i = 0; i < len; i++) {
+            fprintf(stderr, " %02x", pkt[i]);
+        }
+        fprintf(stderr, "\n");
+    }
+    // Broadcast address set and interface clear.
+    if (pkt[0] == 0x88) {
+        if (len == 4 && pkt[1] == 0x30) {
+            uint8_t reply[] = { 0x88, 0x30, (uint8_t)(pkt[2] + 1), 0xFF };
+            queue_reply(cam, fd, 0, reply, sizeof(reply));
+        } else {
+            queue_reply(cam, fd, 0, pkt, len);
+        }
+        return;
+    }
+    if ((pkt[0] & 0xF0) != 0x80 || len < 3) {
+        queue_error(cam, fd, 0x02);
+        return;
+    }
+    // Cancel: 8x 2p FF
+    if ((pkt[1] & 0xF0) == 0x20) {
+        uint8_t reply[] = { 0x90, (uint8_t)(0x60 | (pkt[1] & 0x0F)), 0x04, 0xFF };
+        queue_reply(cam, fd, 0, reply, sizeof(reply));
+        return;
+    }
+    if (pkt[1] == 0x01 && len >= 5) {
+        cam->commands++;
+        uint8_t category = pkt[2], cmd = pkt[3];
+        if (category == 0x04 && cmd == 0x3F && len == 7) {
+            // Memory: 81 01 04 3F 0p pp FF; 00 reset, 01 set, 02 recall
+            int preset = pkt[5];
+            if (pkt[4] == 0x01) {
+                cam->presets[preset] = *st;
+                cam->presetValid[preset] = 1;
+            } else if (pkt[4] == 0x02) {
+                if (cam->presetValid[preset]) {
+                    queue_ack_and_completion(cam, fd, options.moveMS / 1000.0, preset, 0, 0, 0);
+                    return;
+                }
+            } else if (pkt[4] == 0x00) {
+                cam->presetValid[preset] = 0;
+            }
+            queue_ack_and_completion(cam, fd, 0, -1, 0, 0, 0);
+            return;
+        }
+        if (category == 0x06 && cmd == 0x02 && len == 15) {
+            // Absolute pan/tilt: 81 01 06 02 VV WW 0Y0Y0Y0Y 0Z0Z0Z0Z FF
+            int16_t pan = (int16_t)nibbles_to_int(pkt + 6, 4);
+            int16_t tilt = (int16_t)nibbles_to_int(pkt + 10, 4);
+            queue_ack_and_completion(cam, fd, options.moveMS / 1000.0, -1, 1, pan, tilt);
+            return;
+        }
+        if (category == 0x06 && cmd == 0x03 && len == 15) {
+            // Relative pan/tilt
+            int16_t pan = st->pan + (int16_t)nibbles_to_int(pkt + 6, 4);
+            int16_t tilt = st->tilt + (int16_t)nibbles_to_int(pkt + 10, 4);
+            queue_ack_and_completion(cam, fd, options.moveMS / 1000.0, -1, 1, pan, tilt);
+            return;
+        }
+        if (category == 0x06 && (cmd == 0x04 || cmd == 0x05)) {
+            // Home, reset
+            queue_ack_and_completion(cam, fd, options.moveMS / 1000.0, -1, 1, 0, 0);
+            return;
+        }
+        if (category == 0x04 && len == 9 && (pkt[4] & 0xF0) == 0 && (pkt[5] & 0xF0) == 0 && (pkt[6] & 0xF0) == 0 && (pkt[7] & 0xF0) == 0) {
+            // Direct value: 81 01 04 XX 0p 0q 0r 0s FF
+            st->regs[cmd] = (uint16_t)nibbles_to_int(pkt + 4, 4);
+            st->wide[cmd] = 1;
+        } else if (category == 0x04 && len == 6) {
+            // Mode or step: 81 01 04 XX pp FF
+            st->regs[cmd] = pkt[4];
+            st->wide[cmd] = 0;
+        }
+        // Everything else (drive, stop, OSD, ...) is accepted and ignored.
+        queue_ack_and_completion(cam, fd, 0, -1, 0, 0, 0);
+        return;
+    }
+    if (pkt[1] == 0x09 && len == 5) {
+        cam->inquiries++;
+        uint8_t category = pkt[2], cmd = pkt[3];
+        uint8_t payload[8];
+        if (category == 0x06 && cmd == 0x12) {
+            int_to_nibbles(st->pan, payload, 4);
+            int_to_nibbles(st->tilt, payload + 4, 4);
+            queue_inquiry_reply(cam, fd, payload, 8);
+        } else if (category == 0x00 && cmd == 0x02) {
+            // Version: vendor, model, ROM, socket count
+            uint8_t version[] = { 0x00, 0x01, 0x05, 0x11, 0x01, 0x00, 0x02 };
+            queue_inquiry_reply(cam, fd, version, sizeof(version));
+        } else if (category == 0x04 && st->wide[cmd]) {
+            int_to_nibbles(st->regs[cmd], payload, 4);
+            queue_inquiry_reply(cam, fd, payload, 4);
+        } else if (category == 0x04) {
+            payload[0] = (uint8_t)st->regs[cmd];
+            queue_inquiry_reply(cam, fd, payload, 1);
+        } else {
+            queue_error(cam, fd, 0x02);
+        }
+        return;
+    }
+    queue_error(cam, fd, 0x02);
+}
+
+// MARK: sockets
+
+static void close_client(sim_camera *cam, sim_client *client, const char *why)
+{
+    if (options.verbose) {
+        fprintf(stderr, "camera %d: closing client (%s)\n", cam->index, why);
+    }
+    close(client->fd);
+    // Forget anything still queued for this connection.
+    for (int i = 0; i < pendingCount; i++) {
+        if (pending[i].fd == client->fd && pending[i].camera == cam) {
+            pending[i].fd = -1;
+        }
+    }
+    client->fd = -1;
+    client->rxlen = 0;
+}
+
+static void read_client(sim_camera *cam, sim_client *client)
+{
+    uint8_t buf[1024];
+    ssize_t n = recv(client->fd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close_client(cam, client, n == 0 ? "eof" : strerror(errno));
+        return;
+    }
+    if (n < 0) {
+        return;
+    }
+    client->lastActivity = now_seconds();
+    for (ssize_t i = 0; i < n; i++) {
+        if (client->rxlen == MAX_PACKET) {
+            // Garbage; resync on the next terminator.
+            client->rxlen = 0;
+        }
+        client->rx[client->rxlen++] = buf[i];
+        if (buf[i] == 0xFF) {
+            handle_packet(cam, client, client->rx, client->rxlen);
+            client->rxlen = 0;
+        }
+    }
+}
+
+static void accept_client(sim_camera *cam)
+{
+    int fd = accept(cam->listenfd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (cam->clients[i].fd < 0) {
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            set_nonblocking(fd);
+            cam->clients[i].fd = fd;
+            cam->clients[i].rxlen = 0;
+            cam->clients[i].lastActivity = now_seconds();
+            return;
+        }
+    }
+    close(fd);
+}
+
+// Sends everything that's due and returns the time until the next pending reply, in ms (-1 if none).
+static int flush_pending(void)
+{
+    double now = now_seconds();
+    double next = -1;
+    int kept = 0;
+    for (int i = 0; i < pendingCount; i++) {
+        sim_pending *p = &pending[i];
+        if (p->due > now) {
+            if (next < 0 || p->due < next) {
+                next = p->due;
+            }
+            pending[kept++] = *p;
+            continue;
+        }
+        if (p->applyPreset >= 0) {
+            p->camera->state = p->camera->presets[p->applyPreset];
+        } else if (p->applyMove) {
+            p->camera->state.pan = p->movePan;
+            p->camera->state.tilt = p->moveTilt;
+        }
+        if (p->fd >= 0) {
+            send(p->fd, p->bytes, p->length, 0);
+        }
+    }
+    pendingCount = kept;
+    if (next < 0) {
+        return -1;
+    }
+    int ms = (int)((next - now) * 1000) + 1;
+    return ms > 0 ? ms : 0;
+}
+
+static int open_listener(const char *bindAddress, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress, &addr.sin_addr) != 1
+        || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --cameras N        simulated cameras, one port each (default 1)\n"
+            "  --port P           first port (default 5678)\n"
+            "  --bind ADDR        listen address (default 127.0.0.1)\n"
+            "  --latency-ms N     delay before each ACK or inquiry reply (default 20)\n"
+            "  --move-ms N        recall/absolute move time before completion (default 500)\n"
+            "  --drop-rate R      fraction of replies silently dropped, 0-1 (default 0)\n"
+            "  --idle-timeout S   hang up on clients idle for S seconds, like the cameras\n"
+            "                     reallyPingCamera probes for (default 0, never)\n"
+            "  --verbose          log every packet\n",
+            name);
+}
+
+int main(int argc, char *argv[])
+{
+    int cameraCount = 1;
+    int basePort = 5678;
+    const char *bindAddress = "127.0.0.1";
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--verbose")) {
+            options.verbose = 1;
+            continue;
+        }
+        if (value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (!strcmp(arg, "--cameras")) {
+            cameraCount = atoi(value);
+        } else if (!strcmp(arg, "--port")) {
+            basePort = atoi(value);
+        } else if (!strcmp(arg, "--bind")) {
+            bindAddress = value;
+        } else if (!strcmp(arg, "--latency-ms")) {
+            options.latencyMS = atoi(value);
+        } else if (!strcmp(arg, "--move-ms")) {
+            options.moveMS = atoi(value);
+        } else if (!strcmp(arg, "--drop-rate")) {
+            options.dropRate = atof(value);
+        } else if (!strcmp(arg, "--idle-timeout")) {
+            options.idleTimeout = atoi(value);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cameraCount < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sim_camera *cameras = calloc(cameraCount, sizeof(sim_camera));
+    struct pollfd *fds = calloc(cameraCount * (MAX_CLIENTS + 1), sizeof(struct pollfd));
+    if (cameras == NULL || fds == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int c = 0; c < cameraCount; c++) {
+        sim_camera *cam = &cameras[c];
+        cam->index = c + 1;
+        seed_defaults(&cam->state);
+        cam->listenfd = open_listener(bindAddress, basePort + c);
+        if (cam->listenfd < 0) {
+            fprintf(stderr, "unable to listen on %s:%d: %s\n", bindAddress, basePort + c, strerror(errno));
+            return 1;
+        }
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            cam->clients[i].fd = -1;
+        }
+    }
+    fprintf(stderr, "visca_sim: %d camera(s) on %s:%d-%d\n", cameraCount, bindAddress, basePort, basePort + cameraCount - 1);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    srand((unsigned)time(NULL));
+
+    while (!quitting) {
+        int timeout = flush_pending();
+        if (options.idleTimeout > 0 && (timeout < 0 || timeout > 1000)) {
+            timeout = 1000;
+        }
+        int nfds = 0;
+        for (int c = 0; c < cameraCount; c++) {
+            fds[nfds].fd = cameras[c].listenfd;
+            fds[nfds++].events = POLLIN;
+            for (int i = 0; i < MAX_CLIENTS; i++) {
+                fds[nfds].fd = cameras[c].clients[i].fd;
+                fds[nfds++].events = POLLIN;
+            }
+        }
+        if (poll(fds, nfds, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        double now = now_seconds();
+        int f = 0;
+        for (int c = 0; c < cameraCount; c++) {
+            sim_camera *cam = &cameras[c];
+            if (fds[f++].revents & POLLIN) {
+                accept_client(cam);
+            }
+            for (int i = 0; i < MAX_CLIENTS; i++, f++) {
+                sim_client *client = &cam->clients[i];
+                if (client->fd < 0) {
+                    continue;
+                }
+                if (fds[f].fd == client->fd && (fds[f].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    read_client(cam, client);
+                } else if (options.idleTimeout > 0 && now - client->lastActivity > options.idleTimeout) {
+                    close_client(cam, client, "idle");
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < cameraCount; c++) {
+        fprintf(stderr, "camera %d: %lu commands, %lu inquiries, %lu replies dropped\n",
+                cameras[c].index, cameras[c].commands, cameras[c].inquiries, cameras[c].dropped);
+    }
+    return 0;
+}
@@ -0,0 +1,267 @@
+//
+//  visibility_bench.cpp
+//  PTZ Scene Manager
+//
+// Working out which cameras are showing in big scenes, the old way and with
+// obsvisibility::Scene.
+//
+// The old way is visibleSourceItemNames: as it was, ported to C++: every GetSceneItemList
+// reply went through every item again, unioning each camera into a pixman region and then
+// subtracting that from the whole canvas to see if anything was left. The new way keeps the
+// scene and picks the walk up from whichever item a SceneItemTransformChanged or
+// SceneItemEnableStateChanged event is about, and asks obscoverage instead of pixman.
+//
+// Each scene gets a run of random edits: small moves like dragging an item in OBS, and items
+// being hidden and shown. After every edit both ways have to agree on the answer; the times are
+// per edit. (The old way also waited for a GetSceneItemList round trip per change, which isn't
+// counted here.)
+//
+// Build: S="../../PTZ Scene Manager"
+//        cc -O2 -c -I"$S/regions" "$S/regions/pixman-region32.c" "$S/regions/pixman-utils.c"
+//        c++ -std=c++17 -O2 -Wall -Wextra -I"$S" -I"$S/regions" -o visibility_bench visibility_bench.cpp "$S/obsvisibility.cpp" "$S/obscoverage.cpp" "$S/obsmessage.cpp" pixman-region32.o pixman-utils.o
+// Run:   ./visibility_bench [edits]
+
+#include "obsvisibility.hpp"
+#include "pixman.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using obsvisibility::Item;
+
+static const double CanvasWidth = 1920, CanvasHeight = 1080;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// MARK: - The old way
+
+struct CGRectish {
+    double x, y, width, height;
+};
+
+// NSIntegralRect
+static CGRectish integral(CGRectish r)
+{
+    if (r.width <= 0 || r.height <= 0) {
+        return { 0, 0, 0, 0 };
+    }
+    double left = floor(r.x), top = floor(r.y);
+    return { left, top, ceil(r.x + r.width) - left, ceil(r.y + r.height) - top };
+}
+
+// adjustRect:forAlignment:
+static CGRectish adjustRect(CGRectish rect, int alignment)
+{
+    const int left = 1, right = 2, top = 4, bottom = 8;
+    switch (alignment) {
+        case top: rect.x -= rect.width / 2.0; break;
+        case right | top: rect.x -= rect.width; break;
+        case left: rect.y -= rect.height / 2.0; break;
+        case 0: rect.x -= rect.width / 2.0; rect.y -= rect.height / 2.0; break;
+        case right: rect.x -= rect.width; rect.y -= rect.height / 2.0; break;
+        case left | bottom: rect.y -= rect.height; break;
+        case right | bottom: rect.x -= rect.width; rect.y -= rect.height; break;
+    }
+    return rect;
+}
+
+static std::vector<std::string> oldVisibleSources(const std::vector<Item>& items, const std::vector<std::string>& cameras)
+{
+    std::vector<std::string> names;
+    pixman_region32_t region, screenRegion, diffRegion;
+    pixman_region32_init(&region);
+    pixman_region32_init(&diffRegion);
+    pixman_region32_init_rect(&screenRegion, 0, 0, CanvasWidth, CanvasHeight);
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+        const Item& item = *it;
+        bool known = false;
+        for (const std::string& camera : cameras) {
+            known = known || camera == item.sourceName;
+        }
+        if (!known || !item.enabled) {
+            continue;
+        }
+        const obsmessage::SceneItemTransform& t = item.transform;
+        bool doesFill = true;
+        double width = t.width ? t.width : CanvasWidth;
+        double height = t.height ? t.height : CanvasHeight;
+        if (height > 0 && width > 0) {
+            double sourceWidth = t.sourceWidth ? t.sourceWidth : CanvasWidth;
+            double sourceHeight = t.sourceHeight ? t.sourceHeight : CanvasHeight;
+            CGRectish testRect;
+            if (t.boundsType == "OBS_BOUNDS_NONE") {
+                testRect = { t.positionX, t.positionY, width, height };
+            } else {
+                testRect = { t.positionX, t.positionY, t.boundsWidth, t.boundsHeight };
+            }
+            testRect = adjustRect(testRect, t.alignment);
+            testRect.width -= t.cropLeft + t.cropRight;
+            testRect.height -= t.cropTop + t.cropBottom;
+            testRect = integral(testRect);
+            double testHeight = std::min(sourceHeight, testRect.height);
+            double testWidth = std::min(sourceWidth, testRect.width);
+            doesFill = testRect.x == 0 && testRect.y == 0 && fabs(sourceHeight - testHeight) <= 1 && fabs(sourceWidth - testWidth) <= 1;
+            if (!doesFill) {
+                pixman_region32_union_rect(&region, &region, testRect.x, testRect.y, testRect.width, testRect.height);
+                pixman_region32_subtract(&diffRegion, &screenRegion, &region);
+                if (pixman_region32_n_rects(&diffRegion) == 0) {
+                    doesFill = true;
+                }
+            }
+        }
+        names.push_back(item.sourceName);
+        if (doesFill) {
+            break;
+        }
+    }
+    pixman_region32_fini(&diffRegion);
+    pixman_region32_fini(&region);
+    pixman_region32_fini(&screenRegion);
+    return names;
+}
+
+// MARK: - Scenes
+
+struct Layout {
+    const char *name;
+    std::vector<Item> items;
+    std::vector<std::string> cameras;
+};
+
+static Item makeItem(int64_t id, const std::string& name, double x, double y, double w, double h)
+{
+    Item item;
+    item.sceneItemId = id;
+    item.sourceName = name;
+    item.enabled = true;
+    obsmessage::SceneItemTransform& t = item.transform;
+    t.positionX = x;
+    t.positionY = y;
+    t.width = w;
+    t.height = h;
+    // Scaled-down 1080p sources, so nothing "fills" by accident.
+    t.sourceWidth = CanvasWidth * 2;
+    t.sourceHeight = CanvasHeight * 2;
+    t.alignment = 5; // top left
+    t.boundsType = "OBS_BOUNDS_NONE";
+    return item;
+}
+
+// A multiview wall: a grid of cameras that covers the canvas only once the last tile is in.
+static Layout wall(size_t count)
+{
+    Layout layout { "camera wall", {}, {} };
+    size_t columns = (size_t)ceil(sqrt((double)count * CanvasWidth / CanvasHeight));
+    size_t rows = (count + columns - 1) / columns;
+    double h = CanvasHeight / rows;
+    for (size_t i = 0; i < count; i++) {
+        std::string name = "Camera " + std::to_string(i);
+        layout.cameras.push_back(name);
+        // Stretch the last row's tiles so the grid still covers everything.
+        size_t row = i / columns, column = i % columns;
+        size_t inRow = row == rows - 1 ? count - row * columns : columns;
+        double tileWidth = CanvasWidth / inRow;
+        layout.items.push_back(makeItem((int64_t)i + 1, name, floor(column * tileWidth), floor(row * h), ceil(tileWidth) + 1, ceil(h) + 1));
+    }
+    return layout;
+}
+
+// A full-screen camera at the bottom with picture-in-picture cameras scattered over it.
+static Layout pictureInPicture(size_t count, std::mt19937& rng)
+{
+    Layout layout { "picture in picture", {}, {} };
+    std::uniform_real_distribution<double> x(0, CanvasWidth - 200), y(0, CanvasHeight - 120), size(80, 400);
+    layout.cameras.push_back("Wide");
+    layout.items.push_back(makeItem(1, "Wide", 0, 0, CanvasWidth, CanvasHeight));
+    for (size_t i = 1; i < count; i++) {
+        std::string name = "Camera " + std::to_string(i);
+        layout.cameras.push_back(name);
+        double w = size(rng);
+        layout.items.push_back(makeItem((int64_t)i + 1, name, x(rng), y(rng), w, w * 9 / 16));
+    }
+    return layout;
+}
+
+// Mostly overlays and graphics, with a camera every so often.
+static Layout mixed(size_t count, std::mt19937& rng)
+{
+    Layout layout { "mostly graphics", {}, {} };
+    std::uniform_real_distribution<double> x(-100, CanvasWidth), y(-100, CanvasHeight), size(50, 900);
+    for (size_t i = 0; i < count; i++) {
+        bool camera = i % 10 == 0;
+        std::string name = (camera ? "Camera " : "Overlay ") + std::to_string(i);
+        if (camera) {
+            layout.cameras.push_back(name);
+        }
+        layout.items.push_back(makeItem((int64_t)i + 1, name, x(rng), y(rng), size(rng), size(rng)));
+    }
+    return layout;
+}
+
+// MARK: - Main
+
+int main(int argc, char *argv[])
+{
+    int edits = argc > 1 ? atoi(argv[1]) : 2000;
+    if (edits <= 0) {
+        fprintf(stderr, "usage: %s [edits]\n", argv[0]);
+        return 1;
+    }
+    std::mt19937 rng(7);
+    printf("%-20s %6s %14s %14s %14s %9s\n", "scene", "items", "old us/edit", "new us/edit", "setItems us", "speedup");
+    for (size_t count : { 200, 500 }) {
+        std::vector<Layout> layouts = { wall(count), pictureInPicture(count, rng), mixed(count, rng) };
+        for (Layout& layout : layouts) {
+            obsvisibility::Model model;
+            model.setCanvasSize(CanvasWidth, CanvasHeight);
+            model.setCameras(layout.cameras);
+
+            double start = now();
+            const int loads = 20;
+            for (int i = 0; i < loads; i++) {
+                model.setItems("Scene", layout.items).visibleSources();
+            }
+            double setItems = (now() - start) / loads;
+            obsvisibility::Scene& scene = *model.scene("Scene");
+
+            std::vector<Item>& items = layout.items;
+            std::uniform_int_distribution<size_t> pick(0, items.size() - 1);
+            std::uniform_real_distribution<double> nudge(-40, 40);
+            double oldTime = 0, newTime = 0;
+            for (int e = 0; e < edits; e++) {
+                Item& item = items[pick(rng)];
+                bool toggle = rng() % 8 == 0;
+                if (toggle) {
+                    item.enabled = !item.enabled;
+                } else {
+                    item.transform.positionX += nudge(rng);
+                    item.transform.positionY += nudge(rng);
+                }
+
+                double t = now();
+                std::vector<std::string> expected = oldVisibleSources(items, layout.cameras);
+                oldTime += now() - t;
+
+                t = now();
+                bool found = toggle ? scene.setEnabled(item.sceneItemId, item.enabled) : scene.setTransform(item.sceneItemId, item.transform);
+                const std::vector<std::string>& visible = scene.visibleSources();
+                newTime += now() - t;
+
+                if (!found || visible != expected) {
+                    fprintf(stderr, "%s, %zu items: edit %d: %zu sources showing, expected %zu\n", layout.name, count, e, visible.size(), expected.size());
+                    return 1;
+                }
+            }
+            printf("%-20s %6zu %14.2f %14.2f %14.2f %8.1fx\n", layout.name, count, oldTime * 1e6 / edits, newTime * 1e6 / edits, setItems * 1e6, oldTime / newTime);
+        }
+    }
+    return 0;
+}